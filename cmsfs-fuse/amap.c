@@ -10,9 +10,11 @@
  */
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -23,26 +25,27 @@
 #include "helper.h"
 
 /*
- * Hint where to look for the next free block (level 0 only).
- * Updated if a free block is found. If the level 0 amap bitmap
- * block is exhausted we still scan all amap blocks.
+ * Free blocks of the allocation map as extents of block numbers in
+ * ascending order. The extents are built from the bitmap with the first
+ * allocation. Afterwards a free block is taken from the first extent
+ * without scanning the bitmap, which is only updated.
  */
-struct amap_alloction_hint {
-	/* addr of amap bitmap block to check */
-	off_t amap_addr;
-	/* disk addr of the last allocated or freed block */
-	off_t addr;
-	/* offset to start of the amap data block */
-	off_t offset;
+struct amap_extent {
+	/* first free block number */
+	unsigned int start;
+	/* number of free blocks */
+	unsigned int len;
 };
 
-static struct amap_alloction_hint amap_hint;
+static struct amap_extent *amap_ext;
+/* valid extents are amap_ext[amap_ext_first] to amap_ext[amap_ext_used - 1] */
+static int amap_ext_first;
+static int amap_ext_used;
+static int amap_ext_max;
+static int amap_ext_valid;
 
-static void update_amap_hint(off_t amap_addr, off_t addr)
-{
-	amap_hint.amap_addr = amap_addr;
-	amap_hint.addr = addr;
-}
+/* protects the allocation map, the free extents and the used blocks counter */
+static pthread_mutex_t amap_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /*
  * Get L1 block number from address.
@@ -85,14 +88,34 @@ static off_t get_amap_addr(int level, off_t addr, off_t ptr)
 	return ptr;
 }
 
+/*
+ * Return address of the alloc map byte for a disk address and the bit
+ * within that byte. Unaligned addr is tolerated.
+ */
+static off_t amap_entry_addr(off_t addr, unsigned int *bit)
+{
+	off_t amap = get_amap_addr(cmsfs.amap_levels, addr, cmsfs.amap);
+	int block = amap_blocknumber(addr);
+
+	if (block > 0)
+		addr -= (off_t) block * BYTES_PER_BLOCK;
+
+	addr >>= BITS_PER_DATA_BLOCK;
+	*bit = addr % 8;
+	return amap + addr / 8;
+}
+
 /*
  * Mark disk address as allocated in alloc map.
  */
-static void amap_block_set(off_t amap, int bit)
+static void amap_block_set(off_t addr)
 {
+	unsigned int bit;
+	off_t amap;
 	u8 entry;
 	int rc;
 
+	amap = amap_entry_addr(addr, &bit);
 	rc = _read(&entry, sizeof(entry), amap);
 	BUG(rc < 0);
 
@@ -109,139 +132,129 @@ static void amap_block_set(off_t amap, int bit)
  */
 static void amap_block_clear(off_t addr)
 {
-	off_t amap = get_amap_addr(cmsfs.amap_levels, addr, cmsfs.amap);
-	int rc, block = amap_blocknumber(addr);
-	off_t disk_addr = addr;
-	unsigned int byte, bit;
+	unsigned int bit;
+	off_t amap;
 	u8 entry;
+	int rc;
 
-	if (block > 0)
-		addr -= (off_t) block * BYTES_PER_BLOCK;
-
-	addr >>= BITS_PER_DATA_BLOCK;
-	byte = addr / 8;
-	bit = addr % 8;
-
-	rc = _read(&entry, sizeof(entry), amap + byte);
+	amap = amap_entry_addr(addr, &bit);
+	rc = _read(&entry, sizeof(entry), amap);
 	BUG(rc < 0);
 
 	/* already cleared */
 	BUG(!(entry & (1 << (7 - bit))));
 
 	entry &= ~(1 << (7 - bit));
-	rc = _write(&entry, sizeof(entry), amap + byte);
+	rc = _write(&entry, sizeof(entry), amap);
 	BUG(rc < 0);
-
-	/*
-	 * If the freed addr is lower set the hint to it to ensure
-	 * the amap bitmap is packed from the start. That way we do not
-	 * need an extra check if the bitmap entry is above disk end, the
-	 * check if we overflow the total block limit is sufficient.
-	 */
-	if (disk_addr < amap_hint.addr)
-		update_amap_hint(amap + byte, disk_addr);
 }
 
 /*
- * Return the first free bit in one byte.
+ * Insert a free extent before amap_ext[pos].
  */
-static inline int find_first_empty_bit(u8 entry)
+static void amap_ext_insert(int pos, unsigned int start, unsigned int len)
 {
-	u8 i;
-
-	for (i = 0; i < 8; i++)
-		if (!(entry & 1 << (7 - i)))
-			return i;
-	/* unreachable */
-	return -1;
+	if (pos == amap_ext_first && amap_ext_first > 0) {
+		pos = --amap_ext_first;
+	} else {
+		if (amap_ext_used == amap_ext_max) {
+			amap_ext_max = amap_ext_max ? amap_ext_max * 2 : 64;
+			amap_ext = realloc(amap_ext,
+					   amap_ext_max * sizeof(*amap_ext));
+			if (amap_ext == NULL)
+				DIE_PERROR("realloc failed");
+		}
+		memmove(&amap_ext[pos + 1], &amap_ext[pos],
+			(amap_ext_used - pos) * sizeof(*amap_ext));
+		amap_ext_used++;
+	}
+	amap_ext[pos].start = start;
+	amap_ext[pos].len = len;
 }
 
 /*
- * Return the number of bytes addressed by one pointer entry for the
- * specified level.
+ * Add a free block to the extents, merging it with adjacent extents.
  */
-static off_t bytes_per_level(int level)
-{
-	off_t mult = BYTES_PER_BLOCK;
-
-	if (!level)
-		return 0;
-	level--;
-	while (level--)
-		mult *= PTRS_PER_BLOCK;
-	return mult;
-}
-
-static inline int get_amap_entry_bit(off_t amap)
+static void amap_ext_add(unsigned int block)
 {
-	u8 entry;
-	int rc;
-
-	rc = _read(&entry, sizeof(entry), amap);
-	BUG(rc < 0);
-
-	if (entry == 0xff)
-		return -1;
-	return find_first_empty_bit(entry);
-}
-
-static off_t __get_free_block_fast(void)
-{
-	off_t addr, amap = amap_hint.amap_addr & ~DATA_BLOCK_MASK;
-	int bit, i = amap_hint.amap_addr & DATA_BLOCK_MASK;
-
-	for (; i < cmsfs.blksize; i++) {
-		bit = get_amap_entry_bit(amap + i);
-		if (bit == -1)
-			continue;
-
-		/* Calculate the addr for the free block we've found. */
-		addr = (off_t) amap_blocknumber(amap_hint.addr) * BYTES_PER_BLOCK;
-		addr += i * 8 * cmsfs.blksize;
-		addr += bit * cmsfs.blksize;
-
-		amap_block_set(amap + i, bit);
-		update_amap_hint(amap + i, addr);
-		return addr;
+	int lo = amap_ext_first, hi = amap_ext_used, mid;
+	struct amap_extent *prev = NULL, *next = NULL;
+
+	/* find the first extent behind the block */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (amap_ext[mid].start > block)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	if (lo > amap_ext_first) {
+		prev = &amap_ext[lo - 1];
+		/* already free */
+		BUG(block < prev->start + prev->len);
+		if (prev->start + prev->len != block)
+			prev = NULL;
+	}
+	if (lo < amap_ext_used && amap_ext[lo].start == block + 1)
+		next = &amap_ext[lo];
+
+	if (prev && next) {
+		prev->len += next->len + 1;
+		memmove(next, next + 1,
+			(amap_ext_used - lo - 1) * sizeof(*amap_ext));
+		amap_ext_used--;
+	} else if (prev) {
+		prev->len++;
+	} else if (next) {
+		next->start--;
+		next->len++;
+	} else {
+		amap_ext_insert(lo, block, 1);
 	}
-	return 0;
 }
 
 /*
- * Look for the first unallocated block and return addr of allocated block.
+ * Build the free extents from the alloc map bitmap, one bitmap block
+ * at a time. Blocks behind the end of the disk are not added.
  */
-static off_t __get_free_block(int level, off_t amap, off_t addr)
+static void amap_ext_build(void)
 {
-	off_t ptr;
-	int bit, i;
-
-	if (level > 0) {
-		for (i = 0; i < PTRS_PER_BLOCK; i++) {
-			ptr = get_fixed_pointer(amap);
-			if (!ptr)
-				return 0;
-			ptr = __get_free_block(level - 1, ptr,
-				addr + i * bytes_per_level(level));
-			if (ptr)
-				return ptr;
-			amap += PTR_SIZE;
+	unsigned int block = 0, start = 0, len = 0;
+	off_t addr, amap;
+	u8 *buf, entry;
+	int i, bit, rc;
+
+	buf = malloc(cmsfs.blksize);
+	if (buf == NULL)
+		DIE_PERROR("malloc failed");
+
+	for (addr = 0; block < (unsigned int) cmsfs.total_blocks;
+	     addr += BYTES_PER_BLOCK) {
+		amap = get_amap_addr(cmsfs.amap_levels, addr, cmsfs.amap);
+		rc = _read(buf, cmsfs.blksize, amap);
+		BUG(rc < 0);
+
+		for (i = 0; i < cmsfs.blksize &&
+		     block < (unsigned int) cmsfs.total_blocks; i++) {
+			entry = buf[i];
+			for (bit = 0; bit < 8 &&
+			     block < (unsigned int) cmsfs.total_blocks;
+			     bit++, block++) {
+				if (entry & (1 << (7 - bit))) {
+					if (len)
+						amap_ext_insert(amap_ext_used,
+								start, len);
+					len = 0;
+				} else if (len++ == 0) {
+					start = block;
+				}
+			}
 		}
-		return 0;
 	}
-
-	for (i = 0; i < cmsfs.blksize; i++) {
-		bit = get_amap_entry_bit(amap + i);
-		if (bit == -1)
-			continue;
-		amap_block_set(amap + i, bit);
-		/* add byte offset */
-		addr += i * 8 * cmsfs.blksize;
-		/* add bit offset */
-		addr += bit * cmsfs.blksize;
-		update_amap_hint(amap + i, addr);
-		return addr;
-	}
-	return 0;
+	if (len)
+		amap_ext_insert(amap_ext_used, start, len);
+	free(buf);
+	amap_ext_valid = 1;
 }
 
 /*
@@ -249,17 +262,30 @@ static off_t __get_free_block(int level, off_t amap, off_t addr)
  */
 off_t get_free_block(void)
 {
-	off_t addr = 0;
+	struct amap_extent *ext;
+	off_t addr;
 
-	if (cmsfs.used_blocks + cmsfs.reserved_blocks >= cmsfs.total_blocks)
+	pthread_mutex_lock(&amap_lock);
+	if (cmsfs.used_blocks + cmsfs.reserved_blocks >= cmsfs.total_blocks) {
+		pthread_mutex_unlock(&amap_lock);
 		return -ENOSPC;
-	if (amap_hint.amap_addr)
-		addr = __get_free_block_fast();
-	if (!addr)
-		addr = __get_free_block(cmsfs.amap_levels, cmsfs.amap, 0);
-	BUG(!addr);
-
+	}
+	if (!amap_ext_valid)
+		amap_ext_build();
+	BUG(amap_ext_first == amap_ext_used);
+
+	/* the lowest free block keeps the disk packed from the start */
+	ext = &amap_ext[amap_ext_first];
+	addr = (off_t) ext->start << BITS_PER_DATA_BLOCK;
+	ext->start++;
+	if (--ext->len == 0)
+		amap_ext_first++;
+	if (amap_ext_first == amap_ext_used)
+		amap_ext_first = amap_ext_used = 0;
+
+	amap_block_set(addr);
 	cmsfs.used_blocks++;
+	pthread_mutex_unlock(&amap_lock);
 	return addr;
 }
 
@@ -286,7 +312,12 @@ off_t get_zero_block(void)
 void free_block(off_t addr)
 {
 	if (addr) {
+		pthread_mutex_lock(&amap_lock);
+		if (!amap_ext_valid)
+			amap_ext_build();
 		amap_block_clear(addr);
+		amap_ext_add(addr >> BITS_PER_DATA_BLOCK);
 		cmsfs.used_blocks--;
+		pthread_mutex_unlock(&amap_lock);
 	}
 }
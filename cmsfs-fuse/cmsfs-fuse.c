@@ -23,6 +23,7 @@
 #include <linux/xattr.h>
 #endif
 #include <math.h>
+#include <pthread.h>
 #include <search.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -34,6 +35,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "lib/util_base.h"
@@ -51,6 +53,24 @@ static struct util_list open_file_list;
 static struct util_list text_type_list;
 FILE *logfile;
 
+/*
+ * Locking:
+ *
+ * meta_lock protects the directory, the FST entries, the allocation map and
+ * the cached data of open files. It is held for reading by operations that
+ * only read from the disk and for writing by all modifying operations.
+ * open_lock protects open_file_list and the open counters of the file
+ * objects, fcache_lock the FST address hash table. The record hint and the
+ * conversion buffers of a file object are protected by the file lock.
+ * bcache_lock protects the block cache.
+ *
+ * Lock order: meta_lock, file lock, open_lock, fcache_lock, bcache_lock
+ */
+static pthread_rwlock_t meta_lock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_mutex_t open_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t fcache_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t bcache_lock = PTHREAD_MUTEX_INITIALIZER;
+
 #define FSNAME_MAX_LEN	200
 #define MAX_FNAME	18
 
@@ -97,6 +117,9 @@ static void usage(const char *progname)
 static char CODEPAGE_EDF[] = "CP1047";
 static char CODEPAGE_LINUX[] = "ISO-8859-1";
 
+static unsigned char xlat_from_table[256];
+static unsigned char xlat_to_table[256];
+
 #define READDIR_FILE_ENTRY	-1
 #define READDIR_END_OF_DIR	-2
 #define READDIR_DIR_ENTRY	-3
@@ -179,6 +202,8 @@ static struct file_operations fops_variable;
 struct io_operations {
 	int (*read) (void *buf, size_t size, off_t addr);
 	int (*write) (const void *buf, size_t size, off_t addr);
+	/* write back cached blocks to the disk */
+	int (*flush) (void);
 };
 
 static struct io_operations io_ops;
@@ -254,6 +279,10 @@ struct file {
 	int		write_count;
 	/* unlink flag */
 	int		unlinked;
+	/* serializes reads of the file */
+	pthread_mutex_t	lock;
+	/* code page conversion for reads, iconv_t is not thread-safe */
+	iconv_t		iconv_from;
 };
 
 struct xattr {
@@ -319,6 +348,61 @@ static void setup_iconv(iconv_t *conv, const char *from, const char *to)
 			from, to);
 }
 
+/*
+ * Fill a translation table with the conversion of all 256 byte values.
+ * Return 0 if each byte value converts to exactly one byte, which is the
+ * case for single byte code pages like CP1047 and ISO-8859-1.
+ */
+static int setup_xlat(iconv_t conv, unsigned char *table)
+{
+	size_t in_count, out_count, rc;
+	char in, out, *in_p, *out_p;
+	int i;
+
+	for (i = 0; i < 256; i++) {
+		in = i;
+		in_p = &in;
+		out_p = &out;
+		in_count = out_count = 1;
+		rc = iconv(conv, &in_p, &in_count, &out_p, &out_count);
+		if (rc == (size_t) -1 || in_count || out_count)
+			break;
+		table[i] = out;
+	}
+	/* reset conversion state */
+	iconv(conv, NULL, NULL, NULL, NULL);
+	return (i < 256) ? -1 : 0;
+}
+
+/*
+ * Use translation tables instead of iconv for single byte code pages.
+ * Reads copy the record data and EBCDIC linefeeds into the FUSE buffer and
+ * translate the whole buffer at once, so null blocks and linefeeds must be
+ * translated to their ASCII value.
+ */
+static void setup_xlat_tables(void)
+{
+	if (setup_xlat(cmsfs.iconv_from, xlat_from_table) == 0 &&
+	    xlat_from_table[0] == 0 &&
+	    xlat_from_table[LINEFEED_EBCDIC] == LINEFEED_ASCII)
+		cmsfs.xlat_from = xlat_from_table;
+	if (setup_xlat(cmsfs.iconv_to, xlat_to_table) == 0)
+		cmsfs.xlat_to = xlat_to_table;
+	DEBUG("translation tables: from: %d  to: %d\n",
+	      cmsfs.xlat_from != NULL, cmsfs.xlat_to != NULL);
+}
+
+static inline void xlat(const unsigned char *table, const char *in_buf,
+			char *out_buf, size_t size)
+{
+	const unsigned char *in = (const unsigned char *) in_buf;
+	unsigned char *out = (unsigned char *) out_buf;
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		out[i] = table[in[i]];
+}
+
 static inline struct file *get_fobj(struct fuse_file_info *fi)
 {
 	return (struct file *)(unsigned long) fi->fh;
@@ -390,6 +474,163 @@ static int write_memory(const void *buf, size_t size, off_t addr)
 	return 0;
 }
 
+static int flush_none(void)
+{
+	return 0;
+}
+
+/*
+ * Block cache for pread/pwrite disk I/O
+ *
+ * Without a mapping of the disk each metadata update would be a separate
+ * pwrite of a few bytes. Written blocks are therefore kept in the cache
+ * and written back in disk order if the cache is full, on fsync, after
+ * a file was written and on unmount. Reads are served from the cache if
+ * the block is dirty.
+ */
+#define BCACHE_MAX_BLOCKS	1024
+#define BCACHE_HASH_SIZE	256
+
+struct bcache_entry {
+	/* disk address of the block */
+	off_t			addr;
+	/* hash chain */
+	struct bcache_entry	*next;
+	char			data[];
+};
+
+static struct bcache_entry *bcache_hash[BCACHE_HASH_SIZE];
+static int bcache_used;
+
+static struct bcache_entry **bcache_slot(off_t addr)
+{
+	return &bcache_hash[(addr >> BITS_PER_DATA_BLOCK) % BCACHE_HASH_SIZE];
+}
+
+static struct bcache_entry *bcache_lookup(off_t addr)
+{
+	struct bcache_entry *e;
+
+	for (e = *bcache_slot(addr); e != NULL; e = e->next)
+		if (e->addr == addr)
+			return e;
+	return NULL;
+}
+
+static int bcache_cmp(const void *a, const void *b)
+{
+	const struct bcache_entry *ea = *(struct bcache_entry **) a;
+	const struct bcache_entry *eb = *(struct bcache_entry **) b;
+
+	return (ea->addr > eb->addr) - (ea->addr < eb->addr);
+}
+
+/*
+ * Write all cached blocks in disk order. Adjacent blocks are written
+ * with one system call. If a write fails all blocks stay cached.
+ */
+static int __bcache_flush(void)
+{
+	struct bcache_entry *list[BCACHE_MAX_BLOCKS], *e;
+	struct iovec iov[BCACHE_MAX_BLOCKS];
+	int i, j, n = 0;
+	ssize_t len;
+
+	for (i = 0; i < BCACHE_HASH_SIZE; i++)
+		for (e = bcache_hash[i]; e != NULL; e = e->next)
+			list[n++] = e;
+	qsort(list, n, sizeof(list[0]), bcache_cmp);
+
+	for (i = 0; i < n; i = j) {
+		for (j = i; j < n && j - i < IOV_MAX; j++) {
+			if (list[j]->addr != list[i]->addr +
+			    (off_t) (j - i) * cmsfs.blksize)
+				break;
+			iov[j - i].iov_base = list[j]->data;
+			iov[j - i].iov_len = cmsfs.blksize;
+		}
+		len = pwritev(cmsfs.fd, iov, j - i, list[i]->addr);
+		if (len != (ssize_t) (j - i) * cmsfs.blksize) {
+			perror("pwritev failed");
+			return -EIO;
+		}
+	}
+
+	for (i = 0; i < n; i++)
+		free(list[i]);
+	memset(bcache_hash, 0, sizeof(bcache_hash));
+	bcache_used = 0;
+	return 0;
+}
+
+static int flush_cached(void)
+{
+	int rc;
+
+	pthread_mutex_lock(&bcache_lock);
+	rc = __bcache_flush();
+	pthread_mutex_unlock(&bcache_lock);
+	return rc;
+}
+
+static int read_cached(void *buf, size_t size, off_t addr)
+{
+	struct bcache_entry *e;
+
+	pthread_mutex_lock(&bcache_lock);
+	e = bcache_lookup(addr & ~DATA_BLOCK_MASK);
+	if (e != NULL) {
+		memcpy(buf, e->data + (addr & DATA_BLOCK_MASK), size);
+		pthread_mutex_unlock(&bcache_lock);
+		return size;
+	}
+	pthread_mutex_unlock(&bcache_lock);
+	return read_syscall(buf, size, addr);
+}
+
+static int write_cached(const void *buf, size_t size, off_t addr)
+{
+	off_t block = addr & ~DATA_BLOCK_MASK;
+	struct bcache_entry *e;
+	int rc = size;
+
+	pthread_mutex_lock(&bcache_lock);
+	e = bcache_lookup(block);
+	if (e == NULL) {
+		if (bcache_used == BCACHE_MAX_BLOCKS) {
+			rc = __bcache_flush();
+			if (rc < 0)
+				goto out;
+		}
+		e = malloc(sizeof(*e) + cmsfs.blksize);
+		if (e == NULL) {
+			rc = -ENOMEM;
+			goto out;
+		}
+		/* a partially written block must be read first */
+		if (size != (size_t) cmsfs.blksize &&
+		    pread(cmsfs.fd, e->data, cmsfs.blksize, block) !=
+		    cmsfs.blksize) {
+			perror("pread failed");
+			free(e);
+			rc = -EIO;
+			goto out;
+		}
+		e->addr = block;
+		e->next = *bcache_slot(block);
+		*bcache_slot(block) = e;
+		bcache_used++;
+	}
+	if (buf == NULL)
+		memset(e->data + (addr & DATA_BLOCK_MASK), 0, size);
+	else
+		memcpy(e->data + (addr & DATA_BLOCK_MASK), buf, size);
+	rc = size;
+out:
+	pthread_mutex_unlock(&bcache_lock);
+	return rc;
+}
+
 int _write(const void *buf, size_t size, off_t addr)
 {
 	if (!access_ok(size, addr))
@@ -406,11 +647,20 @@ int _zero(off_t addr, size_t size)
 static off_t get_filled_block(void)
 {
 	off_t addr = get_free_block();
+	char *buf;
+	int rc;
 
 	if (addr < 0)
 		return -ENOSPC;
 
-	memset(cmsfs.map + addr, FILLER_EBCDIC, cmsfs.blksize);
+	buf = malloc(cmsfs.blksize);
+	if (buf == NULL)
+		return -ENOMEM;
+	memset(buf, FILLER_EBCDIC, cmsfs.blksize);
+	rc = _write(buf, cmsfs.blksize, addr);
+	free(buf);
+	if (rc < 0)
+		return rc;
 	return addr;
 }
 
@@ -598,7 +848,8 @@ static int set_fst_date_current(struct fst_entry *fst)
 }
 
 /*
- * Check if the file is on the opened list.
+ * Check if the file is on the opened list. The caller must hold open_lock
+ * or meta_lock for writing.
  */
 static struct file *file_open(const char *name)
 {
@@ -619,12 +870,14 @@ static struct file *file_open(const char *name)
  */
 static int file_unlinked(const char *name)
 {
-	struct file *f = file_open(name);
+	struct file *f;
+	int rc;
 
-	if (f && f->unlinked)
-		return 1;
-	else
-		return 0;
+	pthread_mutex_lock(&open_lock);
+	f = file_open(name);
+	rc = f && f->unlinked;
+	pthread_mutex_unlock(&open_lock);
+	return rc;
 }
 
 /*
@@ -1396,6 +1649,7 @@ static void cache_fst_addr(off_t addr, const char *file)
 
 	e.key = strdup(file);
 
+	pthread_mutex_lock(&fcache_lock);
 again:
 	if (hsearch_r(e, FIND, &eptr, &cmsfs.htab) == 0) {
 		/* cache it */
@@ -1415,6 +1669,7 @@ again:
 			DIE("hsearch: hash table full\n");
 	} else
 		free(e.key);
+	pthread_mutex_unlock(&fcache_lock);
 }
 
 static void update_htab_entry(off_t addr, const char *file)
@@ -1424,10 +1679,10 @@ static void update_htab_entry(off_t addr, const char *file)
 
 	e.key = strdup(file);
 
+	pthread_mutex_lock(&fcache_lock);
 	if (hsearch_r(e, FIND, &eptr, &cmsfs.htab) == 0) {
 		/* not yet cached, nothing to do */
 		free(e.key);
-		return;
 	} else {
 		/* update it */
 		fce = eptr->data;
@@ -1436,6 +1691,7 @@ static void update_htab_entry(off_t addr, const char *file)
 		if (hsearch_r(e, ENTER, &eptr, &cmsfs.htab) == 0)
 			DIE("%s: hash table full\n", __func__);
 	}
+	pthread_mutex_unlock(&fcache_lock);
 }
 
 static void invalidate_htab_entry(const char *name)
@@ -1445,10 +1701,11 @@ static void invalidate_htab_entry(const char *name)
 
 	e.key = strdup(name);
 
+	pthread_mutex_lock(&fcache_lock);
 	if (hsearch_r(e, FIND, &eptr, &cmsfs.htab) == 0) {
 		/* nothing to do if not cached */
 		free(e.key);
-		return;
+		goto out;
 	}
 
 	fce = eptr->data;
@@ -1456,6 +1713,8 @@ static void invalidate_htab_entry(const char *name)
 	e.data = fce;
 	if (hsearch_r(e, ENTER, &eptr, &cmsfs.htab) == 0)
 		DIE("hsearch: hash table full\n");
+out:
+	pthread_mutex_unlock(&fcache_lock);
 }
 
 /*
@@ -1577,26 +1836,25 @@ static off_t lookup_file(const char *name, struct fst_entry *fst, int flag)
 	e.key = strdup(uc_name);
 
 	/* already cached ? */
+	pthread_mutex_lock(&fcache_lock);
 	if (hsearch_r(e, FIND, &eptr, &cmsfs.htab)) {
 		fce = eptr->data;
+		/* may be zero for a stale entry */
+		faddr = fce->fst_addr;
+	}
+	pthread_mutex_unlock(&fcache_lock);
+	free(e.key);
 
-		/* check if fst is valid, may be zero for a stale entry */
-		if (!fce->fst_addr)
-			goto renew;
-
+	if (faddr) {
 		/* read in the fst entry */
-		rc = _read(fst, sizeof(*fst), fce->fst_addr);
+		rc = _read(fst, sizeof(*fst), faddr);
 		BUG(rc < 0);
 
 		if (!check_fst_valid(fst))
 			DIE("Invalid file format in file: %s\n", uc_name);
-
-		free(e.key);
-		return fce->fst_addr;
+		return faddr;
 	}
 
-renew:
-	free(e.key);
 	if (encode_edf_name(uc_name, fname, ftype))
 		return 0;
 	memset(&walk, 0, sizeof(walk));
@@ -1728,7 +1986,7 @@ static off_t get_file_size_logical(struct fst_entry *fst)
 	return total;
 }
 
-static int cmsfs_getattr(const char *path, struct stat *stbuf)
+static int __cmsfs_getattr(const char *path, struct stat *stbuf)
 {
 	int mask = (cmsfs.allow_other) ? 0444 : 0440;
 	struct fst_entry fst;
@@ -1782,8 +2040,9 @@ static int cmsfs_getattr(const char *path, struct stat *stbuf)
 	return 0;
 }
 
-static int cmsfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
-			 off_t offset, struct fuse_file_info *fi)
+static int __cmsfs_readdir(const char *path, void *buf,
+			   fuse_fill_dir_t filler, off_t offset,
+			   struct fuse_file_info *fi)
 {
 	struct walk_file walk;
 	struct fst_entry fst;
@@ -1812,7 +2071,7 @@ static int cmsfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
 	return 0;
 }
 
-static int cmsfs_open(const char *path, struct fuse_file_info *fi)
+static int __cmsfs_open(const char *path, struct fuse_file_info *fi)
 {
 	struct fst_entry fst;
 	struct file *f;
@@ -1831,11 +2090,12 @@ static int cmsfs_open(const char *path, struct fuse_file_info *fi)
 	if (!fst_addr)
 		return -ENOENT;
 
+	pthread_mutex_lock(&open_lock);
 	f = file_open(path + 1);
 	if (f == NULL) {
 		f = create_file_object(&fst, &rc);
 		if (f == NULL)
-			return rc;
+			goto out;
 		f->fst_addr = fst_addr;
 
 		/*
@@ -1845,12 +2105,16 @@ static int cmsfs_open(const char *path, struct fuse_file_info *fi)
 		 * be calculated by lrecl * nr_records. Use session_size therefore.
 		 */
 		f->session_size = get_file_size_logical(&fst);
-		if (f->session_size < 0)
-			return -EIO;
+		if (f->session_size < 0) {
+			rc = -EIO;
+			goto out_destroy;
+		}
 
 		f->wcache = malloc(WCACHE_MAX);
-		if (f->wcache == NULL)
-			return -ENOMEM;
+		if (f->wcache == NULL) {
+			rc = -ENOMEM;
+			goto out_destroy;
+		}
 
 		/*
 		 * For fixed-length records f->fst->record_len contains
@@ -1867,8 +2131,18 @@ static int cmsfs_open(const char *path, struct fuse_file_info *fi)
 		else
 			f->iconv_buf = malloc(MAX_RECORD_LEN + 1);
 		if (f->iconv_buf == NULL) {
-			destroy_file_object(f);
-			return -ENOMEM;
+			rc = -ENOMEM;
+			goto out_destroy;
+		}
+
+		if (f->translate && !cmsfs.xlat_from) {
+			f->iconv_from = iconv_open(cmsfs.codepage_to,
+						   cmsfs.codepage_from);
+			if (f->iconv_from == (iconv_t) -1) {
+				f->iconv_from = NULL;
+				rc = -errno;
+				goto out_destroy;
+			}
 		}
 
 		util_strlcpy(f->path, path, MAX_FNAME + 1);
@@ -1883,7 +2157,13 @@ static int cmsfs_open(const char *path, struct fuse_file_info *fi)
 		f->write_count++;
 
 	fi->fh = (uint64_t)(unsigned long) f;
-	return 0;
+	goto out;
+
+out_destroy:
+	destroy_file_object(f);
+out:
+	pthread_mutex_unlock(&open_lock);
+	return rc;
 }
 
 static void set_fdir_date_current(void)
@@ -2099,8 +2379,8 @@ static void update_block_count(void)
 	BUG(rc < 0);
 }
 
-static int cmsfs_create(const char *path, mode_t mode,
-			struct fuse_file_info *fi)
+static int __cmsfs_create(const char *path, mode_t mode,
+			  struct fuse_file_info *fi)
 {
 	char fname[8], ftype[8];
 	char uc_name[MAX_FNAME];
@@ -2118,7 +2398,7 @@ static int cmsfs_create(const char *path, mode_t mode,
 	 * opened.
 	 */
 	if (lookup_file(path + 1, &fst, SHOW_UNLINKED))
-		return cmsfs_open(path, fi);
+		return __cmsfs_open(path, fi);
 
 	if (cmsfs.readonly)
 		return -EACCES;
@@ -2191,7 +2471,7 @@ static int cmsfs_create(const char *path, mode_t mode,
 	BUG(rc < 0);
 	cache_fst_addr(fst_addr, uc_name);
 	increase_file_count();
-	return cmsfs_open(path, fi);
+	return __cmsfs_open(path, fi);
 }
 
 static int purge_pointer_block_fixed(struct file *f, int level, off_t addr)
@@ -2418,19 +2698,25 @@ static int rewrite_pointers(struct file *f)
 }
 
 /*
- * Guess position in record table.
+ * Find the last record that starts at or before offset.
+ *
+ * The file_start values of the record table are ascending, so a binary
+ * search is used instead of walking the table. Records of zero length
+ * share their start with the following record in binary mode and are
+ * skipped that way.
  */
-static int guess_record_number(struct file *f, off_t offset)
+static int search_record_number(struct file *f, off_t offset)
 {
-	int nr;
+	int lo = 0, hi = f->fst->nr_records - 1, mid;
 
-	if (f->linefeed)
-		nr = (offset / (f->fst->record_len + 1));
-	else
-		nr = (offset / f->fst->record_len);
-	if (nr >= f->fst->nr_records)
-		nr = f->fst->nr_records - 1;
-	return nr;
+	while (lo < hi) {
+		mid = lo + (hi - lo + 1) / 2;
+		if (f->rlist[mid].file_start <= offset)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
 }
 
 static int offset_is_linefeed(off_t offset, struct record *prev,
@@ -2469,7 +2755,7 @@ static void set_hint(struct file *f, int hint)
  */
 static struct record *find_record(struct file *f, off_t offset, int *nr)
 {
-	int i, start, step, max = f->fst->nr_records;
+	int i, max = f->fst->nr_records;
 	struct record *rec;
 
 	/*
@@ -2491,44 +2777,21 @@ static struct record *find_record(struct file *f, off_t offset, int *nr)
 		if (offset_is_linefeed(offset, &f->rlist[i - 1], rec))
 			return LINEFEED_OFFSET;
 
-	start = guess_record_number(f, offset);
-
-	/* because of potential linefeed we need to check the next record */
-	rec = &f->rlist[start];
-	if (offset < rec->file_start)
-		step = -1;
-	else
-		step = 1;
-
-	for (i = start; i >= 0 && i < max; i += step) {
-		rec = &f->rlist[i];
-		if (offset_in_record(offset, rec)) {
-			set_hint(f, i + 1);
-			*nr = i;
-			return rec;
-		}
+	i = search_record_number(f, offset);
+	rec = &f->rlist[i];
+	if (offset_in_record(offset, rec)) {
+		set_hint(f, i + 1);
+		*nr = i;
+		return rec;
+	}
 
+	if (f->linefeed) {
 		/* last record reached, only one linefeed can follow */
 		if (i == max - 1) {
-			if (f->linefeed &&
-			    (offset == rec->file_start + rec->total_len))
-				return LINEFEED_OFFSET;
-			else
-				return NULL;
-		}
-
-		/* check for linefeed byte between two records */
-		if (step == 1) {
-			if (offset_is_linefeed(offset, rec, &f->rlist[i + 1]))
-				return LINEFEED_OFFSET;
-		} else
-			/*
-			 * No need to check if i > 0 since no linefeed before
-			 * record 0 possible.
-			 */
-			if (offset_is_linefeed(offset, &f->rlist[i - 1], rec))
+			if (offset == rec->file_start + rec->total_len)
 				return LINEFEED_OFFSET;
-
+		} else if (offset_is_linefeed(offset, rec, &f->rlist[i + 1]))
+			return LINEFEED_OFFSET;
 	}
 	DEBUG("find: record not found!\n");
 	return NULL;
@@ -2570,12 +2833,17 @@ static void get_block_data_from_record(struct record *rec, off_t offset,
 	}
 }
 
-static int convert_text(iconv_t conv, char *in_buf, char *out_buf, int size)
+static int convert_text(iconv_t conv, const unsigned char *table,
+			char *in_buf, char *out_buf, int size)
 {
 	size_t out_count = size;
 	size_t in_count = size;
 	int rc;
 
+	if (table) {
+		xlat(table, in_buf, out_buf, size);
+		return 0;
+	}
 	rc = iconv(conv, &in_buf, &in_count, &out_buf, &out_count);
 	if ((rc == -1) || (in_count != 0)) {
 		DEBUG("Code page translation EBCDIC-ASCII failed\n");
@@ -2584,13 +2852,15 @@ static int convert_text(iconv_t conv, char *in_buf, char *out_buf, int size)
 	return 0;
 }
 
-static int cmsfs_read(const char *path, char *buf, size_t size, off_t offset,
-		      struct fuse_file_info *fi)
+static int __cmsfs_read(const char *path, char *buf, size_t size,
+			off_t offset, struct fuse_file_info *fi)
 {
 	struct file *f = get_fobj(fi);
+	int xlat_buf = f->translate && cmsfs.xlat_from;
 	size_t len, copied = 0;
 	struct record *rec;
 	int chunk, nr, rc;
+	char *start = buf;
 	off_t addr;
 
 	(void) path;
@@ -2614,7 +2884,7 @@ static int cmsfs_read(const char *path, char *buf, size_t size, off_t offset,
 		/* write linefeed directly to buffer and go to next record */
 		if (rec == LINEFEED_OFFSET) {
 			BUG(!f->linefeed);
-			if (f->translate)
+			if (f->translate && !xlat_buf)
 				*buf = LINEFEED_ASCII;
 			else
 				*buf = LINEFEED_EBCDIC;
@@ -2637,11 +2907,12 @@ static int cmsfs_read(const char *path, char *buf, size_t size, off_t offset,
 		/* read one record */
 		if (addr == NULL_BLOCK)
 			memset(buf, 0, chunk);
-		else if (f->translate) {
+		else if (f->translate && !xlat_buf) {
 			rc = _read(f->iconv_buf, chunk, addr);
 			if (rc < 0)
 				return rc;
-			rc = convert_text(cmsfs.iconv_from, f->iconv_buf, buf, chunk);
+			rc = convert_text(f->iconv_from, NULL, f->iconv_buf, buf,
+					  chunk);
 			if (rc < 0)
 				return rc;
 		} else {
@@ -2655,12 +2926,15 @@ static int cmsfs_read(const char *path, char *buf, size_t size, off_t offset,
 		buf += chunk;
 		offset += chunk;
 	}
+	/* translate all records and linefeeds in one pass */
+	if (xlat_buf)
+		xlat(cmsfs.xlat_from, start, start, copied);
 out:
 	DEBUG("%s: copied: %lu\n", __func__, copied);
 	return copied;
 }
 
-static int cmsfs_statfs(const char *path, struct statvfs *buf)
+static int __cmsfs_statfs(const char *path, struct statvfs *buf)
 {
 	unsigned int inode_size = cmsfs.blksize + sizeof(struct fst_entry);
 	unsigned int free_blocks = cmsfs.total_blocks - cmsfs.used_blocks;
@@ -2683,7 +2957,7 @@ static int cmsfs_statfs(const char *path, struct statvfs *buf)
 	return 0;
 }
 
-static int cmsfs_utimens(const char *path, const struct timespec ts[2])
+static int __cmsfs_utimens(const char *path, const struct timespec ts[2])
 {
 	struct fst_entry fst;
 	off_t fst_addr;
@@ -2825,7 +3099,7 @@ error:
 	return rc;
 }
 
-static int cmsfs_rename(const char *path, const char *new_path)
+static int __cmsfs_rename(const char *path, const char *new_path)
 {
 	struct fst_entry fst, fst_new;
 	off_t fst_addr, fst_addr_new;
@@ -2886,16 +3160,23 @@ static int cmsfs_rename(const char *path, const char *new_path)
 	return 0;
 }
 
-static int cmsfs_fsync(const char *path, int datasync,
-		       struct fuse_file_info *fi)
+static int __cmsfs_fsync(const char *path, int datasync,
+			 struct fuse_file_info *fi)
 {
 	(void) path;
 	(void) datasync;
 	(void) fi;
 
+	int rc;
+
 	if (cmsfs.readonly)
 		return -EROFS;
-	return msync(cmsfs.map,	cmsfs.size, MS_SYNC);
+	rc = io_ops.flush();
+	if (rc < 0)
+		return rc;
+	if (cmsfs.map != MAP_FAILED)
+		return msync(cmsfs.map, cmsfs.size, MS_SYNC);
+	return fsync(cmsfs.fd);
 }
 
 /*
@@ -3232,7 +3513,7 @@ static void update_fst(struct file *f, off_t addr)
 	unhide_null_blocks(f);
 }
 
-static int cmsfs_truncate(const char *path, off_t size)
+static int __cmsfs_truncate(const char *path, off_t size)
 {
 	struct fst_entry fst;
 	off_t fst_addr, len;
@@ -3282,8 +3563,8 @@ static int cmsfs_truncate(const char *path, off_t size)
 }
 
 #ifdef HAVE_SETXATTR
-static int cmsfs_setxattr(const char *path, const char *name, const char *value,
-			  size_t size, int flags)
+static int __cmsfs_setxattr(const char *path, const char *name,
+			    const char *value, size_t size, int flags)
 {
 	struct fst_entry fst;
 	off_t fst_addr;
@@ -3361,8 +3642,8 @@ write:
 	return 0;
 }
 
-static int cmsfs_getxattr(const char *path, const char *name, char *value,
-			  size_t size)
+static int __cmsfs_getxattr(const char *path, const char *name,
+			    char *value, size_t size)
 {
 	char buf[xattr_lrecl.size + 1];
 	struct fst_entry fst;
@@ -3414,7 +3695,7 @@ static int cmsfs_getxattr(const char *path, const char *name, char *value,
 	return -ENODATA;
 }
 
-static int cmsfs_listxattr(const char *path, char *list, size_t size)
+static int __cmsfs_listxattr(const char *path, char *list, size_t size)
 {
 	struct fst_entry fst;
 	size_t list_len;
@@ -4234,7 +4515,8 @@ static int cmsfs_write_strings(struct file *f, const char *buf,
 	}
 
 	/* translate */
-	rc = convert_text(cmsfs.iconv_to, f->wcache, f->iconv_buf, f->wcache_used);
+	rc = convert_text(cmsfs.iconv_to, cmsfs.xlat_to, f->wcache, f->iconv_buf,
+			  f->wcache_used);
 	if (rc < 0)
 		return rc;
 
@@ -4270,8 +4552,8 @@ static int cmsfs_write_strings(struct file *f, const char *buf,
 	return rc;
 }
 
-static int cmsfs_write(const char *path, const char *buf, size_t size,
-		       off_t offset, struct fuse_file_info *fi)
+static int __cmsfs_write(const char *path, const char *buf, size_t size,
+			 off_t offset, struct fuse_file_info *fi)
 {
 	struct file *f = get_fobj(fi);
 	int rc, written, nbytes;
@@ -4300,7 +4582,7 @@ static int cmsfs_write(const char *path, const char *buf, size_t size,
 	return written;
 }
 
-static int cmsfs_unlink(const char *path)
+static int __cmsfs_unlink(const char *path)
 {
 	struct fst_entry fst;
 	off_t fst_addr;
@@ -4327,7 +4609,8 @@ static int flush_wcache(struct file *f)
 	int rc;
 
 	/* translate */
-	rc = convert_text(cmsfs.iconv_to, f->wcache, f->iconv_buf, f->wcache_used);
+	rc = convert_text(cmsfs.iconv_to, cmsfs.xlat_to, f->wcache, f->iconv_buf,
+			  f->wcache_used);
 	if (rc < 0)
 		return rc;
 
@@ -4343,10 +4626,10 @@ static int flush_wcache(struct file *f)
 	return 0;
 }
 
-static int cmsfs_release(const char *path, struct fuse_file_info *fi)
+static int __cmsfs_release(const char *path, struct fuse_file_info *fi)
 {
 	struct file *f = get_fobj(fi);
-	int rc = 0;
+	int rc = 0, last;
 
 	(void) path;
 
@@ -4359,15 +4642,21 @@ static int cmsfs_release(const char *path, struct fuse_file_info *fi)
 		f->write_count--;
 		if (f->wcache_used)
 			rc = flush_wcache(f);
+		if (!rc)
+			rc = io_ops.flush();
 	}
 
-	if (f->use_count == 1) {
+	pthread_mutex_lock(&open_lock);
+	last = (--f->use_count == 0);
+	if (last)
+		util_list_remove(&open_file_list, f);
+	pthread_mutex_unlock(&open_lock);
+
+	if (last) {
 		if (f->unlinked)
 			delete_file(f->path);
-		util_list_remove(&open_file_list, f);
 		destroy_file_object(f);
-	} else
-		f->use_count--;
+	}
 
 	fi->fh = 0;
 	return rc;
@@ -4393,6 +4682,7 @@ static struct file *create_file_object(struct fst_entry *fst, int *rc)
 	if (f == NULL)
 		goto oom;
 	memset(f, 0, sizeof(*f));
+	pthread_mutex_init(&f->lock, NULL);
 
 	f->fst = malloc(sizeof(struct fst_entry));
 	if (f->fst == NULL)
@@ -4475,6 +4765,9 @@ static void destroy_file_object(struct file *f)
 	free(f->rlist);
 	free(f->blist);
 	free(f->fst);
+	if (f->iconv_from)
+		iconv_close(f->iconv_from);
+	pthread_mutex_destroy(&f->lock);
 	free(f);
 }
 
@@ -4492,6 +4785,205 @@ static struct file_operations fops_variable = {
 	.write_pointers = rewrite_pointer_block_variable,
 };
 
+/*
+ * FUSE operations with locking, see the description of meta_lock
+ */
+static int cmsfs_getattr(const char *path, struct stat *stbuf)
+{
+	int rc;
+
+	pthread_rwlock_rdlock(&meta_lock);
+	rc = __cmsfs_getattr(path, stbuf);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_statfs(const char *path, struct statvfs *buf)
+{
+	int rc;
+
+	pthread_rwlock_rdlock(&meta_lock);
+	rc = __cmsfs_statfs(path, buf);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
+			 off_t offset, struct fuse_file_info *fi)
+{
+	int rc;
+
+	pthread_rwlock_rdlock(&meta_lock);
+	rc = __cmsfs_readdir(path, buf, filler, offset, fi);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_open(const char *path, struct fuse_file_info *fi)
+{
+	int rc;
+
+	pthread_rwlock_rdlock(&meta_lock);
+	rc = __cmsfs_open(path, fi);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_release(const char *path, struct fuse_file_info *fi)
+{
+	struct file *f = get_fobj(fi);
+	int rc;
+
+	/*
+	 * Flushing the write cache and deleting an unlinked file modify
+	 * the disk. The unlink flag cannot be set while meta_lock is held.
+	 */
+	if (fi->flags & O_RDWR || fi->flags & O_WRONLY) {
+		pthread_rwlock_wrlock(&meta_lock);
+	} else {
+		pthread_rwlock_rdlock(&meta_lock);
+		if (f != NULL && f->unlinked) {
+			pthread_rwlock_unlock(&meta_lock);
+			pthread_rwlock_wrlock(&meta_lock);
+		}
+	}
+	rc = __cmsfs_release(path, fi);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_read(const char *path, char *buf, size_t size, off_t offset,
+		      struct fuse_file_info *fi)
+{
+	struct file *f = get_fobj(fi);
+	int rc;
+
+	pthread_rwlock_rdlock(&meta_lock);
+	pthread_mutex_lock(&f->lock);
+	rc = __cmsfs_read(path, buf, size, offset, fi);
+	pthread_mutex_unlock(&f->lock);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_utimens(const char *path, const struct timespec ts[2])
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&meta_lock);
+	rc = __cmsfs_utimens(path, ts);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_rename(const char *path, const char *new_path)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&meta_lock);
+	rc = __cmsfs_rename(path, new_path);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_fsync(const char *path, int datasync,
+		       struct fuse_file_info *fi)
+{
+	int rc;
+
+	pthread_rwlock_rdlock(&meta_lock);
+	rc = __cmsfs_fsync(path, datasync, fi);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_truncate(const char *path, off_t size)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&meta_lock);
+	rc = __cmsfs_truncate(path, size);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_create(const char *path, mode_t mode,
+			struct fuse_file_info *fi)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&meta_lock);
+	rc = __cmsfs_create(path, mode, fi);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_write(const char *path, const char *buf, size_t size,
+		       off_t offset, struct fuse_file_info *fi)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&meta_lock);
+	rc = __cmsfs_write(path, buf, size, offset, fi);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_unlink(const char *path)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&meta_lock);
+	rc = __cmsfs_unlink(path);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+#ifdef HAVE_SETXATTR
+static int cmsfs_setxattr(const char *path, const char *name, const char *value,
+			  size_t size, int flags)
+{
+	int rc;
+
+	pthread_rwlock_wrlock(&meta_lock);
+	rc = __cmsfs_setxattr(path, name, value, size, flags);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_getxattr(const char *path, const char *name, char *value,
+			  size_t size)
+{
+	int rc;
+
+	pthread_rwlock_rdlock(&meta_lock);
+	rc = __cmsfs_getxattr(path, name, value, size);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+
+static int cmsfs_listxattr(const char *path, char *list, size_t size)
+{
+	int rc;
+
+	pthread_rwlock_rdlock(&meta_lock);
+	rc = __cmsfs_listxattr(path, list, size);
+	pthread_rwlock_unlock(&meta_lock);
+	return rc;
+}
+#endif /* HAVE_SETXATTR */
+
+static void cmsfs_destroy(void *private_data)
+{
+	(void) private_data;
+
+	pthread_rwlock_wrlock(&meta_lock);
+	if (io_ops.flush() < 0)
+		fprintf(stderr, COMP "Writing cached blocks to %s failed\n",
+			cmsfs.device);
+	pthread_rwlock_unlock(&meta_lock);
+}
+
 static struct fuse_operations cmsfs_oper = {
 	.getattr	= cmsfs_getattr,
 	.statfs		= cmsfs_statfs,
@@ -4506,6 +4998,7 @@ static struct fuse_operations cmsfs_oper = {
 	.create		= cmsfs_create,
 	.write		= cmsfs_write,
 	.unlink		= cmsfs_unlink,
+	.destroy	= cmsfs_destroy,
 #ifdef HAVE_SETXATTR
 	.listxattr      = cmsfs_listxattr,
 	.getxattr       = cmsfs_getxattr,
@@ -4584,12 +5077,20 @@ static void init_io(int fd)
 	cmsfs.map = mmap(NULL, cmsfs.size, prot, MAP_SHARED, fd, 0);
 	if (cmsfs.map == MAP_FAILED) {
 		DEBUG("\nmmap failed, using pread/write for disk I/O.\n");
-		io_ops.read = &read_syscall;
-		io_ops.write = &write_syscall;
+		if (cmsfs.readonly) {
+			io_ops.read = &read_syscall;
+			io_ops.write = &write_syscall;
+			io_ops.flush = &flush_none;
+		} else {
+			io_ops.read = &read_cached;
+			io_ops.write = &write_cached;
+			io_ops.flush = &flush_cached;
+		}
 	} else {
 		DEBUG("  addr: %p\n", cmsfs.map);
 		io_ops.read = &read_memory;
 		io_ops.write = &write_memory;
+		io_ops.flush = &flush_none;
 	}
 }
 
@@ -4667,8 +5168,6 @@ int main(int argc, char *argv[])
 
 	if (cmsfs.readonly)
 		fuse_opt_add_arg(&args, "-oro");
-	/* force single threaded mode which requires no locking */
-	fuse_opt_add_arg(&args, "-s");
 	/* force immediate file removal */
 	fuse_opt_add_arg(&args, "-ohard_remove");
 
@@ -4686,6 +5185,7 @@ int main(int argc, char *argv[])
 			    cmsfs.codepage_to);
 		setup_iconv(&cmsfs.iconv_to, cmsfs.codepage_to,
 			    cmsfs.codepage_from);
+		setup_xlat_tables();
 	}
 
 	rc = cmsfs_fuse_main(&args, &cmsfs_oper);
@@ -76,6 +76,9 @@ struct cmsfs {
 	const char	*codepage_to;
 	iconv_t		iconv_from;
 	iconv_t		iconv_to;
+	/* single byte translation tables, NULL if iconv must be used */
+	unsigned char	*xlat_from;
+	unsigned char	*xlat_to;
 
 	/* disk stats */
 	int		total_blocks;
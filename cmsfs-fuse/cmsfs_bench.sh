@@ -0,0 +1,107 @@
+#!/bin/sh
+#
+# cmsfs_bench.sh - Benchmark parallel reads from a CMS disk image
+#
+# Usage: cmsfs_bench.sh IMAGE [JOBS...]
+#
+# Mount the CMS disk image file IMAGE read-only with cmsfs-fuse, first in
+# binary mode, then in text mode with the single byte default code page
+# and then in text mode with UTF-8 (--to=UTF-8). In each mode, measure
+# the time to read:
+#
+# - all files with JOBS parallel readers, each reading different files
+# - the largest file with JOBS parallel readers, each reading the whole file
+#
+# for each JOBS value (default 1 2 4 8). Reads of different files are
+# processed in parallel, reads of the same file wait for each other.
+# The checksums of each run are compared to the first run of the mode.
+#
+# CMSFS selects the cmsfs-fuse binary (default ./cmsfs-fuse).
+#
+# Copyright IBM Corp. 2020
+#
+# s390-tools is free software; you can redistribute it and/or modify
+# it under the terms of the MIT license. See LICENSE for details.
+#
+
+IMAGE=$1
+if [ ! -f "$IMAGE" ]; then
+	echo "Usage: $0 IMAGE [JOBS...]" >&2
+	exit 1
+fi
+shift
+JOBS=${*:-1 2 4 8}
+CMSFS=${CMSFS:-./cmsfs-fuse}
+
+tmp=`mktemp -d /tmp/cmsfs_bench.XXXXXX` || exit 1
+MNT=$tmp/mnt
+mkdir $MNT
+trap "fusermount -u -q $MNT 2> /dev/null; rm -rf $tmp" EXIT
+trap "exit 1" TERM INT
+
+now_ms() {
+	echo $((`date +%s%N` / 1000000))
+}
+
+# Compare the checksums in $tmp/$1.$2 with the reference of the mode
+check_sums() {
+	if [ ! -f $tmp/$1.ref ]; then
+		mv $tmp/$1.$2 $tmp/$1.ref
+	elif ! cmp -s $tmp/$1.ref $tmp/$1.$2; then
+		echo "Checksums ($1) with $2 jobs differ in mode $mode" >&2
+		exit 1
+	fi
+}
+
+for mode in binary text utf-8; do
+	case $mode in
+	binary)	opts= ;;
+	text)	opts=-a ;;
+	utf-8)	opts="-a --to=UTF-8" ;;
+	esac
+	$CMSFS "$IMAGE" $MNT -oro $opts || exit 1
+	rm -f $tmp/*.ref
+
+	find $MNT -type f > $tmp/files
+	find $MNT -type f -printf '%s %p\n' | sort -n | tail -1 > $tmp/largest
+	read size largest < $tmp/largest
+	if [ -z "$largest" ]; then
+		echo "No files found on $IMAGE" >&2
+		exit 1
+	fi
+	if [ $mode = binary ]; then
+		echo "`wc -l < $tmp/files` files, largest ${largest#$MNT/} ($size bytes)"
+		printf "%-8s %-22s %10s\n" "mode" "test" "time [ms]"
+	fi
+
+	for j in $JOBS; do
+		start=`now_ms`
+		xargs -d '\n' -n 1 -P $j md5sum < $tmp/files | sort > $tmp/all.$j
+		end=`now_ms`
+		printf "%-8s %-22s %10d\n" $mode "all files, jobs $j" \
+			$((end - start))
+		check_sums all $j
+	done
+
+	for j in $JOBS; do
+		start=`now_ms`
+		i=0
+		while [ $i -lt $j ]; do
+			md5sum < "$largest" > $tmp/one.$j.$i &
+			i=$((i + 1))
+		done
+		wait
+		end=`now_ms`
+		printf "%-8s %-22s %10d\n" $mode "largest file, jobs $j" \
+			$((end - start))
+		sort -u $tmp/one.$j.* > $tmp/one.$j
+		rm -f $tmp/one.$j.*
+		if [ `wc -l < $tmp/one.$j` -ne 1 ]; then
+			echo "Checksums of parallel reads of the largest file differ in mode $mode" >&2
+			exit 1
+		fi
+		check_sums one $j
+	done
+
+	fusermount -u $MNT || exit 1
+done
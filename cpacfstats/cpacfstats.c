@@ -39,8 +39,14 @@ static const char *const usage =
 	"\t-d, --disable [counter]   Disable one or all counters\n"
 	"\t-r, --reset   [counter]   Reset one or all counter values\n"
 	"\t-p, --print   [counter]   Print one or all counter values\n"
+	"\t-R, --rates   [counter]   Print increase and rates of one or all\n"
+	"\t                          counters sampled by the daemon\n"
+	"\t-w, --window  SEC         Time window for --rates in seconds\n"
+	"\t                          (default %d)\n"
 	"\tcounter can be: 'aes' 'des' 'rng' 'sha' or 'all'\n";
 
+#define RATES_WINDOW	60
+
 static const char *const counter_str[] = {
 	[DES_FUNCTIONS]  = "des",
 	[AES_FUNCTIONS]  = "aes",
@@ -50,16 +56,22 @@ static const char *const counter_str[] = {
 };
 
 
-static int send_query(int s, enum cmd_e cmd, enum ctr_e ctr)
+static int send_query(int s, enum cmd_e cmd, enum ctr_e ctr, uint32_t window)
 {
 	struct msg m;
 
 	memset(&m, 0, sizeof(m));
 
 	m.head.m_ver = VERSION;
-	m.head.m_type = QUERY;
-	m.query.m_ctr = ctr;
-	m.query.m_cmd = cmd;
+	if (cmd == RATES) {
+		m.head.m_type = QUERY_RATES;
+		m.query_rates.m_ctr = ctr;
+		m.query_rates.m_window = window;
+	} else {
+		m.head.m_type = QUERY;
+		m.query.m_ctr = ctr;
+		m.query.m_cmd = cmd;
+	}
 
 	return send_msg(s, &m);
 }
@@ -91,6 +103,72 @@ static int recv_answer(int s, int *ctr, int *state, uint64_t *value)
 }
 
 
+static int recv_answer_all(int s, int state[ALL_COUNTER],
+			   uint64_t value[ALL_COUNTER])
+{
+	struct msg m;
+	int i, rc;
+
+	rc = recv_msg(s, &m);
+	if (rc == 0) {
+		if (m.head.m_ver != VERSION) {
+			eprint("Received msg with wrong version %d != %d\n",
+			       m.head.m_ver, VERSION);
+			return -1;
+		}
+		if (m.head.m_type != ANSWER_ALL) {
+			eprint("Received msg with wrong type %d != %d\n",
+			       m.head.m_type, ANSWER_ALL);
+			return -1;
+		}
+		for (i = 0; i < ALL_COUNTER; i++) {
+			state[i] = m.answer_all.m_ctr[i].m_state;
+			value[i] = m.answer_all.m_ctr[i].m_value;
+		}
+	}
+
+	return rc;
+}
+
+
+static int recv_answer_rates(int s, struct msg_answer_rates *rates)
+{
+	struct msg m;
+	int rc;
+
+	rc = recv_msg(s, &m);
+	if (rc == 0) {
+		if (m.head.m_ver != VERSION) {
+			eprint("Received msg with wrong version %d != %d\n",
+			       m.head.m_ver, VERSION);
+			return -1;
+		}
+		if (m.head.m_type != ANSWER_RATES) {
+			eprint("Received msg with wrong type %d != %d\n",
+			       m.head.m_type, ANSWER_RATES);
+			return -1;
+		}
+		*rates = m.answer_rates;
+	}
+
+	return rc;
+}
+
+
+static void print_rates(int ctr, struct msg_ctr_rates *r)
+{
+	if (r->m_state == DISABLED)
+		printf(" %s counter: disabled\n", counter_str[ctr]);
+	else if (!r->m_samples)
+		printf(" %s counter: no samples\n", counter_str[ctr]);
+	else
+		printf(" %s counter: %"PRIu64" in %"PRIu64".%03"PRIu64" s, rate avg %"PRIu64" min %"PRIu64" max %"PRIu64" per s\n",
+		       counter_str[ctr], r->m_delta,
+		       r->m_span / 1000, r->m_span % 1000,
+		       ctr_rate(r->m_delta, r->m_span), r->m_min, r->m_max);
+}
+
+
 static void print_answer(int ctr, int state, uint64_t value)
 {
 	if (state < 0)
@@ -123,10 +201,14 @@ int eprint(const char *format, ...)
 
 int main(int argc, char *argv[])
 {
+	uint64_t value, values[ALL_COUNTER];
+	int i, j, s, state, states[ALL_COUNTER];
+	uint32_t window = RATES_WINDOW;
+	struct msg_answer_rates rates;
 	enum ctr_e ctr = ALL_COUNTER;
 	enum cmd_e cmd = PRINT;
-	int i, j, s, state;
-	uint64_t value;
+	char *end;
+	long w;
 
 	if (argc > 1) {
 		int opt, idx = 0;
@@ -137,15 +219,17 @@ int main(int argc, char *argv[])
 			{ "disable", 0, NULL, 'd' },
 			{ "reset", 0, NULL, 'r' },
 			{ "print", 0, NULL, 'p' },
+			{ "rates", 0, NULL, 'R' },
+			{ "window", 1, NULL, 'w' },
 			{ NULL, 0, NULL, 0 } };
 		while (1) {
 			opt = getopt_long(argc, argv,
-					  "hvedrp", long_opts, &idx);
+					  "hvedrpRw:", long_opts, &idx);
 			if (opt == -1)
 				break; /* no more arguments */
 			switch (opt) {
 			case 'h':
-				printf(usage, name);
+				printf(usage, name, RATES_WINDOW);
 				exit(0);
 				break;
 			case 'v':
@@ -166,6 +250,18 @@ int main(int argc, char *argv[])
 			case 'p':
 				cmd = PRINT;
 				break;
+			case 'R':
+				cmd = RATES;
+				break;
+			case 'w':
+				w = strtol(optarg, &end, 10);
+				if (*optarg == '\0' || *end != '\0' ||
+				    w <= 0 || w > UINT32_MAX) {
+					eprint("Invalid window '%s'\n", optarg);
+					exit(1);
+				}
+				window = w;
+				break;
 			default:
 				eprint("Invalid argument, try -h or --help for more information\n");
 				exit(1);
@@ -192,14 +288,49 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
+	/* all counter values are printed with one message */
+	if (cmd == PRINT && ctr == ALL_COUNTER)
+		cmd = PRINT_ALL;
+
 	/* send query */
-	if (send_query(s, cmd, ctr) != 0) {
+	if (send_query(s, cmd, ctr, window) != 0) {
 		eprint("Error on sending query message to daemon\n");
 		close(s);
 		exit(1);
 	}
 
-	if (ctr == ALL_COUNTER) {
+	if (cmd == RATES) {
+		/* receive answer */
+		if (recv_answer_rates(s, &rates) != 0) {
+			eprint("Error on receiving answer message from daemon\n");
+			close(s);
+			exit(1);
+		}
+		if (!rates.m_interval) {
+			eprint("Sampling is disabled in the daemon\n");
+			close(s);
+			exit(1);
+		}
+		for (i = 0; i < ALL_COUNTER; i++)
+			if (i == (int) ctr || ctr == ALL_COUNTER)
+				print_rates(i, &rates.m_ctr[i]);
+	} else if (cmd == PRINT_ALL) {
+		/* receive answer */
+		if (recv_answer_all(s, states, values) != 0) {
+			eprint("Error on receiving answer message from daemon\n");
+			close(s);
+			exit(1);
+		}
+		for (i = 0; i < ALL_COUNTER; i++) {
+			if (states[i] < 0) {
+				eprint("Received bad status code %d from daemon\n",
+				       states[i]);
+				close(s);
+				exit(1);
+			}
+			print_answer(i, states[i], values[i]);
+		}
+	} else if (ctr == ALL_COUNTER) {
 		for (i = 0; i < ALL_COUNTER; i++) {
 			/* receive answer */
 			if (recv_answer(s, &j, &state, &value) != 0) {
@@ -32,14 +32,19 @@ enum ctr_e {
 
 enum type_e {
 	QUERY = 0,
-	ANSWER
+	ANSWER,
+	ANSWER_ALL,
+	ANSWER_RATES,
+	QUERY_RATES
 };
 
 enum cmd_e {
 	PRINT = 0,
 	ENABLE,
 	DISABLE,
-	RESET
+	RESET,
+	PRINT_ALL,
+	RATES
 };
 
 enum state_e {
@@ -58,6 +63,17 @@ struct msg_query {
 	uint32_t m_cmd;
 } __packed;
 
+/*
+ * RATES query send from client to daemon
+ * Consist of:
+ * enum counter
+ * window in seconds
+ */
+struct msg_query_rates {
+	uint32_t m_ctr;
+	uint32_t m_window;
+} __packed;
+
 /*
  * answer send from daemon to client
  * Consist of:
@@ -71,6 +87,51 @@ struct msg_answer {
 	uint64_t m_value;
 } __packed;
 
+/*
+ * answer to a PRINT_ALL query send from daemon to client
+ * Consist of one status code and counter value per counter,
+ * indexed by enum counter. All values are read at the same time.
+ */
+struct msg_answer_all {
+	struct {
+		int32_t  m_state;
+		uint64_t m_value;
+	} __packed m_ctr[ALL_COUNTER];
+} __packed;
+
+/*
+ * answer to a RATES query send from daemon to client
+ * Consist of the sampling interval in seconds (0: sampling disabled)
+ * and per counter, indexed by enum counter:
+ * status code
+ * number of sample intervals within the window
+ * time span of these intervals in milliseconds
+ * counter increase within the time span
+ * minimum and maximum rate per second of a single sample interval
+ */
+struct msg_ctr_rates {
+	int32_t  m_state;
+	uint32_t m_samples;
+	uint64_t m_span;
+	uint64_t m_delta;
+	uint64_t m_min;
+	uint64_t m_max;
+} __packed;
+
+struct msg_answer_rates {
+	uint32_t m_interval;
+	struct msg_ctr_rates m_ctr[ALL_COUNTER];
+} __packed;
+
+/*
+ * Rate per second of a counter increase of delta within span_ms
+ * milliseconds. Divide first, so that delta * 1000 cannot overflow.
+ */
+static inline uint64_t ctr_rate(uint64_t delta, uint64_t span_ms)
+{
+	return delta / span_ms * 1000 + delta % span_ms * 1000 / span_ms;
+}
+
 /* stats_sock.c */
 
 #define SERVER 1
@@ -91,8 +152,11 @@ struct msg_header {
 struct msg {
 	struct msg_header head;
 	union {
-		struct msg_query  query;
-		struct msg_answer answer;
+		struct msg_query        query;
+		struct msg_query_rates  query_rates;
+		struct msg_answer       answer;
+		struct msg_answer_all   answer_all;
+		struct msg_answer_rates answer_rates;
 	};
 } __packed;
 
@@ -108,5 +172,6 @@ int  perf_enable_ctr(enum ctr_e ctr);
 int  perf_disable_ctr(enum ctr_e ctr);
 int  perf_reset_ctr(enum ctr_e ctr);
 int  perf_read_ctr(enum ctr_e ctr, uint64_t *value);
+int  perf_read_all(uint64_t value[ALL_COUNTER]);
 
 #endif
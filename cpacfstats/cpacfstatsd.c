@@ -14,6 +14,7 @@
 #include <getopt.h>
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdint.h>
@@ -23,6 +24,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <syslog.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "lib/zt_common.h"
@@ -39,14 +41,117 @@ static const char *const usage =
 	"\n"
 	"\t-h, --help          Print this help, then exit\n"
 	"\t-v, --version       Print version information, then exit\n"
-	"\t-f, --foreground    Run in foreground, do not detach\n";
+	"\t-f, --foreground    Run in foreground, do not detach\n"
+	"\t-i, --interval SEC  Sample the counters every SEC seconds (default %d),\n"
+	"\t                    0 disables sampling\n";
 
 static int daemonized;
 
 static int ctr_state[ALL_COUNTER];
 
+/*
+ * Counter samples for rate queries
+ *
+ * The enabled counters are sampled every sample_interval seconds into a
+ * ring buffer of SAMPLES_MAX samples. The generation of a counter changes
+ * when the counter is enabled, disabled or reset. Only consecutive samples
+ * with the same generation are used to calculate rates, generation 0 marks
+ * a disabled counter.
+ */
+#define SAMPLES_MAX		1024
+#define SAMPLE_INTERVAL		10
+#define MAX_INTERVAL		3600
+
+struct sample {
+	uint64_t time_ms;
+	uint64_t value[ALL_COUNTER];
+	uint32_t gen[ALL_COUNTER];
+};
+
+static struct sample samples[SAMPLES_MAX];
+/* index of the next sample and number of valid samples */
+static int sample_next;
+static int sample_cnt;
+static int sample_interval = SAMPLE_INTERVAL;
+static uint64_t sample_due_ms;
+
+static uint32_t ctr_gen[ALL_COUNTER];
+static uint32_t gen_last;
+
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+/*
+ * Start a new generation of samples for a counter
+ */
+static void new_gen(int ctr)
+{
+	/* generation 0 is reserved for samples of disabled counters */
+	if (++gen_last == 0)
+		gen_last = 1;
+	ctr_gen[ctr] = gen_last;
+}
+
+
+static void take_sample(void)
+{
+	struct sample *smp = &samples[sample_next];
+	uint64_t value[ALL_COUNTER];
+	int i;
 
-static int recv_query(int s, enum ctr_e *ctr, enum cmd_e *cmd)
+	if (perf_read_all(value) != 0)
+		return;
+
+	smp->time_ms = now_ms();
+	for (i = 0; i < ALL_COUNTER; i++) {
+		smp->value[i] = value[i];
+		smp->gen[i] = ctr_state[i] ? ctr_gen[i] : 0;
+	}
+	sample_next = (sample_next + 1) % SAMPLES_MAX;
+	if (sample_cnt < SAMPLES_MAX)
+		sample_cnt++;
+}
+
+
+/*
+ * Return the poll() timeout until the next sample is due
+ */
+static int sample_timeout(void)
+{
+	uint64_t now;
+
+	if (!sample_interval)
+		return -1;
+	now = now_ms();
+	if (now >= sample_due_ms)
+		return 0;
+	return sample_due_ms - now;
+}
+
+
+static void sample_if_due(void)
+{
+	uint64_t now;
+
+	if (!sample_interval)
+		return;
+	now = now_ms();
+	if (now < sample_due_ms)
+		return;
+	take_sample();
+	sample_due_ms = now + (uint64_t) sample_interval * 1000;
+}
+
+
+static int recv_query(int s, enum ctr_e *ctr, enum cmd_e *cmd,
+		      uint32_t *window)
 {
 	struct msg m;
 	int rc;
@@ -58,13 +163,23 @@ static int recv_query(int s, enum ctr_e *ctr, enum cmd_e *cmd)
 			       m.head.m_ver, VERSION);
 			return -1;
 		}
-		if (m.head.m_type != QUERY) {
+		if (m.head.m_type == QUERY_RATES) {
+			*ctr = m.query_rates.m_ctr;
+			*cmd = RATES;
+			*window = m.query_rates.m_window;
+		} else if (m.head.m_type == QUERY) {
+			/* RATES queries carry a window */
+			if (m.query.m_cmd == RATES) {
+				eprint("Received RATES command without window\n");
+				return -1;
+			}
+			*ctr = m.query.m_ctr;
+			*cmd = m.query.m_cmd;
+		} else {
 			eprint("Received msg with wrong type %d != %d\n",
 			       m.head.m_type, QUERY);
 			return -1;
 		}
-		*ctr = m.query.m_ctr;
-		*cmd = m.query.m_cmd;
 	}
 
 	return rc;
@@ -101,6 +216,7 @@ static int do_enable(int s, enum ctr_e ctr)
 					break;
 				}
 				ctr_state[i] = 1;
+				new_gen(i);
 			}
 			rc = perf_read_ctr(i, &value);
 			if (rc != 0) {
@@ -128,6 +244,7 @@ static int do_disable(int s, enum ctr_e ctr)
 					break;
 				}
 				ctr_state[i] = 0;
+				new_gen(i);
 			}
 			send_answer(s, i, DISABLED, 0);
 		}
@@ -149,6 +266,7 @@ static int do_reset(int s, enum ctr_e ctr)
 					send_answer(s, i, rc, 0);
 					break;
 				}
+				new_gen(i);
 				send_answer(s, i, ENABLED, 0);
 			} else {
 				send_answer(s, i, DISABLED, 0);
@@ -161,18 +279,20 @@ static int do_reset(int s, enum ctr_e ctr)
 
 static int do_print(int s, enum ctr_e ctr)
 {
-	int i, rc = 0;
-	uint64_t value;
+	uint64_t value[ALL_COUNTER];
+	int i, rc;
+
+	/* read all counters at once to get a consistent snapshot */
+	rc = perf_read_all(value);
 
 	for (i = 0; i < ALL_COUNTER; i++) {
 		if (i == (int) ctr || ctr == ALL_COUNTER) {
 			if (ctr_state[i]) {
-				rc = perf_read_ctr(i, &value);
 				if (rc != 0) {
 					send_answer(s, i, rc, 0);
 					break;
 				}
-				send_answer(s, i, ENABLED, value);
+				send_answer(s, i, ENABLED, value[i]);
 			} else {
 				send_answer(s, i, DISABLED, 0);
 			}
@@ -182,6 +302,90 @@ static int do_print(int s, enum ctr_e ctr)
 	return rc;
 }
 
+static int do_print_all(int s)
+{
+	uint64_t value[ALL_COUNTER];
+	struct msg m;
+	int i, rc;
+
+	rc = perf_read_all(value);
+
+	memset(&m, 0, sizeof(m));
+
+	m.head.m_ver = VERSION;
+	m.head.m_type = ANSWER_ALL;
+	for (i = 0; i < ALL_COUNTER; i++) {
+		if (!ctr_state[i]) {
+			m.answer_all.m_ctr[i].m_state = DISABLED;
+		} else if (rc != 0) {
+			m.answer_all.m_ctr[i].m_state = rc;
+		} else {
+			m.answer_all.m_ctr[i].m_state = ENABLED;
+			m.answer_all.m_ctr[i].m_value = value[i];
+		}
+	}
+
+	return send_msg(s, &m);
+}
+
+
+/*
+ * Answer the counter increase and the minimum and maximum rate within the
+ * last window seconds. The window ends with the newest sample.
+ */
+static int do_rates(int s, uint32_t window)
+{
+	uint64_t start_ms, span, delta, rate;
+	struct sample *prev, *cur;
+	struct msg_ctr_rates *a;
+	struct msg m;
+	int i, n, ctr;
+
+	memset(&m, 0, sizeof(m));
+
+	m.head.m_ver = VERSION;
+	m.head.m_type = ANSWER_RATES;
+	m.answer_rates.m_interval = sample_interval;
+
+	for (ctr = 0; ctr < ALL_COUNTER; ctr++)
+		m.answer_rates.m_ctr[ctr].m_state =
+			ctr_state[ctr] ? ENABLED : DISABLED;
+
+	if (sample_cnt < 2)
+		return send_msg(s, &m);
+
+	cur = &samples[(sample_next + SAMPLES_MAX - 1) % SAMPLES_MAX];
+	start_ms = cur->time_ms - MIN(cur->time_ms, (uint64_t) window * 1000);
+
+	/* walk from the newest sample backwards */
+	for (n = 1; n < sample_cnt; n++) {
+		i = (sample_next + SAMPLES_MAX - 1 - n) % SAMPLES_MAX;
+		prev = &samples[i];
+		if (prev->time_ms < start_ms)
+			break;
+		span = cur->time_ms - prev->time_ms;
+		for (ctr = 0; ctr < ALL_COUNTER; ctr++) {
+			a = &m.answer_rates.m_ctr[ctr];
+			if (!ctr_state[ctr] || !cur->gen[ctr] ||
+			    cur->gen[ctr] != ctr_gen[ctr] ||
+			    prev->gen[ctr] != cur->gen[ctr] || !span)
+				continue;
+			delta = cur->value[ctr] - prev->value[ctr];
+			rate = ctr_rate(delta, span);
+			if (!a->m_samples || rate < a->m_min)
+				a->m_min = rate;
+			if (!a->m_samples || rate > a->m_max)
+				a->m_max = rate;
+			a->m_samples++;
+			a->m_span += span;
+			a->m_delta += delta;
+		}
+		cur = prev;
+	}
+
+	return send_msg(s, &m);
+}
+
 
 static int become_daemon(void)
 {
@@ -361,6 +565,9 @@ int main(int argc, char *argv[])
 {
 	int rc, sfd, foreground = 0;
 	struct sigaction act;
+	struct pollfd pfd;
+	long interval;
+	char *end;
 
 	if (argc > 1) {
 		int opt, idx = 0;
@@ -368,16 +575,28 @@ int main(int argc, char *argv[])
 			{ "help", 0, NULL, 'h' },
 			{ "foreground", 0, NULL, 'f' },
 			{ "version", 0, NULL, 'v' },
+			{ "interval", 1, NULL, 'i' },
 			{ NULL, 0, NULL, 0 } };
 		while (1) {
 			opt = getopt_long(argc, argv,
-					  "hfv", long_opts, &idx);
+					  "hfvi:", long_opts, &idx);
 			if (opt == -1)
 				break; /* no more arguments */
 			switch (opt) {
 			case 'h':
-				printf(usage, name);
+				printf(usage, name, SAMPLE_INTERVAL);
 				exit(0);
+			case 'i':
+				errno = 0;
+				interval = strtol(optarg, &end, 10);
+				if (errno || *optarg == '\0' || *end != '\0' ||
+				    interval < 0 || interval > MAX_INTERVAL) {
+					printf("%s: Invalid interval '%s', try -h or --help for more information\n",
+					       name, optarg);
+					exit(1);
+				}
+				sample_interval = (int) interval;
+				break;
 			case 'f':
 				foreground = 1;
 				break;
@@ -435,11 +654,25 @@ int main(int argc, char *argv[])
 
 	eprint("Running\n");
 
+	pfd.fd = sfd;
+	pfd.events = POLLIN;
+
 	while (1) {
 		enum ctr_e ctr;
 		enum cmd_e cmd;
+		uint32_t window;
 		int s;
 
+		rc = poll(&pfd, 1, sample_timeout());
+		if (rc < 0 && errno != EINTR) {
+			eprint("Poll() failure, errno=%d [%s]\n",
+			       errno, strerror(errno));
+			exit(1);
+		}
+		sample_if_due();
+		if (rc <= 0 || !(pfd.revents & POLLIN))
+			continue;
+
 		s = accept(sfd, NULL, NULL);
 		if (s < 0) {
 			if (errno == EINTR)
@@ -449,7 +682,7 @@ int main(int argc, char *argv[])
 			exit(1);
 		}
 
-		rc = recv_query(s, &ctr, &cmd);
+		rc = recv_query(s, &ctr, &cmd, &window);
 		if (rc != 0) {
 			eprint("Recv_query() failed, ignoring\n");
 			goto cleanup;
@@ -463,6 +696,10 @@ int main(int argc, char *argv[])
 			rc = do_reset(s, ctr);
 		else if (cmd == PRINT)
 			rc = do_print(s, ctr);
+		else if (cmd == PRINT_ALL)
+			rc = do_print_all(s);
+		else if (cmd == RATES)
+			rc = do_rates(s, window);
 		else {
 			eprint("Received unknown command %d, ignoring\n",
 			       (int) cmd);
@@ -35,30 +35,234 @@ static const struct {
 	{"cpum_cf::PRNG_FUNCTIONS", PRNG_FUNCTIONS}
 };
 
+#define CPU_ONLINE_FILE "/sys/devices/system/cpu/online"
+
 /*
- * We need one filedescriptor per CPU per counter.
- * So perf_init builds this:
- *
- * ctr_fds - is an array of pointers to file descriptor arrays.
- * Each file descriptor array has space for number of logical CPUs + 1
- * filedescriptors (int values). The last element of each file descriptor
- * array is always 0, assuming there will never appear a filedescriptor
- * with value 0:
+ * The counters of each online CPU are opened as one perf event group.
+ * The group leader is a dummy software event which is always enabled,
+ * so the counters can still be enabled and disabled one by one. A single
+ * read() of the leader with PERF_FORMAT_GROUP returns the values of all
+ * counters of the CPU at once:
  *
- * ctr_fds:
- *   ctr_fds[0]             -> [file descriptor 0] [fd1] ... [fd cpus-1][0]
- *   ctr_fds[1]             -> [file descriptor 0] [fd1] ... [fd cpus-1][0]
+ * cpu_groups:
+ *   cpu_groups[0]      -> leader fd, counter fds[0] ... fds[ALL_COUNTER-1]
  *   ...
- *   ctr_fds[ALL_COUNTER-1] -> [file descriptor 0] [fd1] ... [fd cpus-1][0]
+ *   cpu_groups[cpus-1] -> leader fd, counter fds[0] ... fds[ALL_COUNTER-1]
+ *
+ * A leader fd of -1 means that no group is open for this CPU. Groups are
+ * opened for CPUs which come online and closed for CPUs which go offline.
+ * The counter values of a closed group are kept in ctr_offline.
  */
-static int *ctr_fds[ALL_COUNTER];
+struct cpu_group {
+	int leader;
+	int fds[ALL_COUNTER];
+};
 
+static struct cpu_group *cpu_groups;
+static int cpu_groups_cnt;
 
-int perf_init(void)
+/* perf event attributes of each counter */
+static struct perf_event_attr ctr_attr[ALL_COUNTER];
+/* enable state of each counter, applied to the groups of new CPUs */
+static int ctr_enabled[ALL_COUNTER];
+/* counter values of CPUs which went offline */
+static uint64_t ctr_offline[ALL_COUNTER];
+
+/*
+ * Group read format: number of events followed by one value per event,
+ * the value of the group leader comes first.
+ */
+struct group_values {
+	uint64_t nr;
+	uint64_t leader;
+	uint64_t ctr[ALL_COUNTER];
+};
+
+
+/*
+ * Read the online CPU mask, e.g. "0-3,8,10-11", into an array with one
+ * byte per CPU. Return the number of array elements or -1 on error.
+ */
+static int read_online_cpus(char **online)
+{
+	int cnt = 0, first, last, n;
+	char buf[4096], *p;
+	FILE *f;
+
+	*online = NULL;
+	f = fopen(CPU_ONLINE_FILE, "r");
+	if (!f) {
+		eprint("Fopen('%s') failed, errno=%d [%s]\n",
+		       CPU_ONLINE_FILE, errno, strerror(errno));
+		return -1;
+	}
+	p = fgets(buf, sizeof(buf), f);
+	fclose(f);
+	if (!p) {
+		eprint("Could not read '%s'\n", CPU_ONLINE_FILE);
+		return -1;
+	}
+
+	while (sscanf(p, "%d%n", &first, &n) == 1) {
+		p += n;
+		last = first;
+		if (*p == '-') {
+			p++;
+			if (sscanf(p, "%d%n", &last, &n) != 1)
+				break;
+			p += n;
+		}
+		if (first < 0 || last < first)
+			break;
+		if (last >= cnt) {
+			*online = realloc(*online, last + 1);
+			if (!*online) {
+				eprint("Realloc() of %d byte failed, errno=%d [%s]\n",
+				       last + 1, errno, strerror(errno));
+				return -1;
+			}
+			memset(*online + cnt, 0, last + 1 - cnt);
+			cnt = last + 1;
+		}
+		memset(*online + first, 1, last - first + 1);
+		if (*p != ',')
+			break;
+		p++;
+	}
+
+	return cnt;
+}
+
+
+static void close_group(struct cpu_group *grp)
+{
+	int ctr;
+
+	for (ctr = 0; ctr < ALL_COUNTER; ctr++) {
+		if (grp->fds[ctr] >= 0)
+			close(grp->fds[ctr]);
+		grp->fds[ctr] = -1;
+	}
+	if (grp->leader >= 0)
+		close(grp->leader);
+	grp->leader = -1;
+}
+
+
+static int open_group(struct cpu_group *grp, int cpu)
 {
-	int i, cpus, ctr, cpu, ec, *fds;
+	struct perf_event_attr attr;
+	int ctr, fd, ec;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_SOFTWARE;
+	attr.config = PERF_COUNT_SW_DUMMY;
+	attr.read_format = PERF_FORMAT_GROUP;
+
+	fd = perf_event_open(
+		&attr,
+		-1,  /* pid -1 means all processes */
+		cpu,
+		-1,  /* group filedescriptor */
+		0);  /* flags */
+	if (fd < 0) {
+		/* the CPU went offline in the meantime */
+		if (errno == ENODEV)
+			return 0;
+		eprint("Perf_event_open() failed with errno=%d [%s]\n",
+		       errno, strerror(errno));
+		return -1;
+	}
+	grp->leader = fd;
+
+	for (ctr = 0; ctr < ALL_COUNTER; ctr++) {
+		attr = ctr_attr[ctr];
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.disabled = !ctr_enabled[ctr];
+		fd = perf_event_open(&attr, -1, cpu, grp->leader, 0);
+		if (fd < 0) {
+			ec = errno;
+			close_group(grp);
+			if (ec == ENODEV)
+				return 0;
+			eprint("Perf_event_open() failed with errno=%d [%s]\n",
+			       ec, strerror(ec));
+			return -1;
+		}
+		grp->fds[ctr] = fd;
+	}
+
+	return 0;
+}
 
-	memset(ctr_fds, 0, sizeof(ctr_fds));
+
+static int read_group(struct cpu_group *grp, uint64_t value[ALL_COUNTER])
+{
+	struct group_values gv;
+	int ec, ctr;
+
+	ec = read(grp->leader, &gv, sizeof(gv));
+	if (ec != sizeof(gv) || gv.nr != ALL_COUNTER + 1) {
+		eprint("Read() on perf file descriptor failed with errno=%d [%s]\n",
+		       errno, strerror(errno));
+		return -1;
+	}
+	for (ctr = 0; ctr < ALL_COUNTER; ctr++)
+		value[ctr] += gv.ctr[ctr];
+
+	return 0;
+}
+
+
+/*
+ * Open groups for CPUs which came online and close the groups of CPUs
+ * which went offline.
+ */
+static int perf_update_cpus(void)
+{
+	int cpu, cnt, rc = 0;
+	struct cpu_group *grp;
+	char *online;
+
+	cnt = read_online_cpus(&online);
+	if (cnt < 0)
+		return -1;
+
+	if (cnt > cpu_groups_cnt) {
+		grp = realloc(cpu_groups, cnt * sizeof(*grp));
+		if (!grp) {
+			eprint("Realloc() of %d byte failed, errno=%d [%s]\n",
+			       (int)(cnt * sizeof(*grp)),
+			       errno, strerror(errno));
+			free(online);
+			return -1;
+		}
+		memset(grp + cpu_groups_cnt, -1,
+		       (cnt - cpu_groups_cnt) * sizeof(*grp));
+		cpu_groups = grp;
+		cpu_groups_cnt = cnt;
+	}
+
+	for (cpu = 0; cpu < cpu_groups_cnt; cpu++) {
+		grp = &cpu_groups[cpu];
+		if (cpu < cnt && online[cpu]) {
+			if (grp->leader < 0 && open_group(grp, cpu) != 0)
+				rc = -1;
+		} else if (grp->leader >= 0) {
+			read_group(grp, ctr_offline);
+			close_group(grp);
+		}
+	}
+	free(online);
+
+	return rc;
+}
+
+
+int perf_init(void)
+{
+	int i, ctr, ec;
 
 	/*  initialize performance monitoring library */
 	ec = pfm_initialize();
@@ -68,101 +272,87 @@ int perf_init(void)
 		return -1;
 	}
 
-	/* get number of logical processors */
-	cpus = sysconf(_SC_NPROCESSORS_ONLN);
-
 	/* for each counter */
 	for (ctr = 0; ctr < ALL_COUNTER; ctr++) {
-
-		/*
-		 * allocate an array of ints to store for each CPU
-		 * one filedescriptor + a terminating 0
-		 */
-		fds = (int *) calloc(sizeof(int), cpus+1);
-		if (!fds) {
-			eprint("Malloc() of %d byte failed, errno=%d [%s]\n",
-			       (int)(sizeof(int) * (cpus+1)),
-			       errno, strerror(errno));
+		pfm_perf_encode_arg_t pfm_arg;
+		struct perf_event_attr *pfm_event = &ctr_attr[ctr];
+
+		memset(&pfm_arg, 0, sizeof(pfm_arg));
+		memset(pfm_event, 0, sizeof(*pfm_event));
+		pfm_arg.attr = pfm_event;
+		pfm_arg.size = sizeof(pfm_arg);
+		pfm_event->size = sizeof(*pfm_event);
+
+		/* search for the counter's corresponding pfm name */
+		for (i = ALL_COUNTER-1; i >= 0; i--)
+			if ((int) pmf_counter_name[i].ctr == ctr)
+				break;
+		if (i < 0) {
+			eprint("Pfm ctr name not found for counter %d, please adjust pmf_counter_name[] in %s\n",
+			       ctr, __FILE__);
 			return -1;
 		}
 
-		ctr_fds[ctr] = fds;
-
-		for (cpu = 0; cpu < cpus; cpu++) {
-			pfm_perf_encode_arg_t pfm_arg;
-			struct perf_event_attr pfm_event;
-			int fd;
-
-			memset(&pfm_arg, 0, sizeof(pfm_arg));
-			memset(&pfm_event, 0, sizeof(pfm_event));
-			pfm_arg.attr = &pfm_event;
-			pfm_arg.size = sizeof(pfm_arg);
-			pfm_event.size = sizeof(pfm_event);
-
-			/* search for the counter's corresponding pfm name */
-			for (i = ALL_COUNTER-1; i >= 0; i--)
-				if ((int) pmf_counter_name[i].ctr == ctr)
-					break;
-			if (i < 0) {
-				eprint("Pfm ctr name not found for counter %d, please adjust pmf_counter_name[] in %s\n",
-				       ctr, __FILE__);
-				return -1;
-			}
-
-			/* encode the counters perf event into pfm_arg.attr */
-			ec = pfm_get_os_event_encoding(
-				pmf_counter_name[i].pfm_name,
-				PFM_PLM0,
-				PFM_OS_PERF_EVENT,
-				&pfm_arg);
-			if (ec != PFM_SUCCESS) {
-				eprint("Pfm_initialize() for %s failed (%d:%s)\n",
-				       pmf_counter_name[i].pfm_name,
-				       ec, pfm_strerror(ec));
-				return -1;
-			}
-
-			/* fetch file descriptor for this perf event
-			 * the counter event should start disabled
-			 */
-			pfm_event.disabled = 1;
-			fd = perf_event_open(
-				&pfm_event,
-				-1,  /* pid -1 means all processes */
-				cpu,
-				-1,  /* group filedescriptor */
-				0);  /* flags */
-			if (fd < 0) {
-				eprint("Perf_event_open() failed with errno=%d [%s]\n",
-				       errno, strerror(errno));
-				return -1;
-			}
-			fds[cpu] = fd;
+		/* encode the counters perf event into pfm_arg.attr */
+		ec = pfm_get_os_event_encoding(
+			pmf_counter_name[i].pfm_name,
+			PFM_PLM0,
+			PFM_OS_PERF_EVENT,
+			&pfm_arg);
+		if (ec != PFM_SUCCESS) {
+			eprint("Pfm_initialize() for %s failed (%d:%s)\n",
+			       pmf_counter_name[i].pfm_name,
+			       ec, pfm_strerror(ec));
+			return -1;
 		}
 	}
 
-	return 0;
+	/* the counter events should start disabled */
+	memset(ctr_enabled, 0, sizeof(ctr_enabled));
+	memset(ctr_offline, 0, sizeof(ctr_offline));
+
+	return perf_update_cpus();
 }
 
 
 void perf_close(void)
 {
-	int ctr, *fds;
+	int cpu;
 
-	for (ctr = 0; ctr < ALL_COUNTER; ctr++) {
-		for (fds = ctr_fds[ctr]; fds && *fds; fds++) {
-			close(*fds);
-			*fds = 0;
+	for (cpu = 0; cpu < cpu_groups_cnt; cpu++)
+		close_group(&cpu_groups[cpu]);
+	free(cpu_groups);
+	cpu_groups = NULL;
+	cpu_groups_cnt = 0;
+}
+
+
+/*
+ * Issue a perf ioctl for one counter on all CPUs
+ */
+static int perf_ioctl_ctr(enum ctr_e ctr, unsigned long request,
+			  const char *request_str)
+{
+	int cpu, ec, rc = 0;
+
+	for (cpu = 0; cpu < cpu_groups_cnt; cpu++) {
+		if (cpu_groups[cpu].leader < 0)
+			continue;
+		ec = ioctl(cpu_groups[cpu].fds[ctr], request, 0);
+		if (ec < 0) {
+			eprint("Ioctl(%s) failed with errno=%d [%s]\n",
+			       request_str, errno, strerror(errno));
+			rc = -1;
 		}
-		free(ctr_fds[ctr]);
-		ctr_fds[ctr] = NULL;
 	}
+
+	return rc;
 }
 
 
 int perf_enable_ctr(enum ctr_e ctr)
 {
-	int *fds, ec, rc = 0;
+	int rc = 0;
 
 	if (ctr == ALL_COUNTER) {
 		for (ctr = 0; ctr < ALL_COUNTER; ctr++) {
@@ -171,14 +361,10 @@ int perf_enable_ctr(enum ctr_e ctr)
 				return rc;
 		}
 	} else {
-		for (fds = ctr_fds[ctr]; fds && *fds; fds++) {
-			ec = ioctl(*fds, PERF_EVENT_IOC_ENABLE, 0);
-			if (ec < 0) {
-				eprint("Ioctl(PERF_EVENT_IOC_ENABLE) failed with errno=%d [%s]\n",
-				       errno, strerror(errno));
-				rc = -1;
-			}
-		}
+		perf_update_cpus();
+		rc = perf_ioctl_ctr(ctr, PERF_EVENT_IOC_ENABLE,
+				    "PERF_EVENT_IOC_ENABLE");
+		ctr_enabled[ctr] = 1;
 	}
 
 	return rc;
@@ -187,7 +373,7 @@ int perf_enable_ctr(enum ctr_e ctr)
 
 int perf_disable_ctr(enum ctr_e ctr)
 {
-	int *fds, ec, rc = 0;
+	int rc = 0;
 
 	if (ctr == ALL_COUNTER) {
 		for (ctr = 0; ctr < ALL_COUNTER; ctr++) {
@@ -196,14 +382,10 @@ int perf_disable_ctr(enum ctr_e ctr)
 				return rc;
 		}
 	} else {
-		for (fds = ctr_fds[ctr]; fds && *fds; fds++) {
-			ec = ioctl(*fds, PERF_EVENT_IOC_DISABLE, 0);
-			if (ec < 0) {
-				eprint("Ioctl(PERF_EVENT_IOC_DISABLE) failed with errno=%d [%s]\n",
-				       errno, strerror(errno));
-				rc = -1;
-			}
-		}
+		perf_update_cpus();
+		rc = perf_ioctl_ctr(ctr, PERF_EVENT_IOC_DISABLE,
+				    "PERF_EVENT_IOC_DISABLE");
+		ctr_enabled[ctr] = 0;
 	}
 
 	return rc;
@@ -212,7 +394,7 @@ int perf_disable_ctr(enum ctr_e ctr)
 
 int perf_reset_ctr(enum ctr_e ctr)
 {
-	int *fds, ec, rc = 0;
+	int rc = 0;
 
 	if (ctr == ALL_COUNTER) {
 		for (ctr = 0; ctr < ALL_COUNTER; ctr++) {
@@ -221,39 +403,51 @@ int perf_reset_ctr(enum ctr_e ctr)
 				return rc;
 		}
 	} else {
-		for (fds = ctr_fds[ctr]; fds && *fds; fds++) {
-			ec = ioctl(*fds, PERF_EVENT_IOC_RESET, 0);
-			if (ec < 0) {
-				eprint("Ioctl(PERF_EVENT_IOC_RESET) failed with errno=%d [%s]\n",
-				       errno, strerror(errno));
-				rc = -1;
-			}
-		}
+		perf_update_cpus();
+		rc = perf_ioctl_ctr(ctr, PERF_EVENT_IOC_RESET,
+				    "PERF_EVENT_IOC_RESET");
+		ctr_offline[ctr] = 0;
 	}
 
 	return rc;
 }
 
 
-int perf_read_ctr(enum ctr_e ctr, uint64_t *value)
+/*
+ * Read all counters with one read() per CPU
+ */
+int perf_read_all(uint64_t value[ALL_COUNTER])
 {
-	int *fds, ec, rc = -1;
-	uint64_t val;
+	int cpu, ok = 0, failed = 0;
 
 	if (!value)
 		return -1;
-	*value = 0;
-
-	for (fds = ctr_fds[ctr]; fds && *fds; fds++) {
-		ec = read(*fds, &val, sizeof(val));
-		if (ec != sizeof(val)) {
-			eprint("Read() on perf file descriptor failed with errno=%d [%s]\n",
-			       errno, strerror(errno));
-		} else {
-			*value += val;
-			rc = 0;
-		}
+	perf_update_cpus();
+	memcpy(value, ctr_offline, sizeof(ctr_offline));
+
+	for (cpu = 0; cpu < cpu_groups_cnt; cpu++) {
+		if (cpu_groups[cpu].leader < 0)
+			continue;
+		if (read_group(&cpu_groups[cpu], value) == 0)
+			ok = 1;
+		else
+			failed = 1;
 	}
 
+	/* values of CPUs that can be read are better than nothing */
+	return (failed && !ok) ? -1 : 0;
+}
+
+
+int perf_read_ctr(enum ctr_e ctr, uint64_t *value)
+{
+	uint64_t values[ALL_COUNTER];
+	int rc;
+
+	if (!value)
+		return -1;
+	rc = perf_read_all(values);
+	*value = rc ? 0 : values[ctr];
+
 	return rc;
 }
@@ -158,9 +158,18 @@ int send_msg(int sfd, struct msg *m)
 	case QUERY:
 		len += sizeof(m->query);
 		break;
+	case QUERY_RATES:
+		len += sizeof(m->query_rates);
+		break;
 	case ANSWER:
 		len += sizeof(m->answer);
 		break;
+	case ANSWER_ALL:
+		len += sizeof(m->answer_all);
+		break;
+	case ANSWER_RATES:
+		len += sizeof(m->answer_rates);
+		break;
 	default:
 		eprint("Unknown type %d\n", m->head.m_type);
 		return -1;
@@ -192,9 +201,18 @@ int recv_msg(int sfd, struct msg *m)
 	case QUERY:
 		len = sizeof(m->query);
 		break;
+	case QUERY_RATES:
+		len = sizeof(m->query_rates);
+		break;
 	case ANSWER:
 		len = sizeof(m->answer);
 		break;
+	case ANSWER_ALL:
+		len = sizeof(m->answer_all);
+		break;
+	case ANSWER_RATES:
+		len = sizeof(m->answer_rates);
+		break;
 	default:
 		eprint("Unknown type %d\n", m->head.m_type);
 		return -1;
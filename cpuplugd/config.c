@@ -31,6 +31,25 @@ static long parse_positive_value(char *ptr)
 	return value;
 }
 
+/*
+ * Return the value of a decimal number with optional fraction, e.g. "0.5",
+ * or -1 in error case.
+ */
+static double parse_positive_double(char *ptr)
+{
+	unsigned int i, dots = 0;
+
+	if (ptr == NULL || !isdigit(ptr[0]))
+		return -1;
+	for (i = 0; i < strlen(ptr); i++) {
+		if (ptr[i] == '.' && ++dots == 1)
+			continue;
+		if (isdigit(ptr[i]) == 0)
+			return -1;
+	}
+	return strtod(ptr, NULL);
+}
+
 char *get_var_rvalue(char *var_name)
 {
 	char tmp_name[MAX_VARNAME + 3]; /* +3 for '\0', '=' and '\n' */
@@ -82,8 +101,10 @@ static int check_term(char *symbol, char *name, char *rvalue, struct term **term
 		cpuplugd_debug("found the following rule: %s = %s\n",
 			       name, rvalue);
 		*term = parse_term(&rvalue, OP_PRIO_NONE);
-		if (rvalue[0] == '\0')
+		if (rvalue[0] == '\0') {
+			compile_term(*term);
 			return 1;
+		}
 		cpuplugd_exit("parsing error at %s, position: %s\n", symbol,
 			      rvalue);
 	}
@@ -151,7 +172,11 @@ static void parse_configline(char *line)
 	if (check_term("cmm_dec", name, rvalue, &cfg.cmm_dec))
 		return;
 
-	if (check_value("update", name, rvalue, &cfg.update)) {
+	if (!strncasecmp(name, "update", strlen("update"))) {
+		cfg.update = parse_positive_double(rvalue);
+		cpuplugd_debug("found update value: %f\n", cfg.update);
+		if (cfg.update < 0)
+			cpuplugd_exit("parsing error at update\n");
 		if (cfg.update > 0)
 			return;
 		cpuplugd_exit("update must be > 0\n");
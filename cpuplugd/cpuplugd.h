@@ -16,10 +16,12 @@
 #include <errno.h>
 #include <setjmp.h>
 #include <signal.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <syslog.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "lib/util_base.h"
@@ -30,7 +32,6 @@
 #define PIDFILE		"/run/cpuplugd.pid"
 #define LOCKFILE	"/var/lock/cpuplugd.lock"
 #define PROCINFO_LINE	512
-#define CPUSTAT_SIZE	1024
 #define VARINFO_SIZE	4096
 #define MAX_VARNAME	128
 #define MAX_LINESIZE	2048
@@ -120,12 +121,92 @@ struct symbols {
 	double guest_nice;
 };
 
+/*
+ * Slots of the values that are read from /proc/stat and /proc/loadavg
+ */
+enum cpustat_slot {
+	CPUSTAT_ONUMCPUS,
+	CPUSTAT_LOADAVG,
+	CPUSTAT_RUNNABLE,
+	CPUSTAT_USER,
+	CPUSTAT_NICE,
+	CPUSTAT_SYSTEM,
+	CPUSTAT_IDLE,
+	CPUSTAT_IOWAIT,
+	CPUSTAT_IRQ,
+	CPUSTAT_SOFTIRQ,
+	CPUSTAT_STEAL,
+	CPUSTAT_GUEST,
+	CPUSTAT_GUEST_NICE,
+	CPUSTAT_TOTAL_TICKS,
+	CPUSTAT_SLOTS
+};
+
+/*
+ * Numeric history of a /proc file
+ *
+ * The symbol names are read once at startup. Each snapshot of the file is
+ * parsed into one row of values, one row for each history level.
+ */
+struct proc_table {
+	const char *path;
+	char separator;
+	char **names;
+	size_t *name_lens;
+	unsigned int count;
+	double *values;		/* rows * count values */
+	char *valid;		/* rows * count flags for values found */
+	char *buf;		/* read buffer */
+	size_t buf_size;
+};
+
+/*
+ * Instructions of compiled terms
+ *
+ * The terms are compiled into postfix code for a value stack.
+ */
+enum insn_op {
+	INSN_CONST,		/* push value */
+	INSN_SYMBOL,		/* push double at offset arg of symbols */
+	INSN_PROC,		/* push slot arg of table with history index */
+	INSN_TIME,		/* push timestamp with history index */
+	INSN_NEG,
+	INSN_NOT,
+	INSN_BOOL,		/* replace top with top != 0 */
+	INSN_PLUS,
+	INSN_MINUS,
+	INSN_MULT,
+	INSN_DIV,
+	INSN_GREATER,
+	INSN_LESSER,
+	INSN_JZ,		/* jump to arg if top == 0, else pop */
+	INSN_JNZ,		/* jump to arg if top != 0, else pop */
+	INSN_INVALID,		/* operation arg cannot be evaluated */
+};
+
+struct insn {
+	enum insn_op op;
+	unsigned int arg;
+	unsigned int index;
+	double value;
+	struct proc_table *table;
+};
+
+struct code {
+	struct insn *insn;
+	unsigned int count;
+	unsigned int depth;	/* maximum stack depth */
+	double *stack;		/* value stack with depth entries */
+};
+
 struct term {
 	enum operation op;
 	double value;
 	struct term *left, *right;
 	char *proc_name;
 	unsigned int index;
+	struct code *code_bool;	/* compiled for eval_term() */
+	struct code *code_num;	/* compiled for eval_double() */
 };
 
 /*
@@ -135,7 +216,7 @@ struct term {
 struct config {
 	long cpu_max;
 	long cpu_min;
-	long update;
+	double update;
 	long cmm_max;
 	long cmm_min;
 	struct term *cmm_inc;
@@ -161,14 +242,11 @@ extern int num_cpu_start; /* # of online cpus at the time of the startup */
 extern long cmm_pagesize_start; /* cmm_pageize at the time of daemon startup */
 extern struct config cfg;
 extern int reload_pending;
-extern unsigned long meminfo_size;
-extern unsigned long vmstat_size;
-extern unsigned long cpustat_size;
 extern unsigned long varinfo_size;
-extern char *meminfo;
-extern char *vmstat;
-extern char *cpustat;
 extern char *varinfo;
+extern struct proc_table meminfo_table;
+extern struct proc_table vmstat_table;
+extern struct proc_table cpustat_table;
 extern double *timestamps;
 extern unsigned int history_max;
 extern unsigned int history_current;
@@ -183,12 +261,18 @@ void reactivate_cpus();
 void parse_configfile(char *file);
 void print_term(struct term *fn);
 struct term *parse_term(char **p, enum op_prio prio);
+void compile_term(struct term *fn);
 int eval_term(struct term *fn, struct symbols *symbols);
 double eval_double(struct term *fn, struct symbols *symbols);
-double get_proc_value(char *procinfo, char *name, char separator);
-void proc_read(char *procinfo, char *path, unsigned long size);
-void proc_cpu_read(char *procinfo);
-unsigned long proc_read_size(char *path);
+void proc_table_init(struct proc_table *table);
+void proc_table_alloc(struct proc_table *table, unsigned int rows);
+int proc_table_lookup(struct proc_table *table, const char *name);
+int proc_table_slot(struct proc_table *table, const char *name);
+void proc_table_read(struct proc_table *table, unsigned int row);
+double proc_table_value(struct proc_table *table, unsigned int slot,
+			unsigned int row);
+void proc_cpu_read(unsigned int row);
+unsigned int history_row(unsigned int index);
 char *get_var_rvalue(char *var_name);
 void cleanup_cmm(void);
 int hotplug(int cpuid);
@@ -202,9 +202,6 @@ void reload_daemon()
 		cpuplugd_exit("History depth %i exceeded maximum (%i)\n",
 			      history_max, MAX_HISTORY);
 	if (history_max != temp_history) {
-		free(meminfo);
-		free(vmstat);
-		free(cpustat);
 		free(timestamps);
 		setup_history();
 	}
@@ -44,10 +44,62 @@ void get_loadavg_runnable(double *loadavg, double *runnable)
 	return;
 }
 
-void proc_cpu_read(char *procinfo)
+static char *cpustat_names[CPUSTAT_SLOTS] = {
+	[CPUSTAT_ONUMCPUS] = "onumcpus",
+	[CPUSTAT_LOADAVG] = "loadavg",
+	[CPUSTAT_RUNNABLE] = "runnable_proc",
+	[CPUSTAT_USER] = "user",
+	[CPUSTAT_NICE] = "nice",
+	[CPUSTAT_SYSTEM] = "system",
+	[CPUSTAT_IDLE] = "idle",
+	[CPUSTAT_IOWAIT] = "iowait",
+	[CPUSTAT_IRQ] = "irq",
+	[CPUSTAT_SOFTIRQ] = "softirq",
+	[CPUSTAT_STEAL] = "steal",
+	[CPUSTAT_GUEST] = "guest",
+	[CPUSTAT_GUEST_NICE] = "guest_nice",
+	[CPUSTAT_TOTAL_TICKS] = "total_ticks",
+};
+
+struct proc_table meminfo_table = {
+	.path = "/proc/meminfo",
+	.separator = ':',
+};
+
+struct proc_table vmstat_table = {
+	.path = "/proc/vmstat",
+	.separator = ' ',
+};
+
+struct proc_table cpustat_table = {
+	.path = NULL,	/* filled by proc_cpu_read() */
+	.names = cpustat_names,
+	.count = CPUSTAT_SLOTS,
+};
+
+/*
+ * Return the history row for the history index of a symbol, e.g. 1 for
+ * the previous interval
+ */
+unsigned int history_row(unsigned int index)
+{
+	if (index <= history_current)
+		return history_current - index;
+	else
+		return history_max + 1 - (index - history_current);
+}
+
+static void proc_table_set(struct proc_table *table, unsigned int row,
+			   unsigned int slot, double value)
+{
+	table->values[row * table->count + slot] = value;
+	table->valid[row * table->count + slot] = 1;
+}
+
+void proc_cpu_read(unsigned int row)
 {
 	FILE *filp;
-	unsigned int rc, onumcpus;
+	unsigned int onumcpus;
 	unsigned long user, nice, system, idle, iowait, irq, softirq, steal,
 		      guest, guest_nice, total_ticks;
 	double loadavg, runnable;
@@ -56,102 +108,196 @@ void proc_cpu_read(char *procinfo)
 	filp = fopen("/proc/stat", "r");
 	if (!filp)
 		cpuplugd_exit("/proc/stat open failed: %s\n", strerror(errno));
-	rc = fscanf(filp, "cpu %ld %ld %ld %ld %ld %ld %ld %ld %ld %ld", &user,
-		    &nice, &system, &idle, &iowait, &irq, &softirq, &steal,
-		    &guest, &guest_nice);
+	if (fscanf(filp, "cpu %ld %ld %ld %ld %ld %ld %ld %ld %ld %ld", &user,
+		   &nice, &system, &idle, &iowait, &irq, &softirq, &steal,
+		   &guest, &guest_nice) < 8)
+		cpuplugd_exit("cannot parse /proc/stat\n");
+	fclose(filp);
 
 	get_loadavg_runnable(&loadavg, &runnable);
 	onumcpus = get_num_online_cpus();
 	total_ticks = user + nice + system + idle + iowait + irq + softirq +
 		      steal + guest + guest_nice;
 
-	rc = snprintf(procinfo, cpustat_size, "onumcpus %d\nloadavg %f\n"
-		      "runnable_proc %f\nuser %ld\nnice %ld\nsystem %ld\n"
-		      "idle %ld\niowait %ld\nirq %ld\nsoftirq %ld\nsteal %ld\n"
-		      "guest %ld\nguest_nice %ld\ntotal_ticks %ld\n",
-		      onumcpus, loadavg, runnable, user, nice, system, idle,
-		      iowait, irq, softirq, steal, guest, guest_nice,
-		      total_ticks);
-	if (rc >= cpustat_size)
-		cpuplugd_exit("cpustat buffer too small: need %d, have %ld "
-			      "(bytes)\n", rc, cpustat_size);
-	fclose(filp);
-	return;
+	proc_table_set(&cpustat_table, row, CPUSTAT_ONUMCPUS, onumcpus);
+	proc_table_set(&cpustat_table, row, CPUSTAT_LOADAVG, loadavg);
+	proc_table_set(&cpustat_table, row, CPUSTAT_RUNNABLE, runnable);
+	proc_table_set(&cpustat_table, row, CPUSTAT_USER, user);
+	proc_table_set(&cpustat_table, row, CPUSTAT_NICE, nice);
+	proc_table_set(&cpustat_table, row, CPUSTAT_SYSTEM, system);
+	proc_table_set(&cpustat_table, row, CPUSTAT_IDLE, idle);
+	proc_table_set(&cpustat_table, row, CPUSTAT_IOWAIT, iowait);
+	proc_table_set(&cpustat_table, row, CPUSTAT_IRQ, irq);
+	proc_table_set(&cpustat_table, row, CPUSTAT_SOFTIRQ, softirq);
+	proc_table_set(&cpustat_table, row, CPUSTAT_STEAL, steal);
+	proc_table_set(&cpustat_table, row, CPUSTAT_GUEST, guest);
+	proc_table_set(&cpustat_table, row, CPUSTAT_GUEST_NICE, guest_nice);
+	proc_table_set(&cpustat_table, row, CPUSTAT_TOTAL_TICKS, total_ticks);
 }
 
-void proc_read(char *procinfo, char *path, unsigned long size)
+/*
+ * Read the /proc file of a table into the read buffer, which is enlarged
+ * if the file has grown
+ */
+static void proc_read(struct proc_table *table)
 {
 	size_t bytes_read;
 	FILE *filp;
 
-	filp = fopen(path, "r");
+	filp = fopen(table->path, "r");
 	if (!filp)
-		cpuplugd_exit("%s open failed: %s\n", path, strerror(errno));
+		cpuplugd_exit("%s open failed: %s\n", table->path,
+			      strerror(errno));
+	while (1) {
+		bytes_read = fread(table->buf, 1, table->buf_size, filp);
+		if (bytes_read == 0)
+			cpuplugd_exit("%s read failed\n", table->path);
+		if (bytes_read < table->buf_size)
+			break;
+		table->buf_size *= 2;
+		table->buf = realloc(table->buf, table->buf_size);
+		if (!table->buf)
+			cpuplugd_exit("Out of memory: %s\n", table->path);
+		rewind(filp);
+	}
+	table->buf[bytes_read] = '\0';
+	fclose(filp);
+}
 
-	bytes_read = fread(procinfo, 1, size, filp);
-	if (bytes_read == 0)
-		cpuplugd_exit("%s read failed\n", path);
-	if (bytes_read == size)
-		cpuplugd_exit("procinfo buffer too small for %s\n", path);
+/*
+ * Read the symbol names of a /proc file, the lines have the format
+ * "<name><separator><value>"
+ */
+void proc_table_init(struct proc_table *table)
+{
+	char *line, *sep, *next;
+	unsigned int i;
 
-	procinfo[bytes_read] = '\0';
-	fclose(filp);
-	return;
+	if (!table->path)
+		goto out_lens;
+	table->buf_size = PROCINFO_LINE;
+	table->buf = malloc(table->buf_size);
+	if (!table->buf)
+		cpuplugd_exit("Out of memory: %s\n", table->path);
+	proc_read(table);
+
+	table->count = 0;
+	for (line = table->buf; *line; line = next) {
+		next = strchr(line, '\n');
+		next = next ? next + 1 : line + strlen(line);
+		sep = strchr(line, table->separator);
+		if (!sep || sep >= next || sep - line >= PROCINFO_LINE)
+			continue;
+		table->names = realloc(table->names, sizeof(char *) *
+				       (table->count + 1));
+		if (!table->names)
+			cpuplugd_exit("Out of memory: %s\n", table->path);
+		table->names[table->count] = strndup(line, sep - line);
+		if (!table->names[table->count])
+			cpuplugd_exit("Out of memory: %s\n", table->path);
+		table->count++;
+	}
+out_lens:
+	table->name_lens = malloc(sizeof(size_t) * (table->count + 1));
+	if (!table->name_lens)
+		cpuplugd_exit("Out of memory: name lengths\n");
+	for (i = 0; i < table->count; i++)
+		table->name_lens[i] = strlen(table->names[i]);
 }
 
-unsigned long proc_read_size(char *path)
+/*
+ * Allocate the values for a number of history rows
+ */
+void proc_table_alloc(struct proc_table *table, unsigned int rows)
 {
-	FILE *filp;
-	char buf[PROCINFO_LINE];
-	char *linep, *linep_offset;
-	unsigned long size;
+	free(table->values);
+	free(table->valid);
+	table->values = calloc(rows * table->count + 1, sizeof(double));
+	table->valid = calloc(rows * table->count + 1, 1);
+	if (!table->values || !table->valid)
+		cpuplugd_exit("Out of memory: history\n");
+}
 
-	filp = fopen(path, "r");
-	if (!filp)
-		cpuplugd_exit("%s open failed: %s\n", path, strerror(errno));
+/*
+ * Return the slot of a symbol name or -1 if the name is unknown
+ */
+int proc_table_lookup(struct proc_table *table, const char *name)
+{
+	unsigned int i;
 
-	size = 0;
-	while ((linep = fgets(buf, sizeof(buf), filp))) {
-		if (!(linep_offset = strchr(linep, '\n')))
-			cpuplugd_exit("buf too small for line\n");
-		size = size + linep_offset - linep + 1;
+	for (i = 0; i < table->count; i++) {
+		if (strcmp(table->names[i], name) == 0)
+			return i;
 	}
-	fclose(filp);
-	return size;
+	return -1;
+}
+
+/*
+ * Return the slot of a symbol name and exit if the name is unknown
+ */
+int proc_table_slot(struct proc_table *table, const char *name)
+{
+	int slot;
+
+	slot = proc_table_lookup(table, name);
+	if (slot < 0)
+		cpuplugd_exit("Symbol %s not found, check your config file\n",
+			      name);
+	return slot;
 }
 
-double get_proc_value(char *procinfo, char *name, char separator)
+/*
+ * Read a snapshot of the /proc file and parse it into a history row
+ *
+ * The lines are usually in the same order as at startup, so each line is
+ * first compared with the name in the corresponding slot.
+ */
+void proc_table_read(struct proc_table *table, unsigned int row)
 {
-	char buf[PROCINFO_LINE];
-	char *proc_offset;
-	unsigned long proc_length, name_length;
+	char *line, *next, *sep, *name;
+	unsigned int i;
 	double value;
-	int found;
-
-	value = -1;
-	found = 0;
-	name_length = strlen(name);
-	while ((proc_offset = strchr(procinfo, separator))) {
-		proc_length = proc_offset - procinfo;
-		/*
-		 * proc_read_size() made sure that proc_length < PROCINFO_LINE
-		 */
-		memcpy(buf, procinfo, proc_length);
-		buf[proc_length] = '\0';
-		procinfo = proc_offset + 1;
-		if (strncmp(buf, name, MAX(proc_length, name_length)) == 0) {
-			errno = 0;
-			value = strtod(procinfo, NULL);
-			if (errno)
-				cpuplugd_exit("strtod failed\n");
-			found = 1;
-			break;
+	int slot;
+
+	proc_read(table);
+	memset(&table->valid[row * table->count], 0, table->count);
+	for (i = 0, line = table->buf; *line; i++, line = next) {
+		next = strchr(line, '\n');
+		next = next ? next + 1 : line + strlen(line);
+		if (i < table->count &&
+		    strncmp(line, table->names[i], table->name_lens[i]) == 0 &&
+		    line[table->name_lens[i]] == table->separator) {
+			slot = i;
+			sep = line + table->name_lens[i];
+		} else {
+			sep = strchr(line, table->separator);
+			if (!sep || sep >= next)
+				continue;
+			name = strndup(line, sep - line);
+			if (!name)
+				cpuplugd_exit("Out of memory: %s\n",
+					      table->path);
+			slot = proc_table_lookup(table, name);
+			free(name);
+			if (slot < 0)
+				continue;
 		}
-		proc_offset = strchr(procinfo, '\n');
-		procinfo = proc_offset + 1;
+		errno = 0;
+		value = strtod(sep + 1, NULL);
+		if (errno)
+			cpuplugd_exit("strtod failed\n");
+		proc_table_set(table, row, slot, value);
 	}
-	if (!found)
+}
+
+/*
+ * Return the value of a slot in a history row
+ */
+double proc_table_value(struct proc_table *table, unsigned int slot,
+			unsigned int row)
+{
+	if (!table->valid[row * table->count + slot])
 		cpuplugd_exit("Symbol %s not found, check your config file\n",
-			      name);
-	return value;
+			      table->names[slot]);
+	return table->values[row * table->count + slot];
 }
@@ -56,8 +56,8 @@ struct config cfg = {
 
 int num_cpu_start, memory, cpu, reload_pending;
 long cmm_pagesize_start;
-unsigned long meminfo_size, vmstat_size, cpustat_size, varinfo_size;
-char *meminfo, *vmstat, *cpustat, *varinfo;
+unsigned long varinfo_size;
+char *varinfo;
 double *timestamps;
 unsigned int history_max, history_current, history_prev, sym_names_count;
 
@@ -73,46 +73,36 @@ static void sigfpe_handler(int UNUSED(sig))
 	longjmp(jmpenv, 1);
 }
 
+/*
+ * Return the difference of a cpustat value to the previous interval
+ */
+static double cpustat_diff(enum cpustat_slot slot)
+{
+	return proc_table_value(&cpustat_table, slot, history_current) -
+	       proc_table_value(&cpustat_table, slot, history_prev);
+}
+
 static void eval_cpu_rules(void)
 {
 	double diffs[CPUSTATS], diffs_total, percent_factor;
-	char *procinfo_current, *procinfo_prev;
 	int cpu, nr_cpus, on_off;
+	unsigned int i;
 
 	nr_cpus = get_numcpus();
-	procinfo_current = cpustat + history_current * cpustat_size;
-	procinfo_prev = cpustat + history_prev * cpustat_size;
-
-	diffs[0] = get_proc_value(procinfo_current, "user", ' ') -
-		   get_proc_value(procinfo_prev, "user", ' ');
-	diffs[1] = get_proc_value(procinfo_current, "nice", ' ') -
-		   get_proc_value(procinfo_prev, "nice", ' ');
-	diffs[2] = get_proc_value(procinfo_current, "system", ' ') -
-		   get_proc_value(procinfo_prev, "system", ' ');
-	diffs[3] = get_proc_value(procinfo_current, "idle", ' ') -
-		   get_proc_value(procinfo_prev, "idle", ' ');
-	diffs[4] = get_proc_value(procinfo_current, "iowait", ' ') -
-		   get_proc_value(procinfo_prev, "iowait", ' ');
-	diffs[5] = get_proc_value(procinfo_current, "irq", ' ') -
-		   get_proc_value(procinfo_prev, "irq", ' ');
-	diffs[6] = get_proc_value(procinfo_current, "softirq", ' ') -
-		   get_proc_value(procinfo_prev, "softirq", ' ');
-	diffs[7] = get_proc_value(procinfo_current, "steal", ' ') -
-		   get_proc_value(procinfo_prev, "steal", ' ');
-	diffs[8] = get_proc_value(procinfo_current, "guest", ' ') -
-		   get_proc_value(procinfo_prev, "guest", ' ');
-	diffs[9] = get_proc_value(procinfo_current, "guest_nice", ' ') -
-		   get_proc_value(procinfo_prev, "guest_nice", ' ');
-
-	diffs_total = get_proc_value(procinfo_current, "total_ticks", ' ') -
-		      get_proc_value(procinfo_prev, "total_ticks", ' ');
+	for (i = 0; i < CPUSTATS; i++)
+		diffs[i] = cpustat_diff(CPUSTAT_USER + i);
+
+	diffs_total = cpustat_diff(CPUSTAT_TOTAL_TICKS);
 	if (diffs_total == 0)
 		diffs_total = 1;
 
-	symbols.loadavg = get_proc_value(procinfo_current, "loadavg", ' ');
-	symbols.runnable_proc = get_proc_value(procinfo_current,
-					       "runnable_proc", ' ');
-	symbols.onumcpus = get_proc_value(procinfo_current, "onumcpus", ' ');
+	symbols.loadavg = proc_table_value(&cpustat_table, CPUSTAT_LOADAVG,
+					   history_current);
+	symbols.runnable_proc = proc_table_value(&cpustat_table,
+						 CPUSTAT_RUNNABLE,
+						 history_current);
+	symbols.onumcpus = proc_table_value(&cpustat_table, CPUSTAT_ONUMCPUS,
+					    history_current);
 
 	percent_factor = 100 * symbols.onumcpus;
 	symbols.user = (diffs[0] / diffs_total) * percent_factor;
@@ -127,8 +117,11 @@ static void eval_cpu_rules(void)
 	symbols.guest_nice = (diffs[9] / diffs_total) * percent_factor;
 
 	/* only use this for development and testing */
-	cpuplugd_debug("cpustat values:\n%s", cpustat + history_current *
-		       cpustat_size);
+	cpuplugd_debug("cpustat values:\n");
+	for (i = 0; i < CPUSTAT_SLOTS; i++)
+		cpuplugd_debug("%s %f\n", cpustat_table.names[i],
+			       proc_table_value(&cpustat_table, i,
+						history_current));
 	if (debug && foreground == 1) {
 		printf("-------------------- CPU --------------------\n");
 		printf("cpu_min: %ld\n", cfg.cpu_min);
@@ -209,27 +202,33 @@ static void eval_cpu_rules(void)
 	}
 }
 
+/*
+ * Return the difference of a vmstat value to the previous interval
+ */
+static double vmstat_diff(unsigned int slot)
+{
+	return proc_table_value(&vmstat_table, slot, history_current) -
+	       proc_table_value(&vmstat_table, slot, history_prev);
+}
+
 static void eval_mem_rules(double interval)
 {
 	long cmmpages_size, cmm_inc, cmm_dec, cmm_new;
 	double free_memory, swaprate, apcr;
-	char *procinfo_current, *procinfo_prev;
-
-	procinfo_current = meminfo + history_current * meminfo_size;
-	free_memory = get_proc_value(procinfo_current, "MemFree", ':');
-
-	procinfo_current = vmstat + history_current * vmstat_size;
-	procinfo_prev = vmstat + history_prev * vmstat_size;
-	swaprate = (get_proc_value(procinfo_current, "pswpin", ' ') +
-		    get_proc_value(procinfo_current, "pswpout", ' ') -
-		    get_proc_value(procinfo_prev, "pswpin", ' ') -
-		    get_proc_value(procinfo_prev, "pswpout", ' ')) /
-		    interval;
-	apcr = (get_proc_value(procinfo_current, "pgpgin", ' ') +
-		get_proc_value(procinfo_current, "pgpgout", ' ') -
-		get_proc_value(procinfo_prev, "pgpgin", ' ') -
-		get_proc_value(procinfo_prev, "pgpgout", ' ')) /
-		interval;
+	static int memfree = -1, pswpin, pswpout, pgpgin, pgpgout;
+
+	if (memfree < 0) {
+		memfree = proc_table_slot(&meminfo_table, "MemFree");
+		pswpin = proc_table_slot(&vmstat_table, "pswpin");
+		pswpout = proc_table_slot(&vmstat_table, "pswpout");
+		pgpgin = proc_table_slot(&vmstat_table, "pgpgin");
+		pgpgout = proc_table_slot(&vmstat_table, "pgpgout");
+	}
+	free_memory = proc_table_value(&meminfo_table, memfree,
+				       history_current);
+
+	swaprate = (vmstat_diff(pswpin) + vmstat_diff(pswpout)) / interval;
+	apcr = (vmstat_diff(pgpgin) + vmstat_diff(pgpgout)) / interval;
 
 	cmmpages_size = get_cmmpages_size();
 	symbols.apcr = apcr;			// apcr in 512 byte blocks / sec
@@ -319,25 +318,35 @@ static void time_read(double *timestamps)
 	return;
 }
 
+/*
+ * Sleep for the update interval, which can be a fraction of a second.
+ * A signal, e.g. SIGHUP for a reload, ends the sleep early.
+ */
+static void update_sleep(void)
+{
+	struct timespec ts;
+
+	ts.tv_sec = cfg.update;
+	ts.tv_nsec = (cfg.update - ts.tv_sec) * 1000000000;
+	nanosleep(&ts, NULL);
+}
+
+/*
+ * Read the current values of all /proc files into a history row
+ */
+static void proc_snapshot(unsigned int row)
+{
+	time_read(&timestamps[row]);
+	proc_table_read(&meminfo_table, row);
+	proc_table_read(&vmstat_table, row);
+	proc_cpu_read(row);
+}
+
 void setup_history()
 {
-	/*
-	 * The /proc file size will vary during intervals, use double of current
-	 * size to have enough buffer for growing values.
-	 */
-	meminfo_size = proc_read_size("/proc/meminfo") * 2;
-	vmstat_size = proc_read_size("/proc/vmstat") * 2;
-	cpustat_size = CPUSTAT_SIZE;
-
-	meminfo = malloc(meminfo_size * (history_max + 1));
-	if (!meminfo)
-		cpuplugd_exit("Out of memory: meminfo\n");
-	vmstat = malloc(vmstat_size * (history_max + 1));
-	if (!vmstat)
-		cpuplugd_exit("Out of memory: vmstat\n");
-	cpustat = malloc(cpustat_size * (history_max + 1));
-	if (!cpustat)
-		cpuplugd_exit("Out of memory: cpustat\n");
+	proc_table_alloc(&meminfo_table, history_max + 1);
+	proc_table_alloc(&vmstat_table, history_max + 1);
+	proc_table_alloc(&cpustat_table, history_max + 1);
 	timestamps = malloc(sizeof(double) * (history_max + 1));
 	if (!timestamps)
 		cpuplugd_exit("Out of memory: timestamps\n");
@@ -349,13 +358,8 @@ void setup_history()
 	cpuplugd_info("Waiting %i intervals to accumulate history.\n",
 		      history_max);
 	do {
-		time_read(&timestamps[history_current]);
-		proc_read(meminfo + history_current * meminfo_size,
-			  "/proc/meminfo", meminfo_size);
-		proc_read(vmstat + history_current * vmstat_size,
-			  "/proc/vmstat", vmstat_size);
-		proc_cpu_read(cpustat + history_current * cpustat_size);
-		sleep(cfg.update);
+		proc_snapshot(history_current);
+		update_sleep();
 		history_current++;
 	} while (history_current < history_max);
 	history_current--;
@@ -404,6 +408,11 @@ int main(int argc, char *argv[])
 	handle_signals();
 	handle_sighup();
 
+	/* Read the symbol names of the /proc files for rule compilation */
+	proc_table_init(&meminfo_table);
+	proc_table_init(&vmstat_table);
+	proc_table_init(&cpustat_table);
+
 	/* Need 1 history level minimum for internal symbols */
 	history_max = 1;
 	/*
@@ -448,15 +457,10 @@ int main(int argc, char *argv[])
 
 		history_prev = history_current;
 		history_current = (history_current + 1) % (history_max + 1);
-		time_read(&timestamps[history_current]);
-		proc_read(meminfo + history_current * meminfo_size,
-			  "/proc/meminfo", meminfo_size);
-		proc_read(vmstat + history_current * vmstat_size,
-			  "/proc/vmstat", vmstat_size);
-		proc_cpu_read(cpustat + history_current * cpustat_size);
+		proc_snapshot(history_current);
 		interval = timestamps[history_current] -
 			   timestamps[history_prev];
-		cpuplugd_debug("config update interval: %ld seconds\n",
+		cpuplugd_debug("config update interval: %f seconds\n",
 			       cfg.update);
 		cpuplugd_debug("real update interval: %f seconds\n", interval);
 
@@ -477,7 +481,7 @@ int main(int argc, char *argv[])
 					       "skipping memory rule "
 					       "evaluation.\n");
 		}
-		sleep(cfg.update);
+		update_sleep();
 	}
 	return 0;
 }
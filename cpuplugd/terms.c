@@ -326,6 +326,7 @@ struct term *parse_term(char **p, enum op_prio prio)
 			if (fn == NULL)
 				goto out_error;
 			fn->op = sym_names[i].symop;
+			fn->index = 0;
 			s += strlen(sym_names[i].name);
 			length = 0;
 			if (fn->op == OP_SYMBOL_MEMINFO ||
@@ -413,138 +414,308 @@ out_error:
 	return NULL;
 }
 
-static double get_value(struct term *fn)
-{
-	double value = 0;
-	char *procinfo;
-	unsigned int history_index;
+static unsigned int code_sp;
 
-	if (fn->index <= history_current)
-		history_index = history_current - fn->index;
-	else
-		history_index = history_max + 1 - (fn->index - history_current);
+static struct insn *code_emit(struct code *code, enum insn_op op)
+{
+	struct insn *insn;
 
-	switch (fn->op) {
-	case OP_SYMBOL_MEMINFO:
-		procinfo = meminfo + history_index * meminfo_size;
-		value = get_proc_value(procinfo, fn->proc_name, ':');
-		break;
-	case OP_SYMBOL_VMSTAT:
-		procinfo = vmstat + history_index * vmstat_size;
-		value = get_proc_value(procinfo, fn->proc_name, ' ');
-		break;
-	case OP_SYMBOL_CPUSTAT:
-		procinfo = cpustat + history_index * cpustat_size;
-		value = get_proc_value(procinfo, fn->proc_name, ' ');
-		break;
-	case OP_SYMBOL_TIME:
-		value = timestamps[history_index];
+	code->insn = realloc(code->insn, sizeof(struct insn) *
+			     (code->count + 1));
+	if (code->insn == NULL)
+		cpuplugd_exit("Out of memory: compiled term\n");
+	insn = &code->insn[code->count++];
+	memset(insn, 0, sizeof(*insn));
+	insn->op = op;
+	switch (op) {
+	case INSN_CONST:
+	case INSN_SYMBOL:
+	case INSN_PROC:
+	case INSN_TIME:
+	case INSN_INVALID:
+		code_sp++;
+		break;
+	case INSN_PLUS:
+	case INSN_MINUS:
+	case INSN_MULT:
+	case INSN_DIV:
+	case INSN_GREATER:
+	case INSN_LESSER:
+	case INSN_JZ:	/* the fall-through path pops the top */
+	case INSN_JNZ:
+		code_sp--;
+		break;
+	case INSN_NEG:
+	case INSN_NOT:
+	case INSN_BOOL:
 		break;
-	default:
-		cpuplugd_exit("Invalid term specified: %i\n", fn->op);
 	}
-	return value;
+	if (code->depth < code_sp)
+		code->depth = code_sp;
+	return insn;
 }
 
-double eval_double(struct term *fn, struct symbols *symbols)
+static void code_emit_symbol(struct code *code, size_t offset)
 {
-	double a, b, sum;
+	code_emit(code, INSN_SYMBOL)->arg = offset;
+}
+
+static void code_emit_proc(struct code *code, struct proc_table *table,
+			   struct term *fn)
+{
+	struct insn *insn;
+	int slot;
+
+	slot = proc_table_slot(table, fn->proc_name);
+	insn = code_emit(code, INSN_PROC);
+	insn->table = table;
+	insn->arg = slot;
+	insn->index = fn->index;
+}
+
+/*
+ * Compile a term with the semantics of eval_double()
+ */
+static void compile_num(struct code *code, struct term *fn)
+{
+	enum insn_op op;
 
 	switch (fn->op) {
 	case OP_SYMBOL_LOADAVG:
-		return symbols->loadavg;
+		code_emit_symbol(code, offsetof(struct symbols, loadavg));
+		return;
 	case OP_SYMBOL_RUNABLE:
-		return symbols->runnable_proc;
+		code_emit_symbol(code, offsetof(struct symbols, runnable_proc));
+		return;
 	case OP_SYMBOL_CPUS:
-		return symbols->onumcpus;
+		code_emit_symbol(code, offsetof(struct symbols, onumcpus));
+		return;
 	case OP_SYMBOL_USER:
-		return symbols->user;
+		code_emit_symbol(code, offsetof(struct symbols, user));
+		return;
 	case OP_SYMBOL_NICE:
-		return symbols->nice;
+		code_emit_symbol(code, offsetof(struct symbols, nice));
+		return;
 	case OP_SYMBOL_SYSTEM:
-		return symbols->system;
+		code_emit_symbol(code, offsetof(struct symbols, system));
+		return;
 	case OP_SYMBOL_IDLE:
-		return symbols->idle;
+		code_emit_symbol(code, offsetof(struct symbols, idle));
+		return;
 	case OP_SYMBOL_IOWAIT:
-		return symbols->iowait;
+		code_emit_symbol(code, offsetof(struct symbols, iowait));
+		return;
 	case OP_SYMBOL_IRQ:
-		return symbols->irq;
+		code_emit_symbol(code, offsetof(struct symbols, irq));
+		return;
 	case OP_SYMBOL_SOFTIRQ:
-		return symbols->softirq;
+		code_emit_symbol(code, offsetof(struct symbols, softirq));
+		return;
 	case OP_SYMBOL_STEAL:
-		return symbols->steal;
+		code_emit_symbol(code, offsetof(struct symbols, steal));
+		return;
 	case OP_SYMBOL_GUEST:
-		return symbols->guest;
+		code_emit_symbol(code, offsetof(struct symbols, guest));
+		return;
 	case OP_SYMBOL_GUEST_NICE:
-		return symbols->guest_nice;
+		code_emit_symbol(code, offsetof(struct symbols, guest_nice));
+		return;
 	case OP_SYMBOL_FREEMEM:
-		return symbols->freemem;
+		code_emit_symbol(code, offsetof(struct symbols, freemem));
+		return;
 	case OP_SYMBOL_APCR:
-		return symbols->apcr;
+		code_emit_symbol(code, offsetof(struct symbols, apcr));
+		return;
 	case OP_SYMBOL_SWAPRATE:
-		return symbols->swaprate;
+		code_emit_symbol(code, offsetof(struct symbols, swaprate));
+		return;
 	case OP_SYMBOL_MEMINFO:
+		code_emit_proc(code, &meminfo_table, fn);
+		return;
 	case OP_SYMBOL_VMSTAT:
+		code_emit_proc(code, &vmstat_table, fn);
+		return;
 	case OP_SYMBOL_CPUSTAT:
+		code_emit_proc(code, &cpustat_table, fn);
+		return;
 	case OP_SYMBOL_TIME:
-		return get_value(fn);
+		code_emit(code, INSN_TIME)->index = fn->index;
+		return;
 	case OP_CONST:
-		return fn->value;
+		code_emit(code, INSN_CONST)->value = fn->value;
+		return;
 	case OP_NEG:
-		return -eval_double(fn->left, symbols);
+		compile_num(code, fn->left);
+		code_emit(code, INSN_NEG);
+		return;
 	case OP_PLUS:
-		return eval_double(fn->left, symbols) +
-			eval_double(fn->right, symbols);
+		op = INSN_PLUS;
+		break;
 	case OP_MINUS:
-		return eval_double(fn->left, symbols) -
-			eval_double(fn->right, symbols);
+		op = INSN_MINUS;
+		break;
 	case OP_MULT:
-		a = eval_double(fn->left, symbols);
-		b = eval_double(fn->right, symbols);
-		sum = a*b;
-		return sum;
-		/*return eval_double(fn->left, symbols) *
-			eval_double(fn->right, symbols);*/
+		op = INSN_MULT;
+		break;
 	case OP_DIV:
-		a = eval_double(fn->left, symbols);
-		b = eval_double(fn->right, symbols);
-		sum = a/b;
-		return sum;
-		/*return eval_double(fn->left, symbols) /
-			eval_double(fn->right, symbols); */
-	case OP_NOT:
-	case OP_AND:
-	case OP_OR:
-	case OP_GREATER:
-	case OP_LESSER:
-	case VAR_LOAD:
-	case VAR_RUN:
-	case VAR_ONLINE:
-		cpuplugd_exit("Invalid term specified: %i\n", fn->op);
+		op = INSN_DIV;
+		break;
+	default:
+		/* Reported when the term is evaluated */
+		code_emit(code, INSN_INVALID)->arg = fn->op;
+		return;
 	}
-	return 0;
+	compile_num(code, fn->left);
+	compile_num(code, fn->right);
+	code_emit(code, op);
 }
 
-int eval_term(struct term *fn, struct symbols *symbols)
+/*
+ * Compile a term with the semantics of eval_term()
+ */
+static void compile_bool(struct code *code, struct term *fn)
 {
-	if (fn == NULL || symbols == NULL)
-		return 0.0;
+	unsigned int jump;
+
 	switch (fn->op) {
 	case OP_NOT:
-		return !eval_term(fn->left, symbols);
+		compile_bool(code, fn->left);
+		code_emit(code, INSN_NOT);
+		break;
 	case OP_OR:
-		return eval_term(fn->left, symbols) == 1 ||
-			eval_term(fn->right, symbols) == 1;
 	case OP_AND:
-		return eval_term(fn->left, symbols) == 1 &&
-			eval_term(fn->right, symbols) == 1;
+		/* Evaluate the right term only if the left one does not decide */
+		compile_bool(code, fn->left);
+		jump = code->count;
+		code_emit(code, fn->op == OP_OR ? INSN_JNZ : INSN_JZ);
+		compile_bool(code, fn->right);
+		code->insn[jump].arg = code->count;
+		break;
 	case OP_GREATER:
-		return eval_double(fn->left, symbols) >
-			eval_double(fn->right, symbols);
 	case OP_LESSER:
-		return eval_double(fn->left, symbols) <
-			eval_double(fn->right, symbols);
+		compile_num(code, fn->left);
+		compile_num(code, fn->right);
+		code_emit(code, fn->op == OP_GREATER ? INSN_GREATER :
+			  INSN_LESSER);
+		break;
 	default:
-		return eval_double(fn, symbols) != 0.0;
+		compile_num(code, fn);
+		code_emit(code, INSN_BOOL);
+		break;
+	}
+}
+
+static struct code *compile(struct term *fn,
+			    void (*compile_fn)(struct code *, struct term *))
+{
+	struct code *code;
+
+	code = calloc(1, sizeof(*code));
+	if (code == NULL)
+		cpuplugd_exit("Out of memory: compiled term\n");
+	code_sp = 0;
+	compile_fn(code, fn);
+	code->stack = malloc(sizeof(double) * code->depth);
+	if (code->stack == NULL)
+		cpuplugd_exit("Out of memory: compiled term\n");
+	return code;
+}
+
+/*
+ * Compile a parsed term into postfix code, so that the rules are evaluated
+ * without walking the term tree and /proc symbols are resolved only once
+ */
+void compile_term(struct term *fn)
+{
+	if (fn == NULL)
+		return;
+	fn->code_bool = compile(fn, compile_bool);
+	fn->code_num = compile(fn, compile_num);
+}
+
+static double run_code(struct code *code, struct symbols *symbols)
+{
+	double *stack = code->stack;
+	unsigned int ip, sp = 0;
+	struct insn *insn;
+
+	for (ip = 0; ip < code->count; ip++) {
+		insn = &code->insn[ip];
+		switch (insn->op) {
+		case INSN_CONST:
+			stack[sp++] = insn->value;
+			break;
+		case INSN_SYMBOL:
+			stack[sp++] = *(double *)((char *) symbols + insn->arg);
+			break;
+		case INSN_PROC:
+			stack[sp++] = proc_table_value(insn->table, insn->arg,
+						       history_row(insn->index));
+			break;
+		case INSN_TIME:
+			stack[sp++] = timestamps[history_row(insn->index)];
+			break;
+		case INSN_NEG:
+			stack[sp - 1] = -stack[sp - 1];
+			break;
+		case INSN_NOT:
+			stack[sp - 1] = stack[sp - 1] == 0.0;
+			break;
+		case INSN_BOOL:
+			stack[sp - 1] = stack[sp - 1] != 0.0;
+			break;
+		case INSN_PLUS:
+			sp--;
+			stack[sp - 1] += stack[sp];
+			break;
+		case INSN_MINUS:
+			sp--;
+			stack[sp - 1] -= stack[sp];
+			break;
+		case INSN_MULT:
+			sp--;
+			stack[sp - 1] *= stack[sp];
+			break;
+		case INSN_DIV:
+			sp--;
+			stack[sp - 1] /= stack[sp];
+			break;
+		case INSN_GREATER:
+			sp--;
+			stack[sp - 1] = stack[sp - 1] > stack[sp];
+			break;
+		case INSN_LESSER:
+			sp--;
+			stack[sp - 1] = stack[sp - 1] < stack[sp];
+			break;
+		case INSN_JZ:
+			if (stack[sp - 1] == 0.0)
+				ip = insn->arg - 1;
+			else
+				sp--;
+			break;
+		case INSN_JNZ:
+			if (stack[sp - 1] != 0.0)
+				ip = insn->arg - 1;
+			else
+				sp--;
+			break;
+		case INSN_INVALID:
+			cpuplugd_exit("Invalid term specified: %i\n",
+				      insn->arg);
+		}
 	}
+	return stack[0];
+}
+
+double eval_double(struct term *fn, struct symbols *symbols)
+{
+	return run_code(fn->code_num, symbols);
+}
+
+int eval_term(struct term *fn, struct symbols *symbols)
+{
+	if (fn == NULL || symbols == NULL)
+		return 0.0;
+	return run_code(fn->code_bool, symbols) != 0.0;
 }
@@ -0,0 +1,84 @@
+#!/bin/sh
+#
+# genprotimg_bench.sh - Benchmark genprotimg with large ramdisks
+#
+# Usage: genprotimg_bench.sh [SIZES] [JOBS...]
+#
+# Create a random kernel image and random ramdisks of each size in
+# SIZES (MiB, comma separated, default 64,256,1024) and measure the run
+# time and the maximum resident set size of "genprotimg --jobs JOBS" for
+# each JOBS value (default 1 2 4 8). The maximum resident set size is
+# only shown if GNU time is available as TIME (default /usr/bin/time).
+# A self-signed host certificate is created with openssl, so
+# "--no-cert-check" is used.
+#
+# genprotimg loads the stage3a and stage3b loaders from the installed
+# package data directory, so run "make install" first or point
+# GENPROTIMG to an installed binary.
+#
+# Copyright IBM Corp. 2020
+#
+# s390-tools is free software; you can redistribute it and/or modify
+# it under the terms of the MIT license. See LICENSE for details.
+#
+
+SIZES=${1:-64,256,1024}
+[ $# -gt 0 ] && shift
+JOBS=${*:-1 2 4 8}
+GENPROTIMG=${GENPROTIMG:-./src/genprotimg}
+TIME=${TIME:-/usr/bin/time}
+
+root=`mktemp -d /tmp/genprotimg_bench.XXXXXX` || exit 1
+trap "rm -rf $root" EXIT TERM INT
+
+now_ms() {
+	echo $((`date +%s%N` / 1000000))
+}
+
+# Run the command $@ and write its run time in seconds and its maximum
+# resident set size in kB to $root/time
+run() {
+	if [ -x "$TIME" ]; then
+		$TIME -f "%e %M" -o $root/time "$@"
+	else
+		start=`now_ms`
+		"$@" || return
+		end=`now_ms`
+		ms=$((end - start))
+		printf "%d.%03d -\n" $((ms / 1000)) $((ms % 1000)) > $root/time
+	fi
+}
+
+openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:secp521r1 \
+	-nodes -subj "/CN=genprotimg_bench" -days 1 \
+	-keyout $root/host.key -out $root/host.crt 2> /dev/null || exit 1
+head -c 32 /dev/urandom > $root/header.key
+head -c 64 /dev/urandom > $root/comp.key
+head -c $((8 * 1024 * 1024)) /dev/urandom > $root/image
+echo "root=/dev/ram0" > $root/parmfile
+
+printf "%-10s %-6s %10s %12s\n" "size [MiB]" "jobs" "time [s]" "max RSS [kB]"
+for size in `echo $SIZES | tr , ' '`; do
+	head -c $((size * 1024 * 1024)) /dev/urandom > $root/ramdisk
+	ref=
+	for j in $JOBS; do
+		run $GENPROTIMG --no-cert-check --jobs $j \
+			--host-certificate $root/host.crt \
+			--header-key $root/header.key --comp-key $root/comp.key \
+			--image $root/image --ramdisk $root/ramdisk \
+			--parmfile $root/parmfile --output $root/out.img \
+			2> /dev/null || { echo "genprotimg --jobs $j failed" >&2; exit 1; }
+		read t rss < $root/time
+		printf "%-10s %-6s %10s %12s\n" $size $j $t $rss
+		# The header and the tweaks contain random data, so only the
+		# image size is compared here. "make check" compares the
+		# encrypted components for different numbers of threads.
+		out=`stat -c %s $root/out.img`
+		if [ -z "$ref" ]; then
+			ref=$out
+		elif [ "$ref" != "$out" ]; then
+			echo "Image size of genprotimg --jobs $j differs" >&2
+			exit 1
+		fi
+	done
+done
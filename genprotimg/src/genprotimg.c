@@ -27,39 +27,21 @@ enum {	LOGLEVEL_CRITICAL = 0,
 };
 
 static gint debug_level;
-static gchar *tmp_dir;
+/* path of the temporary image file, set as soon as it is created */
+static gchar *image_path;
 
-static void rmdir_recursive(gchar *dir_path, GError **err)
+static void remove_image_file(void)
 {
-	const gchar *file = NULL;
-	g_autoptr(GDir) d = NULL;
-
-	if (!dir_path)
+	if (!image_path)
 		return;
 
-	d = g_dir_open(dir_path, 0, err);
-	if (!d) {
-		g_set_error(err, G_FILE_ERROR, (gint)g_file_error_from_errno(errno),
-			    _("Failed to open directory '%s': %s"), dir_path, g_strerror(errno));
-		return;
-	}
-
-	while ((file = g_dir_read_name(d)) != NULL) {
-		g_autofree gchar *file_path = g_build_filename(dir_path, file, NULL);
-		/* ignore error */
-		(void)g_unlink(file_path);
-	}
-
-	if (g_rmdir(dir_path) != 0) {
-		g_set_error(err, G_FILE_ERROR, (gint)g_file_error_from_errno(errno),
-			    _("Failed to remove directory '%s': %s"), dir_path, g_strerror(errno));
-		return;
-	}
+	/* ignore error */
+	(void)g_unlink(image_path);
 }
 
 static void sig_term_handler(int signal G_GNUC_UNUSED)
 {
-	rmdir_recursive(tmp_dir, NULL);
+	remove_image_file();
 	exit(EXIT_FAILURE);
 }
 
@@ -117,9 +99,10 @@ static void remove_signal_handler(const gint *signals, const gsize signals_n)
  *    comp = prepare_component (encryption/size alignment) -> needs: keys
  *    + tweak
  * 2. add stub stage3a (so we can calculate the memory addresses)
- * 3. add other components(): calc src, dest, and hashes
+ * 3. add other components(): calc src, dest, and hashes. Each component
+ *    is read, encrypted, hashed and written to the image file in one pass
  * 4. build and add stage3b: calculate the hashes
- * 5. update stage3a
+ * 5. update stage3a and write it to the image file
  */
 int main(int argc, char *argv[])
 {
@@ -136,10 +119,6 @@ int main(int argc, char *argv[])
 	if (pv_args_parse_options(pv_args, &argc, &argv, &err) < 0)
 		goto error;
 
-	/* create a temporary directory which will be used for the
-	 * preparation of the user components */
-	pv_args->tmp_dir = g_dir_make_tmp("genprotimg-XXXXXX", &err);
-
 	/* set new log level */
 	debug_level = pv_args->log_level;
 
@@ -151,6 +130,7 @@ int main(int argc, char *argv[])
 	img = pv_img_new(pv_args, GENPROTIMG_STAGE3A_PATH, &err);
 	if (!img)
 		goto error;
+	image_path = img->tmp_path;
 
 	/* add user components */
 	/* the args must be sorted by the component type => by guest address */
@@ -164,7 +144,7 @@ int main(int argc, char *argv[])
 	if (pv_img_finalize(img, GENPROTIMG_STAGE3B_PATH, &err) < 0)
 		goto error;
 
-	if (pv_img_write(img, pv_args->output_path, &err) < 0)
+	if (pv_img_write(img, &err) < 0)
 		goto error;
 
 	ret = EXIT_SUCCESS;
@@ -175,7 +155,8 @@ error:
 		fputc('\n', stderr);
 		g_clear_error(&err);
 	}
-	rmdir_recursive(pv_args->tmp_dir, NULL);
+	if (ret != EXIT_SUCCESS)
+		remove_image_file();
 	remove_signal_handler(signals, G_N_ELEMENTS(signals));
 	exit(ret);
 }
@@ -58,6 +58,12 @@ static int pv_args_validate_options(PvArgs *args, GError **err)
 		return -1;
 	}
 
+	if (args->jobs < 0) {
+		g_set_error(err, PV_ERROR, PV_ERROR_PARSE_SYNTAX,
+			    _("Invalid value for option '--jobs': %d"), args->jobs);
+		return -1;
+	}
+
 	if (!args->no_cert_check) {
 		g_set_error(err, PV_ERROR, PR_ERROR_PARSE_MISSING_ARGUMENT,
 			    "Please use the option '--no-cert-check' as the verification"
@@ -213,6 +219,14 @@ int pv_args_parse_options(PvArgs *args, gint *argc, gchar **argv[], GError **err
 		  .arg_data = &args->no_cert_check,
 		  .description = _("Disable the certification check (optional)"),
 		  .arg_description = NULL },
+		{ .long_name = "jobs",
+		  .short_name = 'j',
+		  .flags = G_OPTION_FLAG_NONE,
+		  .arg = G_OPTION_ARG_INT,
+		  .arg_data = &args->jobs,
+		  .description = _(
+			  "Use NUMBER threads for the component encryption (optional, default: number of CPUs)"),
+		  .arg_description = _("NUMBER") },
 		{ .long_name = "verbose",
 		  .short_name = 'V',
 		  .flags = G_OPTION_FLAG_NO_ARG,
@@ -317,7 +331,6 @@ void pv_args_free(PvArgs *args)
 	g_free(args->xts_key_path);
 	g_slist_free_full(args->comps, (GDestroyNotify)pv_arg_free);
 	g_free(args->output_path);
-	g_free(args->tmp_dir);
 	g_free(args);
 }
 
@@ -29,6 +29,7 @@ int pv_arg_has_type(gconstpointer arg, gconstpointer type);
 typedef struct {
 	int log_level;
 	int no_cert_check;
+	int jobs; /* number of encryption threads, 0 means one per CPU */
 	char *pcf;
 	char *scf;
 	char *psw_addr; /* PSW address which will be used for the start of
@@ -41,7 +42,6 @@ typedef struct {
 	char *xts_key_path;
 	GSList *comps;
 	char *output_path;
-	char *tmp_dir;
 } PvArgs;
 
 PvArgs *pv_args_new(void);
@@ -150,104 +150,33 @@ bool pv_component_is_stage3b(const PvComponent *component)
 	return pv_component_type(component) == PV_COMP_TYPE_STAGE3B;
 }
 
-int pv_component_align_and_encrypt(PvComponent *component, const char *tmp_path, void *opaque,
-				   GError **err)
+/* Page align the size of the buffer component and encrypt it if
+ * @parms is not NULL */
+static int pv_component_prepare_buf(PvComponent *component, const struct cipher_parms *parms,
+				    GError **err)
 {
-	struct cipher_parms *parms = opaque;
+	g_autoptr(Buffer) enc_buf = NULL;
 
-	switch ((PvComponentDataType)component->d_type) {
-	case DATA_BUFFER: {
-		g_autoptr(Buffer) enc_buf = NULL;
-		if (!(IS_PAGE_ALIGNED(pv_component_size(component)))) {
-			g_autoptr(Buffer) new = NULL;
-			/* create a page aligned copy */
-			new = buffer_dup(component->buf, true);
-			buffer_clear(&component->buf);
-			component->buf = g_steal_pointer(&new);
-		}
-		enc_buf = encrypt_buf(parms, component->buf, err);
-		if (!enc_buf)
-			return -1;
+	g_assert(component->d_type == DATA_BUFFER);
 
+	if (!(IS_PAGE_ALIGNED(pv_component_size(component)))) {
+		g_autoptr(Buffer) new = NULL;
+		/* create a page aligned copy */
+		new = buffer_dup(component->buf, true);
 		buffer_clear(&component->buf);
-		component->buf = g_steal_pointer(&enc_buf);
-		return 0;
+		component->buf = g_steal_pointer(&new);
 	}
-	case DATA_FILE: {
-		size_t orig_size;
-		size_t prep_size;
-		gchar *path_in = component->file->path;
-		const char *comp_name = pv_component_name(component);
-		g_autofree char *path_out = NULL;
-
-		g_assert(path_in);
 
-		path_out = g_build_filename(tmp_path, comp_name, NULL);
-		if (encrypt_file(parms, path_in, path_out, &orig_size, &prep_size, err) < 0)
-			return -1;
-
-		if (component->orig_size != orig_size) {
-			g_set_error(err, G_FILE_ERROR, PV_ERROR_INTERNAL,
-				    _("File has changed during the preparation '%s'"), path_out);
-			return -1;
-		}
-
-		g_free(path_in);
-		component->file->size = prep_size;
-		component->file->path = g_steal_pointer(&path_out);
+	if (!parms)
 		return 0;
-	}
-	}
-
-	g_assert_not_reached();
-}
-
-/* Page align the size of the component */
-int pv_component_align(PvComponent *component, const char *tmp_path, void *opaque G_GNUC_UNUSED,
-		       GError **err)
-{
-	int ret = -1;
-	FILE *f_in = NULL, *f_out = NULL;
-	g_autoptr(Buffer) buf = NULL;
-
-	if (IS_PAGE_ALIGNED(pv_component_size(component)))
-		return 0;
-
-	switch (component->d_type) {
-	case DATA_BUFFER: {
-		buf = buffer_dup(component->buf, true);
-		buffer_clear(&component->buf);
-		component->buf = g_steal_pointer(&buf);
-	} break;
-	case DATA_FILE: {
-		size_t size_out;
-		gchar *path_in = component->file->path;
-		const char *comp_name = pv_component_name(component);
-		g_autofree gchar *path_out = g_build_filename(tmp_path, comp_name, NULL);
-
-		f_in = file_open(path_in, "rb", err);
-		if (!f_in)
-			goto err;
-		f_out = file_open(path_out, "wb", err);
-		if (!f_out)
-			goto err;
-
-		if (pad_file_right(f_out, f_in, &size_out, PAGE_SIZE, err) < 0)
-			goto err;
 
-		g_free(path_in);
-		component->file->path = g_steal_pointer(&path_out);
-		component->file->size = size_out;
-	} break;
-	}
+	enc_buf = encrypt_buf(parms, component->buf, err);
+	if (!enc_buf)
+		return -1;
 
-	ret = 0;
-err:
-	if (f_out)
-		fclose(f_out);
-	if (f_in)
-		fclose(f_in);
-	return ret;
+	buffer_clear(&component->buf);
+	component->buf = g_steal_pointer(&enc_buf);
+	return 0;
 }
 
 /* Convert uint64_t address to byte array */
@@ -288,146 +217,193 @@ int64_t pv_component_update_ald(const PvComponent *comp, EVP_MD_CTX *ctx, GError
 }
 
 /* Handle empty components as well (needs one page) */
-int64_t pv_component_update_pld(const PvComponent *comp, EVP_MD_CTX *ctx, GError **err)
+static int64_t pv_component_update_pld(const PvComponent *comp, EVP_MD_CTX *ctx, GError **err)
 {
 	g_assert(comp);
+	g_assert(comp->d_type == DATA_BUFFER);
 
 	int64_t nep = 0;
+	Buffer *buf = comp->buf;
+	unsigned long quot = buf->size / PAGE_SIZE;
+	unsigned int remaind = buf->size % PAGE_SIZE;
+	g_assert(quot <= INT64_MAX);
+
+	/* case `buf->size == 0` */
+	nep = quot ? (int64_t)quot : 1;
+
+	if (EVP_DigestUpdate(ctx, buf->data, quot * PAGE_SIZE) != 1) {
+		g_set_error(err, PV_CRYPTO_ERROR, PV_CRYPTO_ERROR_INTERNAL,
+			    _("EVP_DigestUpdate failed"));
+		return -1;
+	}
 
-	switch (comp->d_type) {
-	case DATA_BUFFER: {
-		Buffer *buf = comp->buf;
-		unsigned long quot = buf->size / PAGE_SIZE;
-		unsigned int remaind = buf->size % PAGE_SIZE;
-		g_assert(quot <= INT64_MAX);
-
-		/* case `buf->size == 0` */
-		nep = quot ? (int64_t)quot : 1;
+	if (remaind != 0) {
+		uint8_t in_buf[PAGE_SIZE] = { 0 };
+		memcpy(in_buf, buf->data + quot * PAGE_SIZE, remaind);
 
-		if (EVP_DigestUpdate(ctx, buf->data, quot * PAGE_SIZE) != 1) {
+		if (EVP_DigestUpdate(ctx, in_buf, PAGE_SIZE) != 1) {
 			g_set_error(err, PV_CRYPTO_ERROR, PV_CRYPTO_ERROR_INTERNAL,
 				    _("EVP_DigestUpdate failed"));
 			return -1;
 		}
-
-		if (remaind != 0) {
-			uint8_t in_buf[PAGE_SIZE] = { 0 };
-			memcpy(in_buf, buf->data + quot * PAGE_SIZE, remaind);
-
-			if (EVP_DigestUpdate(ctx, in_buf, PAGE_SIZE) != 1) {
-				g_set_error(err, PV_CRYPTO_ERROR, PV_CRYPTO_ERROR_INTERNAL,
-					    _("EVP_DigestUpdate failed"));
-				return -1;
-			}
-			nep++;
-		}
-		break;
-	}
-	case DATA_FILE: {
-		const char *in_path = comp->file->path;
-		unsigned char in_buf[PAGE_SIZE];
-		size_t num_bytes_read = 0;
-		size_t num_bytes_read_total = 0;
-
-		FILE *f_in = file_open(in_path, "rb", err);
-		if (!f_in)
-			return -1;
-
-		do {
-			memset(in_buf, 0, sizeof(in_buf));
-
-			/* Read data in blocks. Update the digest
-			 * context each read. */
-			if (file_read(f_in, in_buf, sizeof(unsigned char), sizeof(in_buf),
-				      &num_bytes_read, err) < 0) {
-				fclose(f_in);
-				return -1;
-			}
-			num_bytes_read_total += num_bytes_read;
-
-			if (EVP_DigestUpdate(ctx, in_buf, sizeof(in_buf)) != 1) {
-				g_set_error(err, PV_CRYPTO_ERROR, PV_CRYPTO_ERROR_INTERNAL,
-					    _("EVP_DigestUpdate failed"));
-				fclose(f_in);
-				return -1;
-			}
-
-			nep++;
-		} while (num_bytes_read_total < pv_component_size(comp) && num_bytes_read != 0);
-
-		if (num_bytes_read_total != pv_component_size(comp)) {
-			g_set_error(err, G_FILE_ERROR, PV_ERROR_INTERNAL,
-				    _("File '%s' has changed during the preparation"), in_path);
-			fclose(f_in);
-			return -1;
-		}
-		fclose(f_in);
-	}
+		nep++;
 	}
 
 	return nep;
 }
 
-/* Handle empty components as well (needs one page) */
+/* Handle empty components as well (needs one page). The tweaks of
+ * `PV_COMP_TLD_BATCH` pages are collected and digested at once. */
 int64_t pv_component_update_tld(const PvComponent *comp, EVP_MD_CTX *ctx, GError **err)
 {
 	int64_t nep = 0;
 	uint64_t size = pv_component_size(comp);
-	const union tweak *tweak = &comp->tweak;
-	g_autoptr(BIGNUM) tweak_num = BN_bin2bn(tweak->data, sizeof(tweak->data), NULL);
+	union tweak tweak = comp->tweak;
+	union tweak batch[PV_COMP_TLD_BATCH];
+	size_t n = 0;
 
 	for (uint64_t cur = 0; cur < size || cur == 0; cur += PAGE_SIZE) {
-		unsigned char tmp[sizeof(tweak->data)] = { 0 };
-
-		g_assert(BN_num_bytes(tweak_num) >= 0);
-		g_assert(sizeof(tmp) - (unsigned int)BN_num_bytes(tweak_num) > 0);
+		batch[n++] = tweak;
+		/* set new tweak value */
+		tweak_add(&tweak, PAGE_SIZE);
+		nep++;
 
-		if (BN_bn2binpad(tweak_num, tmp, sizeof(tmp)) < 0) {
-			g_set_error(err, PV_CRYPTO_ERROR, PV_CRYPTO_ERROR_INTERNAL,
-				    "BN_bn2binpad failed");
-		};
+		if (n < G_N_ELEMENTS(batch) && cur + PAGE_SIZE < size)
+			continue;
 
-		if (EVP_DigestUpdate(ctx, tmp, sizeof(tmp)) != 1) {
+		if (EVP_DigestUpdate(ctx, batch, n * sizeof(batch[0])) != 1) {
 			g_set_error(err, PV_CRYPTO_ERROR, PV_CRYPTO_ERROR_INTERNAL,
 				    _("EVP_DigestUpdate failed"));
 			return -1;
 		}
+		n = 0;
+	}
 
-		/* set new tweak value */
-		if (BN_add_word(tweak_num, PAGE_SIZE) != 1) {
+	return nep;
+}
+
+/* Reads the file component in chunks of `PV_COMP_IO_BUF_SIZE`, pads
+ * the last page with zeros, encrypts the data if @parms is not NULL,
+ * updates the page list digest @pld_ctx, and writes the result to
+ * @f_out at the source address of the component - all in one pass. Handles empty components as well (needs one page).
+ * Returns the number of pages or -1 in case of an error. */
+static int64_t pv_component_process_file(PvComponent *comp, const struct cipher_parms *parms,
+					 EncryptPool *pool, EVP_MD_CTX *pld_ctx, FILE *f_out,
+					 GError **err)
+{
+	CompFile *file = comp->file;
+	size_t buf_size = PV_COMP_IO_BUF_SIZE;
+	g_autofree uint8_t *in_buf = g_malloc(buf_size);
+	g_autofree uint8_t *out_buf = parms ? g_malloc(buf_size) : NULL;
+	size_t num_bytes_read, num_bytes_read_total = 0;
+	size_t prep_size = 0;
+	int64_t nep = 0;
+	FILE *f_in;
+
+	f_in = file_open(file->path, "rb", err);
+	if (!f_in)
+		return -1;
+
+	if (file_seek(f_out, pv_component_get_src_addr(comp), err) < 0)
+		goto err;
+
+	do {
+		size_t len, write_len;
+		uint8_t *data = in_buf;
+
+		if (file_read(f_in, in_buf, 1, buf_size, &num_bytes_read, err) < 0)
+			goto err;
+		num_bytes_read_total += num_bytes_read;
+
+		/* in case we reached the end and it's not the special
+		 * case of a empty component we can break here */
+		if (num_bytes_read == 0 && num_bytes_read_total != 0)
+			break;
+
+		len = num_bytes_read ? PAGE_ALIGN(num_bytes_read) : PAGE_SIZE;
+		memset(in_buf + num_bytes_read, 0, len - num_bytes_read);
+
+		/* An empty component that is not encrypted stays empty,
+		 * but its (zero) page is still part of the digest */
+		write_len = len;
+		if (parms) {
+			int rc;
+
+			if (pool)
+				rc = encrypt_pool_encrypt_pages(pool, parms, prep_size, in_buf,
+								out_buf, len, err);
+			else
+				rc = encrypt_pages(parms, prep_size, in_buf, out_buf, len, err);
+			if (rc < 0)
+				goto err;
+			data = out_buf;
+		} else if (num_bytes_read == 0) {
+			write_len = 0;
+		}
+
+		if (EVP_DigestUpdate(pld_ctx, data, len) != 1) {
 			g_set_error(err, PV_CRYPTO_ERROR, PV_CRYPTO_ERROR_INTERNAL,
-				    "BN_add_word failed");
+				    _("EVP_DigestUpdate failed"));
+			goto err;
 		}
 
-		nep++;
+		if (write_len && file_write(f_out, data, 1, write_len, NULL, err) < 0)
+			goto err;
+
+		prep_size += write_len;
+		nep += (int64_t)(len / PAGE_SIZE);
+	} while (num_bytes_read == buf_size);
+
+	if (num_bytes_read_total != comp->orig_size) {
+		g_set_error(err, G_FILE_ERROR, PV_ERROR_INTERNAL,
+			    _("File '%s' has changed during the preparation"), file->path);
+		goto err;
 	}
 
+	fclose(f_in);
+	file->size = prep_size;
 	return nep;
+err:
+	fclose(f_in);
+	return -1;
 }
 
-int pv_component_write(const PvComponent *component, FILE *f, GError **err)
+static int pv_component_write(const PvComponent *component, FILE *f, GError **err)
 {
-	g_assert(component);
+	g_assert(component->d_type == DATA_BUFFER);
+
+	Buffer *buf = component->buf;
+	uint64_t offset = pv_component_get_src_addr(component);
+
+	if (seek_and_write_buffer(f, buf, offset, err) < 0)
+		return -1;
+
+	return 0;
+}
+
+int64_t pv_component_prepare_and_write(PvComponent *component, const struct cipher_parms *parms,
+				       EncryptPool *pool, EVP_MD_CTX *pld_ctx, FILE *f_out,
+				       GError **err)
+{
+	int64_t nep;
 
-	switch (component->d_type) {
-	case DATA_BUFFER: {
-		Buffer *buf = component->buf;
-		uint64_t offset = pv_component_get_src_addr(component);
+	g_assert(component);
 
-		if (seek_and_write_buffer(f, buf, offset, err) < 0)
+	switch ((PvComponentDataType)component->d_type) {
+	case DATA_BUFFER:
+		if (pv_component_prepare_buf(component, parms, err) < 0)
 			return -1;
 
-		return 0;
-	}
-	case DATA_FILE: {
-		const CompFile *file = component->file;
-		uint64_t offset = pv_component_get_src_addr(component);
+		nep = pv_component_update_pld(component, pld_ctx, err);
+		if (nep < 0)
+			return -1;
 
-		if (seek_and_write_file(f, file, offset, err) < 0)
+		if (pv_component_write(component, f_out, err) < 0)
 			return -1;
 
-		return 0;
-	}
+		return nep;
+	case DATA_FILE:
+		return pv_component_process_file(component, parms, pool, pld_ctx, f_out, err);
 	}
 
 	g_assert_not_reached();
@@ -12,6 +12,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <glib.h>
 #include <openssl/evp.h>
 
@@ -26,6 +27,13 @@ typedef enum {
 	PV_COMP_TYPE_STAGE3B = 10,
 } PvComponentType;
 
+/* Size of the buffer used for streaming file components. It does not
+ * depend on the number of encryption threads, the threads encrypt
+ * different page ranges of the same buffer. */
+#define PV_COMP_IO_BUF_SIZE (1024 * PAGE_SIZE)
+/* Number of tweaks digested at once for the tweak list digest */
+#define PV_COMP_TLD_BATCH 256
+
 typedef enum {
 	DATA_FILE = 0,
 	DATA_BUFFER,
@@ -63,12 +71,16 @@ uint64_t pv_component_get_orig_size(const PvComponent *component);
 uint64_t pv_component_get_tweak_prefix(const PvComponent *component);
 bool pv_component_is_stage3b(const PvComponent *component);
 
-int pv_component_align_and_encrypt(PvComponent *component, const char *tmp_path, void *opaque,
-				   GError **err);
-int pv_component_align(PvComponent *component, const char *tmp_path, void *opaque, GError **err);
-int64_t pv_component_update_pld(const PvComponent *comp, EVP_MD_CTX *ctx, GError **err);
+/* Prepares the component (page alignment and encryption if @parms is
+ * not NULL), updates the page list digest and writes the component to
+ * @f_out at its source address. File components are streamed, so that
+ * each file is read only once, and are encrypted by the threads of
+ * @pool if given. Returns the number of pages or -1 in case of an
+ * error. */
+int64_t pv_component_prepare_and_write(PvComponent *component, const struct cipher_parms *parms,
+				       EncryptPool *pool, EVP_MD_CTX *pld_ctx, FILE *f_out,
+				       GError **err);
 int64_t pv_component_update_ald(const PvComponent *comp, EVP_MD_CTX *ctx, GError **err);
 int64_t pv_component_update_tld(const PvComponent *comp, EVP_MD_CTX *ctx, GError **err);
-int pv_component_write(const PvComponent *component, FILE *f, GError **err);
 
 #endif
@@ -71,16 +71,18 @@ unsigned int pv_img_comps_length(const PvImgComps *comps)
 	return g_slist_length(comps->comps);
 }
 
-/* Update hashes and nep */
+/* Prepare and write the component, update hashes and nep */
 /* Returns 0 in case of success and -1 in case of a failure */
-static int pv_img_comps_hash_comp(PvImgComps *comps, const PvComponent *comp, GError **err)
+static int pv_img_comps_process_comp(PvImgComps *comps, PvComponent *comp,
+				     const struct cipher_parms *parms, EncryptPool *pool,
+				     FILE *f_out, GError **err)
 {
 	int64_t nep_1 = 0;
 	int64_t nep_2 = 0;
 	int64_t nep_3 = 0;
 
-	/* update pld */
-	nep_1 = pv_component_update_pld(comp, comps->pld, err);
+	/* prepare and write the component and update pld */
+	nep_1 = pv_component_prepare_and_write(comp, parms, pool, comps->pld, f_out, err);
 	if (nep_1 < 0)
 		return -1;
 
@@ -102,7 +104,9 @@ static int pv_img_comps_hash_comp(PvImgComps *comps, const PvComponent *comp, GE
 	return 0;
 }
 
-int pv_img_comps_add_component(PvImgComps *comps, PvComponent *comp, GError **err)
+int pv_img_comps_add_component(PvImgComps *comps, PvComponent *comp,
+			       const struct cipher_parms *parms, EncryptPool *pool, FILE *f_out,
+			       GError **err)
 {
 	g_assert(comp);
 	g_assert(comps);
@@ -121,6 +125,10 @@ int pv_img_comps_add_component(PvImgComps *comps, PvComponent *comp, GError **er
 	/* set the address of the component in the memory layout */
 	comp->src_addr = src_addr;
 
+	/* the components are hashed in the order they are added */
+	if (pv_img_comps_process_comp(comps, comp, parms, pool, f_out, err) < 0)
+		return -1;
+
 	g_info("%12s:\t0x%012lx (%12ld / %12ld Bytes)", pv_component_name(comp),
 	       pv_component_get_src_addr(comp), pv_component_size(comp),
 	       pv_component_get_orig_size(comp));
@@ -200,15 +208,6 @@ int pv_img_comps_finalize(PvImgComps *comps, Buffer **pld_digest, Buffer **ald_d
 	g_autoptr(Buffer) tmp_tld_digest = NULL;
 
 	comps->finalized = true;
-	for (GSList *iterator = comps->comps; iterator; iterator = iterator->next) {
-		const PvComponent *comp = iterator->data;
-		int rc;
-
-		/* update hashes and nep */
-		rc = pv_img_comps_hash_comp(comps, comp, err);
-		if (rc < 0)
-			return -1;
-	}
 
 	tmp_pld_digest = digest_ctx_finalize(comps->pld, err);
 	if (!tmp_pld_digest)
@@ -28,7 +28,9 @@ PvImgComps *pv_img_comps_new(const EVP_MD *ald_md, const EVP_MD *pld_md, const E
 unsigned int pv_img_comps_length(const PvImgComps *comps);
 GSList *pv_img_comps_get_comps(const PvImgComps *comps);
 struct stage3b_args *pv_img_comps_get_stage3b_args(const PvImgComps *comps, struct psw_t *psw);
-int pv_img_comps_add_component(PvImgComps *comps, PvComponent *comp, GError **err G_GNUC_UNUSED);
+int pv_img_comps_add_component(PvImgComps *comps, PvComponent *comp,
+			       const struct cipher_parms *parms, EncryptPool *pool, FILE *f_out,
+			       GError **err);
 PvComponent *pv_img_comps_get_nth_comp(PvImgComps *comps, unsigned int n);
 int pv_img_comps_set_offset(PvImgComps *comps, size_t offset, GError **err);
 int pv_img_comps_finalize(PvImgComps *comps, Buffer **pld_digest, Buffer **ald_digest,
@@ -12,7 +12,9 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <errno.h>
+#include <sys/stat.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <openssl/evp.h>
 
 #include "boot/stage3a.h"
@@ -47,40 +49,6 @@ const PvComponent *pv_img_get_stage3b_comp(const PvImage *img, GError **err)
 	return comp;
 }
 
-typedef int (*prepare_func)(PvComponent *obj, const char *tmp_path, void *opaque, GError **err);
-
-static int pv_img_prepare_component(const PvImage *img, PvComponent *comp, GError **err)
-{
-	int rc;
-	prepare_func func = NULL;
-	void *opaque = NULL;
-	struct cipher_parms parms = { 0 };
-
-	if (img->pcf & PV_CONTROL_FLAG_NO_DECRYPTION) {
-		/* we only need to align the components */
-		func = pv_component_align;
-		opaque = NULL;
-	} else {
-		g_assert((int)img->xts_key->size == EVP_CIPHER_key_length(img->xts_cipher));
-		g_assert(sizeof(parms.key) == EVP_CIPHER_key_length(img->xts_cipher));
-		g_assert(sizeof(parms.tweak) == EVP_CIPHER_iv_length(img->xts_cipher));
-
-		func = pv_component_align_and_encrypt;
-		parms.cipher = img->xts_cipher;
-		parms.padding = PAGE_SIZE;
-		memcpy(&parms.key, img->xts_key->data, sizeof(parms.key));
-		memcpy(&parms.tweak, &comp->tweak, sizeof(parms.tweak));
-
-		opaque = &parms;
-	}
-
-	rc = (*func)(comp, img->tmp_dir, opaque, err);
-	if (rc)
-		return -1;
-
-	return 0;
-}
-
 static Buffer *pv_img_read_key(const char *path, unsigned int key_size, GError **err)
 {
 	Buffer *ret = NULL;
@@ -346,11 +314,49 @@ static int pv_img_set_comps_offset(PvImage *img, uint64_t offset, GError **err)
 	return pv_img_comps_set_offset(img->comps, offset, err);
 }
 
+/* Create the temporary image file in the directory of the image file,
+ * so that it can be renamed to the image file once it is complete.
+ * The file is created with the permissions of a file created by
+ * fopen().
+ */
+static int pv_img_open_tmp_file(PvImage *img, const gchar *path, GError **err)
+{
+	mode_t mask;
+	int fd;
+
+	img->tmp_path = g_strdup_printf("%s.XXXXXX", path);
+	fd = g_mkstemp(img->tmp_path);
+	if (fd < 0) {
+		g_set_error(err, G_FILE_ERROR, (gint)g_file_error_from_errno(errno),
+			    _("Failed to create file '%s': %s"), img->tmp_path,
+			    g_strerror(errno));
+		g_free(img->tmp_path);
+		img->tmp_path = NULL;
+		return -1;
+	}
+
+	mask = umask(0);
+	umask(mask);
+	(void)fchmod(fd, 0666 & ~mask);
+
+	img->f_out = fdopen(fd, "wb");
+	if (!img->f_out) {
+		g_set_error(err, G_FILE_ERROR, (gint)g_file_error_from_errno(errno),
+			    _("Failed to open file '%s': %s"), img->tmp_path,
+			    g_strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	img->out_path = g_strdup(path);
+	return 0;
+}
+
 PvImage *pv_img_new(PvArgs *args, const gchar *stage3a_path, GError **err)
 {
 	g_autoptr(PvImage) ret = g_new0(PvImage, 1);
 
-	g_assert(args->tmp_dir);
+	g_assert(args->output_path);
 	g_assert(stage3a_path);
 
 	ret->comps = pv_img_comps_new(EVP_sha512(), EVP_sha512(), EVP_sha512(), err);
@@ -361,7 +367,6 @@ PvImage *pv_img_new(PvArgs *args, const gchar *stage3a_path, GError **err)
 	ret->initial_psw.addr = DEFAULT_INITIAL_PSW_ADDR;
 	ret->initial_psw.mask = DEFAULT_INITIAL_PSW_MASK;
 	ret->nid = NID_secp521r1;
-	ret->tmp_dir = g_strdup(args->tmp_dir);
 	ret->xts_cipher = EVP_aes_256_xts();
 
 	/* set initial PSW that will be loaded by the stage3b */
@@ -372,6 +377,17 @@ PvImage *pv_img_new(PvArgs *args, const gchar *stage3a_path, GError **err)
 	if (pv_img_set_control_flags(ret, args->pcf, args->scf, err) < 0)
 		return NULL;
 
+	/* the pages of the components are encrypted in parallel, by
+	 * default using one thread per online CPU. Components are not
+	 * encrypted at all if decryption is disabled by the PCF. */
+	if (!(ret->pcf & PV_CONTROL_FLAG_NO_DECRYPTION)) {
+		guint n_threads = args->jobs > 0 ? (guint)args->jobs : g_get_num_processors();
+
+		ret->xts_pool = encrypt_pool_new(n_threads, err);
+		if (!ret->xts_pool)
+			return NULL;
+	}
+
 	/* read in the keys */
 	if (pv_img_set_keys(ret, args, err) < 0)
 		return NULL;
@@ -390,6 +406,12 @@ PvImage *pv_img_new(PvArgs *args, const gchar *stage3a_path, GError **err)
 	if (pv_img_set_comps_offset(ret, off, err) < 0)
 		return NULL;
 
+	/* the components are written to the image file as soon as they
+	 * are added. An existing image file is only replaced when the
+	 * new image is complete. */
+	if (pv_img_open_tmp_file(ret, args->output_path, err) < 0)
+		return NULL;
+
 	return g_steal_pointer(&ret);
 }
 
@@ -404,8 +426,12 @@ void pv_img_free(PvImage *img)
 	EVP_PKEY_free(img->cust_pub_priv_key);
 	buffer_clear(&img->stage3a);
 	pv_img_comps_free(img->comps);
-	g_free(img->tmp_dir);
+	if (img->f_out)
+		fclose(img->f_out);
+	g_free(img->tmp_path);
+	g_free(img->out_path);
 	buffer_free(img->xts_key);
+	encrypt_pool_free(img->xts_pool);
 	buffer_free(img->cust_root_key);
 	buffer_free(img->gcm_iv);
 	buffer_free(img->cust_comm_key);
@@ -415,20 +441,37 @@ void pv_img_free(PvImage *img)
 static int pv_img_prepare_and_add_component(PvImage *img, PvComponent **comp, GError **err)
 {
 	int rc;
+	struct cipher_parms parms = { 0 };
+	const struct cipher_parms *parms_p = NULL;
+	g_autoptr(PvComponent) tmp_comp = NULL;
+
 	g_assert(comp);
 
-	/* prepares the component: does the alignment and encryption
-	 * if required */
-	rc = pv_img_prepare_component(img, *comp, err);
-	if (rc)
-		return -1;
+	/* if no decryption is needed, we only need to align the
+	 * components */
+	if (!(img->pcf & PV_CONTROL_FLAG_NO_DECRYPTION)) {
+		g_assert((int)img->xts_key->size == EVP_CIPHER_key_length(img->xts_cipher));
+		g_assert(sizeof(parms.key) == EVP_CIPHER_key_length(img->xts_cipher));
+		g_assert(sizeof(parms.tweak) == EVP_CIPHER_iv_length(img->xts_cipher));
+
+		parms.cipher = img->xts_cipher;
+		parms.padding = PAGE_SIZE;
+		memcpy(&parms.key, img->xts_key->data, sizeof(parms.key));
+		memcpy(&parms.tweak, &(*comp)->tweak, sizeof(parms.tweak));
+		parms_p = &parms;
+	}
 
-	/* calculates the memory layout and adds the component to its
-	 * internal list */
-	rc = pv_img_comps_add_component(img->comps, g_steal_pointer(comp), err);
+	/* calculates the memory layout, prepares the component (does
+	 * the alignment and encryption if required), writes it to the
+	 * image file and adds it to its internal list */
+	tmp_comp = g_steal_pointer(comp);
+	rc = pv_img_comps_add_component(img->comps, tmp_comp, parms_p, img->xts_pool, img->f_out,
+					err);
 	if (rc)
 		return -1;
 
+	/* now owned by `img->comps` */
+	tmp_comp = NULL;
 	return 0;
 }
 
@@ -700,34 +743,33 @@ static int write_short_psw(FILE *f, struct psw_t *psw, GError **err)
 	return file_write(f, &short_psw_be, 1, sizeof(short_psw_be), NULL, err);
 }
 
-int pv_img_write(PvImage *img, const char *path, GError **err)
+int pv_img_write(PvImage *img, GError **err)
 {
-	int ret = -1;
-	FILE *f = file_open(path, "wb", err);
+	FILE *f = img->f_out;
 
-	if (!f)
-		return -1;
+	g_assert(f);
 
 	if (write_short_psw(f, &img->stage3a_psw, err) < 0)
-		goto err;
+		return -1;
 
 	if (seek_and_write_buffer(f, img->stage3a, STAGE3A_LOAD_ADDRESS, err) < 0)
-		goto err;
+		return -1;
 
-	/* list is sorted by component type => by address */
-	for (GSList *iterator = pv_img_comps_get_comps(img->comps); iterator;
-	     iterator = iterator->next) {
-		int rc;
-		const PvComponent *comp = iterator->data;
+	/* all components have already been written while they were
+	 * added */
+	img->f_out = NULL;
+	if (fclose(f) != 0) {
+		g_set_error(err, G_FILE_ERROR, (gint)g_file_error_from_errno(errno),
+			    _("Failed to close image file: '%s'"), g_strerror(errno));
+		return -1;
+	}
 
-		rc = pv_component_write(comp, f, err);
-		if (rc < 0)
-			goto err;
+	if (g_rename(img->tmp_path, img->out_path) != 0) {
+		g_set_error(err, G_FILE_ERROR, (gint)g_file_error_from_errno(errno),
+			    _("Failed to rename '%s' to '%s': %s"), img->tmp_path,
+			    img->out_path, g_strerror(errno));
+		return -1;
 	}
 
-	ret = 0;
-err:
-	if (f)
-		fclose(f);
-	return ret;
+	return 0;
 }
@@ -12,6 +12,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <glib.h>
 #include <glib/gtypes.h>
 #include <openssl/evp.h>
@@ -25,8 +26,11 @@
 #include "pv_stage3.h"
 
 typedef struct {
-	char *tmp_dir; /* temporary directory used for the temporary
-			* files (e.g. encrypted kernel) */
+	FILE *f_out; /* image file, the components are written to it
+		      * as soon as they are added */
+	gchar *out_path; /* path of the image file */
+	gchar *tmp_path; /* temporary image file, renamed to `out_path`
+			  * when the image is complete */
 	Buffer *stage3a; /* stage3a containing IPIB and PV header */
 	gsize stage3a_size; /* size of stage3a.bin */
 	struct psw_t stage3a_psw; /* (short) PSW that is written to
@@ -46,6 +50,7 @@ typedef struct {
 	const EVP_CIPHER *cust_comm_cipher;
 	Buffer *xts_key;
 	const EVP_CIPHER *xts_cipher;
+	EncryptPool *xts_pool; /* threads used for the component encryption */
 	GSList *key_slots;
 	GSList *optional_items;
 	PvImgComps *comps;
@@ -65,6 +70,6 @@ const PvComponent *pv_img_get_stage3b_comp(const PvImage *img, GError **err);
 int pv_img_add_stage3b_comp(PvImage *img, const gchar *path, GError **err);
 uint32_t pv_img_get_enc_size(const PvImage *img);
 uint32_t pv_img_get_pv_hdr_size(const PvImage *img);
-int pv_img_write(PvImage *img, const char *path, GError **err);
+int pv_img_write(PvImage *img, GError **err);
 
 #endif
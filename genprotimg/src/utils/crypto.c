@@ -24,6 +24,7 @@
 #include "pv/pv_error.h"
 #include "common.h"
 #include "include/pv_crypto_defs.h"
+#include "utils/align.h"
 #include "utils/buffer.h"
 
 #include "crypto.h"
@@ -220,6 +221,21 @@ int generate_tweak(union tweak *tweak, uint16_t i, GError **err)
 	return 0;
 }
 
+/* Adds @offset to the 128-bit big-endian value @tweak (modulo 2^128) */
+void tweak_add(union tweak *tweak, uint64_t offset)
+{
+	uint64_t lo = GUINT64_FROM_BE(tweak->page_idx);
+	uint64_t hi = GUINT64_FROM_BE(tweak->cmp_idx.data);
+
+	lo += offset;
+	/* carry */
+	if (lo < offset)
+		hi++;
+
+	tweak->page_idx = GUINT64_TO_BE(lo);
+	tweak->cmp_idx.data = GUINT64_TO_BE(hi);
+}
+
 Buffer *generate_aes_key(unsigned int size, GError **err)
 {
 	g_autoptr(Buffer) key = buffer_alloc(size);
@@ -517,6 +533,203 @@ static int __encrypt_decrypt_bio(const struct cipher_parms *parms, BIO *b_in, BI
 	return 0;
 }
 
+/* Encrypts @size bytes (a multiple of `PAGE_SIZE`) from @in to @out
+ * page by page using the cipher context @ctx. The page at @offset
+ * (relative to the start of the component) is encrypted with the tweak
+ * `parms->tweak + offset`, so the result is the same as encrypting the
+ * whole component at once. */
+static int __encrypt_pages(EVP_CIPHER_CTX *ctx, const struct cipher_parms *parms,
+			   uint64_t offset, const uint8_t *in, uint8_t *out, size_t size,
+			   GError **err)
+{
+	union tweak tweak = parms->tweak;
+	int out_len;
+
+	g_assert(IS_PAGE_ALIGNED(size));
+	g_assert(sizeof(parms->tweak) == AES_256_XTS_TWEAK_SIZE);
+
+	tweak_add(&tweak, offset);
+
+	if (EVP_CipherInit_ex(ctx, parms->cipher, NULL, NULL, NULL, 1) != 1) {
+		g_set_error(err, PV_CRYPTO_ERROR, PV_CRYPTO_ERROR_INTERNAL,
+			    "EVP_CipherInit_ex failed");
+		return -1;
+	}
+
+	g_assert(EVP_CIPHER_CTX_key_length(ctx) == AES_256_XTS_KEY_SIZE);
+	g_assert(EVP_CIPHER_CTX_iv_length(ctx) == (int)sizeof(tweak.data));
+
+	for (size_t cur = 0; cur < size; cur += PAGE_SIZE) {
+		if (EVP_CipherInit_ex(ctx, NULL, NULL, cur ? NULL : parms->key, tweak.data, 1) !=
+		    1) {
+			g_set_error(err, PV_CRYPTO_ERROR, PV_CRYPTO_ERROR_INTERNAL,
+				    "EVP_CipherInit_ex failed");
+			return -1;
+		}
+
+		if (EVP_CipherUpdate(ctx, out + cur, &out_len, in + cur, (int)PAGE_SIZE) != 1) {
+			g_set_error(err, PV_CRYPTO_ERROR, PV_CRYPTO_ERROR_INTERNAL,
+				    "EVP_CipherUpdate failed");
+			return -1;
+		}
+		g_assert(out_len == (int)PAGE_SIZE);
+
+		tweak_add(&tweak, PAGE_SIZE);
+	}
+
+	return 0;
+}
+
+int encrypt_pages(const struct cipher_parms *parms, uint64_t offset, const uint8_t *in,
+		  uint8_t *out, size_t size, GError **err)
+{
+	g_autoptr(EVP_CIPHER_CTX) ctx = EVP_CIPHER_CTX_new();
+
+	if (!ctx)
+		g_abort();
+
+	return __encrypt_pages(ctx, parms, offset, in, out, size, err);
+}
+
+/* A page range of an encryption request. Each task owns a cipher
+ * context, so the tasks of one request never share any state. */
+struct encrypt_task {
+	EncryptPool *pool;
+	EVP_CIPHER_CTX *ctx;
+	const struct cipher_parms *parms;
+	uint64_t offset;
+	const uint8_t *in;
+	uint8_t *out;
+	size_t size;
+	GError *err;
+};
+
+struct encrypt_pool {
+	guint n_threads;
+	struct encrypt_task *tasks; /* one task per thread */
+	GThreadPool *workers; /* `n_threads - 1` threads, the caller
+			       * does the first task itself */
+	GMutex lock;
+	GCond done;
+	guint pending;
+};
+
+static void encrypt_task_run(struct encrypt_task *task)
+{
+	(void)__encrypt_pages(task->ctx, task->parms, task->offset, task->in, task->out,
+			      task->size, &task->err);
+}
+
+static void encrypt_pool_worker(gpointer data, gpointer user_data G_GNUC_UNUSED)
+{
+	struct encrypt_task *task = data;
+	EncryptPool *pool = task->pool;
+
+	encrypt_task_run(task);
+
+	g_mutex_lock(&pool->lock);
+	if (--pool->pending == 0)
+		g_cond_signal(&pool->done);
+	g_mutex_unlock(&pool->lock);
+}
+
+EncryptPool *encrypt_pool_new(guint n_threads, GError **err)
+{
+	g_autoptr(EncryptPool) ret = g_new0(EncryptPool, 1);
+
+	g_assert(n_threads > 0);
+
+	g_mutex_init(&ret->lock);
+	g_cond_init(&ret->done);
+	ret->n_threads = n_threads;
+	ret->tasks = g_new0(struct encrypt_task, n_threads);
+	for (guint i = 0; i < n_threads; i++) {
+		ret->tasks[i].pool = ret;
+		ret->tasks[i].ctx = EVP_CIPHER_CTX_new();
+		if (!ret->tasks[i].ctx)
+			g_abort();
+	}
+
+	if (n_threads > 1) {
+		ret->workers = g_thread_pool_new(encrypt_pool_worker, NULL, (gint)(n_threads - 1),
+						 TRUE, err);
+		if (!ret->workers)
+			return NULL;
+	}
+
+	return g_steal_pointer(&ret);
+}
+
+/* Same as `encrypt_pages`, but the pages are split into contiguous
+ * ranges which are encrypted in parallel by the threads of @pool. As
+ * every page has its own tweak the result is byte-identical to the
+ * serial encryption. */
+int encrypt_pool_encrypt_pages(EncryptPool *pool, const struct cipher_parms *parms,
+			       uint64_t offset, const uint8_t *in, uint8_t *out, size_t size,
+			       GError **err)
+{
+	size_t num_pages = size / PAGE_SIZE;
+	size_t pages_per_task = (num_pages + pool->n_threads - 1) / pool->n_threads;
+	guint n_tasks = 0;
+	int ret = 0;
+
+	g_assert(IS_PAGE_ALIGNED(size));
+
+	for (size_t cur = 0; cur < size; cur += pages_per_task * PAGE_SIZE) {
+		struct encrypt_task *task = &pool->tasks[n_tasks++];
+
+		task->parms = parms;
+		task->offset = offset + cur;
+		task->in = in + cur;
+		task->out = out + cur;
+		task->size = MIN(pages_per_task * PAGE_SIZE, size - cur);
+		task->err = NULL;
+	}
+	g_assert(n_tasks <= pool->n_threads);
+
+	pool->pending = n_tasks > 0 ? n_tasks - 1 : 0;
+	for (guint i = 1; i < n_tasks; i++) {
+		if (!g_thread_pool_push(pool->workers, &pool->tasks[i], NULL))
+			g_abort();
+	}
+
+	if (n_tasks > 0)
+		encrypt_task_run(&pool->tasks[0]);
+
+	g_mutex_lock(&pool->lock);
+	while (pool->pending > 0)
+		g_cond_wait(&pool->done, &pool->lock);
+	g_mutex_unlock(&pool->lock);
+
+	for (guint i = 0; i < n_tasks; i++) {
+		struct encrypt_task *task = &pool->tasks[i];
+
+		if (task->err && ret == 0) {
+			g_propagate_error(err, g_steal_pointer(&task->err));
+			ret = -1;
+		}
+		g_clear_error(&task->err);
+	}
+
+	return ret;
+}
+
+void encrypt_pool_free(EncryptPool *pool)
+{
+	if (!pool)
+		return;
+
+	/* wait for all running tasks */
+	if (pool->workers)
+		g_thread_pool_free(pool->workers, FALSE, TRUE);
+	for (guint i = 0; i < pool->n_threads; i++)
+		EVP_CIPHER_CTX_free(pool->tasks[i].ctx);
+	g_free(pool->tasks);
+	g_cond_clear(&pool->done);
+	g_mutex_clear(&pool->lock);
+	g_free(pool);
+}
+
 static Buffer *__encrypt_decrypt_buffer(const struct cipher_parms *parms, const Buffer *in,
 					bool encrypt, GError **err)
 {
@@ -562,46 +775,6 @@ Buffer *decrypt_buf(const struct cipher_parms *parms, const Buffer *in, GError *
 	return __encrypt_decrypt_buffer(parms, in, false, err);
 }
 
-static int __encrypt_decrypt_file(const struct cipher_parms *parms, const char *path_in,
-				  const char *path_out, gsize *size_in, gsize *size_out,
-				  bool encrypt, GError **err)
-{
-	g_autoptr(BIO) b_in = NULL;
-	g_autoptr(BIO) b_out = NULL;
-
-	b_in = BIO_new_file(path_in, "rb");
-	if (!b_in) {
-		g_set_error(err, PV_CRYPTO_ERROR, PV_CRYPTO_ERROR_READ_CERTIFICATE,
-			    _("Failed to read file: '%s'"), path_in);
-		return -1;
-	}
-
-	b_out = BIO_new_file(path_out, "wb");
-	if (!b_out) {
-		g_set_error(err, PV_CRYPTO_ERROR, PV_CRYPTO_ERROR_READ_CERTIFICATE,
-			    _("Failed to write file: '%s'"), path_out);
-		return -1;
-	}
-
-	if (__encrypt_decrypt_bio(parms, b_in, b_out, size_in, size_out, encrypt, err) < 0)
-		return -1;
-
-	return 0;
-}
-
-int encrypt_file(const struct cipher_parms *parms, const char *path_in, const char *path_out,
-		 size_t *in_size, size_t *out_size, GError **err)
-{
-	return __encrypt_decrypt_file(parms, path_in, path_out, in_size, out_size, true, err);
-}
-
-G_GNUC_UNUSED static int decrypt_file(const struct cipher_parms *parms, const char *path_in,
-				      const char *path_out, size_t *in_size, size_t *out_size,
-				      GError **err)
-{
-	return __encrypt_decrypt_file(parms, path_in, path_out, in_size, out_size, false, err);
-}
-
 int64_t gcm_encrypt_decrypt(const Buffer *in, const Buffer *aad, struct gcm_cipher_parms *parms,
 			    Buffer *out, Buffer *tag, bool encrypt, GError **err)
 {
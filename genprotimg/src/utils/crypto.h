@@ -69,6 +69,7 @@ union tweak {
 	} __attribute__((packed));
 	uint8_t data[16];
 };
+STATIC_ASSERT(sizeof(union tweak) == AES_256_XTS_TWEAK_SIZE)
 
 struct cipher_parms {
 	const EVP_CIPHER *cipher;
@@ -77,6 +78,9 @@ struct cipher_parms {
 	unsigned int padding;
 };
 
+/* Pool of threads used for the parallel AES XTS encryption of pages */
+typedef struct encrypt_pool EncryptPool;
+
 struct gcm_cipher_parms {
 	const EVP_CIPHER *cipher;
 	uint8_t key[AES_256_GCM_KEY_SIZE];
@@ -88,15 +92,23 @@ Buffer *compute_exchange_key(EVP_PKEY *cust, EVP_PKEY *host, GError **err);
 Buffer *generate_aes_key(unsigned int size, GError **err);
 EVP_PKEY *generate_ec_key(int nid, GError **err);
 int generate_tweak(union tweak *tweak, uint16_t i, GError **err);
+void tweak_add(union tweak *tweak, uint64_t offset);
 union ecdh_pub_key *evp_pkey_to_ecdh_pub_key(EVP_PKEY *key, GError **err);
 EVP_MD_CTX *digest_ctx_new(const EVP_MD *md, GError **err);
 Buffer *digest_ctx_finalize(EVP_MD_CTX *ctx, GError **err);
 Buffer *sha256_buffer(const Buffer *buf, GError **err);
 int64_t gcm_encrypt_decrypt(const Buffer *in, const Buffer *aad, struct gcm_cipher_parms *parms,
 			    Buffer *out, Buffer *tag, bool encrypt, GError **err);
-int encrypt_file(const struct cipher_parms *parms, const char *in_path, const char *path_out,
-		 size_t *in_size, size_t *out_size, GError **err);
+int encrypt_pages(const struct cipher_parms *parms, uint64_t offset, const uint8_t *in,
+		  uint8_t *out, size_t size, GError **err);
+EncryptPool *encrypt_pool_new(guint n_threads, GError **err);
+int encrypt_pool_encrypt_pages(EncryptPool *pool, const struct cipher_parms *parms,
+			       uint64_t offset, const uint8_t *in, uint8_t *out, size_t size,
+			       GError **err);
+void encrypt_pool_free(EncryptPool *pool);
 Buffer *encrypt_buf(const struct cipher_parms *parms, const Buffer *in, GError **err);
 Buffer *decrypt_buf(const struct cipher_parms *parms, const Buffer *in, GError **err);
 
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(EncryptPool, encrypt_pool_free)
+
 #endif
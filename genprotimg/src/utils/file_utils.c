@@ -105,7 +105,7 @@ int file_write(FILE *out, const void *ptr, size_t size, size_t count, size_t *co
 	return 0;
 }
 
-static int file_seek(FILE *f, uint64_t offset, GError **err)
+int file_seek(FILE *f, uint64_t offset, GError **err)
 {
 	int rc;
 
@@ -124,45 +124,6 @@ static int file_seek(FILE *f, uint64_t offset, GError **err)
 	return 0;
 }
 
-int seek_and_write_file(FILE *o, const CompFile *ifile, uint64_t offset, GError **err)
-{
-	int ret = -1;
-	FILE *i = NULL;
-	char buf[4096];
-	size_t bytes_read, bytes_written;
-	size_t total_bytes_read = 0;
-
-	if (file_seek(o, offset, err) < 0)
-		return -1;
-
-	i = file_open(ifile->path, "rb", err);
-	if (!i)
-		return -1;
-
-	do {
-		if (file_read(i, buf, 1, sizeof(buf), &bytes_read, err) < 0)
-			goto err;
-
-		if (bytes_read == 0)
-			break;
-		total_bytes_read += bytes_read;
-
-		if (file_write(o, buf, bytes_read, 1, &bytes_written, err) < 0)
-			goto err;
-	} while (bytes_written != 0);
-
-	if (ifile->size != total_bytes_read) {
-		g_set_error(err, PV_ERROR, PV_ERROR_INTERNAL,
-			    _("File '%s' has changed during the preparation"), ifile->path);
-		goto err;
-	}
-
-	ret = 0;
-err:
-	fclose(i);
-	return ret;
-}
-
 int seek_and_write_buffer(FILE *o, const Buffer *buf, uint64_t offset, GError **err)
 {
 	if (file_seek(o, offset, err) < 0)
@@ -173,32 +134,3 @@ int seek_and_write_buffer(FILE *o, const Buffer *buf, uint64_t offset, GError **
 
 	return 0;
 }
-
-/* Could be optimized... determine the length and remove unnecessary
- * memsets and adapt buffer sizes */
-int pad_file_right(FILE *f_out, FILE *f_in, size_t *size_out, unsigned int padding, GError **err)
-{
-	unsigned char buf[padding];
-	uint64_t size_in = 0;
-	size_t num_bytes_read;
-	size_t num_bytes_written;
-	*size_out = 0;
-
-	do {
-		memset(buf, 0, sizeof(buf));
-		/* Read in data in 4096 bytes blocks. Update the ciphering
-		 * with each read. */
-		if (file_read(f_in, buf, 1, sizeof(buf), &num_bytes_read, err) < 0)
-			return -1;
-
-		size_in += num_bytes_read;
-
-		if (file_write(f_out, buf, 1, sizeof(buf), &num_bytes_written, err))
-			return -1;
-
-		*size_out += num_bytes_written;
-	} while (num_bytes_read == padding);
-
-	g_assert(num_bytes_written == ALIGN(num_bytes_read, padding));
-	return 0;
-}
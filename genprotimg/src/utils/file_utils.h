@@ -28,8 +28,7 @@ int file_size(const char *filename, gsize *size, GError **err);
 int file_read(FILE *in, void *ptr, size_t size, size_t count, size_t *count_read, GError **err);
 int file_write(FILE *out, const void *ptr, size_t size, size_t count, size_t *count_written,
 	       GError **err);
-int pad_file_right(FILE *f_out, FILE *f_in, size_t *size_out, unsigned int padding, GError **err);
+int file_seek(FILE *f, uint64_t offset, GError **err);
 int seek_and_write_buffer(FILE *out, const Buffer *buf, uint64_t offset, GError **err);
-int seek_and_write_file(FILE *o, const CompFile *ifile, uint64_t offset, GError **err);
 
 #endif
@@ -0,0 +1,160 @@
+/*
+ * test_encrypt - Test program for genprotimg
+ *
+ * Test program to check that the encryption of file components by a pool
+ * of threads produces the same output and page list digest as the
+ * encryption without threads
+ *
+ * Copyright IBM Corp. 2020
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <openssl/evp.h>
+
+#include "boot/s390.h"
+#include "pv/pv_comp.h"
+#include "utils/align.h"
+#include "utils/crypto.h"
+
+#define SRC_ADDR (3 * PAGE_SIZE)
+
+static unsigned int failures;
+
+#define CHECK(cond, ...)                                                     \
+	do {                                                                 \
+		if (!(cond)) {                                               \
+			fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);      \
+			fprintf(stderr, __VA_ARGS__);                        \
+			fprintf(stderr, "\n");                               \
+			failures++;                                          \
+		}                                                            \
+	} while (0)
+
+struct result {
+	int64_t nep;
+	uint8_t pld[SHA512_DIGEST_LENGTH];
+	uint8_t *data;
+	size_t size;
+};
+
+static char *tmp_file(const char *dir, const char *name)
+{
+	return g_build_filename(dir, name, NULL);
+}
+
+/* Write @size bytes of a fixed pattern to @path */
+static void write_input(const char *path, size_t size)
+{
+	FILE *f = fopen(path, "wb");
+
+	g_assert(f);
+	for (size_t i = 0; i < size; i++)
+		g_assert(fputc((int)((i * 7 + i / PAGE_SIZE) & 0xff), f) != EOF);
+	g_assert(fclose(f) == 0);
+}
+
+/* Encrypt the file @in as component with @threads encryption threads
+ * (none if 0) and store the written image data in @res */
+static void encrypt_component(const char *in, const char *out, guint threads,
+			      struct result *res)
+{
+	struct cipher_parms parms = { .cipher = EVP_aes_256_xts(), .padding = PAGE_SIZE };
+	EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+	EncryptPool *pool = NULL;
+	GError *err = NULL;
+	PvComponent *comp;
+	unsigned int md_len;
+	gchar *data;
+	gsize len;
+	FILE *f;
+
+	for (size_t i = 0; i < sizeof(parms.key); i++)
+		parms.key[i] = (unsigned char)(i * 13 + (i >= sizeof(parms.key) / 2));
+	comp = pv_component_new_file(PV_COMP_TYPE_INITRD, in, &err);
+	g_assert(comp);
+	/* The tweak is random, use the same one for all runs */
+	memset(&comp->tweak, 0, sizeof(comp->tweak));
+	comp->tweak.cmp_idx.data = GUINT64_TO_BE(0x0002a1b2c3d4e5f6);
+	comp->src_addr = SRC_ADDR;
+	parms.tweak = comp->tweak;
+
+	if (threads) {
+		pool = encrypt_pool_new(threads, &err);
+		g_assert(pool);
+	}
+	g_assert(ctx);
+	g_assert(EVP_DigestInit_ex(ctx, EVP_sha512(), NULL) == 1);
+	f = fopen(out, "wb");
+	g_assert(f);
+	res->nep = pv_component_prepare_and_write(comp, &parms, pool, ctx, f, &err);
+	CHECK(res->nep >= 0, "%u threads: %s", threads, err ? err->message : "");
+	g_clear_error(&err);
+	g_assert(fclose(f) == 0);
+	g_assert(EVP_DigestFinal_ex(ctx, res->pld, &md_len) == 1);
+
+	g_assert(g_file_get_contents(out, &data, &len, NULL));
+	res->data = (uint8_t *)data;
+	res->size = len;
+
+	EVP_MD_CTX_free(ctx);
+	encrypt_pool_free(pool);
+	pv_component_free(comp);
+}
+
+static void check_size(const char *dir, size_t size)
+{
+	static const guint threads[] = { 1, 2, 3, 8 };
+	g_autofree char *in = tmp_file(dir, "in");
+	g_autofree char *out = tmp_file(dir, "out");
+	size_t aligned = size ? PAGE_ALIGN(size) : PAGE_SIZE;
+	struct result ref, res;
+
+	write_input(in, size);
+	encrypt_component(in, out, 0, &ref);
+	CHECK(ref.size == SRC_ADDR + aligned,
+	      "size %zu: %zu bytes written", size, ref.size);
+
+	for (size_t i = 0; i < G_N_ELEMENTS(threads); i++) {
+		encrypt_component(in, out, threads[i], &res);
+		CHECK(res.nep == ref.nep, "size %zu, %u threads: %" PRId64
+		      " pages instead of %" PRId64, size, threads[i], res.nep, ref.nep);
+		CHECK(res.size == ref.size && memcmp(res.data, ref.data, ref.size) == 0,
+		      "size %zu, %u threads: output differs", size, threads[i]);
+		CHECK(memcmp(res.pld, ref.pld, sizeof(ref.pld)) == 0,
+		      "size %zu, %u threads: PLD differs", size, threads[i]);
+		g_free(res.data);
+	}
+	g_free(ref.data);
+	unlink(out);
+	unlink(in);
+}
+
+int main(void)
+{
+	/* Sizes around the I/O buffer size of file components */
+	static const size_t sizes[] = {
+		0, 1, PAGE_SIZE, 5 * PAGE_SIZE + 17,
+		PV_COMP_IO_BUF_SIZE - PAGE_SIZE, PV_COMP_IO_BUF_SIZE,
+		PV_COMP_IO_BUF_SIZE + 1, 2 * PV_COMP_IO_BUF_SIZE + 7 * PAGE_SIZE,
+	};
+	g_autofree char *dir = g_dir_make_tmp("test_encrypt.XXXXXX", NULL);
+
+	g_assert(dir);
+	for (size_t i = 0; i < G_N_ELEMENTS(sizes); i++)
+		check_size(dir, sizes[i]);
+	rmdir(dir);
+
+	if (failures) {
+		fprintf(stderr, "%u check(s) failed\n", failures);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,212 @@
+/*
+ * test_tld - Test program for genprotimg
+ *
+ * Test program to compare tweak_add() and the tweak list digest with the
+ * BIGNUM based implementation they replace
+ *
+ * Copyright IBM Corp. 2020
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <openssl/bn.h>
+#include <openssl/evp.h>
+
+#include "common.h"
+#include "boot/s390.h"
+#include "pv/pv_comp.h"
+#include "utils/crypto.h"
+
+#define TWEAK_BITS (8 * AES_256_XTS_TWEAK_SIZE)
+
+static unsigned int failures;
+
+#define CHECK(cond, ...)                                                     \
+	do {                                                                 \
+		if (!(cond)) {                                               \
+			fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);      \
+			fprintf(stderr, __VA_ARGS__);                        \
+			fprintf(stderr, "\n");                               \
+			failures++;                                          \
+		}                                                            \
+	} while (0)
+
+/* Build a tweak from its upper and lower 64 bits */
+static union tweak make_tweak(uint64_t hi, uint64_t lo)
+{
+	union tweak tweak;
+
+	tweak.cmp_idx.data = GUINT64_TO_BE(hi);
+	tweak.page_idx = GUINT64_TO_BE(lo);
+	return tweak;
+}
+
+/* Reference: add @offset to @in with BIGNUMs (modulo 2^128) */
+static void ref_tweak_add(const union tweak *in, uint64_t offset, union tweak *out)
+{
+	BIGNUM *num = BN_bin2bn(in->data, sizeof(in->data), NULL);
+	BIGNUM *off = BN_new();
+
+	g_assert(num && off);
+	g_assert(BN_set_word(off, (BN_ULONG)(offset >> 32)) == 1);
+	g_assert(BN_lshift(off, off, 32) == 1);
+	g_assert(BN_add_word(off, (BN_ULONG)(offset & 0xffffffff)) == 1);
+	g_assert(BN_add(num, num, off) == 1);
+	if (BN_num_bits(num) > TWEAK_BITS)
+		g_assert(BN_mask_bits(num, TWEAK_BITS) == 1);
+	g_assert(BN_bn2binpad(num, out->data, sizeof(out->data)) == sizeof(out->data));
+	BN_free(off);
+	BN_free(num);
+}
+
+/* Reference: the tweak list digest computed page by page with BIGNUMs */
+static void ref_tld(const union tweak *tweak, uint64_t size, uint8_t *md,
+		    int64_t *nep)
+{
+	EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+	BIGNUM *num = BN_bin2bn(tweak->data, sizeof(tweak->data), NULL);
+	unsigned int md_len;
+
+	g_assert(ctx && num);
+	g_assert(EVP_DigestInit_ex(ctx, EVP_sha512(), NULL) == 1);
+	*nep = 0;
+	for (uint64_t cur = 0; cur < size || cur == 0; cur += PAGE_SIZE) {
+		unsigned char tmp[sizeof(tweak->data)];
+
+		g_assert(BN_bn2binpad(num, tmp, sizeof(tmp)) == sizeof(tmp));
+		g_assert(EVP_DigestUpdate(ctx, tmp, sizeof(tmp)) == 1);
+		g_assert(BN_add_word(num, PAGE_SIZE) == 1);
+		if (BN_num_bits(num) > TWEAK_BITS)
+			g_assert(BN_mask_bits(num, TWEAK_BITS) == 1);
+		(*nep)++;
+	}
+	g_assert(EVP_DigestFinal_ex(ctx, md, &md_len) == 1);
+	g_assert(md_len == SHA512_DIGEST_LENGTH);
+	BN_free(num);
+	EVP_MD_CTX_free(ctx);
+}
+
+static void test_tweak_add(void)
+{
+	static const struct {
+		uint64_t hi, lo, offset;
+	} cases[] = {
+		{ 0x0002a1b2c3d4e5f6, 0, 0 },
+		{ 0x0002a1b2c3d4e5f6, 0, PAGE_SIZE },
+		{ 0x0002a1b2c3d4e5f6, 0x123456789000, 77 * PAGE_SIZE },
+		/* carry from the lower to the upper 64 bits */
+		{ 0x0002a1b2c3d4e5f6, 0xfffffffffffff000, PAGE_SIZE },
+		{ 0x0002a1b2c3d4e5f6, 0xffffffffffffffff, 1 },
+		{ 0x0002a1b2c3d4e5f6, 0xffffffffffff0000, 0x100000 },
+		{ 0x00000000ffffffff, 0xffffffffffffffff, UINT64_MAX },
+		{ 0x0002a1b2c3d4e5f6, 0x8000000000000000, 0x8000000000000000 },
+		/* wrap-around of the whole 128-bit value */
+		{ UINT64_MAX, 0xfffffffffffff000, PAGE_SIZE },
+		{ UINT64_MAX, 0xffffffffffffffff, UINT64_MAX },
+	};
+
+	for (size_t i = 0; i < G_N_ELEMENTS(cases); i++) {
+		union tweak tweak = make_tweak(cases[i].hi, cases[i].lo);
+		union tweak ref;
+
+		ref_tweak_add(&tweak, cases[i].offset, &ref);
+		tweak_add(&tweak, cases[i].offset);
+		CHECK(memcmp(tweak.data, ref.data, sizeof(ref.data)) == 0,
+		      "tweak_add(%016" PRIx64 "%016" PRIx64 ", %" PRIx64 ") differs",
+		      cases[i].hi, cases[i].lo, cases[i].offset);
+	}
+
+	/* repeated page steps across the carry */
+	union tweak tweak = make_tweak(0x0002a1b2c3d4e5f6,
+				       UINT64_MAX - 8 * PAGE_SIZE + 1);
+	for (int i = 0; i < 16; i++) {
+		union tweak ref;
+
+		ref_tweak_add(&tweak, PAGE_SIZE, &ref);
+		tweak_add(&tweak, PAGE_SIZE);
+		CHECK(memcmp(tweak.data, ref.data, sizeof(ref.data)) == 0,
+		      "tweak_add() step %d differs", i);
+	}
+}
+
+static void check_tld(uint64_t hi, uint64_t lo, uint64_t size)
+{
+	struct comp_file file = { .path = NULL, .size = size };
+	PvComponent comp = {
+		.type = PV_COMP_TYPE_INITRD,
+		.d_type = DATA_FILE,
+		.file = &file,
+		.tweak = make_tweak(hi, lo),
+	};
+	uint8_t md[SHA512_DIGEST_LENGTH], ref_md[SHA512_DIGEST_LENGTH];
+	EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+	GError *err = NULL;
+	int64_t nep, ref_nep;
+	unsigned int md_len;
+
+	g_assert(ctx);
+	g_assert(EVP_DigestInit_ex(ctx, EVP_sha512(), NULL) == 1);
+	nep = pv_component_update_tld(&comp, ctx, &err);
+	CHECK(nep >= 0, "pv_component_update_tld() failed: %s",
+	      err ? err->message : "");
+	g_clear_error(&err);
+	g_assert(EVP_DigestFinal_ex(ctx, md, &md_len) == 1);
+	EVP_MD_CTX_free(ctx);
+
+	ref_tld(&comp.tweak, size, ref_md, &ref_nep);
+	CHECK(nep == ref_nep, "size %" PRIu64 ": %" PRId64 " pages instead of %" PRId64,
+	      size, nep, ref_nep);
+	CHECK(memcmp(md, ref_md, sizeof(md)) == 0,
+	      "size %" PRIu64 ", tweak %016" PRIx64 "%016" PRIx64 ": TLD differs",
+	      size, hi, lo);
+}
+
+static void test_tld(void)
+{
+	static const uint64_t pages[] = {
+		0, 1, 2,
+		PV_COMP_TLD_BATCH - 1, PV_COMP_TLD_BATCH, PV_COMP_TLD_BATCH + 1,
+		2 * PV_COMP_TLD_BATCH - 1, 2 * PV_COMP_TLD_BATCH,
+		2 * PV_COMP_TLD_BATCH + 1, 3 * PV_COMP_TLD_BATCH + 77,
+	};
+	static const struct {
+		uint64_t hi, lo;
+	} tweaks[] = {
+		{ 0x0002a1b2c3d4e5f6, 0 },
+		/* carry within and at the end of the first batch */
+		{ 0x0002a1b2c3d4e5f6, UINT64_MAX - 9 * PAGE_SIZE + 1 },
+		{ 0x0002a1b2c3d4e5f6,
+		  UINT64_MAX - PV_COMP_TLD_BATCH * PAGE_SIZE + 1 },
+		/* wrap-around of the whole 128-bit value */
+		{ UINT64_MAX, UINT64_MAX - 100 * PAGE_SIZE + 1 },
+	};
+
+	for (size_t t = 0; t < G_N_ELEMENTS(tweaks); t++) {
+		for (size_t p = 0; p < G_N_ELEMENTS(pages); p++) {
+			check_tld(tweaks[t].hi, tweaks[t].lo,
+				  pages[p] * PAGE_SIZE);
+		}
+		/* sizes that are not page aligned */
+		check_tld(tweaks[t].hi, tweaks[t].lo, 1);
+		check_tld(tweaks[t].hi, tweaks[t].lo,
+			  PV_COMP_TLD_BATCH * PAGE_SIZE + 1);
+	}
+}
+
+int main(void)
+{
+	test_tweak_add();
+	test_tld();
+
+	if (failures) {
+		fprintf(stderr, "%u check(s) failed\n", failures);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -8,6 +8,7 @@
  */
 
 #include <ctype.h>
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <fuse.h>
@@ -23,6 +24,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/stat.h>
 #include <syslog.h>
 #include <time.h>
 #include <unistd.h>
@@ -59,6 +61,27 @@
  */
 #define HMCDRV_FUSE_DIRBUF_LEN	(HMCDRV_FUSE_DIRBUF_SIZE - 1)
 
+/* block size of file content cache (multiple of DVD sector size)
+ */
+#define HMCDRV_FUSE_BLKSIZE	(64 * 1024)
+
+/* size of file content cache hash table (should be a prime number)
+ */
+#define HMCDRV_FUSE_BLKHASH_SIZE 1031
+
+/* default size of file content cache in MiB (option "-o cache_size=MB")
+ */
+#define HMCDRV_FUSE_BLKCACHE_MB	32
+
+/* default read-ahead in KiB for sequential reads (option "-o readahead=KB")
+ */
+#define HMCDRV_FUSE_READAHEAD_KB 512
+
+/* default size of on-disk cache directory in MiB (option
+ * "-o cache_dir_size=MB")
+ */
+#define HMCDRV_FUSE_DSKCACHE_MB	1024
+
 
 /* pointer to path (token) in FTP command string associated with file 'fp'
  */
@@ -126,6 +149,11 @@ struct hmcdrv_fuse_opt {
 
 	char *hmctz; /* HMC timezone option "-o hmctz=TZ" */
 	char *hmclang; /* HMC locale option "-o hmclang=LANG" */
+	char *hmcdrv; /* FTP device or stand-in "-o hmcdrv=PATH" */
+	char *cachedir; /* on-disk cache option "-o cache_dir=DIR" */
+	unsigned int cachesize; /* cache size option "-o cache_size=MB" */
+	unsigned int dsksize; /* on-disk cache size "-o cache_dir_size=MB" */
+	unsigned int readahead; /* read-ahead option "-o readahead=KB" */
 };
 
 
@@ -143,6 +171,23 @@ struct hmcdrv_fuse_context {
 	pid_t pid; /* PID of main() */
 	char *abmon[12]; /* abbreviated month name of HMC locale */
 	int ablen[12]; /* length of each abbreviated month name */
+	int local; /* option 'hmcdrv' is a local stand-in directory */
+	size_t blkbytes; /* size of all blocks in file content cache */
+	size_t blkmax; /* max. size of file content cache */
+	struct hmcdrv_fuse_blk *lru_head; /* most recently used block */
+	struct hmcdrv_fuse_blk *lru_tail; /* least recently used block */
+	pthread_mutex_t ftpmutex; /* FTP device access mutex */
+	pthread_mutex_t dskmutex; /* on-disk cache size mutex */
+	size_t dskbytes; /* size of all files in on-disk cache directory */
+	size_t dskmax; /* max. size of on-disk cache directory */
+	pthread_t ratid; /* read-ahead thread ID */
+	int rarun; /* read-ahead thread is running */
+	pthread_mutex_t ramutex; /* read-ahead request mutex */
+	pthread_cond_t racond; /* signals a new read-ahead request */
+	struct hmcdrv_fuse_file *rafile; /* copy of file to read ahead */
+	off_t rafirst; /* first block index to read ahead */
+	off_t ralast; /* last block index to read ahead */
+	int rastop; /* read-ahead thread shall terminate */
 };
 
 
@@ -154,11 +199,50 @@ struct hmcdrv_fuse_file {
 	struct stat st; /* stat structure of this file */
 	char *symlnk; /* pointer to path name of symlink target (S_IFLNK) */
 	time_t timeout; /* cache timeout for this file */
+	off_t ranext; /* next block index expected on sequential reads */
 	size_t cmdlen; /* length of FTP command + path */
 	char ftpcmd[0]; /* FTP command + path (max HMCDRV_FUSE_MAXCMDLEN) */
 };
 
 
+/*
+ * block of file content cache, identified by path, modification time and
+ * block index
+ */
+struct hmcdrv_fuse_blk {
+	struct hmcdrv_fuse_blk *next; /* collision list (equal hash) */
+	struct hmcdrv_fuse_blk *lru_prev; /* more recently used block */
+	struct hmcdrv_fuse_blk *lru_next; /* less recently used block */
+	unsigned int hash; /* index in hash table */
+	time_t mtime; /* modification time of file */
+	off_t index; /* block index in file */
+	size_t len; /* length of data (less than block size at EOF) */
+	char path[HMCDRV_FUSE_MAXPATH]; /* file path */
+	char data[0]; /* file content */
+};
+
+
+/*
+ * block file in the on-disk cache directory (used for pruning)
+ */
+struct hmcdrv_fuse_dskent {
+	char name[32]; /* file name */
+	time_t mtime; /* time of last use */
+	off_t size; /* file size */
+};
+
+
+/*
+ * header of a block in the on-disk cache directory
+ */
+struct hmcdrv_fuse_dskblk {
+	char path[HMCDRV_FUSE_MAXPATH]; /* file path */
+	int64_t mtime; /* modification time of file */
+	uint64_t index; /* block index in file */
+	uint64_t len; /* length of data following the header */
+};
+
+
 /*
  * all file attributes accumulated from interpreting tokens/fields of 'dir'
  * command listing
@@ -198,6 +282,12 @@ static const char *const hmcdrv_fuse_logsevname[] = {
 static struct hmcdrv_fuse_file *hmcdrv_fuse_cache[HMCDRV_FUSE_CACHE_SIZE];
 
 
+/*
+ * file content cache
+ */
+static struct hmcdrv_fuse_blk *hmcdrv_fuse_blkcache[HMCDRV_FUSE_BLKHASH_SIZE];
+
+
 /*
  * context
  */
@@ -205,6 +295,10 @@ static struct hmcdrv_fuse_context hmcdrv_ctx = {
 	.fd = -1,
 	.ctmo = 1 + HMCDRV_FUSE_CACHE_TMOFS,
 	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.ftpmutex = PTHREAD_MUTEX_INITIALIZER,
+	.dskmutex = PTHREAD_MUTEX_INITIALIZER,
+	.ramutex = PTHREAD_MUTEX_INITIALIZER,
+	.racond = PTHREAD_COND_INITIALIZER,
 };
 
 
@@ -337,6 +431,7 @@ static void hmcdrv_cache_refresh(const char *path, const struct stat *st,
 		fp->symlnk = NULL;
 		hmcdrv_cache_symlink(fp, symlink);
 		hmcdrv_cache_trestart(fp);
+		fp->ranext = 0;
 		fp->next = NULL;
 	}
 }
@@ -459,6 +554,11 @@ static ssize_t hmcdrv_ftp_transfer(struct hmcdrv_fuse_file *fp, char *buf,
 
 	ssize_t retlen;
 
+	/* the read-ahead thread accesses the device without holding the
+	 * cache mutex
+	 */
+	pthread_mutex_lock(&hmcdrv_ctx.ftpmutex);
+
 	/*
 	 * First check if this is a sequential read from the same file.	 If
 	 * so skip repositioning the files seek pointer and emitting a new
@@ -469,8 +569,9 @@ static ssize_t hmcdrv_ftp_transfer(struct hmcdrv_fuse_file *fp, char *buf,
 
 		if ((lseek(hmcdrv_ctx.fd, offset, SEEK_END) < 0) ||
 		    (write(hmcdrv_ctx.fd, fp->ftpcmd, fp->cmdlen) < 0)) {
+			retlen = -errno;
 			last_ftpcmd[0] = '\0';
-			return -errno;
+			goto out;
 		}
 
 		current_offset = offset;
@@ -479,16 +580,164 @@ static ssize_t hmcdrv_ftp_transfer(struct hmcdrv_fuse_file *fp, char *buf,
 	retlen = read(hmcdrv_ctx.fd, buf, len);
 
 	if (retlen < 0) {
+		retlen = -errno;
 		last_ftpcmd[0] = '\0';
-		return -errno;
+		goto out;
 	}
 
 	current_offset += retlen;
 	util_strlcpy(last_ftpcmd, fp->ftpcmd, HMCDRV_FUSE_MAXCMDLEN);
+out:
+	pthread_mutex_unlock(&hmcdrv_ctx.ftpmutex);
 	return retlen;
 }
 
 
+/*
+ * write a 'dir' listing line for file 'name' in directory 'dir' of the local
+ * stand-in, in the same format as the HMC does
+ */
+static void hmcdrv_local_line(FILE *out, const char *dir, const char *name,
+			      int year)
+{
+	static const char modechr[] = "rwxrwxrwx";
+	char path[PATH_MAX];
+	char target[PATH_MAX];
+	char mode[11];
+	struct stat st;
+	struct tm tm;
+	ssize_t len;
+	int i;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+	if (lstat(path, &st) != 0)
+		return;
+
+	if (S_ISDIR(st.st_mode))
+		mode[0] = 'd';
+	else if (S_ISLNK(st.st_mode))
+		mode[0] = 'l';
+	else
+		mode[0] = '-';
+
+	for (i = 0; i < 9; ++i)
+		mode[i + 1] = (st.st_mode & (0400 >> i)) ? modechr[i] : '-';
+
+	mode[10] = '\0';
+	localtime_r(&st.st_mtime, &tm);
+	fprintf(out, "%s %lu %u %u %lld %s %d ", mode,
+		(unsigned long) st.st_nlink, st.st_uid, st.st_gid,
+		(long long) st.st_size, hmcdrv_ctx.abmon[tm.tm_mon],
+		tm.tm_mday);
+
+	if (tm.tm_year == year)
+		fprintf(out, "%02d:%02d %s", tm.tm_hour, tm.tm_min, name);
+	else
+		fprintf(out, "%d %s", tm.tm_year + 1900, name);
+
+	if (S_ISLNK(st.st_mode)) {
+		len = readlink(path, target, sizeof(target) - 1);
+
+		if (len > 0) {
+			target[len] = '\0';
+			fprintf(out, " -> %s", target);
+		}
+	}
+
+	fputc('\n', out);
+}
+
+
+/*
+ * execute 'dir' on the local stand-in directory
+ */
+static ssize_t hmcdrv_local_dir(const char *dir, char *buf, size_t len,
+				off_t offset)
+{
+	struct dirent *de;
+	char *listing;
+	size_t size;
+	time_t now;
+	struct tm tm;
+	FILE *out;
+	DIR *dp;
+
+	dp = opendir(dir);
+
+	if (dp == NULL)
+		return -errno;
+
+	out = open_memstream(&listing, &size);
+
+	if (out == NULL) {
+		closedir(dp);
+		return -ENOMEM;
+	}
+
+	now = time(NULL);
+	localtime_r(&now, &tm);
+
+	while ((de = readdir(dp)) != NULL) {
+		if ((strcmp(de->d_name, ".") != 0) &&
+		    (strcmp(de->d_name, "..") != 0))
+			hmcdrv_local_line(out, dir, de->d_name, tm.tm_year);
+	}
+
+	closedir(dp);
+	fclose(out);
+
+	if ((size_t) offset >= size) {
+		len = 0;
+	} else {
+		len = MIN(len, size - offset);
+		memcpy(buf, listing + offset, len);
+	}
+
+	free(listing);
+	return len;
+}
+
+
+/*
+ * FTP command emulation on a local stand-in directory (option "-o hmcdrv"),
+ * which allows to use FUSE.HMCDRVFS without HMC
+ */
+static ssize_t hmcdrv_local_cmd(struct hmcdrv_fuse_file *fp,
+				enum hmcdrv_fuse_cmdid cmd,
+				char *buf, size_t len, off_t offset)
+{
+	char path[PATH_MAX];
+	ssize_t retlen;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s%s", hmcdrv_ctx.opt.hmcdrv,
+		 HMCDRV_FUSE_PATH(fp));
+
+	switch (cmd) {
+	case HMCDRV_FUSE_CMDID_DIR:
+		return hmcdrv_local_dir(path, buf, len, offset);
+
+	case HMCDRV_FUSE_CMDID_GET:
+		fd = open(path, O_RDONLY);
+
+		if (fd < 0)
+			return -errno;
+
+		retlen = pread(fd, buf, len, offset);
+
+		if (retlen < 0)
+			retlen = -errno;
+
+		close(fd);
+		return retlen;
+
+	default:
+		return -EINVAL;
+	}
+}
+
+
 /*
  * FTP command assembly and execution
  */
@@ -500,11 +749,601 @@ static ssize_t hmcdrv_ftp_cmd(struct hmcdrv_fuse_file *fp,
 		return -EBADF;
 
 	hmcdrv_ftp_str(cmd, fp->ftpcmd);
+
+	if (hmcdrv_ctx.local)
+		return hmcdrv_local_cmd(fp, cmd, buf, len, offset);
+
 	return hmcdrv_ftp_transfer(fp, buf, len, offset);
 }
 
 
 
+/*
+ * calculate a hash value from path, modification time and index of a block
+ */
+static unsigned int hmcdrv_blk_fnv(const char *path, time_t mtime,
+				   off_t index)
+{
+	unsigned int hash = 2166136261U;
+	uint64_t val;
+	int i;
+
+	while (*path != '\0') {
+		hash ^= (unsigned char) *path++;
+		hash *= 16777619U;
+	}
+
+	for (val = mtime, i = 0; i < 2; ++i, val = index) {
+		hash ^= (unsigned int) (val ^ (val >> 32));
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+
+/*
+ * remove a block from the LRU list
+ */
+static void hmcdrv_blk_lru_unlink(struct hmcdrv_fuse_blk *blk)
+{
+	if (blk->lru_prev != NULL)
+		blk->lru_prev->lru_next = blk->lru_next;
+	else
+		hmcdrv_ctx.lru_head = blk->lru_next;
+
+	if (blk->lru_next != NULL)
+		blk->lru_next->lru_prev = blk->lru_prev;
+	else
+		hmcdrv_ctx.lru_tail = blk->lru_prev;
+}
+
+
+/*
+ * insert a block as most recently used one into the LRU list
+ */
+static void hmcdrv_blk_lru_push(struct hmcdrv_fuse_blk *blk)
+{
+	blk->lru_prev = NULL;
+	blk->lru_next = hmcdrv_ctx.lru_head;
+
+	if (hmcdrv_ctx.lru_head != NULL)
+		hmcdrv_ctx.lru_head->lru_prev = blk;
+	else
+		hmcdrv_ctx.lru_tail = blk;
+
+	hmcdrv_ctx.lru_head = blk;
+}
+
+
+/*
+ * remove a block from the file content cache and free it
+ */
+static void hmcdrv_blk_free(struct hmcdrv_fuse_blk *blk)
+{
+	struct hmcdrv_fuse_blk **pbase = &hmcdrv_fuse_blkcache[blk->hash];
+
+	while (*pbase != blk)
+		pbase = &(*pbase)->next;
+
+	*pbase = blk->next;
+	hmcdrv_blk_lru_unlink(blk);
+	hmcdrv_ctx.blkbytes -= HMCDRV_FUSE_BLKSIZE;
+	free(blk);
+}
+
+
+/*
+ * search for a block in file content cache
+ */
+static struct hmcdrv_fuse_blk *hmcdrv_blk_find(const char *path,
+					       time_t mtime, off_t index)
+{
+	unsigned int hash = hmcdrv_blk_fnv(path, mtime, index) %
+		HMCDRV_FUSE_BLKHASH_SIZE;
+	struct hmcdrv_fuse_blk *blk = hmcdrv_fuse_blkcache[hash];
+
+	while (blk != NULL) {
+		if ((blk->index == index) && (blk->mtime == mtime) &&
+		    (strcmp(blk->path, path) == 0)) {
+			hmcdrv_blk_lru_unlink(blk);
+			hmcdrv_blk_lru_push(blk);
+			return blk;
+		}
+
+		blk = blk->next;
+	}
+
+	return NULL;
+}
+
+
+/*
+ * build the file name of a block in the on-disk cache directory
+ */
+static void hmcdrv_blk_dskname(struct hmcdrv_fuse_blk *blk, char *name,
+			       size_t size)
+{
+	snprintf(name, size, "%s/%08x.%jd", hmcdrv_ctx.opt.cachedir,
+		 hmcdrv_blk_fnv(blk->path, blk->mtime, blk->index),
+		 (intmax_t) blk->index);
+}
+
+
+/*
+ * check if 'name' is the name of a block in the on-disk cache directory
+ */
+static int hmcdrv_dsk_isblk(const char *name)
+{
+	unsigned int hash;
+	intmax_t index;
+	int len = 0;
+
+	return (sscanf(name, "%8x.%jd%n", &hash, &index, &len) == 2) &&
+		(name[len] == '\0');
+}
+
+
+/*
+ * compare two on-disk cache directory entries by modification time
+ */
+static int hmcdrv_dsk_cmp(const void *a, const void *b)
+{
+	const struct hmcdrv_fuse_dskent *ea = a, *eb = b;
+
+	if (ea->mtime != eb->mtime)
+		return (ea->mtime < eb->mtime) ? -1 : 1;
+
+	return 0;
+}
+
+
+/*
+ * scan the on-disk cache directory, and remove the least recently used
+ * blocks until the size of all blocks is not greater than 'max'
+ *
+ * Note: must be called with 'dskmutex' held
+ */
+static void hmcdrv_dsk_prune(size_t max)
+{
+	struct hmcdrv_fuse_dskent *ent = NULL, *tmp;
+	size_t cnt = 0, alloc = 0, i;
+	char name[PATH_MAX];
+	struct dirent *de;
+	struct stat st;
+	DIR *dp;
+
+	dp = opendir(hmcdrv_ctx.opt.cachedir);
+
+	if (dp == NULL)
+		return;
+
+	hmcdrv_ctx.dskbytes = 0;
+
+	while ((de = readdir(dp)) != NULL) {
+		if (!hmcdrv_dsk_isblk(de->d_name))
+			continue;
+
+		snprintf(name, sizeof(name), "%s/%s",
+			 hmcdrv_ctx.opt.cachedir, de->d_name);
+
+		if ((lstat(name, &st) != 0) || !S_ISREG(st.st_mode))
+			continue;
+
+		if (cnt == alloc) {
+			alloc = alloc ? 2 * alloc : 256;
+			tmp = realloc(ent, alloc * sizeof(*ent));
+
+			if (tmp == NULL)
+				break;
+
+			ent = tmp;
+		}
+
+		util_strlcpy(ent[cnt].name, de->d_name, sizeof(ent[cnt].name));
+		ent[cnt].mtime = st.st_mtime;
+		ent[cnt].size = st.st_size;
+		hmcdrv_ctx.dskbytes += st.st_size;
+		++cnt;
+	}
+
+	closedir(dp);
+
+	/* remove the oldest blocks first
+	 */
+	qsort(ent, cnt, sizeof(*ent), hmcdrv_dsk_cmp);
+
+	for (i = 0; (i < cnt) && (hmcdrv_ctx.dskbytes > max); ++i) {
+		snprintf(name, sizeof(name), "%s/%s",
+			 hmcdrv_ctx.opt.cachedir, ent[i].name);
+
+		if (unlink(name) == 0)
+			hmcdrv_ctx.dskbytes -= ent[i].size;
+	}
+
+	free(ent);
+	HMCDRV_FUSE_DBGLOG("on-disk cache %zu bytes (max. %zu)",
+			   hmcdrv_ctx.dskbytes, hmcdrv_ctx.dskmax);
+}
+
+
+/*
+ * load a block from the on-disk cache directory
+ *
+ * Return: 0 on success, -1 if the block is not in the on-disk cache
+ */
+static int hmcdrv_blk_dskload(struct hmcdrv_fuse_blk *blk)
+{
+	struct hmcdrv_fuse_dskblk hdr;
+	char name[PATH_MAX];
+	int rc = -1;
+	int fd;
+
+	if (hmcdrv_ctx.opt.cachedir == NULL)
+		return -1;
+
+	hmcdrv_blk_dskname(blk, name, sizeof(name));
+	fd = open(name, O_RDONLY);
+
+	if (fd < 0)
+		return -1;
+
+	if ((read(fd, &hdr, sizeof(hdr)) == sizeof(hdr)) &&
+	    (hdr.mtime == blk->mtime) && (hdr.index == (uint64_t) blk->index) &&
+	    (hdr.len == blk->len) &&
+	    (strncmp(hdr.path, blk->path, HMCDRV_FUSE_MAXPATH) == 0) &&
+	    (read(fd, blk->data, blk->len) == (ssize_t) blk->len)) {
+		futimens(fd, NULL); /* mark as recently used */
+		rc = 0;
+	}
+
+	close(fd);
+	return rc;
+}
+
+
+/*
+ * store a block in the on-disk cache directory (errors are ignored, the
+ * block is then read from the HMC again)
+ */
+static void hmcdrv_blk_dskstore(struct hmcdrv_fuse_blk *blk)
+{
+	struct hmcdrv_fuse_dskblk hdr;
+	char name[PATH_MAX];
+	char tmp[PATH_MAX + 8];
+	int fd, ok;
+
+	if (hmcdrv_ctx.opt.cachedir == NULL)
+		return;
+
+	memset(&hdr, 0, sizeof(hdr));
+	util_strlcpy(hdr.path, blk->path, sizeof(hdr.path));
+	hdr.mtime = blk->mtime;
+	hdr.index = blk->index;
+	hdr.len = blk->len;
+
+	hmcdrv_blk_dskname(blk, name, sizeof(name));
+	snprintf(tmp, sizeof(tmp), "%s.XXXXXX", name);
+	fd = mkstemp(tmp);
+
+	if (fd < 0)
+		return;
+
+	ok = (write(fd, &hdr, sizeof(hdr)) == sizeof(hdr)) &&
+		(write(fd, blk->data, blk->len) == (ssize_t) blk->len);
+
+	/* rename() makes a complete block visible at once
+	 */
+	if ((close(fd) != 0) || !ok || (rename(tmp, name) != 0)) {
+		unlink(tmp);
+		return;
+	}
+
+	/* prune to 3/4 of the limit, so that not every new block requires
+	 * a scan of the directory
+	 */
+	pthread_mutex_lock(&hmcdrv_ctx.dskmutex);
+	hmcdrv_ctx.dskbytes += sizeof(hdr) + blk->len;
+
+	if (hmcdrv_ctx.dskbytes > hmcdrv_ctx.dskmax)
+		hmcdrv_dsk_prune(hmcdrv_ctx.dskmax / 4 * 3);
+
+	pthread_mutex_unlock(&hmcdrv_ctx.dskmutex);
+}
+
+
+/*
+ * read a block of file 'fp' from the on-disk cache or from the HMC drive
+ *
+ * Note: does not access the file content cache, so the caller does not
+ *       need to hold the cache mutex if 'fp' is a private copy
+ *
+ * Return: pointer to new block or NULL with error code in 'rc'
+ */
+static struct hmcdrv_fuse_blk *hmcdrv_blk_load(struct hmcdrv_fuse_file *fp,
+					       off_t index, int *rc)
+{
+	off_t offset = index * HMCDRV_FUSE_BLKSIZE;
+	struct hmcdrv_fuse_blk *blk;
+	ssize_t retlen;
+	size_t len;
+
+	blk = malloc(offsetof(struct hmcdrv_fuse_blk, data) +
+		     HMCDRV_FUSE_BLKSIZE);
+
+	if (blk == NULL) {
+		*rc = -ENOMEM;
+		return NULL;
+	}
+
+	util_strlcpy(blk->path, HMCDRV_FUSE_PATH(fp), sizeof(blk->path));
+	blk->mtime = fp->st.st_mtime;
+	blk->index = index;
+	blk->len = MIN((off_t) HMCDRV_FUSE_BLKSIZE, fp->st.st_size - offset);
+
+	if (hmcdrv_blk_dskload(blk) != 0) {
+		len = 0;
+
+		while (len < blk->len) {
+			retlen = hmcdrv_ftp_cmd(fp, HMCDRV_FUSE_CMDID_GET,
+						blk->data + len,
+						blk->len - len,
+						offset + len);
+			if (retlen < 0) {
+				*rc = retlen;
+				free(blk);
+				return NULL;
+			}
+
+			if (retlen == 0) /* file is shorter than expected */
+				break;
+
+			len += retlen;
+		}
+
+		blk->len = len;
+		hmcdrv_blk_dskstore(blk);
+	}
+
+	return blk;
+}
+
+
+/*
+ * insert a block into the file content cache, evicting least recently
+ * used blocks if the cache is full
+ */
+static void hmcdrv_blk_insert(struct hmcdrv_fuse_blk *blk)
+{
+	blk->hash = hmcdrv_blk_fnv(blk->path, blk->mtime, blk->index) %
+		HMCDRV_FUSE_BLKHASH_SIZE;
+	blk->next = hmcdrv_fuse_blkcache[blk->hash];
+	hmcdrv_fuse_blkcache[blk->hash] = blk;
+	hmcdrv_blk_lru_push(blk);
+	hmcdrv_ctx.blkbytes += HMCDRV_FUSE_BLKSIZE;
+
+	while ((hmcdrv_ctx.blkbytes > hmcdrv_ctx.blkmax) &&
+	       (hmcdrv_ctx.lru_tail != blk))
+		hmcdrv_blk_free(hmcdrv_ctx.lru_tail);
+}
+
+
+/*
+ * read a block of file 'fp' into the file content cache
+ *
+ * Return: pointer to block or NULL with error code in 'rc'
+ */
+static struct hmcdrv_fuse_blk *hmcdrv_blk_fetch(struct hmcdrv_fuse_file *fp,
+						off_t index, int *rc)
+{
+	struct hmcdrv_fuse_blk *blk = hmcdrv_blk_load(fp, index, rc);
+
+	if (blk != NULL)
+		hmcdrv_blk_insert(blk);
+
+	return blk;
+}
+
+
+/*
+ * check if the read-ahead thread shall stop reading the current file,
+ * because it shall terminate or a new request supersedes the current one
+ */
+static int hmcdrv_blk_readahead_stop(void)
+{
+	int stop;
+
+	pthread_mutex_lock(&hmcdrv_ctx.ramutex);
+	stop = (hmcdrv_ctx.rafile != NULL) || hmcdrv_ctx.rastop;
+	pthread_mutex_unlock(&hmcdrv_ctx.ramutex);
+
+	return stop;
+}
+
+
+/*
+ * read blocks 'index' to 'last' of file 'fp' (a private copy) into the file
+ * content cache, without holding the cache mutex while the data is
+ * transferred from the HMC drive
+ */
+static void hmcdrv_blk_readahead_file(struct hmcdrv_fuse_file *fp,
+				      off_t index, off_t last)
+{
+	struct hmcdrv_fuse_blk *blk;
+	int rc;
+
+	for (; index <= last; ++index) {
+		if (hmcdrv_blk_readahead_stop())
+			break;
+
+		pthread_mutex_lock(&hmcdrv_ctx.mutex);
+		blk = hmcdrv_blk_find(HMCDRV_FUSE_PATH(fp),
+				      fp->st.st_mtime, index);
+		pthread_mutex_unlock(&hmcdrv_ctx.mutex);
+
+		if (blk != NULL)
+			continue;
+
+		blk = hmcdrv_blk_load(fp, index, &rc);
+
+		if (blk == NULL)
+			break;
+
+		/* a reader could have fetched the block meanwhile
+		 */
+		pthread_mutex_lock(&hmcdrv_ctx.mutex);
+
+		if (hmcdrv_blk_find(blk->path, blk->mtime, index) == NULL)
+			hmcdrv_blk_insert(blk);
+		else
+			free(blk);
+
+		pthread_mutex_unlock(&hmcdrv_ctx.mutex);
+	}
+}
+
+
+/*
+ * read-ahead thread: handles the most recent read-ahead request
+ */
+static void *hmcdrv_blk_readahead(void *UNUSED(arg))
+{
+	struct hmcdrv_fuse_file *fp;
+	off_t first, last;
+
+	pthread_mutex_lock(&hmcdrv_ctx.ramutex);
+
+	while (!hmcdrv_ctx.rastop) {
+		if (hmcdrv_ctx.rafile == NULL) {
+			pthread_cond_wait(&hmcdrv_ctx.racond,
+					  &hmcdrv_ctx.ramutex);
+			continue;
+		}
+
+		fp = hmcdrv_ctx.rafile;
+		first = hmcdrv_ctx.rafirst;
+		last = hmcdrv_ctx.ralast;
+		hmcdrv_ctx.rafile = NULL;
+		pthread_mutex_unlock(&hmcdrv_ctx.ramutex);
+
+		hmcdrv_blk_readahead_file(fp, first, last);
+		free(fp);
+
+		pthread_mutex_lock(&hmcdrv_ctx.ramutex);
+	}
+
+	pthread_mutex_unlock(&hmcdrv_ctx.ramutex);
+	return NULL;
+}
+
+
+/*
+ * pass blocks 'first' to 'last' of file 'fp' to the read-ahead thread,
+ * replacing a pending request
+ *
+ * Note: must be called with the cache mutex held
+ */
+static void hmcdrv_blk_readahead_post(struct hmcdrv_fuse_file *fp,
+				      off_t first, off_t last)
+{
+	size_t size = offsetof(struct hmcdrv_fuse_file, ftpcmd) +
+		fp->cmdlen + 1;
+	struct hmcdrv_fuse_file *copy;
+
+	/* the read-ahead thread uses a private copy of the file, because
+	 * the original can expire while the cache mutex is released
+	 */
+	copy = malloc(size);
+
+	if (copy == NULL)
+		return;
+
+	memcpy(copy, fp, size);
+	copy->next = NULL;
+	copy->symlnk = NULL;
+
+	pthread_mutex_lock(&hmcdrv_ctx.ramutex);
+	free(hmcdrv_ctx.rafile);
+	hmcdrv_ctx.rafile = copy;
+	hmcdrv_ctx.rafirst = first;
+	hmcdrv_ctx.ralast = last;
+	pthread_cond_signal(&hmcdrv_ctx.racond);
+	pthread_mutex_unlock(&hmcdrv_ctx.ramutex);
+}
+
+
+/*
+ * read file content through the file content cache, and read ahead
+ * blocks on sequential access
+ */
+static int hmcdrv_blk_read(struct hmcdrv_fuse_file *fp, char *buf,
+			   size_t size, off_t offset)
+{
+	off_t index, first, last, ralast;
+	struct hmcdrv_fuse_blk *blk;
+	size_t ofs, len, done = 0;
+	int sequential;
+	int rc = 0;
+
+	if (offset >= fp->st.st_size)
+		return 0;
+
+	size = MIN((off_t) size, fp->st.st_size - offset);
+	first = offset / HMCDRV_FUSE_BLKSIZE;
+	last = (offset + size - 1) / HMCDRV_FUSE_BLKSIZE;
+	sequential = (first == fp->ranext) || (first + 1 == fp->ranext);
+
+	for (index = first; index <= last; ++index) {
+		blk = hmcdrv_blk_find(HMCDRV_FUSE_PATH(fp),
+				      fp->st.st_mtime, index);
+
+		if (blk == NULL)
+			blk = hmcdrv_blk_fetch(fp, index, &rc);
+
+		if (blk == NULL)
+			return (done > 0) ? (int) done : rc;
+
+		ofs = (offset + done) - index * HMCDRV_FUSE_BLKSIZE;
+
+		if (ofs >= blk->len) /* file is shorter than expected */
+			break;
+
+		len = MIN(blk->len - ofs, size - done);
+		memcpy(buf + done, blk->data + ofs, len);
+		done += len;
+	}
+
+	fp->ranext = last + 1;
+
+	if (!sequential || !hmcdrv_ctx.rarun)
+		return done;
+
+	/* read ahead while the HMC drive is positioned behind the last
+	 * block, unless the blocks are already cached
+	 */
+	ralast = last + (hmcdrv_ctx.opt.readahead * 1024 +
+			 HMCDRV_FUSE_BLKSIZE - 1) / HMCDRV_FUSE_BLKSIZE;
+	ralast = MIN(ralast, (fp->st.st_size - 1) / HMCDRV_FUSE_BLKSIZE);
+
+	if ((ralast > last) &&
+	    (hmcdrv_blk_find(HMCDRV_FUSE_PATH(fp), fp->st.st_mtime,
+			     ralast) == NULL))
+		hmcdrv_blk_readahead_post(fp, last + 1, ralast);
+
+	return done;
+}
+
+
+/*
+ * free all blocks of the file content cache
+ */
+static void hmcdrv_blk_free_all(void)
+{
+	while (hmcdrv_ctx.lru_tail != NULL)
+		hmcdrv_blk_free(hmcdrv_ctx.lru_tail);
+}
+
+
 /*
  * returns a file path (from internal file structure) to a buffer,
  * with appending a slash (in case it is missing)
@@ -1215,9 +2054,11 @@ static int hmcdrv_fuse_read(const char *path, char *buf, size_t size,
 
 	if (fp == NULL)
 		rc = -ENOENT;
-	else
+	else if ((hmcdrv_ctx.blkmax == 0) || (fp->st.st_size == 0))
 		rc = hmcdrv_ftp_cmd(fp, HMCDRV_FUSE_CMDID_GET,
 				    buf, size, offset);
+	else
+		rc = hmcdrv_blk_read(fp, buf, size, offset);
 
 	pthread_mutex_unlock(&hmcdrv_ctx.mutex);
 	return rc;
@@ -1235,18 +2076,26 @@ static int hmcdrv_fuse_read(const char *path, char *buf, size_t size,
 static void *hmcdrv_fuse_init(struct fuse_conn_info *UNUSED(conn))
 {
 	pthread_mutexattr_t attr;
+	struct stat st;
 
 	memset(hmcdrv_fuse_cache, 0, sizeof(hmcdrv_fuse_cache));
+	memset(hmcdrv_fuse_blkcache, 0, sizeof(hmcdrv_fuse_blkcache));
 	openlog(HMCDRV_FUSE_LOGNAME, LOG_PID, LOG_DAEMON);
 
 	if (pthread_mutexattr_init(&attr) != 0)
 		goto err_out;
 
 	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
-	hmcdrv_ctx.fd = open(HMCDRV_FUSE_FTPDEV, O_RDWR);
+	hmcdrv_ctx.fd = -1;
+	hmcdrv_ctx.local = (stat(hmcdrv_ctx.opt.hmcdrv, &st) == 0) &&
+		S_ISDIR(st.st_mode);
 
-	if (hmcdrv_ctx.fd < 0)
-		goto err_dev;
+	if (!hmcdrv_ctx.local) {
+		hmcdrv_ctx.fd = open(hmcdrv_ctx.opt.hmcdrv, O_RDWR);
+
+		if (hmcdrv_ctx.fd < 0)
+			goto err_dev;
+	}
 
 	if (pthread_mutex_init(&hmcdrv_ctx.mutex, &attr) != 0)
 		goto err_mutex;
@@ -1256,12 +2105,21 @@ static void *hmcdrv_fuse_init(struct fuse_conn_info *UNUSED(conn))
 	if (pthread_create(&hmcdrv_ctx.tid, NULL,
 			   hmcdrv_cache_aging, NULL) == 0) {
 
+		/* without read-ahead thread there is no read-ahead
+		 */
+		if ((hmcdrv_ctx.blkmax > 0) && (hmcdrv_ctx.opt.readahead > 0))
+			hmcdrv_ctx.rarun =
+				(pthread_create(&hmcdrv_ctx.ratid, NULL,
+						hmcdrv_blk_readahead,
+						NULL) == 0);
+
 		pthread_mutexattr_destroy(&attr);
 		return &hmcdrv_ctx.tid;
 	}
 
 err_mutex:
-	close(hmcdrv_ctx.fd);
+	if (hmcdrv_ctx.fd >= 0)
+		close(hmcdrv_ctx.fd);
 err_dev:
 	pthread_mutexattr_destroy(&attr);
 err_out:
@@ -1281,6 +2139,17 @@ static void hmcdrv_fuse_exit(void *arg)
 	struct hmcdrv_fuse_file *fp, *next;
 	int i;
 
+	if (hmcdrv_ctx.rarun) {
+		pthread_mutex_lock(&hmcdrv_ctx.ramutex);
+		hmcdrv_ctx.rastop = 1;
+		pthread_cond_signal(&hmcdrv_ctx.racond);
+		pthread_mutex_unlock(&hmcdrv_ctx.ramutex);
+		pthread_join(hmcdrv_ctx.ratid, NULL);
+		free(hmcdrv_ctx.rafile);
+		hmcdrv_ctx.rafile = NULL;
+		hmcdrv_ctx.rarun = 0;
+	}
+
 	if (arg != NULL)
 		pthread_cancel(*(pthread_t *) arg);
 
@@ -1298,6 +2167,7 @@ static void hmcdrv_fuse_exit(void *arg)
 	}
 
 	memset(hmcdrv_fuse_cache, 0, sizeof(hmcdrv_fuse_cache));
+	hmcdrv_blk_free_all();
 	pthread_mutex_destroy(&hmcdrv_ctx.mutex);
 	closelog();
 
@@ -1348,6 +2218,14 @@ static void hmcdrv_fuse_usage(const char *progname)
 		"Specific options:\n"
 		"    -o hmclang=LANG        HMC speaks language LANG (see locale(1))\n"
 		"    -o hmctz=TZ            HMC is in timezone TZ (see tzset(3))\n"
+		"    -o cache_size=MB       Cache MB MiB of file content (default %d)\n"
+		"    -o readahead=KB        Read ahead KB KiB on sequential reads\n"
+		"                           (default %d)\n"
+		"    -o cache_dir=DIR       Also cache file content in directory DIR\n"
+		"    -o cache_dir_size=MB   Keep up to MB MiB in directory DIR\n"
+		"                           (default %d)\n"
+		"    -o hmcdrv=PATH         Use FTP device or local directory PATH\n"
+		"                           (default %s)\n"
 		"\n"
 		"Attention:\n"
 		"    The following general and FUSE specific mount options will\n"
@@ -1356,7 +2234,9 @@ static void hmcdrv_fuse_usage(const char *progname)
 		"    -o atomic_o_trunc, -o hard_remove, -o negative_timeout=T,\n"
 		"    -o use_ino, -o readdir_ino, -o subdir=DIR\n"
 		"\n",
-		progname, progname);
+		progname, progname, HMCDRV_FUSE_BLKCACHE_MB,
+		HMCDRV_FUSE_READAHEAD_KB, HMCDRV_FUSE_DSKCACHE_MB,
+		HMCDRV_FUSE_FTPDEV);
 }
 
 
@@ -1399,6 +2279,68 @@ static int hmcdrv_optproc_lang(void)
 }
 
 
+/*
+ * check the "-o hmcdrv=PATH", "-o cache_dir=DIR", "-o cache_dir_size=MB",
+ * "-o cache_size=MB" and "-o readahead=KB" command line options
+ *
+ * Note: The paths are made absolute, because FUSE changes the working
+ *       directory when running in background.
+ *
+ * Return: 0 on success, -1 on error
+ */
+static int hmcdrv_optproc_cache(void)
+{
+	char *path;
+
+	if (hmcdrv_ctx.opt.hmcdrv == NULL) {
+		hmcdrv_ctx.opt.hmcdrv = HMCDRV_FUSE_FTPDEV;
+	} else {
+		path = realpath(hmcdrv_ctx.opt.hmcdrv, NULL);
+
+		if (path == NULL) {
+			HMCDRV_FUSE_LOG(LOG_ERR, "Could not access '%s': %s",
+					hmcdrv_ctx.opt.hmcdrv,
+					strerror(errno));
+			return -1;
+		}
+
+		hmcdrv_ctx.opt.hmcdrv = path;
+	}
+
+	if (hmcdrv_ctx.opt.cachedir != NULL) {
+		path = realpath(hmcdrv_ctx.opt.cachedir, NULL);
+
+		if ((path == NULL) || (access(path, W_OK) != 0)) {
+			HMCDRV_FUSE_LOG(LOG_ERR,
+					"Could not use cache directory '%s': %s",
+					hmcdrv_ctx.opt.cachedir,
+					strerror(errno));
+			return -1;
+		}
+
+		hmcdrv_ctx.opt.cachedir = path;
+
+		/* determine the size of the on-disk cache, and enforce the
+		 * limit already at mount time
+		 */
+		hmcdrv_ctx.dskmax = (size_t) hmcdrv_ctx.opt.dsksize *
+			1024 * 1024;
+		hmcdrv_dsk_prune(hmcdrv_ctx.dskmax);
+	}
+
+	/* keep at least half of the cache for blocks that are not read ahead
+	 */
+	hmcdrv_ctx.blkmax = (size_t) hmcdrv_ctx.opt.cachesize * 1024 * 1024;
+
+	if (hmcdrv_ctx.opt.readahead > hmcdrv_ctx.blkmax / 2048)
+		hmcdrv_ctx.opt.readahead = hmcdrv_ctx.blkmax / 2048;
+
+	HMCDRV_FUSE_DBGLOG("file content cache %zu bytes, read-ahead %u KiB",
+			   hmcdrv_ctx.blkmax, hmcdrv_ctx.opt.readahead);
+	return 0;
+}
+
+
 /*
  * option parsing function
  */
@@ -1513,6 +2455,11 @@ int main(int argc, char *argv[])
 
 		HMCDRV_FUSE_OPT("hmctz=%s", hmctz, 0),
 		HMCDRV_FUSE_OPT("hmclang=%s", hmclang, 0),
+		HMCDRV_FUSE_OPT("hmcdrv=%s", hmcdrv, 0),
+		HMCDRV_FUSE_OPT("cache_dir=%s", cachedir, 0),
+		HMCDRV_FUSE_OPT("cache_dir_size=%u", dsksize, 0),
+		HMCDRV_FUSE_OPT("cache_size=%u", cachesize, 0),
+		HMCDRV_FUSE_OPT("readahead=%u", readahead, 0),
 
 		FUSE_OPT_KEY("ro", HMCDRV_FUSE_OPTKEY_RO),
 		FUSE_OPT_KEY("-r", HMCDRV_FUSE_OPTKEY_RO),
@@ -1551,11 +2498,17 @@ int main(int argc, char *argv[])
 	struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
 
 	memset(&hmcdrv_ctx.opt, 0, sizeof(hmcdrv_ctx.opt));
+	hmcdrv_ctx.opt.cachesize = HMCDRV_FUSE_BLKCACHE_MB;
+	hmcdrv_ctx.opt.readahead = HMCDRV_FUSE_READAHEAD_KB;
+	hmcdrv_ctx.opt.dsksize = HMCDRV_FUSE_DSKCACHE_MB;
 	hmcdrv_ctx.pid = getpid();
 
 	fuse_opt_parse(&args, &hmcdrv_ctx.opt, lookup_opt,
 		       hmcdrv_fuse_optproc);
 
+	if (hmcdrv_optproc_cache() != 0)
+		exit(EXIT_FAILURE);
+
 	/* the following options are required on a read-only media */
 	if (!hmcdrv_ctx.opt.ro)
 		fuse_opt_add_arg(&args, "-oro");
@@ -14,6 +14,7 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include "dg_debugfs.h"
 #include "helper.h"
@@ -50,6 +51,8 @@ int dg_debugfs_init(int exit_on_err)
 {
 	int rc;
 
+	if (g.o.replay_file)
+		return dg_debugfs_replay_init();
 	l_debugfs_dir = ht_mount_point_get("debugfs");
 	if (!l_debugfs_dir) {
 		if (!exit_on_err)
@@ -91,3 +94,39 @@ int dg_debugfs_open(const char *file)
 	else
 		return fh;
 }
+
+/*
+ * Read a debugfs file that starts with a header of size "hdr_size"
+ *
+ * The first member of the header is the length of the data that follows
+ * the header. The buffer size "buf_size" is adjusted until the complete
+ * file fits into the buffer. When recording, the buffer is appended to the
+ * record file and when replaying, it is taken from the replay file.
+ */
+void *dg_debugfs_read(const char *file, size_t hdr_size, long *buf_size)
+{
+	long real_buf_size;
+	ssize_t rc;
+	void *buf;
+	int fh;
+
+	if (dg_debugfs_replay_info())
+		return dg_debugfs_replay_read(file, hdr_size);
+	do {
+		fh = dg_debugfs_open(file);
+		if (fh < 0)
+			ERR_EXIT_ERRNO("Could not open file: %s", file);
+		buf = ht_alloc(*buf_size);
+		rc = read(fh, buf, *buf_size);
+		if (rc == -1)
+			ERR_EXIT_ERRNO("Reading hypervisor data failed");
+		close(fh);
+		real_buf_size = *((u64 *) buf) + hdr_size;
+		if (rc == real_buf_size)
+			break;
+		*buf_size = real_buf_size;
+		ht_free(buf);
+	} while (1);
+	dg_debugfs_rec_write(file, buf, real_buf_size);
+	return buf;
+}
@@ -12,14 +12,19 @@
 #ifndef DG_DEBUGFS_H
 #define DG_DEBUGFS_H
 
+#include <sys/time.h>
+
 #include "sd.h"
 
 #define DBFS_WAIT_TIME_US 10000
+#define DG_DEBUGFS_GUEST_NAME_LEN 64
 
 extern int dg_debugfs_init(int exit_on_err);
 extern int dg_debugfs_vm_init(void);
 extern int dg_debugfs_lpar_init(void);
 extern int dg_debugfs_open(const char *file);
+extern void *dg_debugfs_read(const char *file, size_t hdr_size,
+			     long *buf_size);
 
 /*
  * z/VM diag 0C prototypes
@@ -28,4 +33,25 @@ int dg_debugfs_vmd0c_init(void);
 void dg_debugfs_vmd0c_sys_cpu_fill(struct sd_sys *sys, u64 online_time,
 				   unsigned int cpu_cnt);
 
+/*
+ * Record and replay of debugfs data
+ */
+enum dg_debugfs_rec_dg {
+	DG_DEBUGFS_REC_LPAR	= 1,
+	DG_DEBUGFS_REC_VM	= 2,
+};
+
+struct dg_debugfs_rec_info {
+	enum dg_debugfs_rec_dg	dg;
+	char			guest_name[DG_DEBUGFS_GUEST_NAME_LEN];
+	int			vmd0c;
+};
+
+void dg_debugfs_rec_start(struct dg_debugfs_rec_info *info);
+void dg_debugfs_rec_write(const char *file, void *buf, size_t len);
+int dg_debugfs_replay_init(void);
+void *dg_debugfs_replay_read(const char *file, size_t hdr_size);
+struct dg_debugfs_rec_info *dg_debugfs_replay_info(void);
+int dg_debugfs_replay_time(struct timeval *tv);
+
 #endif /* DG_DEBUGFS_H */
@@ -214,25 +214,9 @@ struct l_debugfs_d204 {
 static void l_read_debugfs(struct l_debugfs_d204_hdr **hdr,
 			   struct l_x_info_blk_hdr **data)
 {
-	long real_buf_size;
-	ssize_t rc;
-	void *buf;
-	int fh;
-
-	do {
-		fh = dg_debugfs_open(DEBUGFS_FILE);
-		*hdr = buf = ht_alloc(l_204_buf_size);
-		rc = read(fh, buf, l_204_buf_size);
-		if (rc == -1)
-			ERR_EXIT_ERRNO("Reading hypervisor data failed");
-		close(fh);
-		real_buf_size = (*hdr)->len + sizeof(struct l_debugfs_d204_hdr);
-		if (rc == real_buf_size)
-			break;
-		l_204_buf_size = real_buf_size;
-		ht_free(buf);
-	} while (1);
-	*data = buf + sizeof(struct l_debugfs_d204_hdr);
+	*hdr = dg_debugfs_read(DEBUGFS_FILE, sizeof(struct l_debugfs_d204_hdr),
+			       &l_204_buf_size);
+	*data = ((void *) *hdr) + sizeof(struct l_debugfs_d204_hdr);
 }
 
 /*
@@ -370,14 +354,19 @@ static struct sd_dg l_sd_dg = {
  */
 int dg_debugfs_lpar_init(void)
 {
+	struct dg_debugfs_rec_info rec_info = {
+		.dg = DG_DEBUGFS_REC_LPAR,
+	};
 	int fh;
 
 	l_204_buf_size = sizeof(struct l_debugfs_d204_hdr);
-	fh = dg_debugfs_open(DEBUGFS_FILE);
-	if (fh < 0)
-		return fh;
-	else
+	if (!dg_debugfs_replay_info()) {
+		fh = dg_debugfs_open(DEBUGFS_FILE);
+		if (fh < 0)
+			return fh;
 		close(fh);
+	}
+	dg_debugfs_rec_start(&rec_info);
 	sd_dg_register(&l_sd_dg, 1);
 	return 0;
 }
@@ -0,0 +1,292 @@
+/*
+ * hyptop - Show hypervisor performance data on System z
+ *
+ * Record and replay of debugfs data
+ *
+ * A recording consists of a file header that describes the data gatherer
+ * followed by the raw debugfs buffers in the order in which they have been
+ * read. Each buffer is preceded by a record header with the time of day
+ * of the read operation. All data is stored in host byte order.
+ *
+ * Copyright IBM Corp. 2020
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "lib/util_libc.h"
+
+#include "dg_debugfs.h"
+#include "helper.h"
+#include "hyptop.h"
+
+#define REC_MAGIC	"HYPTOPRC"
+#define REC_MAGIC_LEN	8
+#define REC_VERSION	1
+#define REC_FLG_VMD0C	0x1
+
+/*
+ * File header of a recording
+ */
+struct l_rec_file_hdr {
+	char	magic[REC_MAGIC_LEN];
+	u16	version;
+	u16	dg;
+	u32	flags;
+	char	guest_name[DG_DEBUGFS_GUEST_NAME_LEN];
+} __attribute__ ((packed));
+
+/*
+ * Header for one recorded debugfs buffer
+ */
+struct l_rec_hdr {
+	u64	time_us;	/* Time of day of read operation */
+	u32	len;		/* Length of buffer */
+	u16	file;		/* Index of debugfs file in l_file_vec */
+	u16	reserved;
+} __attribute__ ((packed));
+
+/*
+ * Debugfs files that can be recorded
+ */
+static const char *l_file_vec[] = {
+	"diag_204",
+	"diag_2fc",
+	"diag_0c",
+	NULL,
+};
+
+static FILE *l_rec_fh;
+static FILE *l_replay_fh;
+static struct dg_debugfs_rec_info l_replay_info;
+static unsigned int l_replay_primary;
+static u64 l_replay_time_us;
+static off_t l_replay_size;
+
+/*
+ * Get index of debugfs file in l_file_vec
+ */
+static unsigned int l_file_idx(const char *file)
+{
+	unsigned int i;
+
+	for (i = 0; l_file_vec[i]; i++) {
+		if (strcmp(l_file_vec[i], file) == 0)
+			return i;
+	}
+	ERR_EXIT("Debugfs file \"%s\" cannot be recorded\n", file);
+}
+
+/*
+ * Get current time of day in microseconds
+ */
+static u64 l_time_us(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (u64) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/*
+ * Fill file header with data gatherer information
+ */
+static void l_file_hdr_init(struct l_rec_file_hdr *hdr,
+			    struct dg_debugfs_rec_info *info)
+{
+	memset(hdr, 0, sizeof(*hdr));
+	memcpy(hdr->magic, REC_MAGIC, REC_MAGIC_LEN);
+	hdr->version = REC_VERSION;
+	hdr->dg = info->dg;
+	hdr->flags = info->vmd0c ? REC_FLG_VMD0C : 0;
+	util_strlcpy(hdr->guest_name, info->guest_name,
+		     sizeof(hdr->guest_name));
+}
+
+/*
+ * Start recording for data gatherer
+ *
+ * If the record file already contains data, it must have been recorded
+ * for the same data gatherer. New buffers are then appended.
+ */
+void dg_debugfs_rec_start(struct dg_debugfs_rec_info *info)
+{
+	struct l_rec_file_hdr hdr, hdr_old;
+
+	if (!g.o.record_file)
+		return;
+	l_rec_fh = fopen(g.o.record_file, "a+");
+	if (!l_rec_fh)
+		ERR_EXIT_ERRNO("Could not open record file \"%s\"",
+			       g.o.record_file);
+	l_file_hdr_init(&hdr, info);
+	fseek(l_rec_fh, 0, SEEK_END);
+	if (ftell(l_rec_fh) == 0) {
+		if (fwrite(&hdr, sizeof(hdr), 1, l_rec_fh) != 1)
+			ERR_EXIT_ERRNO("Could not write record file \"%s\"",
+				       g.o.record_file);
+		return;
+	}
+	rewind(l_rec_fh);
+	if (fread(&hdr_old, sizeof(hdr_old), 1, l_rec_fh) != 1 ||
+	    memcmp(&hdr, &hdr_old, sizeof(hdr)) != 0)
+		ERR_EXIT("Record file \"%s\" contains data of another "
+			 "system\n", g.o.record_file);
+}
+
+/*
+ * Append debugfs buffer to record file
+ */
+void dg_debugfs_rec_write(const char *file, void *buf, size_t len)
+{
+	struct l_rec_hdr hdr;
+
+	if (!l_rec_fh)
+		return;
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.time_us = l_time_us();
+	hdr.len = len;
+	hdr.file = l_file_idx(file);
+	if (fwrite(&hdr, sizeof(hdr), 1, l_rec_fh) != 1 ||
+	    fwrite(buf, len, 1, l_rec_fh) != 1 ||
+	    fflush(l_rec_fh) != 0)
+		ERR_EXIT_ERRNO("Could not write record file \"%s\"",
+			       g.o.record_file);
+}
+
+/*
+ * Exit for inconsistent replay file
+ */
+static void __noreturn l_replay_inval_exit(void)
+{
+	ERR_EXIT("Replay file \"%s\" is not valid\n", g.o.replay_file);
+}
+
+/*
+ * Check that the buffer of record header "hdr" fits into the replay file
+ */
+static int l_replay_len_valid(struct l_rec_hdr *hdr)
+{
+	long pos = ftell(l_replay_fh);
+
+	return pos >= 0 && hdr->len <= l_replay_size - pos;
+}
+
+/*
+ * Set update delay to the recorded interval to the next primary buffer
+ */
+static void l_replay_delay_set(u64 time_us)
+{
+	struct l_rec_hdr hdr;
+	u64 delay_us = 0;
+	long pos;
+
+	pos = ftell(l_replay_fh);
+	while (fread(&hdr, sizeof(hdr), 1, l_replay_fh) == 1) {
+		if (hdr.file == l_replay_primary) {
+			if (hdr.time_us > time_us && g.o.replay_speed)
+				delay_us = (hdr.time_us - time_us) /
+					g.o.replay_speed;
+			break;
+		}
+		if (!l_replay_len_valid(&hdr) ||
+		    fseek(l_replay_fh, hdr.len, SEEK_CUR))
+			break;
+	}
+	fseek(l_replay_fh, pos, SEEK_SET);
+	g.o.delay_s = delay_us / 1000000;
+	g.o.delay_us = delay_us % 1000000;
+}
+
+/*
+ * Read next debugfs buffer from replay file
+ *
+ * The buffers have to be requested in the same order as they have been
+ * recorded. At the end of the replay file hyptop exits.
+ */
+void *dg_debugfs_replay_read(const char *file, size_t hdr_size)
+{
+	struct l_rec_hdr hdr;
+	void *buf;
+
+	if (fread(&hdr, sizeof(hdr), 1, l_replay_fh) != 1)
+		hyptop_exit(0);
+	if (hdr.file != l_file_idx(file) || hdr.len < hdr_size ||
+	    !l_replay_len_valid(&hdr))
+		l_replay_inval_exit();
+	buf = ht_alloc(hdr.len);
+	if (fread(buf, hdr.len, 1, l_replay_fh) != 1)
+		hyptop_exit(0);
+	/* The length field of all debugfs headers is the first u64 */
+	if (*((u64 *) buf) + hdr_size != hdr.len)
+		l_replay_inval_exit();
+	l_replay_time_us = hdr.time_us;
+	/* An explicitly specified delay overrides the recorded one */
+	if (hdr.file == l_replay_primary && !g.o.delay_specified)
+		l_replay_delay_set(hdr.time_us);
+	return buf;
+}
+
+/*
+ * Return data gatherer information of replay file or NULL if hyptop
+ * does not replay
+ */
+struct dg_debugfs_rec_info *dg_debugfs_replay_info(void)
+{
+	return l_replay_fh ? &l_replay_info : NULL;
+}
+
+/*
+ * Return time of day of the last replayed buffer
+ */
+int dg_debugfs_replay_time(struct timeval *tv)
+{
+	if (!l_replay_fh)
+		return -ENODEV;
+	tv->tv_sec = l_replay_time_us / 1000000;
+	tv->tv_usec = l_replay_time_us % 1000000;
+	return 0;
+}
+
+/*
+ * Initialize debugfs data gatherer from replay file
+ */
+int dg_debugfs_replay_init(void)
+{
+	struct l_rec_file_hdr hdr;
+	struct stat sb;
+
+	l_replay_fh = fopen(g.o.replay_file, "r");
+	if (!l_replay_fh)
+		ERR_EXIT_ERRNO("Could not open replay file \"%s\"",
+			       g.o.replay_file);
+	if (fstat(fileno(l_replay_fh), &sb))
+		ERR_EXIT_ERRNO("Could not access replay file \"%s\"",
+			       g.o.replay_file);
+	l_replay_size = sb.st_size;
+	if (fread(&hdr, sizeof(hdr), 1, l_replay_fh) != 1 ||
+	    memcmp(hdr.magic, REC_MAGIC, REC_MAGIC_LEN) != 0 ||
+	    hdr.version != REC_VERSION)
+		l_replay_inval_exit();
+	l_replay_info.dg = hdr.dg;
+	l_replay_info.vmd0c = !!(hdr.flags & REC_FLG_VMD0C);
+	memcpy(l_replay_info.guest_name, hdr.guest_name,
+	       DG_DEBUGFS_GUEST_NAME_LEN);
+	l_replay_info.guest_name[DG_DEBUGFS_GUEST_NAME_LEN - 1] = 0;
+
+	switch (l_replay_info.dg) {
+	case DG_DEBUGFS_REC_LPAR:
+		l_replay_primary = l_file_idx("diag_204");
+		return dg_debugfs_lpar_init();
+	case DG_DEBUGFS_REC_VM:
+		l_replay_primary = l_file_idx("diag_2fc");
+		return dg_debugfs_vm_init();
+	default:
+		l_replay_inval_exit();
+	}
+}
@@ -28,7 +28,7 @@
 static u64 l_update_time_us;
 static long l_2fc_buf_size;
 static int l_use_debugfs_vmd0c;
-static char l_guest_name[64];
+static char l_guest_name[DG_DEBUGFS_GUEST_NAME_LEN];
 
 /*
  * Diag 2fc data structure definition
@@ -186,25 +186,9 @@ static void l_sd_sys_fill(struct sd_sys *guest, struct l_diag2fc_data *data)
 static void l_read_debugfs(struct l_debugfs_d2fc_hdr **hdr,
 			   struct l_diag2fc_data **data)
 {
-	long real_buf_size;
-	ssize_t rc;
-	void *buf;
-	int fh;
-
-	do {
-		fh = dg_debugfs_open(DEBUGFS_FILE);
-		*hdr = buf = ht_alloc(l_2fc_buf_size);
-		rc = read(fh, buf, l_2fc_buf_size);
-		if (rc == -1)
-			ERR_EXIT_ERRNO("Reading hypervisor data failed");
-		close(fh);
-		real_buf_size = (*hdr)->len + sizeof(struct l_debugfs_d2fc_hdr);
-		if (rc == real_buf_size)
-			break;
-		l_2fc_buf_size = real_buf_size;
-		ht_free(buf);
-	} while (1);
-	*data = buf + sizeof(struct l_debugfs_d2fc_hdr);
+	*hdr = dg_debugfs_read(DEBUGFS_FILE, sizeof(struct l_debugfs_d2fc_hdr),
+			       &l_2fc_buf_size);
+	*data = ((void *) *hdr) + sizeof(struct l_debugfs_d2fc_hdr);
 }
 
 /*
@@ -346,18 +330,32 @@ static struct sd_dg dg_debugfs_vm_dg = {
  */
 int dg_debugfs_vm_init(void)
 {
+	struct dg_debugfs_rec_info *replay_info = dg_debugfs_replay_info();
+	struct dg_debugfs_rec_info rec_info = {
+		.dg = DG_DEBUGFS_REC_VM,
+	};
 	int fh;
 
-	fh = dg_debugfs_vmd0c_init();
-	if (fh == 0)
-		l_use_debugfs_vmd0c = 1;
-	fh = dg_debugfs_open(DEBUGFS_FILE);
-	if (fh < 0)
-		return fh;
-	else
-		close(fh);
 	l_2fc_buf_size = sizeof(struct l_debugfs_d2fc_hdr);
-	l_guest_name_init();
+	if (replay_info) {
+		l_use_debugfs_vmd0c = replay_info->vmd0c;
+		if (l_use_debugfs_vmd0c)
+			dg_debugfs_vmd0c_init();
+		strcpy(l_guest_name, replay_info->guest_name);
+	} else {
+		fh = dg_debugfs_vmd0c_init();
+		if (fh == 0)
+			l_use_debugfs_vmd0c = 1;
+		fh = dg_debugfs_open(DEBUGFS_FILE);
+		if (fh < 0)
+			return fh;
+		else
+			close(fh);
+		l_guest_name_init();
+	}
+	rec_info.vmd0c = l_use_debugfs_vmd0c;
+	strcpy(rec_info.guest_name, l_guest_name);
+	dg_debugfs_rec_start(&rec_info);
 	sd_dg_register(&dg_debugfs_vm_dg, 0);
 	return 0;
 }
@@ -80,27 +80,9 @@ static void l_sd_cpu_fill(struct sd_sys *sys, unsigned int cpu_nr,
 static void l_read_debugfs(struct hypfs_diag0c_hdr **hdr,
 			   struct hypfs_diag0c_entry **entry)
 {
-	long real_buf_size;
-	ssize_t rc;
-	void *buf;
-	int fh;
-
-	do {
-		fh = dg_debugfs_open(DEBUGFS_FILE);
-		if (fh < 0)
-			ERR_EXIT_ERRNO("Could not open file: %s", DEBUGFS_FILE);
-		*hdr = buf = ht_alloc(l_0c_buf_size);
-		rc = read(fh, buf, l_0c_buf_size);
-		if (rc == -1)
-			ERR_EXIT_ERRNO("Reading hypervisor data failed");
-		close(fh);
-		real_buf_size = (*hdr)->len + sizeof(struct hypfs_diag0c_hdr);
-		if (rc == real_buf_size)
-			break;
-		l_0c_buf_size = real_buf_size;
-		ht_free(buf);
-	} while (1);
-	*entry = buf + sizeof(struct hypfs_diag0c_hdr);
+	*hdr = dg_debugfs_read(DEBUGFS_FILE, sizeof(struct hypfs_diag0c_hdr),
+			       &l_0c_buf_size);
+	*entry = ((void *) *hdr) + sizeof(struct hypfs_diag0c_hdr);
 }
 
 /*
@@ -140,11 +122,12 @@ int dg_debugfs_vmd0c_init(void)
 {
 	int fh;
 
-	fh = dg_debugfs_open(DEBUGFS_FILE);
-	if (fh < 0)
-		return -1;
-	else
+	if (!dg_debugfs_replay_info()) {
+		fh = dg_debugfs_open(DEBUGFS_FILE);
+		if (fh < 0)
+			return -1;
 		close(fh);
+	}
 	l_0c_buf_size = sizeof(struct hypfs_diag0c_hdr);
 	return 0;
 }
@@ -25,6 +25,7 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "dg_debugfs.h"
 #include "helper.h"
 #include "hyptop.h"
 #include "sd.h"
@@ -37,6 +38,15 @@ static int	l_underline_cnt;
 static int	l_reverse_cnt;
 static int	l_bold_cnt;
 
+/*
+ * Get time of day or the time of the replayed data
+ */
+void ht_time_get(struct timeval *tv)
+{
+	if (dg_debugfs_replay_time(tv) != 0)
+		gettimeofday(tv, NULL);
+}
+
 /*
  * Print time of day
  */
@@ -46,7 +56,7 @@ void ht_print_time(void)
 	struct timeval tv;
 	struct tm *tm;
 
-	gettimeofday(&tv, NULL);
+	ht_time_get(&tv);
 	tm = localtime(&tv.tv_sec);
 	strftime(time_str, sizeof(time_str), "%H:%M:%S", tm);
 	hyptop_printf("%s", time_str);
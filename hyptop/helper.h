@@ -14,6 +14,7 @@
 
 #include <limits.h>
 #include <stdlib.h>
+#include <sys/time.h>
 #include <sys/types.h>
 
 #include "lib/util_base.h"
@@ -33,6 +34,7 @@ extern void ht_print_help_icon(void);
 extern void ht_ebcdic_to_ascii(char *in, char *out, size_t len);
 extern char *ht_mount_point_get(const char *fs_type);
 extern u64 ht_ext_tod_2_us(void *tod_ext);
+extern void ht_time_get(struct timeval *tv);
 extern void ht_print_time(void);
 
 /*
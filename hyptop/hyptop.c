@@ -23,6 +23,7 @@
 #include "hyptop.h"
 #include "opts.h"
 #include "sd.h"
+#include "stream.h"
 #include "win_cpu_types.h"
 
 #ifdef WITH_HYPFS
@@ -252,6 +253,11 @@ fail:
 #ifdef WITH_HYPFS
 static void l_dg_init(void)
 {
+	/* Only the debugfs data gatherer supports record and replay */
+	if (g.o.record_file || g.o.replay_file) {
+		dg_debugfs_init(1);
+		return;
+	}
 	if (dg_debugfs_init(0) == 0)
 		return;
 	if (dg_hypfs_init() == 0)
@@ -364,6 +370,8 @@ int main(int argc, char *argv[])
 	sd_init();
 	l_dg_init();
 	opt_verify_systems();
+	if (g.o.format)
+		stream_run();
 	l_term_init();
 
 	win_sys_list_init();
@@ -22,10 +22,20 @@
 #include "table.h"
 
 #define HYPTOP_OPT_DEFAULT_DELAY	2
+#define HYPTOP_OPT_DEFAULT_REPLAY_SPEED	1
 #define HYPTOP_MAX_WIN_DEPTH		4
 #define HYPTOP_MAX_LINE			512
 #define PROG_NAME			"hyptop"
 
+/*
+ * Output formats for the "--format" option
+ */
+enum hyptop_format {
+	HYPTOP_FORMAT_NONE,
+	HYPTOP_FORMAT_CSV,
+	HYPTOP_FORMAT_JSON,
+};
+
 /*
  * Options info
  */
@@ -58,8 +68,16 @@ struct hyptop_opts {
 	struct hyptop_win		*cur_win;
 	struct hyptop_str_vec_opt	cpu_types;
 
+	unsigned int			delay_specified;
 	int				delay_s;
 	int				delay_us;
+
+	char				*record_file;
+	char				*replay_file;
+	unsigned int			replay_speed_specified;
+	unsigned int			replay_speed;
+
+	enum hyptop_format		format;
 };
 
 /*
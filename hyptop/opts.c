@@ -38,8 +38,12 @@ static char HELP_TEXT[] =
 "-S, --sort LETTER               Sort field for current window\n"
 "-t, --cpu_types TYPE[,..]       CPU types used for time calculations\n"
 "-b, --batch_mode                Use batch mode (no curses)\n"
+"-F, --format FORMAT             Print records in FORMAT (\"csv\" or \"json\")\n"
 "-d, --delay SECONDS             Delay time between screen updates\n"
-"-n, --iterations NUMBER         Number of iterations before ending\n";
+"-n, --iterations NUMBER         Number of iterations before ending\n"
+"-r, --record FILE               Append hypervisor data to FILE\n"
+"-R, --replay FILE               Use hypervisor data from FILE\n"
+"-x, --replay_speed FACTOR       Speed up replay by FACTOR (0: no delay)\n";
 
 /*
  * Initialize default settings
@@ -48,6 +52,7 @@ static void l_init_defaults(void)
 {
 	g.prog_name = PROG_NAME;
 	g.o.delay_s = HYPTOP_OPT_DEFAULT_DELAY;
+	g.o.replay_speed = HYPTOP_OPT_DEFAULT_REPLAY_SPEED;
 	g.w.cur = &win_sys_list;
 	g.o.cur_win = &win_sys_list;
 }
@@ -104,6 +109,7 @@ static void l_delay_set(char *delay_string)
 	l_number_check(delay_string);
 	if (sscanf(delay_string, "%i", &secs) != 1)
 		ERR_EXIT("The delay value \"%s\" is invalid\n", delay_string);
+	g.o.delay_specified = 1;
 	g.o.delay_s = secs;
 	g.o.delay_us = 0;
 }
@@ -271,11 +277,40 @@ static void l_batch_mode_set(void)
 	g.o.batch_mode_specified = 1;
 }
 
+/*
+ * Set the "--format" option
+ */
+static void l_format_set(const char *str)
+{
+	if (strcmp(str, "csv") == 0)
+		g.o.format = HYPTOP_FORMAT_CSV;
+	else if (strcmp(str, "json") == 0)
+		g.o.format = HYPTOP_FORMAT_JSON;
+	else
+		ERR_EXIT("The format \"%s\" is unknown\n", str);
+}
+
+/*
+ * Set the "--replay_speed" option
+ */
+static void l_replay_speed_set(const char *str)
+{
+	l_number_check(str);
+	g.o.replay_speed_specified = 1;
+	g.o.replay_speed = atoi(str);
+}
+
 /*
  * Make option consisteny checks at end of command line parsing
  */
 static void l_parse_finish(void)
 {
+	if (g.o.record_file && g.o.replay_file)
+		ERR_EXIT("The \"--record\" and \"--replay\" options cannot "
+			 "be used together\n");
+	if (g.o.replay_speed_specified && !g.o.replay_file)
+		ERR_EXIT("The \"--replay_speed\" option requires "
+			 "\"--replay\"\n");
 	if (g.o.iterations_specified && g.o.iterations == 0)
 		hyptop_exit(0);
 	if (g.o.cur_win != &win_sys)
@@ -305,9 +340,13 @@ void opts_parse(int argc, char *argv[])
 		{ "fields",      required_argument, NULL, 'f'},
 		{ "sort_field",  required_argument, NULL, 'S'},
 		{ "cpu_types",   required_argument, NULL, 't'},
+		{ "format",      required_argument, NULL, 'F'},
+		{ "record",      required_argument, NULL, 'r'},
+		{ "replay",      required_argument, NULL, 'R'},
+		{ "replay_speed", required_argument, NULL, 'x'},
 		{ NULL,          0,                 NULL, 0  }
 	};
-	static const char option_string[] = "vhbd:w:s:n:f:t:S:";
+	static const char option_string[] = "vhbd:w:s:n:f:t:S:F:r:R:x:";
 
 	l_init_defaults();
 	while (1) {
@@ -346,6 +385,18 @@ void opts_parse(int argc, char *argv[])
 		case 'S':
 			l_sort_field_set(optarg);
 			break;
+		case 'F':
+			l_format_set(optarg);
+			break;
+		case 'r':
+			g.o.record_file = optarg;
+			break;
+		case 'R':
+			g.o.replay_file = optarg;
+			break;
+		case 'x':
+			l_replay_speed_set(optarg);
+			break;
 		default:
 			l_std_usage_exit();
 		}
@@ -414,7 +465,7 @@ void opts_iterations_next(void)
 		if (g.o.iterations_act >= g.o.iterations)
 			hyptop_exit(0);
 	}
-	if (g.o.batch_mode_specified)
+	if (g.o.batch_mode_specified && !g.o.format)
 		printf("---------------------------------------------------"
 		       "----------------------------\n");
 }
@@ -60,6 +60,20 @@ struct sd_sys_name {
 
 struct sd_sys;
 
+/*
+ * Hash index for systems and CPUs by ID
+ */
+struct sd_hash_node {
+	struct sd_hash_node	*next;
+	const char		*id;
+};
+
+struct sd_hash {
+	struct sd_hash_node	**bucket_vec;
+	unsigned int		bucket_cnt;
+	unsigned int		cnt;
+};
+
 /*
  * SD info
  */
@@ -75,14 +89,17 @@ struct sd_cpu;
  */
 struct sd_sys {
 	struct util_list_node	list;
+	struct sd_hash_node	hash_node;
 	struct sd_info		i;
 	u64			update_time_us;
 	u32			child_cnt;
 	u32			child_cnt_active;
 	struct util_list	child_list;
+	struct sd_hash		child_hash;
 	u32			cpu_cnt;
 	u32			cpu_cnt_active;
 	struct util_list	cpu_list;
+	struct sd_hash		cpu_hash;
 	u32			threads_per_core;
 	char			id[SD_SYS_ID_SIZE];
 	struct sd_sys_name	name;
@@ -192,6 +209,7 @@ enum sd_cpu_state {
 
 struct sd_cpu {
 	struct util_list_node	list;
+	struct sd_hash_node	hash_node;
 	struct sd_info		i;
 	char			id[9];
 	struct sd_cpu_type	*type;
@@ -10,6 +10,7 @@
  * it under the terms of the MIT license. See LICENSE for details.
  */
 
+#include <stddef.h>
 #include <string.h>
 #include <time.h>
 
@@ -18,6 +19,11 @@
 #include "opts.h"
 #include "sd.h"
 
+#define L_HASH_BUCKET_CNT_MIN	16U
+
+#define l_hash_entry(node, type) \
+	((type *) ((char *) (node) - offsetof(type, hash_node)))
+
 /*
  * Internal globals for system data
  */
@@ -181,19 +187,101 @@ int sd_dg_has_core_data(void)
 }
 
 /*
- * Get CPU from sys by ID
+ * Hash function for IDs (FNV-1a)
  */
-struct sd_cpu *sd_cpu_get(struct sd_sys *sys, const char* id)
+static unsigned int l_hash_fn(const char *id)
 {
-	struct sd_cpu *cpu;
+	unsigned int hash = 2166136261U;
 
-	util_list_iterate(&sys->cpu_list, cpu) {
-		if (strcmp(cpu->id, id) == 0)
-			return cpu;
+	while (*id) {
+		hash ^= (unsigned char) *id++;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+/*
+ * Resize hash and redistribute all nodes
+ */
+static void l_hash_resize(struct sd_hash *hash, unsigned int bucket_cnt)
+{
+	struct sd_hash_node **bucket_vec, *node, *next;
+	unsigned int i, bucket;
+
+	bucket_vec = ht_zalloc(bucket_cnt * sizeof(*bucket_vec));
+	for (i = 0; i < hash->bucket_cnt; i++) {
+		for (node = hash->bucket_vec[i]; node; node = next) {
+			next = node->next;
+			bucket = l_hash_fn(node->id) % bucket_cnt;
+			node->next = bucket_vec[bucket];
+			bucket_vec[bucket] = node;
+		}
+	}
+	ht_free(hash->bucket_vec);
+	hash->bucket_vec = bucket_vec;
+	hash->bucket_cnt = bucket_cnt;
+}
+
+/*
+ * Add node with ID to hash
+ */
+static void l_hash_add(struct sd_hash *hash, struct sd_hash_node *node,
+		       const char *id)
+{
+	unsigned int bucket;
+
+	if (hash->cnt >= hash->bucket_cnt)
+		l_hash_resize(hash, MAX(hash->bucket_cnt * 2,
+					L_HASH_BUCKET_CNT_MIN));
+	node->id = id;
+	bucket = l_hash_fn(id) % hash->bucket_cnt;
+	node->next = hash->bucket_vec[bucket];
+	hash->bucket_vec[bucket] = node;
+	hash->cnt++;
+}
+
+/*
+ * Remove node from hash
+ */
+static void l_hash_del(struct sd_hash *hash, struct sd_hash_node *node)
+{
+	struct sd_hash_node **ptr;
+
+	ptr = &hash->bucket_vec[l_hash_fn(node->id) % hash->bucket_cnt];
+	while (*ptr != node)
+		ptr = &(*ptr)->next;
+	*ptr = node->next;
+	hash->cnt--;
+}
+
+/*
+ * Find node by ID
+ */
+static struct sd_hash_node *l_hash_find(struct sd_hash *hash, const char *id)
+{
+	struct sd_hash_node *node;
+
+	if (hash->cnt == 0)
+		return NULL;
+	node = hash->bucket_vec[l_hash_fn(id) % hash->bucket_cnt];
+	for (; node; node = node->next) {
+		if (strcmp(node->id, id) == 0)
+			return node;
 	}
 	return NULL;
 }
 
+/*
+ * Get CPU from sys by ID
+ */
+struct sd_cpu *sd_cpu_get(struct sd_sys *sys, const char* id)
+{
+	struct sd_hash_node *node;
+
+	node = l_hash_find(&sys->cpu_hash, id);
+	return node ? l_hash_entry(node, struct sd_cpu) : NULL;
+}
+
 /*
  * Get CPU type by ID
  */
@@ -225,6 +313,7 @@ struct sd_cpu *sd_cpu_new(struct sd_sys *parent, const char *id,
 	cpu->cnt = cnt;
 
 	util_list_add_tail(&parent->cpu_list, cpu);
+	l_hash_add(&parent->cpu_hash, &cpu->hash_node, cpu->id);
 
 	return cpu;
 }
@@ -234,13 +323,10 @@ struct sd_cpu *sd_cpu_new(struct sd_sys *parent, const char *id,
  */
 struct sd_sys *sd_sys_get(struct sd_sys *parent, const char* id)
 {
-	struct sd_sys *sys;
+	struct sd_hash_node *node;
 
-	util_list_iterate(&parent->child_list, sys) {
-		if (strcmp(sys->id, id) == 0)
-			return sys;
-	}
-	return NULL;
+	node = l_hash_find(&parent->child_hash, id);
+	return node ? l_hash_entry(node, struct sd_sys) : NULL;
 }
 
 /*
@@ -259,6 +345,8 @@ struct sd_sys *sd_sys_new(struct sd_sys *parent, const char *id)
 		sys_new->i.parent = parent;
 		parent->child_cnt++;
 		util_list_add_tail(&parent->child_list, sys_new);
+		l_hash_add(&parent->child_hash, &sys_new->hash_node,
+			   sys_new->id);
 	}
 	sys_new->threads_per_core = 1;
 	return sys_new;
@@ -269,6 +357,8 @@ struct sd_sys *sd_sys_new(struct sd_sys *parent, const char *id)
  */
 static void sd_sys_free(struct sd_sys *sys)
 {
+	ht_free(sys->child_hash.bucket_vec);
+	ht_free(sys->cpu_hash.bucket_vec);
 	ht_free(sys);
 }
 
@@ -330,6 +420,7 @@ static void l_cpu_update_end(struct sd_sys *sys)
 		if (!cpu->i.active) {
 			/* CPU has not been updated, remove it */
 			util_list_remove(&sys->cpu_list, cpu);
+			l_hash_del(&sys->cpu_hash, &cpu->hash_node);
 			sd_cpu_free(cpu);
 			continue;
 		}
@@ -350,6 +441,7 @@ static void l_sys_update_end(struct sd_sys *sys)
 		if (!child->i.active) {
 			/* child has not been updated, remove it */
 			util_list_remove(&sys->child_list, child);
+			l_hash_del(&sys->child_hash, &child->hash_node);
 			sd_sys_free(child);
 			continue;
 		}
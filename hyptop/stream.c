@@ -0,0 +1,300 @@
+/*
+ * hyptop - Show hypervisor performance data on System z
+ *
+ * Stream module: Print machine-readable records for monitoring tools
+ *
+ * The records are printed directly from the system data without using
+ * tables. For window "sys_list" one record is printed for each system and
+ * for window "sys" one record is printed for each CPU of the system. All
+ * values are printed in their base units: Microseconds for times,
+ * microseconds per second for time differences, and KiB for memory.
+ *
+ * Copyright IBM Corp. 2020
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "helper.h"
+#include "hyptop.h"
+#include "opts.h"
+#include "sd.h"
+#include "stream.h"
+
+/*
+ * Field of a record
+ */
+struct l_field {
+	const char		*name;
+	enum sd_item_type	type;
+	struct sd_sys_item	*sys_item;
+	struct sd_cpu_item	*cpu_item;
+};
+
+static struct l_field	*l_field_vec;
+static unsigned int	l_field_cnt;
+static int		l_cpu_mode;
+
+/*
+ * Add system item as field
+ */
+static void l_field_add_sys(struct sd_sys_item *item)
+{
+	struct l_field *field = &l_field_vec[l_field_cnt++];
+
+	field->name = sd_sys_item_table_col(item)->head;
+	field->type = sd_sys_item_type(item);
+	field->sys_item = item;
+}
+
+/*
+ * Add CPU item as field
+ */
+static void l_field_add_cpu(struct sd_cpu_item *item)
+{
+	struct l_field *field = &l_field_vec[l_field_cnt++];
+
+	field->name = sd_cpu_item_table_col(item)->head;
+	field->type = sd_cpu_item_type(item);
+	field->cpu_item = item;
+}
+
+/*
+ * Add field for hotkey defined in "col_spec"
+ */
+static void l_field_add_spec(struct table_col_spec *col_spec)
+{
+	struct sd_sys_item *sys_item;
+	struct sd_cpu_item *cpu_item;
+	unsigned int i;
+
+	if (col_spec->unit_str)
+		ERR_EXIT("Units cannot be used with the \"--format\" "
+			 "option\n");
+	if (l_cpu_mode) {
+		sd_cpu_item_iterate(cpu_item, i) {
+			if (table_col_hotkey(sd_cpu_item_table_col(cpu_item)) ==
+			    col_spec->hotkey) {
+				l_field_add_cpu(cpu_item);
+				return;
+			}
+		}
+	} else {
+		sd_sys_item_iterate(sys_item, i) {
+			if (table_col_hotkey(sd_sys_item_table_col(sys_item)) ==
+			    col_spec->hotkey) {
+				l_field_add_sys(sys_item);
+				return;
+			}
+		}
+	}
+	ERR_EXIT("Unknown field \"%c\"\n", col_spec->hotkey);
+}
+
+/*
+ * Setup fields from command line or like defined in data gatherer
+ */
+static void l_fields_init(void)
+{
+	struct hyptop_col_vec_opt *opt = &g.o.cur_win->opts.fields;
+	struct sd_sys_item *sys_item;
+	struct sd_cpu_item *cpu_item;
+	unsigned int i, cnt;
+
+	l_cpu_mode = (g.o.cur_win == &win_sys);
+	if (l_cpu_mode)
+		cnt = sd_cpu_item_cnt();
+	else
+		cnt = sd_sys_item_cnt();
+	l_field_vec = ht_zalloc(sizeof(*l_field_vec) * (cnt + opt->cnt));
+
+	if (opt->specified) {
+		/* The option parser stores the fields in reverse order */
+		for (i = opt->cnt; i > 0; i--)
+			l_field_add_spec(opt->vec[i - 1]);
+	} else if (l_cpu_mode) {
+		sd_cpu_item_enable_iterate(cpu_item, i)
+			l_field_add_cpu(cpu_item);
+	} else {
+		sd_sys_item_enable_iterate(sys_item, i)
+			l_field_add_sys(sys_item);
+	}
+}
+
+/*
+ * Print string as JSON string
+ */
+static void l_json_str_print(const char *str)
+{
+	putchar('"');
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			putchar('\\');
+		putchar(*str);
+	}
+	putchar('"');
+}
+
+/*
+ * Print name of record member
+ */
+static void l_name_print(const char *name, int first)
+{
+	switch (g.o.format) {
+	case HYPTOP_FORMAT_CSV:
+		if (!first)
+			putchar(',');
+		break;
+	case HYPTOP_FORMAT_JSON:
+		putchar(first ? '{' : ',');
+		l_json_str_print(name);
+		putchar(':');
+		break;
+	case HYPTOP_FORMAT_NONE:
+		break;
+	}
+}
+
+/*
+ * Print string value of record member
+ */
+static void l_str_print(const char *name, const char *str, int first)
+{
+	l_name_print(name, first);
+	if (g.o.format == HYPTOP_FORMAT_JSON)
+		l_json_str_print(str);
+	else
+		fputs(str, stdout);
+}
+
+/*
+ * Print value of field
+ */
+static void l_field_print(struct l_field *field, struct sd_sys *sys,
+			  struct sd_cpu *cpu)
+{
+	const char *str;
+	int set;
+
+	if (field->sys_item)
+		set = sd_sys_item_set(sys, field->sys_item);
+	else
+		set = sd_cpu_item_set(field->cpu_item, cpu);
+	l_name_print(field->name, 0);
+	if (!set) {
+		if (g.o.format == HYPTOP_FORMAT_JSON)
+			fputs("null", stdout);
+		return;
+	}
+	switch (field->type) {
+	case SD_TYPE_U16:
+	case SD_TYPE_U32:
+	case SD_TYPE_U64:
+		printf("%llu", field->sys_item ?
+		       sd_sys_item_u64(sys, field->sys_item) :
+		       sd_cpu_item_u64(field->cpu_item, cpu));
+		break;
+	case SD_TYPE_S64:
+		printf("%lld", field->sys_item ?
+		       sd_sys_item_s64(sys, field->sys_item) :
+		       (s64) sd_cpu_item_s64(field->cpu_item, cpu));
+		break;
+	case SD_TYPE_STR:
+		str = field->sys_item ? sd_sys_item_str(sys, field->sys_item) :
+			sd_cpu_item_str(field->cpu_item, cpu);
+		if (g.o.format == HYPTOP_FORMAT_JSON)
+			l_json_str_print(str);
+		else
+			fputs(str, stdout);
+		break;
+	}
+}
+
+/*
+ * Print one record for system or CPU
+ */
+static void l_record_print(const char *time_str, struct sd_sys *sys,
+			   struct sd_cpu *cpu)
+{
+	unsigned int i;
+
+	l_name_print("time", 1);
+	fputs(time_str, stdout);
+	l_str_print("system", sd_sys_id(sys), 0);
+	if (cpu)
+		l_str_print("cpuid", sd_cpu_id(cpu), 0);
+	for (i = 0; i < l_field_cnt; i++)
+		l_field_print(&l_field_vec[i], sys, cpu);
+	if (g.o.format == HYPTOP_FORMAT_JSON)
+		putchar('}');
+	putchar('\n');
+}
+
+/*
+ * Print CSV header line
+ */
+static void l_csv_header_print(void)
+{
+	unsigned int i;
+
+	printf("time,system");
+	if (l_cpu_mode)
+		printf(",cpuid");
+	for (i = 0; i < l_field_cnt; i++)
+		printf(",%s", l_field_vec[i].name);
+	putchar('\n');
+}
+
+/*
+ * Print records for all systems or all CPUs of the selected system
+ */
+static void l_records_print(void)
+{
+	struct sd_sys *parent, *sys;
+	char time_str[32];
+	struct timeval tv;
+	struct sd_cpu *cpu;
+
+	ht_time_get(&tv);
+	snprintf(time_str, sizeof(time_str), "%lld.%06ld",
+		 (long long) tv.tv_sec, (long) tv.tv_usec);
+	parent = sd_sys_root_get();
+	if (l_cpu_mode) {
+		sys = sd_sys_get(parent, win_sys.opts.sys.vec[0]);
+		if (!sys)
+			return;
+		sd_cpu_iterate(sys, cpu)
+			l_record_print(time_str, sys, cpu);
+		return;
+	}
+	sd_sys_iterate(parent, sys) {
+		if (!opts_sys_specified(&win_sys_list, sd_sys_id(sys)))
+			continue;
+		l_record_print(time_str, sys, NULL);
+	}
+}
+
+/*
+ * Print records at regular intervals
+ */
+void __noreturn stream_run(void)
+{
+	struct timespec ts;
+
+	l_fields_init();
+	if (g.o.format == HYPTOP_FORMAT_CSV)
+		l_csv_header_print();
+	while (1) {
+		l_records_print();
+		fflush(stdout);
+		opts_iterations_next();
+		ts.tv_sec = g.o.delay_s;
+		ts.tv_nsec = g.o.delay_us * 1000;
+		nanosleep(&ts, NULL);
+		sd_update();
+	}
+}
@@ -0,0 +1,19 @@
+/*
+ * hyptop - Show hypervisor performance data on System z
+ *
+ * Stream module: Print machine-readable records for monitoring tools
+ *
+ * Copyright IBM Corp. 2020
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "lib/zt_common.h"
+
+extern void __noreturn stream_run(void);
+
+#endif /* STREAM_H */
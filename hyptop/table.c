@@ -410,36 +410,29 @@ static void l_row_last_calc(struct table *t)
 	l_row_format(t, t->row_last);
 }
 
+static void l_table_sort(struct table *t);
+
 /*
  * Finish table after all rows have been added
  */
 void table_finish(struct table *t)
 {
+	if (t->attr_sorted_table)
+		l_table_sort(t);
 	l_row_last_calc(t);
 	t->ready = 1;
 }
 
 /*
  * Add new row to table
+ *
+ * Sorted tables are sorted once in table_finish() after all rows have
+ * been added.
  */
 void table_row_add(struct table *t, struct table_row *row)
 {
-	struct table_row *tmp;
-
 	l_row_format(t, row);
-
-	if (util_list_is_empty(&t->row_list) || !t->attr_sorted_table) {
-		util_list_add_tail(&t->row_list, row);
-	} else {
-		util_list_iterate(&t->row_list, tmp) {
-			if (l_row_less_than(t, tmp, row))
-				break;
-		}
-		if (tmp)
-			util_list_add_prev(&t->row_list, row, tmp);
-		else
-			util_list_add_tail(&t->row_list, row);
-	}
+	util_list_add_tail(&t->row_list, row);
 	if (l_row_is_marked(t, row)) {
 		row->marked = 1;
 		t->row_cnt_marked++;
@@ -465,6 +458,9 @@ void table_rebuild(struct table *t)
 
 /*
  * Compare callback for linked list sorting (ordering: large to small)
+ *
+ * Since util_list_sort() is stable, this results in the same order as
+ * inserting the rows one after the other before the first smaller row.
  */
 static int l_row_cmp_fn(void *a, void *b, void *data)
 {
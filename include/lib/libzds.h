@@ -794,6 +794,17 @@ int lzds_dshandle_set_keepRDW(struct dshandle *dsh, int keepRDW);
  */
 void lzds_dshandle_get_keepRDW(struct dshandle *dsh, int *keepRDW);
 
+/**
+ * @brief Set the flag that causes the library to read the next track frame
+ * in the background while the current track frame is interpreted.
+ */
+int lzds_dshandle_set_prefetch(struct dshandle *dsh, int prefetch);
+
+/**
+ * @brief Read out the current setting of the prefetch flag.
+ */
+void lzds_dshandle_get_prefetch(struct dshandle *dsh, int *prefetch);
+
 /**
  * @brief Prepares the dsh and the related devices for read operations.
  */
@@ -816,6 +827,12 @@ int lzds_dshandle_read(struct dshandle *dsh, char *buf,
 int lzds_dshandle_lseek(struct dshandle *dsh, long long offset,
 			long long *rcoffset);
 
+/**
+ * @brief Read data from the given offset of the data set in one operation.
+ */
+int lzds_dshandle_pread(struct dshandle *dsh, char *buf, size_t size,
+			long long offset, ssize_t *rcsize);
+
 /**
  * @brief Get the current buffer position.
  */
@@ -832,12 +849,31 @@ void lzds_dshandle_get_errorlog(struct dshandle *dsh, struct errorlog **log);
 int lzds_dshandle_set_seekbuffer(struct dshandle *dsh,
 				 unsigned long long seek_buffer_size);
 
+/**
+ * @brief Save the seek buffer, so that it can be loaded into another
+ *        dshandle for the same data set.
+ */
+int lzds_dshandle_save_seekbuffer(struct dshandle *dsh, char **buffer,
+				  size_t *size);
+
+/**
+ * @brief Load a seek buffer that has been saved before.
+ */
+int lzds_dshandle_load_seekbuffer(struct dshandle *dsh, const char *buffer,
+				  size_t size);
+
 /**
  * @brief Get the size of the data set in number of tracks (sum of all extents).
  */
 void lzds_dataset_get_size_in_tracks(struct dataset *ds,
 				     unsigned long long *tracks);
 
+/**
+ * @brief Get a value that changes when the data set is changed.
+ */
+void lzds_dataset_get_change_marker(struct dataset *ds,
+				    unsigned long long *marker);
+
 /**
  * @brief Get the name of a partitioned dataset member.
  */
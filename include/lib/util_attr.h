@@ -0,0 +1,58 @@
+/**
+ * @defgroup util_attr_h util_attr: Directory attribute interface
+ * @{
+ * @brief Read attribute files relative to an open directory
+ *
+ * Copyright IBM Corp. 2020
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef LIB_UTIL_ATTR_H
+#define LIB_UTIL_ATTR_H
+
+#include <dirent.h>
+#include <stddef.h>
+
+/**
+ * Attribute description for util_attr_dir_read()
+ */
+struct util_attr {
+	/** Name of the attribute file relative to the directory */
+	const char *name;
+	/** First line of the attribute file or NULL on error */
+	char *value;
+};
+
+struct util_attr_dir;
+
+/**
+ * Callback for util_attr_dir_foreach()
+ *
+ * @param[in] dir   Opened directory of the entry
+ * @param[in] idx   Index of the entry in the directory entry vector
+ * @param[in] data  Private data of the caller
+ */
+typedef void (*util_attr_dir_fn)(struct util_attr_dir *dir, int idx,
+				 void *data);
+
+struct util_attr_dir *util_attr_dir_new(void);
+void util_attr_dir_free(struct util_attr_dir *dir);
+int util_attr_dir_open(struct util_attr_dir *dir, const char *fmt, ...);
+int util_attr_dir_open_at(struct util_attr_dir *dir,
+			  struct util_attr_dir *parent, const char *name);
+void util_attr_dir_close(struct util_attr_dir *dir);
+const char *util_attr_dir_path(struct util_attr_dir *dir);
+
+int util_attr_read_line(struct util_attr_dir *dir, char *str, size_t size,
+			const char *name);
+int util_attr_read_ul(struct util_attr_dir *dir, unsigned long *val,
+		      int base, const char *name);
+int util_attr_dir_read(struct util_attr_dir *dir, struct util_attr *attr_vec,
+		       int count);
+
+int util_attr_dir_foreach(const char *path, struct dirent **de_vec, int count,
+			  int jobs, util_attr_dir_fn fn, void *data);
+
+#endif /** LIB_UTIL_ATTR_H @} */
@@ -0,0 +1,372 @@
+/*
+ * util - Utility function library
+ *
+ * Read attribute files relative to an open directory
+ *
+ * Copyright IBM Corp. 2020
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lib/util_attr.h"
+#include "lib/util_base.h"
+#include "lib/util_libc.h"
+#include "lib/util_panic.h"
+
+/* Maximum size of a sysfs attribute including the terminating null byte */
+#define UTIL_ATTR_SIZE_MAX	4096
+
+/// @cond
+struct util_attr_dir {
+	int fd;			/* Directory file descriptor or -1 */
+	char *path;		/* Path name of the directory */
+	char *buf;		/* Buffer for util_attr_dir_read() */
+	size_t buf_size;	/* Size of buffer */
+};
+
+struct foreach_ctx {
+	struct util_attr_dir *parent;
+	struct dirent **de_vec;
+	int count;
+	util_attr_dir_fn fn;
+	void *data;
+	pthread_mutex_t lock;	/* Protects next */
+	int next;		/* Index of next entry to be processed */
+};
+/// @endcond
+
+/*
+ * Read the first line of attribute "name" into "str"
+ *
+ * Return the length of the line or -1 on error or for an empty line.
+ */
+static ssize_t attr_gets(struct util_attr_dir *dir, char *str, size_t size,
+			 const char *name)
+{
+	ssize_t rc;
+	char *end;
+	int fd;
+
+	/* In case of error we always return empty string */
+	str[0] = 0;
+	if (dir->fd < 0 || size < 2)
+		return -1;
+	fd = openat(dir->fd, name, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -1;
+	do {
+		rc = pread(fd, str, size - 1, 0);
+	} while (rc < 0 && errno == EINTR);
+	close(fd);
+	if (rc <= 0) {
+		str[0] = 0;
+		return -1;
+	}
+	str[rc] = 0;
+	end = memchr(str, '\n', rc);
+	if (end)
+		*end = 0;
+	rc = strlen(str);
+	return rc ? rc : -1;
+}
+
+/**
+ * Allocate a new directory handle
+ *
+ * The handle owns a buffer that is reused for all attribute reads and
+ * can be (re)opened for any number of directories.
+ *
+ * @returns   Pointer to the directory handle
+ */
+struct util_attr_dir *util_attr_dir_new(void)
+{
+	struct util_attr_dir *dir;
+
+	dir = util_zalloc(sizeof(*dir));
+	dir->fd = -1;
+	return dir;
+}
+
+/**
+ * Close a directory handle and free all resources
+ *
+ * @param[in] dir  Directory handle
+ */
+void util_attr_dir_free(struct util_attr_dir *dir)
+{
+	if (!dir)
+		return;
+	util_attr_dir_close(dir);
+	free(dir->buf);
+	free(dir);
+}
+
+/**
+ * Close the directory of a directory handle
+ *
+ * @param[in] dir  Directory handle
+ */
+void util_attr_dir_close(struct util_attr_dir *dir)
+{
+	if (dir->fd >= 0)
+		close(dir->fd);
+	dir->fd = -1;
+	free(dir->path);
+	dir->path = NULL;
+}
+
+/**
+ * Open a directory by path name
+ *
+ * A directory that is already open for the handle is closed first.
+ *
+ * @param[in] dir  Directory handle
+ * @param[in] fmt  Format string for generation of the path name
+ * @param[in] ...  Parameters for format string
+ *
+ * @retval    0    Directory was opened
+ * @retval   -1    Error while opening the directory, errno is set
+ */
+int util_attr_dir_open(struct util_attr_dir *dir, const char *fmt, ...)
+{
+	char path[PATH_MAX];
+	va_list ap;
+
+	/* Construct the directory name */
+	UTIL_VSPRINTF(path, fmt, ap);
+
+	util_attr_dir_close(dir);
+	dir->path = util_strdup(path);
+	dir->fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	return dir->fd < 0 ? -1 : 0;
+}
+
+/**
+ * Open a subdirectory of another directory handle
+ *
+ * The path name is not resolved again, only the relative name is looked
+ * up in the parent directory.
+ *
+ * @param[in] dir     Directory handle
+ * @param[in] parent  Directory handle of the parent directory
+ * @param[in] name    Name of the subdirectory
+ *
+ * @retval    0       Directory was opened
+ * @retval   -1       Error while opening the directory, errno is set
+ */
+int util_attr_dir_open_at(struct util_attr_dir *dir,
+			  struct util_attr_dir *parent, const char *name)
+{
+	util_attr_dir_close(dir);
+	util_asprintf(&dir->path, "%s/%s", parent->path, name);
+	if (parent->fd < 0) {
+		errno = EBADF;
+		return -1;
+	}
+	dir->fd = openat(parent->fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	return dir->fd < 0 ? -1 : 0;
+}
+
+/**
+ * Return the path name of a directory handle
+ *
+ * @param[in] dir  Directory handle
+ *
+ * @returns   Path name or NULL if the handle was never opened
+ */
+const char *util_attr_dir_path(struct util_attr_dir *dir)
+{
+	return dir->path;
+}
+
+/**
+ * Read the first line of an attribute file
+ *
+ * If read is successful 'str' contains first line of the file without the
+ * trailing newline. If read fails, an empty string is returned for 'str'.
+ * The resulting string will always be null-terminated.
+ *
+ * @param[in]  dir    Directory handle
+ * @param[out] str    Result buffer
+ * @param[in]  size   Size of the result buffer
+ * @param[in]  name   Name of the attribute file relative to the directory
+ *
+ * @retval     0      File was read
+ * @retval    -1      Error while reading file
+ */
+int util_attr_read_line(struct util_attr_dir *dir, char *str, size_t size,
+			const char *name)
+{
+	return attr_gets(dir, str, size, name) < 0 ? -1 : 0;
+}
+
+/**
+ * Read an attribute file and convert it to unsigned long according to
+ * given base
+ *
+ * @param[in]  dir    Directory handle
+ * @param[out] val    Buffer for value
+ * @param[in]  base   Base for conversion, either 8, 10, or 16
+ * @param[in]  name   Name of the attribute file relative to the directory
+ *
+ * @retval     0      Integer has been read correctly
+ * @retval    -1      Error while reading file
+ */
+int util_attr_read_ul(struct util_attr_dir *dir, unsigned long *val,
+		      int base, const char *name)
+{
+	char buf[512];
+	int count;
+
+	if (attr_gets(dir, buf, sizeof(buf), name) < 0)
+		return -1;
+	switch (base) {
+	case 8:
+		count = sscanf(buf, "%lo", val);
+		break;
+	case 10:
+		count = sscanf(buf, "%lu", val);
+		break;
+	case 16:
+		count = sscanf(buf, "%lx", val);
+		break;
+	default:
+		util_panic("Invalid base: %d\n", base);
+	}
+	return (count == 1) ? 0 : -1;
+}
+
+/**
+ * Read a set of attribute files
+ *
+ * For each element of 'attr_vec' the first line of the attribute file is
+ * stored in the 'value' member without the trailing newline, or NULL if
+ * the file could not be read or is empty. The values are stored in the
+ * buffer of the directory handle and stay valid until the next call of
+ * util_attr_dir_read() for the same handle.
+ *
+ * @param[in]     dir       Directory handle
+ * @param[in,out] attr_vec  Vector of attributes
+ * @param[in]     count     Number of attributes in 'attr_vec'
+ *
+ * @returns       Number of attributes that have been read
+ */
+int util_attr_dir_read(struct util_attr_dir *dir, struct util_attr *attr_vec,
+		       int count)
+{
+	size_t off = 0;
+	ssize_t len;
+	int i, n = 0;
+
+	/* Every value fits even if all attributes have the maximum size */
+	if (dir->buf_size < (size_t) count * UTIL_ATTR_SIZE_MAX) {
+		dir->buf_size = (size_t) count * UTIL_ATTR_SIZE_MAX;
+		dir->buf = util_realloc(dir->buf, dir->buf_size);
+	}
+	for (i = 0; i < count; i++) {
+		len = attr_gets(dir, dir->buf + off, UTIL_ATTR_SIZE_MAX,
+				attr_vec[i].name);
+		if (len < 0) {
+			attr_vec[i].value = NULL;
+			continue;
+		}
+		attr_vec[i].value = dir->buf + off;
+		off += len + 1;
+		n++;
+	}
+	return n;
+}
+
+/*
+ * Process directory entries until all have been handed out
+ */
+static void *foreach_worker(void *arg)
+{
+	struct foreach_ctx *ctx = arg;
+	struct util_attr_dir *dir;
+	int idx;
+
+	dir = util_attr_dir_new();
+	while (1) {
+		pthread_mutex_lock(&ctx->lock);
+		idx = ctx->next++;
+		pthread_mutex_unlock(&ctx->lock);
+		if (idx >= ctx->count)
+			break;
+		util_attr_dir_open_at(dir, ctx->parent,
+				      ctx->de_vec[idx]->d_name);
+		ctx->fn(dir, idx, ctx->data);
+	}
+	util_attr_dir_free(dir);
+	return NULL;
+}
+
+/**
+ * Call a function for each entry of a directory entry vector
+ *
+ * The directory 'path' is opened once and each entry of 'de_vec' is opened
+ * relative to it before 'fn' is called. If an entry cannot be opened, 'fn'
+ * is called anyway and all attribute reads for the entry fail.
+ *
+ * With 'jobs' > 1 the entries are distributed over up to 'jobs' threads
+ * and 'fn' is called concurrently in no particular order. The 'idx'
+ * parameter of 'fn' can be used to store results that are processed in
+ * order after util_attr_dir_foreach() returned.
+ *
+ * @param[in] path    Path to the directory that contains the entries
+ * @param[in] de_vec  Vector of directory entries, e.g. from util_scandir()
+ * @param[in] count   Count of directory entries
+ * @param[in] jobs    Maximum number of threads
+ * @param[in] fn      Callback function
+ * @param[in] data    Private data passed to 'fn'
+ *
+ * @retval    0       All entries have been processed
+ * @retval   -1       Error while opening 'path', errno is set
+ */
+int util_attr_dir_foreach(const char *path, struct dirent **de_vec, int count,
+			  int jobs, util_attr_dir_fn fn, void *data)
+{
+	struct foreach_ctx ctx = {
+		.de_vec = de_vec,
+		.count = count,
+		.fn = fn,
+		.data = data,
+		.next = 0,
+	};
+	pthread_t *threads;
+	int i, n = 0;
+
+	ctx.parent = util_attr_dir_new();
+	if (util_attr_dir_open(ctx.parent, "%s", path)) {
+		util_attr_dir_free(ctx.parent);
+		return -1;
+	}
+	pthread_mutex_init(&ctx.lock, NULL);
+	if (jobs > count)
+		jobs = count;
+	/* The calling thread is one of the workers */
+	threads = util_zalloc(sizeof(*threads) * (jobs > 1 ? jobs - 1 : 1));
+	for (i = 0; i < jobs - 1; i++) {
+		if (pthread_create(&threads[i], NULL, foreach_worker, &ctx))
+			break;
+		n++;
+	}
+	foreach_worker(&ctx);
+	for (i = 0; i < n; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	pthread_mutex_destroy(&ctx.lock);
+	util_attr_dir_free(ctx.parent);
+	return 0;
+}
@@ -3,7 +3,7 @@
  *
  * Linked list functions
  *
- * Copyright IBM Corp. 2013, 2017
+ * Copyright IBM Corp. 2013, 2020
  *
  * s390-tools is free software; you can redistribute it and/or modify
  * it under the terms of the MIT license. See LICENSE for details.
@@ -76,6 +76,7 @@ void util_list_add_tail(struct util_list *list, void *entry)
 		node->prev = list->end;
 	}
 	list->end = node;
+	list->len++;
 }
 
 /*
@@ -94,6 +95,7 @@ void util_list_add_head(struct util_list *list, void *entry)
 		node->next = list->start;
 	}
 	list->start = node;
+	list->len++;
 }
 
 /*
@@ -111,6 +113,7 @@ void util_list_add_next(struct util_list *list, void *entry, void *list_entry)
 	else
 		list->end = node;
 	list_node->next = node;
+	list->len++;
 }
 
 /*
@@ -128,6 +131,7 @@ void util_list_add_prev(struct util_list *list, void *entry, void *list_entry)
 	else
 		list->start = node;
 	list_node->prev = node;
+	list->len++;
 }
 
 /*
@@ -145,6 +149,7 @@ void util_list_remove(struct util_list *list, void *entry)
 		node->prev->next = node->next;
 	if (node->next)
 		node->next->prev = node->prev;
+	list->len--;
 }
 
 /*
@@ -204,50 +209,75 @@ void *util_list_prev(struct util_list *list, void *entry)
  */
 unsigned long util_list_len(struct util_list *list)
 {
-	unsigned long cnt = 0;
-	void *entry;
+	return list->len;
+}
+
+/*
+ * Merge the two sorted and NULL terminated node chains a and b (only the
+ * next pointers are used). On equal elements the one from a comes first,
+ * which keeps the sort stable.
+ */
+static struct util_list_node *merge(struct util_list *list,
+				    struct util_list_node *a,
+				    struct util_list_node *b,
+				    util_list_cmp_fn cmp_fn, void *data)
+{
+	struct util_list_node head, *tail = &head;
 
-	util_list_iterate(list, entry)
-		cnt++;
-	return cnt;
+	while (a && b) {
+		if (cmp_fn(n2e(list, a), n2e(list, b), data) <= 0) {
+			tail->next = a;
+			a = a->next;
+		} else {
+			tail->next = b;
+			b = b->next;
+		}
+		tail = tail->next;
+	}
+	tail->next = a ? a : b;
+	return head.next;
 }
 
 /*
- * Sort table (bubble sort)
+ * Sort list (stable bottom-up merge sort)
+ *
+ * Slot i of "pending" holds either nothing or a sorted chain of 2^i
+ * elements. Each element is merged into the slots like a carry into a
+ * binary counter, so that all merges are balanced. Slots with a higher
+ * index always hold earlier elements.
  */
 void util_list_sort(struct util_list *list, util_list_cmp_fn cmp_fn,
 		    void *data)
 {
-	struct util_list_node *node1, *node2;
-	unsigned long list_cnt, i, j;
-	void *entry1, *entry2;
-
-	list_cnt = util_list_len(list);
+	struct util_list_node *pending[sizeof(unsigned long) * 8 + 1] = { NULL };
+	struct util_list_node *node, *next, *carry, *prev;
+	unsigned int i, max = 0;
 
-	for (i = 1; i < list_cnt; i++) {
-		node1 = list->start;
-		for (j = 0; j < list_cnt - i; j++) {
-			node2 = node1->next;
-			entry1 = n2e(list, node1);
-			entry2 = n2e(list, node2);
-			if (cmp_fn(entry1, entry2, data) > 0) {
-				node1->next = node2->next;
-				if (node1->next)
-					node1->next->prev = node1;
-				else
-					list->end = node1;
-				node2->next = node1;
-				node2->prev = node1->prev;
-				if (node2->prev)
-					node2->prev->next = node2;
-				else
-					list->start = node2;
-				node1->prev = node2;
-			} else {
-				node1 = node2;
-			}
+	for (node = list->start; node; node = next) {
+		next = node->next;
+		carry = node;
+		carry->next = NULL;
+		for (i = 0; pending[i]; i++) {
+			carry = merge(list, pending[i], carry, cmp_fn, data);
+			pending[i] = NULL;
 		}
+		pending[i] = carry;
+		if (i > max)
+			max = i;
+	}
+	carry = NULL;
+	for (i = 0; i <= max; i++) {
+		if (pending[i])
+			carry = merge(list, pending[i], carry, cmp_fn, data);
+	}
+	/* Restore the prev pointers and the list boundaries */
+	list->start = carry;
+	prev = NULL;
+	for (node = carry; node; node = node->next) {
+		node->prev = prev;
+		prev = node;
 	}
+	list->end = prev;
 }
 
 /*
@@ -0,0 +1,139 @@
+/**
+ * util_list_bench - Benchmark program for util_list
+ *
+ * Measure the cost of inserting, iterating, sorting and removing list
+ * elements for 10^3 to 10^6 elements.
+ *
+ * Copyright IBM Corp. 2020
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "lib/util_libc.h"
+#include "lib/util_list.h"
+#include "lib/util_panic.h"
+
+#define BENCH_MIN_ELEMENTS	1000UL
+#define BENCH_MAX_ELEMENTS	1000000UL
+
+struct bench_entry {
+	unsigned long key;		/* Sort key */
+	unsigned long seq;		/* Insertion order */
+	struct util_list_node node;
+};
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int bench_cmp(void *a, void *b, void *UNUSED(data))
+{
+	struct bench_entry *e1 = a, *e2 = b;
+
+	if (e1->key < e2->key)
+		return -1;
+	return e1->key > e2->key;
+}
+
+/*
+ * Check that the list is sorted and that equal keys kept their
+ * insertion order
+ */
+static void bench_verify(struct util_list *list, unsigned long cnt)
+{
+	struct bench_entry *entry, *prev = NULL;
+	unsigned long n = 0;
+
+	util_list_iterate(list, entry) {
+		if (prev) {
+			util_assert(prev->key <= entry->key,
+				    "List is not sorted\n");
+			util_assert(prev->key != entry->key ||
+				    prev->seq < entry->seq,
+				    "Sort is not stable\n");
+		}
+		prev = entry;
+		n++;
+	}
+	util_assert(n == cnt && util_list_len(list) == cnt,
+		    "Wrong number of list elements\n");
+	util_assert(util_list_end(list) == prev, "Wrong list end\n");
+}
+
+static void bench_run(unsigned long cnt)
+{
+	double t_add, t_iter, t_len, t_sort, t_resort, t_remove, t;
+	struct bench_entry *entries, *entry, *next;
+	unsigned long i, sum = 0, len = 0;
+	struct util_list list;
+
+	entries = util_malloc(cnt * sizeof(*entries));
+	for (i = 0; i < cnt; i++) {
+		/* Few distinct keys to exercise stability */
+		entries[i].key = (unsigned long) random() % (cnt / 4 + 1);
+		entries[i].seq = i;
+	}
+	util_list_init(&list, struct bench_entry, node);
+
+	t = now_ms();
+	for (i = 0; i < cnt; i++)
+		util_list_add_tail(&list, &entries[i]);
+	t_add = now_ms() - t;
+
+	t = now_ms();
+	util_list_iterate(&list, entry)
+		sum += entry->key;
+	t_iter = now_ms() - t;
+
+	t = now_ms();
+	for (i = 0; i < cnt; i++)
+		len += util_list_len(&list);
+	t_len = now_ms() - t;
+
+	t = now_ms();
+	util_list_sort(&list, bench_cmp, NULL);
+	t_sort = now_ms() - t;
+	bench_verify(&list, cnt);
+
+	/* Sort the already sorted list again */
+	t = now_ms();
+	util_list_sort(&list, bench_cmp, NULL);
+	t_resort = now_ms() - t;
+	bench_verify(&list, cnt);
+
+	t = now_ms();
+	util_list_iterate_safe(&list, entry, next)
+		util_list_remove(&list, entry);
+	t_remove = now_ms() - t;
+	util_assert(util_list_is_empty(&list) && util_list_len(&list) == 0,
+		    "List is not empty\n");
+
+	printf("%10lu %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n", cnt,
+	       t_add, t_iter, t_len, t_sort, t_resort, t_remove);
+	/* Keep the compiler from optimizing the loops away */
+	if (sum == 1 && len == 1)
+		printf("\n");
+	free(entries);
+}
+
+int main(void)
+{
+	unsigned long cnt;
+
+	srandom(0);
+	printf("Time in milliseconds (len: %s)\n", "one call per element");
+	printf("%10s %10s %10s %10s %10s %10s %10s\n", "elements", "add_tail",
+	       "iterate", "len", "sort", "resort", "remove");
+	for (cnt = BENCH_MIN_ELEMENTS; cnt <= BENCH_MAX_ELEMENTS; cnt *= 10)
+		bench_run(cnt);
+	return EXIT_SUCCESS;
+}
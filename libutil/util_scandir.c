@@ -56,7 +56,7 @@ static int __scandir(struct dirent ***de_vec, const char *path,
 				      const struct dirent **))
 {
 	struct dirent *de, *de_new, **de_vec_new = NULL;
-	int count = 0;
+	int count = 0, size = 0;
 	DIR *dirp;
 
 	*de_vec = NULL;
@@ -68,7 +68,12 @@ static int __scandir(struct dirent ***de_vec, const char *path,
 			continue;
 		de_new = util_malloc(sizeof(*de_new));
 		*de_new = *de;
-		de_vec_new = realloc(de_vec_new, sizeof(void *) * (count + 1));
+		/* Grow the vector geometrically to avoid a realloc per entry */
+		if (count == size) {
+			size = size ? size * 2 : 64;
+			de_vec_new = util_realloc(de_vec_new,
+						  sizeof(void *) * size);
+		}
 		de_vec_new[count++] = de_new;
 	}
 	closedir(dirp);
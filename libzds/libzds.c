@@ -15,9 +15,11 @@
 #include <errno.h>
 #include <linux/types.h>
 #include <malloc.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 
 #include "lib/dasd_base.h"
 #include "lib/dasd_sys.h"
@@ -214,6 +216,32 @@ struct seekelement {
  */
 #define TRACK_BUFFER_DEFAULT 128
 
+/**
+ * @brief Internal structure for a track frame that is read in the background
+ *
+ * While a track frame is interpreted, a thread reads the following track
+ * frame into a second raw buffer. When the read code advances to that
+ * frame, the two buffers are swapped.
+ */
+struct prefetch {
+	/** @brief Thread that reads the track frame */
+	pthread_t thread;
+	/** @brief Flag that is set while the thread has not been joined */
+	int active;
+	/** @brief The dasdhandle the thread reads from */
+	struct dasdhandle *dasdh;
+	/** @brief Index number of the data set part of the track frame */
+	int dsp_no;
+	/** @brief First track of the track frame */
+	unsigned int bufstarttrk;
+	/** @brief Last track of the track frame */
+	unsigned int bufendtrk;
+	/** @brief Buffer for the raw track images, same size as rawbuffer */
+	char *rawbuffer;
+	/** @brief Return code of lzds_dasdhandle_read_tracks_to_buffer */
+	int rc;
+};
+
 struct dshandle {
 	/** @brief Data set this context relates to */
 	struct dataset *ds;
@@ -233,6 +261,10 @@ struct dshandle {
 	/** @brief Flag: While interpreting the data, keep the record
 	 *  descriptor words in the data stream */
 	int keepRDW;
+	/** @brief Flag: Read the next track frame in the background */
+	int prefetch;
+	/** @brief State of the track frame that is read in the background */
+	struct prefetch pf;
 	/** @brief Flag that is set between open and close */
 	int is_open;
 	/** @brief This flag is set when during interpretation of the track
@@ -298,6 +330,8 @@ struct dshandle {
 	 *  Example: If skip is 2, then every 2'nd frame is stored.
 	 */
 	unsigned long long skip;
+	/** @brief Serializes read, seek and offset queries of several threads */
+	pthread_mutex_t mutex;
 	/** @brief Detailed error messages in case of a problem */
 	struct errorlog *log;
 };
@@ -411,10 +445,15 @@ void lzds_zdsroot_free(struct zdsroot *root)
 static int dasd_read_geometry(struct dasd *dasd)
 {
 	unsigned long long size_in_bytes;
+	struct stat st;
 
 	errorlog_clear(dasd->log);
 
-	if (dasd_get_blocksize_in_bytes(dasd->device, &size_in_bytes) != 0)
+	/* A raw track image file has no block device size */
+	if (fstat(dasd->inusefd, &st) == 0 && S_ISREG(st.st_mode))
+		size_in_bytes = st.st_size;
+	else if (dasd_get_blocksize_in_bytes(dasd->device,
+					     &size_in_bytes) != 0)
 		return errorlog_add_message(
 			&dasd->log, NULL, EIO,
 			"read geometry: could not get size from device %s\n",
@@ -917,6 +956,9 @@ int lzds_dasdhandle_open(struct dasdhandle *dasdh)
 {
 	errorlog_clear(dasdh->log);
 	dasdh->fd = open(dasdh->dasd->device, O_RDONLY | O_DIRECT);
+	/* Image files on file systems like tmpfs do not support O_DIRECT */
+	if (dasdh->fd < 0 && errno == EINVAL)
+		dasdh->fd = open(dasdh->dasd->device, O_RDONLY);
 	if (dasdh->fd < 0) {
 		dasdh->fd = -1;
 		return errorlog_add_message(
@@ -949,6 +991,10 @@ int lzds_dasdhandle_close(struct dasdhandle *dasdh)
 }
 
 /**
+ * The tracks are read with pread, so that the tracks of the same
+ * dasdhandle can be read by another thread while no other operation
+ * is done on the dasdhandle.
+ *
  * @param[in]  dasdh The dasdhandle we are reading from
  * @param[in]  starttrck First track to read
  * @param[in]  endtrck Last track to read
@@ -967,7 +1013,6 @@ int lzds_dasdhandle_read_tracks_to_buffer(struct dasdhandle *dasdh,
 {
 	off_t trckseek;
 	ssize_t residual;
-	off_t rc;
 	ssize_t count;
 
 	unsigned int cylinders;
@@ -991,23 +1036,19 @@ int lzds_dasdhandle_read_tracks_to_buffer(struct dasdhandle *dasdh,
 	trckseek = (off_t)starttrck * RAWTRACKSIZE;
 	/* residual is the number of bytes we still have to read */
 	residual = (off_t)(endtrck - starttrck + 1) * RAWTRACKSIZE;
-	rc = lseek(dasdh->fd, trckseek, SEEK_SET);
-	if (rc < 0)
-		return errorlog_add_message(
-			&dasdh->log, NULL, EINVAL,
-			"dasdhandle read tracks: seek to %llu, failed"
-			" for device %s\n",
-			(unsigned long long)trckseek, dasdh->dasd->device);
 
 	while (residual) {
-		count = read(dasdh->fd, trackdata, residual);
+		count = pread(dasdh->fd, trackdata, residual, trckseek);
+		if (count < 0 && errno == EINTR)
+			continue;
 		if (count < 0)
 			return errorlog_add_message(
 				&dasdh->log, NULL, EIO,
 				"dasdhandle read tracks: read failed"
 				" for device %s, start %u, end %u\n",
 				dasdh->dasd->device, starttrck, endtrck);
-		if (count % RAWTRACKSIZE) /* No full track read */
+		/* No full track read or end of image file */
+		if (count % RAWTRACKSIZE || !count)
 			return errorlog_add_message(
 				&dasdh->log, NULL, EPROTO,
 				"dasdhandle read tracks: read returned "
@@ -1016,6 +1057,7 @@ int lzds_dasdhandle_read_tracks_to_buffer(struct dasdhandle *dasdh,
 				dasdh->dasd->device, starttrck, endtrck);
 		residual -= count;
 		trackdata += count;
+		trckseek += count;
 	}
 	return 0;
 }
@@ -2460,6 +2502,50 @@ void lzds_dataset_get_size_in_tracks(struct dataset *ds,
 	*tracks = sumtracks;
 }
 
+/**
+ * @brief Helper function that adds data to a FNV-1a hash value.
+ */
+static void hash_add(unsigned long long *hash, const void *data, size_t size)
+{
+	const unsigned char *p = data;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		*hash ^= p[i];
+		*hash *= 0x100000001b3ULL;
+	}
+}
+
+/**
+ * The change marker is a hash over the format 1 DSCBs and the extents of
+ * all data set parts. The reference date is left out, because it changes
+ * whenever the data set is read on z/OS. A changed marker indicates that
+ * the content of the data set may have been changed.
+ *
+ * @param[in]  ds     The dataset we want to know the change marker of.
+ * @param[out] marker Reference to a return buffer for the change marker.
+ */
+void lzds_dataset_get_change_marker(struct dataset *ds,
+				    unsigned long long *marker)
+{
+	unsigned long long hash = 0xcbf29ce484222325ULL;
+	size_t refd = offsetof(format1_label_t, DS1REFD);
+	format1_label_t *f1;
+	int i;
+
+	for (i = 0; i < MAXVOLUMESPERDS; ++i) {
+		if (!ds->dsp[i])
+			continue;
+		hash_add(&hash, &i, sizeof(i));
+		f1 = ds->dsp[i]->f1;
+		hash_add(&hash, f1, refd);
+		hash_add(&hash, (char *)f1 + refd + sizeof(f1->DS1REFD),
+			 sizeof(*f1) - refd - sizeof(f1->DS1REFD));
+		hash_add(&hash, ds->dsp[i]->ext, sizeof(ds->dsp[i]->ext));
+	}
+	*marker = hash;
+}
+
 /**
  * @param[in]  member The PDS member we want to know the name of.
  * @param[out] name   Reference to a pointer variable in which a pointer to
@@ -2590,6 +2676,36 @@ int lzds_dataset_get_member_by_name(struct dataset *ds, char *membername,
 	return 0;
 }
 
+/**
+ * @brief Thread function that reads a track frame in the background
+ */
+static void *dshandle_prefetch_thread(void *arg)
+{
+	struct prefetch *pf = arg;
+
+	pf->rc = lzds_dasdhandle_read_tracks_to_buffer(pf->dasdh,
+						       pf->bufstarttrk,
+						       pf->bufendtrk,
+						       pf->rawbuffer);
+	return NULL;
+}
+
+/**
+ * @brief Wait until a track frame that is read in the background is
+ *        complete.
+ *
+ * The dasdhandles of dsh must not be used while a prefetch is active.
+ *
+ * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ */
+static void dshandle_prefetch_wait(struct dshandle *dsh)
+{
+	if (!dsh->pf.active)
+		return;
+	pthread_join(dsh->pf.thread, NULL);
+	dsh->pf.active = 0;
+}
+
 /**
  * @param[in] dsh Pointer to structure that is to be freed.
  */
@@ -2599,14 +2715,17 @@ void lzds_dshandle_free(struct dshandle *dsh)
 
 	if (!dsh)
 		return;
+	dshandle_prefetch_wait(dsh);
 	for (i = 0; i < MAXVOLUMESPERDS; ++i)
 		if (dsh->dasdhandle[i])
 			lzds_dasdhandle_free(dsh->dasdhandle[i]);
 	free(dsh->databuffer);
 	free(dsh->rawbuffer);
+	free(dsh->pf.rawbuffer);
 	if (dsh->seekbuf)
 		free(dsh->seekbuf);
 	errorlog_free(dsh->log);
+	pthread_mutex_destroy(&dsh->mutex);
 	free(dsh);
 }
 
@@ -2630,6 +2749,7 @@ int lzds_dataset_alloc_dshandle(struct dataset *ds,
 	if (!dshtmp)
 		return ENOMEM;
 	memset(dshtmp, 0, sizeof(*dshtmp));
+	pthread_mutex_init(&dshtmp->mutex, NULL);
 	for (i = 0; i < ds->dspcount; ++i) {
 		rc = lzds_dasd_alloc_dasdhandle(ds->dsp[i]->dasdi,
 						&dshtmp->dasdhandle[i]);
@@ -2662,6 +2782,35 @@ int lzds_dataset_alloc_dshandle(struct dataset *ds,
 	return 0;
 }
 
+/**
+ * @brief subroutine of lzds_dshandle_set_seekbuffer and
+ *        lzds_dshandle_load_seekbuffer
+ *
+ * Compute the maximum number of track frames that may be read from the
+ * data set.
+ */
+static unsigned long long dshandle_max_frames(struct dshandle *dsh)
+{
+	unsigned long long totaltracks;
+	unsigned int extents;
+	struct dataset *ds;
+	int i, j;
+
+	ds = dsh->ds;
+	lzds_dataset_get_size_in_tracks(ds, &totaltracks);
+
+	/* compute the total number of extents */
+	extents = 0;
+	for (i = 0; i < ds->dspcount; ++i)
+		for (j = 0; j < MAXEXTENTS; ++j)
+			if (ds->dsp[i]->ext[j].typeind != 0x00)
+				++extents;
+
+	/* track frames at the end of an extent may be shorter,
+	 * increasing the maximum number of frames we need to read */
+	return (totaltracks / dsh->tracks_per_frame) + 1 + extents;
+}
+
 /**
  * The number of user data bytes per track is not predictable as record
  * sizes and number of records per track may vary. Seeking forward will
@@ -2681,11 +2830,8 @@ int lzds_dataset_alloc_dshandle(struct dataset *ds,
 int lzds_dshandle_set_seekbuffer(struct dshandle *dsh,
 				 unsigned long long seek_buffer_size)
 {
-	unsigned long long totaltracks;
 	size_t entries, frames;
-	unsigned int extents, skip;
-	struct dataset *ds;
-	int i, j;
+	unsigned int skip;
 	unsigned long long buf_count;
 
 	errorlog_clear(dsh->log);
@@ -2699,21 +2845,8 @@ int lzds_dshandle_set_seekbuffer(struct dshandle *dsh,
 	if (!seek_buffer_size)
 		return 0;
 
-	ds = dsh->ds;
-	lzds_dataset_get_size_in_tracks(ds, &totaltracks);
-
-	/* compute the total number of extents */
-	extents = 0;
-	for (i = 0; i < ds->dspcount; ++i)
-		for (j = 0; j < MAXEXTENTS; ++j)
-			if (ds->dsp[i]->ext[j].typeind != 0x00)
-				++extents;
-
 	entries = seek_buffer_size / sizeof(struct seekelement);
-
-	/* track frames at the end of an extent may be shorter,
-	 * increasing the maximum number of frames we need to read */
-	frames = (totaltracks / dsh->tracks_per_frame) + 1 + extents;
+	frames = dshandle_max_frames(dsh);
 	skip = (frames / entries) + 1;
 	buf_count = (frames / skip) + 1;
 
@@ -2727,6 +2860,111 @@ int lzds_dshandle_set_seekbuffer(struct dshandle *dsh,
 }
 
 
+/**
+ * @brief Internal structure for the header of a saved seek buffer
+ */
+struct seekbuffer_header {
+	/** @brief The tracks_per_frame value of the dshandle */
+	unsigned int tracks_per_frame;
+	unsigned int reserved;
+	/** @brief The skip value of the seek buffer */
+	unsigned long long skip;
+	/** @brief Number of stored seek elements */
+	unsigned long long count;
+};
+
+/**
+ * The seek buffer contains the data offsets of the track frames that
+ * have been read so far. It can be saved, e.g. after the whole data set
+ * has been read, and loaded into a new dshandle for the same data set,
+ * so that seek operations do not need to read the data set again.
+ *
+ * @param[in]  dsh    The dshandle that keeps track of the I/O operations.
+ * @param[out] buffer Reference to a pointer variable in which a newly
+ *                    allocated buffer with the seek buffer data is returned.
+ *                    The buffer must be freed by the caller.
+ * @param[out] size   Reference to a variable in which the size of the
+ *                    buffer is returned.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - ENOMEM  Could not allocate the buffer due to lack of memory.
+ */
+int lzds_dshandle_save_seekbuffer(struct dshandle *dsh, char **buffer,
+				  size_t *size)
+{
+	struct seekbuffer_header hdr;
+	size_t elements_size;
+
+	memset(&hdr, 0, sizeof(hdr));
+	pthread_mutex_lock(&dsh->mutex);
+	hdr.tracks_per_frame = dsh->tracks_per_frame;
+	hdr.skip = dsh->skip;
+	hdr.count = dsh->seek_current;
+	elements_size = hdr.count * sizeof(struct seekelement);
+	*buffer = malloc(sizeof(hdr) + elements_size);
+	if (!*buffer) {
+		pthread_mutex_unlock(&dsh->mutex);
+		return ENOMEM;
+	}
+	memcpy(*buffer, &hdr, sizeof(hdr));
+	if (elements_size)
+		memcpy(*buffer + sizeof(hdr), dsh->seekbuf, elements_size);
+	pthread_mutex_unlock(&dsh->mutex);
+	*size = sizeof(hdr) + elements_size;
+	return 0;
+}
+
+/**
+ * Replace the seek buffer of a dshandle with data that has been saved
+ * with lzds_dshandle_save_seekbuffer for the same data set and the same
+ * number of tracks per frame.
+ *
+ * @param[in]  dsh    The dshandle we want to modify.
+ * @param[in]  buffer The saved seek buffer data.
+ * @param[in]  size   The size of the saved seek buffer data.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - EINVAL  The data does not match the dshandle.
+ *   - ENOMEM  Could not allocate structure due to lack of memory.
+ */
+int lzds_dshandle_load_seekbuffer(struct dshandle *dsh, const char *buffer,
+				  size_t size)
+{
+	struct seekbuffer_header hdr;
+	unsigned long long buf_count;
+	struct seekelement *seekbuf;
+	size_t elements_size;
+
+	errorlog_clear(dsh->log);
+	if (size < sizeof(hdr))
+		return errorlog_add_message(
+			&dsh->log, NULL, EINVAL,
+			"load seek buffer: buffer too small\n");
+	memcpy(&hdr, buffer, sizeof(hdr));
+	/* keep room for all frames that may still be stored */
+	buf_count = hdr.skip ? (dshandle_max_frames(dsh) / hdr.skip) + 1 : 0;
+	if (hdr.tracks_per_frame != dsh->tracks_per_frame || !hdr.skip ||
+	    hdr.count > buf_count ||
+	    size != sizeof(hdr) + hdr.count * sizeof(struct seekelement))
+		return errorlog_add_message(
+			&dsh->log, NULL, EINVAL,
+			"load seek buffer: data does not match data set %s\n",
+			dsh->ds->name);
+	elements_size = buf_count * sizeof(struct seekelement);
+	seekbuf = malloc(elements_size);
+	if (!seekbuf)
+		return ENOMEM;
+	memset(seekbuf, 0, elements_size);
+	memcpy(seekbuf, buffer + sizeof(hdr),
+	       hdr.count * sizeof(struct seekelement));
+	pthread_mutex_lock(&dsh->mutex);
+	free(dsh->seekbuf);
+	dsh->seekbuf = seekbuf;
+	dsh->seek_count = buf_count;
+	dsh->seek_current = hdr.count;
+	dsh->skip = hdr.skip;
+	pthread_mutex_unlock(&dsh->mutex);
+	return 0;
+}
+
 /**
  * If dsh points to a partitioned data set, the library needs to know
  * which member of that PDS should be read. So this function must be
@@ -2815,6 +3053,46 @@ void lzds_dshandle_get_keepRDW(struct dshandle *dsh, int *keepRDW)
 	*keepRDW = dsh->keepRDW;
 }
 
+/**
+ * With prefetch enabled, lzds_dshandle_read reads the following track
+ * frame in a background thread while the current track frame is
+ * interpreted. This requires a second track buffer of the same size.
+ *
+ * @pre The dsh must not be open when this function is called.
+ *
+ * @param[in] dsh      The dshandle we want to modify.
+ * @param[in] prefetch Set this to 1 to enable prefetch or 0 to disable it.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - EBUSY   The handle is already open.
+ *   - ENOMEM  Could not allocate the track buffer due to lack of memory.
+ */
+int lzds_dshandle_set_prefetch(struct dshandle *dsh, int prefetch)
+{
+	errorlog_clear(dsh->log);
+	if (dsh->is_open)
+		return errorlog_add_message(
+			&dsh->log, NULL, EBUSY,
+			"dshandle: cannot set prefetch while handle is open\n");
+	if (prefetch && !dsh->pf.rawbuffer) {
+		/* track buffer must be page aligned for O_DIRECT */
+		dsh->pf.rawbuffer = memalign(4096, dsh->rawbufmax);
+		if (!dsh->pf.rawbuffer)
+			return ENOMEM;
+	}
+	dsh->prefetch = !!prefetch;
+	return 0;
+}
+
+/**
+ * @param[in]  dsh      The dshandle that we want to know the setting of.
+ * @param[out] prefetch Reference to a variable in which the previously
+ *                      set prefetch value is returned.
+ */
+void lzds_dshandle_get_prefetch(struct dshandle *dsh, int *prefetch)
+{
+	*prefetch = dsh->prefetch;
+}
+
 /**
  * @brief Helper function that initializes the given handle so that it
  *        points to the beginning of the dataset or member.
@@ -2936,6 +3214,8 @@ static int initialize_buffer_positions_for_first_read(struct dshandle *dsh)
 void lzds_dshandle_close(struct dshandle *dsh)
 {
 	int i;
+
+	dshandle_prefetch_wait(dsh);
 	for (i = 0; i < MAXVOLUMESPERDS; ++i)
 		if (dsh->dasdhandle[i])
 			lzds_dasdhandle_close(dsh->dasdhandle[i]);
@@ -3355,21 +3635,82 @@ static int dshandle_store_trackframe(struct dshandle *dsh)
 }
 
 /**
- * @param[in]  dsh    The dshandle that keeps track of the I/O operations.
- * @param[in]  buf    The target buffer for the read data.
- * @param[in]  size   The number of bytes that are to be read.
- * @param[out] rcsize Reference to a variable in which the actual number
- *                    of read bytes is returned.
- *                    If this is 0, the end of the file is reached.
- * @return     0 on success, otherwise one of the following error codes:
- *   - EINVAL  The data in dsh is inconsistent.
- *   - ERANGE  The data in dsh is inconsistent.
- *   - EPROTO  The data read from the disk does not conform to the
- *             expected format.
- *   - EIO     I/O error when reading from device.
+ * @brief subroutine of lzds_dshandle_read
+ *
+ * Start to read the track frame that follows the current track frame
+ * in the background. If the thread cannot be created, the next track
+ * frame is simply read synchronously.
+ *
+ * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
  */
-int lzds_dshandle_read(struct dshandle *dsh, char *buf,
-		       size_t size, ssize_t *rcsize)
+static void dshandle_prefetch_start(struct dshandle *dsh)
+{
+	struct prefetch *pf = &dsh->pf;
+	struct dshandle next;
+
+	if (!dsh->prefetch || pf->active)
+		return;
+	/* Advance a copy of the position to find the next track frame,
+	 * which may be in the next extent or data set part */
+	next = *dsh;
+	if (!dshandle_prepare_for_next_read_tracks(&next))
+		return;
+	pf->dasdh = dsh->dasdhandle[next.dsp_no];
+	pf->dsp_no = next.dsp_no;
+	pf->bufstarttrk = next.bufstarttrk;
+	pf->bufendtrk = next.bufendtrk;
+	if (pthread_create(&pf->thread, NULL, dshandle_prefetch_thread, pf))
+		return;
+	pf->active = 1;
+}
+
+/**
+ * @brief subroutine of lzds_dshandle_read
+ *
+ * Read the raw tracks of the current track frame into the rawbuffer.
+ * If the track frame has been prefetched, the buffers are swapped.
+ * A failed prefetch is repeated synchronously to get the error log of
+ * the dasdhandle.
+ *
+ * @param[in]  dsh  The dshandle that keeps track of the I/O operations.
+ * @return     0 on success, otherwise the error codes of
+ *             lzds_dasdhandle_read_tracks_to_buffer
+ */
+static int dshandle_read_trackframe(struct dshandle *dsh)
+{
+	struct prefetch *pf = &dsh->pf;
+	char *rawbuffer;
+	int rc;
+
+	if (pf->active) {
+		dshandle_prefetch_wait(dsh);
+		if (!pf->rc && pf->dsp_no == dsh->dsp_no &&
+		    pf->bufstarttrk == dsh->bufstarttrk &&
+		    pf->bufendtrk == dsh->bufendtrk) {
+			rawbuffer = dsh->rawbuffer;
+			dsh->rawbuffer = pf->rawbuffer;
+			pf->rawbuffer = rawbuffer;
+			dshandle_prefetch_start(dsh);
+			return 0;
+		}
+	}
+	rc = lzds_dasdhandle_read_tracks_to_buffer(
+		dsh->dasdhandle[dsh->dsp_no], dsh->bufstarttrk,
+		dsh->bufendtrk, dsh->rawbuffer);
+	if (rc)
+		return rc;
+	dshandle_prefetch_start(dsh);
+	return 0;
+}
+
+/**
+ * @brief subroutine of lzds_dshandle_read, lzds_dshandle_lseek and
+ *        lzds_dshandle_pread
+ *
+ * Same as lzds_dshandle_read, but the caller must hold dsh->mutex.
+ */
+static int dshandle_read(struct dshandle *dsh, char *buf,
+			 size_t size, ssize_t *rcsize)
 {
 	ssize_t copysize;
 	int rc;
@@ -3387,9 +3728,7 @@ int lzds_dshandle_read(struct dshandle *dsh, char *buf,
 				break; /* end of data in data set reached */
 			if (!dshandle_prepare_for_next_read_tracks(dsh))
 				break; /* end of data set extents reached */
-			rc = lzds_dasdhandle_read_tracks_to_buffer(
-				dsh->dasdhandle[dsh->dsp_no], dsh->bufstarttrk,
-				dsh->bufendtrk, dsh->rawbuffer);
+			rc = dshandle_read_trackframe(dsh);
 			if (rc)
 				return errorlog_add_message(
 					&dsh->log,
@@ -3546,26 +3885,12 @@ static void dshandle_reset_buffer_position_to_seekelement(
 }
 
 /**
- * It is not possible to seek beyond the end of the data, but an
- * attempt to do so is a common occurrence as we may not know the
- * actual data size beforehand. In this case, the returned rcoffset
- * is smaller than offset and points to the offset directly following
- * the last data byte.
+ * @brief subroutine of lzds_dshandle_lseek and lzds_dshandle_pread
  *
- * @param[in]  dsh      The dshandle that keeps track of the I/O operations.
- * @param[in]  offset   The data offset in the dataset that we want to reach.
- * @param[out] rcoffset Reference to a variable in which the actual offset
- *                      is returned.
- *
- * @return     0 on success, otherwise one of the following error codes:
- *   - EINVAL  The data in dsh is inconsistent.
- *   - ERANGE  The data in dsh is inconsistent.
- *   - EPROTO  The data read from the disk does not conform to the
- *             expected format.
- *   - EIO     I/O error when reading from device.
+ * Same as lzds_dshandle_lseek, but the caller must hold dsh->mutex.
  */
-int lzds_dshandle_lseek(struct dshandle *dsh, long long offset,
-			long long *rcoffset)
+static int dshandle_lseek(struct dshandle *dsh, long long offset,
+			  long long *rcoffset)
 {
 	char foo;
 	ssize_t rcsize;
@@ -3605,7 +3930,7 @@ int lzds_dshandle_lseek(struct dshandle *dsh, long long offset,
 	 */
 	while (dsh->databufoffset + dsh->databufsize <= offset) {
 		dsh->bufpos = dsh->databufsize;
-		rc = lzds_dshandle_read(dsh, &foo, sizeof(foo), &rcsize);
+		rc = dshandle_read(dsh, &foo, sizeof(foo), &rcsize);
 		if (rc || !rcsize) {
 			*rcoffset = dsh->databufoffset + dsh->databufsize;
 			if (rc)
@@ -3622,6 +3947,94 @@ int lzds_dshandle_lseek(struct dshandle *dsh, long long offset,
 	return 0;
 }
 
+/**
+ * @param[in]  dsh    The dshandle that keeps track of the I/O operations.
+ * @param[in]  buf    The target buffer for the read data.
+ * @param[in]  size   The number of bytes that are to be read.
+ * @param[out] rcsize Reference to a variable in which the actual number
+ *                    of read bytes is returned.
+ *                    If this is 0, the end of the file is reached.
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - EINVAL  The data in dsh is inconsistent.
+ *   - ERANGE  The data in dsh is inconsistent.
+ *   - EPROTO  The data read from the disk does not conform to the
+ *             expected format.
+ *   - EIO     I/O error when reading from device.
+ */
+int lzds_dshandle_read(struct dshandle *dsh, char *buf,
+		       size_t size, ssize_t *rcsize)
+{
+	int rc;
+
+	pthread_mutex_lock(&dsh->mutex);
+	rc = dshandle_read(dsh, buf, size, rcsize);
+	pthread_mutex_unlock(&dsh->mutex);
+	return rc;
+}
+
+/**
+ * It is not possible to seek beyond the end of the data, but an
+ * attempt to do so is a common occurrence as we may not know the
+ * actual data size beforehand. In this case, the returned rcoffset
+ * is smaller than offset and points to the offset directly following
+ * the last data byte.
+ *
+ * @param[in]  dsh      The dshandle that keeps track of the I/O operations.
+ * @param[in]  offset   The data offset in the dataset that we want to reach.
+ * @param[out] rcoffset Reference to a variable in which the actual offset
+ *                      is returned.
+ *
+ * @return     0 on success, otherwise one of the following error codes:
+ *   - EINVAL  The data in dsh is inconsistent.
+ *   - ERANGE  The data in dsh is inconsistent.
+ *   - EPROTO  The data read from the disk does not conform to the
+ *             expected format.
+ *   - EIO     I/O error when reading from device.
+ */
+int lzds_dshandle_lseek(struct dshandle *dsh, long long offset,
+			long long *rcoffset)
+{
+	int rc;
+
+	pthread_mutex_lock(&dsh->mutex);
+	rc = dshandle_lseek(dsh, offset, rcoffset);
+	pthread_mutex_unlock(&dsh->mutex);
+	return rc;
+}
+
+/**
+ * Read data from the given offset without a separate lzds_dshandle_lseek
+ * call. Seek and read are done as one operation, so that several threads
+ * can share one dshandle. The current offset is left behind the read data,
+ * so sequential reads of one thread do not need to seek.
+ *
+ * @param[in]  dsh    The dshandle that keeps track of the I/O operations.
+ * @param[in]  buf    The target buffer for the read data.
+ * @param[in]  size   The number of bytes that are to be read.
+ * @param[in]  offset The data offset in the data set to read from.
+ * @param[out] rcsize Reference to a variable in which the actual number
+ *                    of read bytes is returned.
+ *                    If this is 0, the end of the file is reached.
+ * @return     0 on success, otherwise one of the error codes of
+ *             lzds_dshandle_lseek and lzds_dshandle_read.
+ */
+int lzds_dshandle_pread(struct dshandle *dsh, char *buf, size_t size,
+			long long offset, ssize_t *rcsize)
+{
+	long long rcoffset = offset;
+	int rc = 0;
+
+	pthread_mutex_lock(&dsh->mutex);
+	*rcsize = 0;
+	if (dsh->databufoffset + dsh->bufpos != offset)
+		rc = dshandle_lseek(dsh, offset, &rcoffset);
+	/* an offset beyond the end of the data is not an error */
+	if (!rc && rcoffset == offset)
+		rc = dshandle_read(dsh, buf, size, rcsize);
+	pthread_mutex_unlock(&dsh->mutex);
+	return rc;
+}
+
 /**
  * @param[in]  dsh    The dshandle that keeps track of the I/O operations.
  * @param[out] offset Reference to a variable in which the current offset
@@ -3629,7 +4042,9 @@ int lzds_dshandle_lseek(struct dshandle *dsh, long long offset,
  */
 void lzds_dshandle_get_offset(struct dshandle *dsh, long long *offset)
 {
+	pthread_mutex_lock(&dsh->mutex);
 	*offset = dsh->databufoffset + dsh->bufpos;
+	pthread_mutex_unlock(&dsh->mutex);
 }
 
 /**
@@ -0,0 +1,209 @@
+/*
+ * test_image - Test program for libzds
+ *
+ * Test program to read a data set from raw track image files instead of
+ * DASD devices. Checks that the geometry of an image file is taken from
+ * its size and that image files are opened without O_DIRECT if the file
+ * system does not support it.
+ *
+ * Copyright IBM Corp. 2020
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Number of open() calls with and without O_DIRECT */
+static int direct_opens;
+static int buffered_opens;
+/* Simulate a file system that rejects O_DIRECT */
+static int fail_direct;
+
+static int test_open(const char *path, int flags)
+{
+	if (flags & O_DIRECT) {
+		direct_opens++;
+		if (fail_direct) {
+			errno = EINVAL;
+			return -1;
+		}
+	} else {
+		buffered_opens++;
+	}
+	return open(path, flags);
+}
+
+#define open test_open
+#include "../libzds.c"
+#undef open
+
+#define IMG_CYLS	4
+#define IMG_RECS	3
+#define IMG_DATALEN	4000
+
+/* Two extents of the data set on the image */
+static const unsigned int ext_trk[2][2] = { { 1, 10 }, { 40, 52 } };
+
+static unsigned char data_byte(unsigned int trk, unsigned int rec,
+			       unsigned int i)
+{
+	return (trk * 7 + rec * 13 + i) & 0xff;
+}
+
+static int is_data_track(unsigned int trk)
+{
+	unsigned int i;
+
+	for (i = 0; i < 2; i++) {
+		if (trk >= ext_trk[i][0] && trk <= ext_trk[i][1])
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Write a raw track image with IMG_RECS data records on each track of the
+ * data set and an incomplete track at the end
+ */
+static void write_image(int fd)
+{
+	unsigned int trk, rec, i;
+	struct eckd_count *ec;
+	char *buf, *ptr;
+
+	buf = malloc(RAWTRACKSIZE);
+	assert(buf != NULL);
+	for (trk = 0; trk < IMG_CYLS * 15; trk++) {
+		memset(buf, 0, RAWTRACKSIZE);
+		/* record 0 */
+		ec = (struct eckd_count *) buf;
+		ec->dl = 8;
+		ptr = buf + sizeof(*ec) + ec->dl;
+		for (rec = 1; is_data_track(trk) && rec <= IMG_RECS; rec++) {
+			ec = (struct eckd_count *) ptr;
+			ec->recid.b = rec;
+			ec->dl = IMG_DATALEN;
+			ptr += sizeof(*ec);
+			for (i = 0; i < IMG_DATALEN; i++)
+				*ptr++ = data_byte(trk, rec, i);
+		}
+		memset(ptr, 0xff, 8);
+		assert(write(fd, buf, RAWTRACKSIZE) == RAWTRACKSIZE);
+	}
+	assert(write(fd, buf, RAWTRACKSIZE / 2) == RAWTRACKSIZE / 2);
+	free(buf);
+}
+
+static void set_extent(extent_t *ext, unsigned int first, unsigned int last)
+{
+	ext->typeind = 1;
+	vtoc_set_cchh(&ext->llimit, first / 15, first % 15);
+	vtoc_set_cchh(&ext->ulimit, last / 15, last % 15);
+}
+
+/*
+ * Read the whole data set and compare it with the records on the image
+ */
+static void read_dataset(struct dataset *ds, int prefetch)
+{
+	unsigned int e, trk, rec, i;
+	struct dshandle *dsh;
+	char *buf, *ptr;
+	ssize_t count;
+	size_t total;
+
+	buf = malloc(65536);
+	assert(buf != NULL);
+	assert(lzds_dataset_alloc_dshandle(ds, 4, &dsh) == 0);
+	assert(lzds_dshandle_set_prefetch(dsh, prefetch) == 0);
+	assert(lzds_dshandle_open(dsh) == 0);
+	e = 0;
+	trk = ext_trk[0][0];
+	rec = 1;
+	i = 0;
+	total = 0;
+	do {
+		assert(lzds_dshandle_read(dsh, buf, 65536, &count) == 0);
+		for (ptr = buf; ptr < buf + count; ptr++) {
+			assert(e < 2);
+			assert((unsigned char) *ptr == data_byte(trk, rec, i));
+			if (++i < IMG_DATALEN)
+				continue;
+			i = 0;
+			if (++rec <= IMG_RECS)
+				continue;
+			rec = 1;
+			if (++trk <= ext_trk[e][1])
+				continue;
+			if (++e < 2)
+				trk = ext_trk[e][0];
+		}
+		total += count;
+	} while (count);
+	assert(e == 2);
+	assert(total == (size_t) (ext_trk[0][1] - ext_trk[0][0] + 1 +
+				  ext_trk[1][1] - ext_trk[1][0] + 1) *
+		IMG_RECS * IMG_DATALEN);
+	lzds_dshandle_close(dsh);
+	lzds_dshandle_free(dsh);
+	free(buf);
+}
+
+int main(void)
+{
+	char path[] = "/tmp/test_image.XXXXXX";
+	struct datasetpart dsp;
+	format1_label_t f1;
+	struct zdsroot *root;
+	struct dataset ds;
+	struct dasd *dasd;
+	int fd, prefetch;
+
+	fd = mkstemp(path);
+	assert(fd >= 0);
+	write_image(fd);
+	close(fd);
+
+	/* The geometry of an image file is derived from its size */
+	assert(lzds_zdsroot_alloc(&root) == 0);
+	assert(lzds_zdsroot_add_device(root, path, &dasd) == 0);
+	assert(dasd->cylinders == IMG_CYLS);
+	assert(dasd->heads == 15);
+
+	memset(&f1, 0, sizeof(f1));
+	f1.DS1DSRG1 = 0x40;	/* physical sequential */
+	f1.DS1RECFM = 0x80;	/* fixed */
+	memset(&dsp, 0, sizeof(dsp));
+	dsp.dasdi = dasd;
+	dsp.f1 = &f1;
+	set_extent(&dsp.ext[0], ext_trk[0][0], ext_trk[0][1]);
+	set_extent(&dsp.ext[1], ext_trk[1][0], ext_trk[1][1]);
+	memset(&ds, 0, sizeof(ds));
+	strcpy(ds.name, "TEST.IMAGE");
+	ds.dsp[0] = &dsp;
+	ds.dspcount = 1;
+	ds.iscomplete = 1;
+
+	for (prefetch = 0; prefetch <= 1; prefetch++) {
+		/* Image files are opened with O_DIRECT where possible */
+		fail_direct = 0;
+		direct_opens = 0;
+		read_dataset(&ds, prefetch);
+		assert(direct_opens > 0);
+
+		/* If O_DIRECT is rejected, the file is opened without it */
+		fail_direct = 1;
+		direct_opens = 0;
+		buffered_opens = 0;
+		read_dataset(&ds, prefetch);
+		assert(direct_opens > 0);
+		assert(buffered_opens == direct_opens);
+	}
+
+	lzds_zdsroot_free(root);
+	unlink(path);
+	return 0;
+}
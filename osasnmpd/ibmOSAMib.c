@@ -27,6 +27,13 @@ TABLE_OID* oid_list_head;
 IF_LIST* if_list;
 int ifNumber;
 
+/* lifetime of cached GET responses in seconds, 0 disables the cache */
+int get_cache_ttl = GET_CACHE_TTL;
+
+/* cached GET responses hashed by ifIndex and OID */
+static GET_CACHE* get_cache[GET_CACHE_SIZE];
+static int get_cache_cnt;
+
 
 
 /**********************************************************************
@@ -143,7 +150,7 @@ void init_ibmOSAMib(void) {
 	  strcpy( ifr.ifr_name, if_list[i].if_Name );         /* add interface name */       
 	  ifr.ifr_ifru.ifru_data = (char*) buffer;            /* add data buffer    */ 
 	  
-	  if ( ioctl( sd, SIOC_QETH_ADP_SET_SNMP_CONTROL, &ifr ) < 0 )
+	  if ( osa_snmp_ioctl( sd, &ifr ) < 0 )
 	    {
 	      error_code = errno;
 
@@ -612,11 +619,186 @@ unsigned char* var_DisplayStr( struct variable *vp,
 } /* end var_DisplayStr */
 
 
+/**********************************************************************
+ * get_cache_now()
+ *  Returns the current time in seconds for lifetime checks of cached
+ *  GET responses. A monotonic clock is used to be independent of
+ *  changes of the time of day.
+ *********************************************************************/
+static time_t get_cache_now( void )
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec;
+} /* end get_cache_now */
+
+
+/**********************************************************************
+ * get_cache_key()
+ *  Returns the hash bucket for an ifIndex and OID string.
+ *********************************************************************/
+static unsigned int get_cache_key( int ifIndex, const char *oid_str )
+{
+  unsigned int key = (unsigned int) ifIndex;
+
+  for ( ; *oid_str; oid_str++ )
+    key = key * 31 + (unsigned char) *oid_str;
+
+  return key % GET_CACHE_SIZE;
+} /* end get_cache_key */
+
+
+/**********************************************************************
+ * get_cache_free()
+ *  Frees a single cache entry.
+ *********************************************************************/
+static void get_cache_free( GET_CACHE *entry )
+{
+  free( entry->oid_str );
+  free( entry->cmd );
+  free( entry );
+  get_cache_cnt--;
+} /* end get_cache_free */
+
+
+/**********************************************************************
+ * get_cache_flush()
+ *  Frees all cached GET responses.
+ *********************************************************************/
+static void get_cache_flush( void )
+{
+  GET_CACHE *entry;
+  int i;
+
+  for ( i=0; i < GET_CACHE_SIZE; i++ )
+    {
+      while ( get_cache[i] != NULL )
+	{
+	  entry = get_cache[i];
+	  get_cache[i] = entry->next;
+	  get_cache_free( entry );
+	}
+    } /* end for */
+} /* end get_cache_flush */
+
+
+/**********************************************************************
+ * get_cache_lookup()
+ *  Looks up a cached GET response for an OID of an interface. Expired
+ *  entries and entries from before the last MIB update are removed
+ *  while walking the hash chain.
+ *  parameters:
+ *  IN    int ifIndex       - IF-MIB interface index
+ *  IN    char *oid_str     - OID as string
+ *  INOUT IPA_CMD_GET** cmd - copy of cached GET command area
+ *  returns:  offset to returned data
+ *           -1 - no valid response cached
+ *********************************************************************/
+static int get_cache_lookup( int ifIndex, const char *oid_str,
+			     IPA_CMD_GET **cmd )
+{
+  GET_CACHE **pentry, *entry;
+  time_t now;
+
+  if ( get_cache_ttl <= 0 )
+    return -1;
+
+  now = get_cache_now();
+  pentry = &get_cache[get_cache_key( ifIndex, oid_str )];
+  while ( *pentry != NULL )
+    {
+      entry = *pentry;
+      if ( entry->expires <= now || entry->generation != mib_generation )
+	{
+	  *pentry = entry->next;
+	  get_cache_free( entry );
+	  continue;
+	}
+      if ( entry->ifIndex == ifIndex && strcmp( entry->oid_str, oid_str ) == 0 )
+	{
+	  *cmd = ( IPA_CMD_GET* ) malloc( GET_AREA_LEN );
+	  if ( *cmd == NULL )
+	    return -1;
+	  memcpy( *cmd, entry->cmd, entry->cmd_len );
+	  return entry->offset;
+	}
+      pentry = &entry->next;
+    } /* end while */
+
+  return -1;
+} /* end get_cache_lookup */
+
+
+/**********************************************************************
+ * get_cache_store()
+ *  Adds a successful GET response to the cache. Only the used part of
+ *  the GET command area up to the end of the returned data is stored.
+ *  parameters:
+ *  IN    int ifIndex       - IF-MIB interface index
+ *  IN    char *oid_str     - OID as string
+ *  IN    IPA_CMD_GET* cmd  - GET command area
+ *  IN    int offset        - offset to returned data
+ *  returns: none
+ *********************************************************************/
+static void get_cache_store( int ifIndex, const char *oid_str,
+			     IPA_CMD_GET *cmd, int offset )
+{
+  IPA_GET_DATA *get_res;
+  GET_CACHE    *entry;
+  unsigned int key;
+  long         len;
+  void         *tmp_ptr;
+
+  if ( get_cache_ttl <= 0 )
+    return;
+
+  /* determine end of returned data portion */
+  tmp_ptr = (char*) cmd;
+  tmp_ptr += offset;
+  get_res = (IPA_GET_DATA*) (PTR_ALIGN4( tmp_ptr ));
+  len = (char*) get_res->data - (char*) cmd;
+  if ( get_res->len < 0 || len + get_res->len > GET_AREA_LEN )
+    return;
+  len += get_res->len;
+
+  /* do not grow without limit, responses are cheap to get again */
+  if ( get_cache_cnt >= GET_CACHE_MAX )
+    get_cache_flush();
+
+  entry = ( GET_CACHE* ) malloc( sizeof( *entry ) );
+  if ( entry == NULL )
+    return;
+  entry->oid_str = strdup( oid_str );
+  entry->cmd = ( IPA_CMD_GET* ) malloc( len );
+  if ( entry->oid_str == NULL || entry->cmd == NULL )
+    {
+      free( entry->oid_str );
+      free( entry->cmd );
+      free( entry );
+      return;
+    }
+  memcpy( entry->cmd, cmd, len );
+  entry->cmd_len = len;
+  entry->ifIndex = ifIndex;
+  entry->offset = offset;
+  entry->expires = get_cache_now() + get_cache_ttl;
+  entry->generation = mib_generation;
+
+  key = get_cache_key( ifIndex, oid_str );
+  entry->next = get_cache[key];
+  get_cache[key] = entry;
+  get_cache_cnt++;
+} /* end get_cache_store */
+
+
 /**********************************************************************
  * do_GET_ioctl()
  *  This function handles the communication with an OSA Express Card
  *  to query the appropriate MIB information from IPAssists.
  *  An ioctl is used in order to qet the appropriate information.
+ *  Successful responses are cached for get_cache_ttl seconds, so that
+ *  repeated walks do not query the OSA Express card again.
  *  parameters:
  *  IN    int ifIndex       - IF-MIB interface index 
  *  IN    oid    *name      - OID being returned
@@ -628,24 +810,18 @@ unsigned char* var_DisplayStr( struct variable *vp,
 int do_GET_ioctl ( int ifIndex, oid *name, size_t len, IPA_CMD_GET **cmd )
 {
   int  sd;                                   /* socket descriptor */
-  int  i, error_code;
+  int  error_code, offset;
   char oid_str[MAX_OID_STR_LEN];             /* may hold an OID as string */
   char time_buf[TIME_BUF_SIZE];              /* date/time buffer */
-  char device[IFNAME_MAXLEN] = "not_found";  /* device name for ioctl */
+  char device[IFNAME_MAXLEN];                /* device name for ioctl */
   struct ifreq ifr;                          /* request structure for ioctl */
+  IF_LIST *if_entry;
   
   
   /* search device name in in global interface list for ifIndex */
-  for ( i=0; i < ifNumber; i++ )
-    {
-      if ( if_list[i].ifIndex == ifIndex )
-	{
-	  strcpy( device, if_list[i].if_Name );
-	  break;
-	}
-    } /* end for */
+  if_entry = search_if_list( ifIndex );
   
-  if ( strcmp( device, "not_found" ) == 0 )
+  if ( if_entry == NULL )
     {
       get_time( time_buf );	    
       snmp_log( LOG_ERR, "%s do_GET_ioctl(): "
@@ -655,6 +831,7 @@ int do_GET_ioctl ( int ifIndex, oid *name, size_t len, IPA_CMD_GET **cmd )
 		,time_buf, ifIndex );
       return -1;
     } 
+  strcpy( device, if_entry->if_Name );
 
   /*
    * query IPAssists for data appropriate to the OID that we just validated
@@ -670,6 +847,11 @@ int do_GET_ioctl ( int ifIndex, oid *name, size_t len, IPA_CMD_GET **cmd )
       return -1;
     } 
 
+  /* use a cached response if it is still valid */
+  offset = get_cache_lookup( ifIndex, oid_str, cmd );
+  if ( offset >= 0 )
+    return offset;
+
   /* allocate memory for Get/GetNext command area */
   *cmd = ( IPA_CMD_GET* ) malloc( GET_AREA_LEN ); 
   if ( *cmd == NULL ) 
@@ -721,7 +903,7 @@ int do_GET_ioctl ( int ifIndex, oid *name, size_t len, IPA_CMD_GET **cmd )
   /* do ioctl */
   strcpy( ifr.ifr_name, device );       
   ifr.ifr_ifru.ifru_data = (char*) (*cmd);
-  if ( ioctl( sd, SIOC_QETH_ADP_SET_SNMP_CONTROL, &ifr ) < 0 )
+  if ( osa_snmp_ioctl( sd, &ifr ) < 0 )
     {
       error_code = errno;
       get_time( time_buf );
@@ -794,7 +976,9 @@ int do_GET_ioctl ( int ifIndex, oid *name, size_t len, IPA_CMD_GET **cmd )
     
   case IPA_SNMP_SUCCESS:
     /* return offset to data portion */
-    return ( sizeof( IPA_CMD_GET ) + strlen( oid_str ) + 1 );
+    offset = sizeof( IPA_CMD_GET ) + strlen( oid_str ) + 1;
+    get_cache_store( ifIndex, oid_str, *cmd, offset );
+    return offset;
     break;
 
   case IPA_SNMP_INV_TOPOID: 
@@ -27,6 +27,9 @@ FindVarMethod var_ibmOSAMib;            /* handle GET and GETNEXT requests */
 FindVarMethod var_DisplayStr;           /* handle special case Display String */
 WriteMethod   write_ibmOSAMib;          /* handle SET requests             */
 
+/* lifetime of cached GET responses in seconds, 0 disables the cache */
+extern int get_cache_ttl;
+
 /* ioctl for Get/Getnext processing */
 int do_GET_ioctl ( int, oid*, size_t, IPA_CMD_GET** ); 
 
@@ -45,6 +45,10 @@
 #define GET_AREA_LEN  MAX_GET_DATA + 512  /* size for GET command area length */
 #define TIME_BUF_SIZE 128   /* buffer size for date and time string */
 #define MAX_OID_STR_LEN   MAX_OID_LEN * 5 /* max OID string size */
+#define GET_CACHE_TTL 5     /* default lifetime of cached GET responses (s) */
+#define GET_CACHE_SIZE 1021 /* hash buckets for cached GET responses */
+#define GET_CACHE_MAX 16384 /* max number of cached GET responses */
+#define IND_HASH_SIZE 4099  /* hash buckets for registered indices */
 /* definitions for 2.6 qeth */
 #define QETH_SYSFILE "/sys/bus/ccwgroup/drivers/qeth/notifier_register"
 #define SIOC_QETH_ADP_SET_SNMP_CONTROL	(SIOCDEVPRIVATE + 5)
@@ -184,6 +188,10 @@ typedef struct reg_indices
 {
   char                *full_index;     /* full index portion from IPA */
   int                 ifIndex;         /* ifIndex from IF-MIB */
+  oid                 *ind_oid;        /* index portion as net-snmp oid */
+  size_t              ind_len;         /* length of ind_oid */
+  struct reg_indices  *head;           /* ptr to head of this list */
+  struct reg_indices  *hnext;          /* ptr to next entry in hash chain */
   struct reg_indices  *next;           /* ptr to next entry in list */
 } REG_INDICES;
 
@@ -200,3 +208,19 @@ typedef struct if_List
   int  ipa_ver;                      /* IPA microcode level */
 } IF_LIST;
 
+
+/*******************************************************************/
+/* cache for GET responses from IPAssists                          */
+/*******************************************************************/
+typedef struct get_cache
+{
+  int               ifIndex;         /* IF-MIB ifIndex */
+  char              *oid_str;        /* requested OID as string */
+  IPA_CMD_GET       *cmd;            /* copy of used part of GET area */
+  int               cmd_len;         /* length of copy */
+  int               offset;          /* offset to returned data portion */
+  time_t            expires;         /* end of lifetime (CLOCK_MONOTONIC) */
+  int               generation;      /* MIB generation of response */
+  struct get_cache  *next;           /* ptr to next entry in hash chain */
+} GET_CACHE;
+
@@ -29,6 +29,15 @@ extern TABLE_OID* oid_list_head;
 /* proc file filedescriptor. opened in osasnmpd.c */
 extern int proc_fd;
 
+/* incremented whenever the MIB information is updated */
+volatile sig_atomic_t mib_generation;
+
+/* SNMP control ioctl backend, can be replaced for testing */
+int (*osa_snmp_ioctl)( int, struct ifreq* ) = osa_snmp_ioctl_dev;
+
+/* hash table for entries of all index linked lists */
+static REG_INDICES* ind_hash[IND_HASH_SIZE];
+
 
 
 
@@ -174,6 +183,10 @@ TABLE_OID* init_oid_list ()
  *  This function searches the linked OID list for a given OID and
  *  returns a ptr to the element if it is an exact match, otherwise the 
  *  previous (smaller) OID in the list is returned.
+ *  The list holds one entry per MIB table of the IPAssists MIB (less
+ *  than a dozen) and is only searched when MIB information is
+ *  registered, so a linear walk is sufficient. The per-request lookup
+ *  of table indices is hashed, see search_index().
  *                                   
  *  parameters:
  *  IN   oid*   s_oid      - Toplevel OID to search for 
@@ -224,6 +237,7 @@ int search_oid ( oid* s_oid, size_t len, TABLE_OID* lhead, TABLE_OID** curr  )
  *  OID from the linked list.
  *  It returns a pointer to the element if it is an exact match. 
  *  Otherwise the return OID is set to NULL.
+ *  Like search_oid(), this walks the short list of MIB tables.
  *                                   
  *  parameters:
  *  IN   oid*   s_oid      - Fully qualified OID 
@@ -413,14 +427,41 @@ REG_INDICES* init_ind_list ( )
   /* allocate list head */
   ihead = (REG_INDICES*) malloc( sizeof *ihead );
 
-  if ( ihead != NULL )  
-    ihead->next = NULL;
+  if ( ihead != NULL ) {
+    memset( ihead, 0, sizeof *ihead );
+    ihead->head = ihead;
+  } /* end if */
 
   return ihead; 
  
 } /* init_ind_list() */
 
 
+/**********************************************************************
+ * ind_hash_key():
+ *  This function computes the hash bucket of an index within the index
+ *  linked list with head lhead.
+ *
+ *  parameters:
+ *  IN   REG_INDICES* lhead   - head of index linked list
+ *  IN   oid*         ind_oid - index portion as net-snmp oid
+ *  IN   size_t       len     - length of index portion
+ *  returns: unsigned int     - hash bucket
+ *********************************************************************/
+static unsigned int ind_hash_key( REG_INDICES* lhead, oid* ind_oid,
+				  size_t len )
+{
+  unsigned long key = (unsigned long) lhead;
+  size_t i;
+
+  for ( i=0; i < len; i++ )
+    key = key * 31 + ind_oid[i];
+
+  return key % IND_HASH_SIZE;
+
+} /* ind_hash_key() */
+
+
 /**********************************************************************
  * index_insert_after():  
  *  This function adds a new index entry to the index linked list   
@@ -437,23 +478,74 @@ REG_INDICES* index_insert_after ( char* i_index, int ifIndex,
 {
   REG_INDICES *new_entry;
 
+  oid    ind_oid[MAX_OID_LEN];     /* temporary net-snmp oid */
+  size_t ind_len;
+  unsigned int key;
+
   new_entry = (REG_INDICES*) malloc( sizeof *new_entry );
   if ( new_entry == NULL )
     return NULL;
 
+  /* keep the index portion as net-snmp oid for comparisons */
+  ind_len = str_to_oid_conv( i_index, ind_oid );
+  new_entry->ind_oid = (oid*) malloc( (ind_len + 1) * sizeof(oid) );
+  if ( new_entry->ind_oid == NULL )
+    {
+      free( new_entry );
+      return NULL;
+    } /* end if */
+  memcpy( new_entry->ind_oid, ind_oid, ind_len * sizeof(oid) );
+  new_entry->ind_len = ind_len;
+
   /* assign index and ifIndex */
   new_entry->full_index = i_index;  
   new_entry->ifIndex = ifIndex;
+  new_entry->head = pre_ind->head;
 
   /* insert */
   new_entry->next = pre_ind->next;
   pre_ind->next = new_entry;
 
+  /* add to hash table */
+  key = ind_hash_key( new_entry->head, ind_oid, ind_len );
+  new_entry->hnext = ind_hash[key];
+  ind_hash[key] = new_entry;
+
   return new_entry;
  
 } /* index_insert_after()*/
 
 
+/**********************************************************************
+ * free_index():
+ *  This function removes an entry of an index linked list from the
+ *  hash table and frees it.
+ *
+ *  parameters:
+ *  IN       REG_INDICES *entry   - entry to free
+ *  returns: none
+ *********************************************************************/
+static void free_index( REG_INDICES* entry )
+{
+  REG_INDICES **hptr;
+
+  hptr = &ind_hash[ind_hash_key( entry->head, entry->ind_oid,
+				 entry->ind_len )];
+  for ( ; *hptr != NULL; hptr = &(*hptr)->hnext )
+    {
+      if ( *hptr == entry ) {
+	*hptr = entry->hnext;
+	break;
+      } /* end if */
+    } /* end for */
+
+  free( entry->ind_oid );
+  free( entry->full_index );
+  free( entry );
+
+} /* free_index() */
+
+
 /**********************************************************************
  * delete_index():  
  *  This function deletes an entry in the index linked list indexed by
@@ -479,8 +571,7 @@ int delete_index( REG_INDICES* lhead, int ifIndex, int del_type )
 	if ( curr->next->ifIndex == ifIndex ) {
 	  del_entry = curr->next;
 	  curr->next = curr->next->next;
-	  free( del_entry->full_index );
-	  free( del_entry );
+	  free_index( del_entry );
 	} /* end if */
 	else
 	  curr=curr->next;
@@ -494,8 +585,7 @@ int delete_index( REG_INDICES* lhead, int ifIndex, int del_type )
       {
 	del_entry = curr->next;
 	curr->next = curr->next->next;
-	free( del_entry->full_index );
-	free( del_entry );
+	free_index( del_entry );
       } /* end while */
   } /* end if */
 
@@ -509,6 +599,8 @@ int delete_index( REG_INDICES* lhead, int ifIndex, int del_type )
  *  This function searches the linked index list for a given index and
  *  returns a ptr to the element if it is an exact match, otherwise the 
  *  previous (smaller) index in the list is returned.
+ *  Exact matches are looked up in the hash table, only the insertion
+ *  point for a missing index requires a walk through the list.
  *                                   
  *  parameters:
  *  IN   index*       s_index    - index to search for 
@@ -521,19 +613,30 @@ int delete_index( REG_INDICES* lhead, int ifIndex, int del_type )
 int search_index ( char* s_index, REG_INDICES* lhead, REG_INDICES** curr  )
 {
 
-  int  oid_len1, oid_len2;
-  oid  ind_oid1[MAX_OID_LEN];           /* temporary net-snmp oids */
-  oid  ind_oid2[MAX_OID_LEN];
+  int  oid_len1;
+  oid  ind_oid1[MAX_OID_LEN];           /* temporary net-snmp oid */
+  REG_INDICES *hentry;
+
+  oid_len1 = str_to_oid_conv( (char*) s_index, ind_oid1 );
+
+  /* look for an exact match in the hash table first */
+  hentry = ind_hash[ind_hash_key( lhead, ind_oid1, oid_len1 )];
+  for ( ; hentry != NULL; hentry = hentry->hnext )
+    {
+      if ( hentry->head == lhead &&
+	   snmp_oid_compare( ind_oid1, oid_len1, hentry->ind_oid,
+			     hentry->ind_len ) == 0 ) {
+	*curr = hentry;
+	return INDEX_FOUND;
+      } /* end if */
+    } /* end for */
 
   /* loop through list and compare indices */
   for( *curr=lhead; (*curr)->next != NULL; *curr=(*curr)->next )    
     {
-      oid_len1 = str_to_oid_conv( (char*) s_index, ind_oid1 );
-      oid_len2 = str_to_oid_conv( (char*) (*curr)->next->full_index,
-				  ind_oid2 );
-
       switch
-        ( snmp_oid_compare( ind_oid1, oid_len1, ind_oid2, oid_len2 ) )
+        ( snmp_oid_compare( ind_oid1, oid_len1, (*curr)->next->ind_oid,
+			    (*curr)->next->ind_len ) )
         {
         case  0:      /* exact index match - curr->next points to entry */
           /* exact index match - curr-> points to entry */
@@ -1186,6 +1289,9 @@ void update_mib_info ()
 	char*        buffer;          /* a data buffer */
 
 
+	/* invalidate cached GET responses */
+	mib_generation++;
+
 	/* Retrieve ifNumber/ifIndex/ifDescr newly from IF-MIB for all interfaces */
 	/* retrieve data in temporary list first */
 	if_num = query_IF_MIB( &tmp_list );
@@ -1301,7 +1407,7 @@ void update_mib_info ()
 	    strcpy( ifr.ifr_name, if_list[i].if_Name );         /* add interface name */       
 	    ifr.ifr_ifru.ifru_data = (char*) buffer;            /* add data buffer    */ 
 	
-	    if ( ioctl( sd,SIOC_QETH_ADP_SET_SNMP_CONTROL, &ifr ) < 0 )
+	    if ( osa_snmp_ioctl( sd, &ifr ) < 0 )
 	      {
 		error_code = errno;
 		get_time( time_buf );
@@ -1458,6 +1564,60 @@ void update_mib_info ()
 } /* end update_mib_info */
 
 
+/**********************************************************************
+ * cmp_if_list():
+ *  Compare function for sorting and searching the interface list by
+ *  IF-MIB ifIndex.
+ *********************************************************************/
+static int cmp_if_list( const void* a, const void* b )
+{
+  const IF_LIST *if_a = a, *if_b = b;
+
+  if ( if_a->ifIndex < if_b->ifIndex )
+    return -1;
+  return if_a->ifIndex > if_b->ifIndex;
+
+} /* end cmp_if_list() */
+
+
+/**********************************************************************
+ * search_if_list():
+ *  Search the global interface list for an IF-MIB ifIndex.
+ *  parameters:
+ *  IN    int ifIndex   - IF-MIB ifIndex
+ *  returns: IF_LIST* - interface list entry
+ *           NULL     - ifIndex is not recorded in interface list
+ *********************************************************************/
+IF_LIST* search_if_list( int ifIndex )
+{
+  IF_LIST key;
+
+  if ( if_list == NULL || ifNumber <= 0 )
+    return NULL;
+
+  key.ifIndex = ifIndex;
+  return (IF_LIST*) bsearch( &key, if_list, ifNumber, sizeof(IF_LIST),
+			     cmp_if_list );
+
+} /* end search_if_list() */
+
+
+/**********************************************************************
+ * osa_snmp_ioctl_dev():
+ *  Default backend for SNMP control requests: issue the ioctl against
+ *  the OSA Express device named in ifr.
+ *  parameters:
+ *  IN    int sd             - socket descriptor
+ *  INOUT struct ifreq* ifr  - request structure for ioctl
+ *  returns: return code of ioctl()
+ *********************************************************************/
+int osa_snmp_ioctl_dev( int sd, struct ifreq* ifr )
+{
+  return ioctl( sd, SIOC_QETH_ADP_SET_SNMP_CONTROL, ifr );
+
+} /* end osa_snmp_ioctl_dev() */
+
+
 /**********************************************************************
  * query_IF_MIB():
  *  Retrieve ifIndex values for all OSA devices residing on this    
@@ -1671,7 +1831,12 @@ int query_IF_MIB ( IF_LIST** ifList )
   /* Cleanup */
   snmp_sess_close( sessp );
   if ( have_info )
-    return ( if_Number );
+    {
+      /* keep list sorted by ifIndex for search_if_list() */
+      if ( if_Number > 0 )
+	qsort( *ifList, if_Number, sizeof(IF_LIST), cmp_if_list );
+      return ( if_Number );
+    }
   else
     return -1;
 
@@ -1745,7 +1910,7 @@ int get_time( char* buffer )
 
 static const char* usage_text[] = {
 "Usage:  osasnmpd [-h] [-v] [-l LOGFILE] [-A] [-f] [-L] [-P PIDFILE]",
-"                 [-x SOCKADDR]",
+"                 [-x SOCKADDR] [-t SECONDS]",
 "",
 "-h, --help              This usage message",
 "-v, --version           Version information",
@@ -1755,6 +1920,8 @@ static const char* usage_text[] = {
 "-f, --nofork            Do not fork() from the calling shell",
 "-P, --pidfile PIDFILE   Save the process ID of the subagent in PIDFILE",
 "-x, --sockaddr SOCKADDR Bind AgentX port to this address",
+"-t, --cache-ttl SECONDS Cache OSA-E responses for SECONDS (default 5,",
+"                        0 disables the cache)",
 ""
 };
 
@@ -16,6 +16,7 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <math.h>
+#include <signal.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,6 +25,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <linux/if.h>
@@ -96,5 +98,17 @@ unsigned int query_OSA_EXP ( IF_LIST** ,int );
 /* get time of day */
 int get_time( char* );
 
+/* searches an interface in the global interface list */
+IF_LIST* search_if_list( int );
+
+/* issue SNMP control ioctl against an OSA Express device */
+int osa_snmp_ioctl_dev( int, struct ifreq* );
+
+/* SNMP control ioctl backend, can be replaced for testing */
+extern int (*osa_snmp_ioctl)( int, struct ifreq* );
+
+/* incremented whenever the MIB information is updated */
+extern volatile sig_atomic_t mib_generation;
+
 /* display help message */
 void usage();
@@ -103,10 +103,11 @@ static struct option longopts[] = {
 	{"logfile",required_argument,0,'l'},
 	{"pidfile",required_argument,0,'P'},
 	{"sockaddr",required_argument,0,'x'},
+	{"cache-ttl",required_argument,0,'t'},
 	{0,0,0,0}
 };
 
-#define OPTSTRING "hvALfl:A:P:x:"
+#define OPTSTRING "hvALfl:A:P:x:t:"
 
 /*
  * main routine
@@ -120,6 +121,8 @@ int main( int argc, char *argv[] )
 	FILE *PID;
 	struct sigaction act;
 	int res,c,longIndex,rc;
+	char *endptr;
+	long ttl;
 	unsigned char rel_a, rel_b, rel_c;
 	struct utsname buf;
 	char suffix[sizeof(buf.release)];
@@ -178,6 +181,18 @@ int main( int argc, char *argv[] )
 				netsnmp_ds_set_string(NETSNMP_DS_APPLICATION_ID,
 					NETSNMP_DS_AGENT_X_SOCKET, optarg);
 				break;
+			case 't':
+				errno = 0;
+				ttl = strtol(optarg, &endptr, 10);
+				if (errno || *endptr || ttl < 0 ||
+				    ttl > INT_MAX) {
+					fprintf(stderr, "osasnmpd: invalid "
+						"cache lifetime '%s'\n",
+						optarg);
+					exit(1);
+				}
+				get_cache_ttl = (int) ttl;
+				break;
 			default:
 				fprintf(stderr, "Try 'osasnmpd --help' for more"
 						" information.\n");
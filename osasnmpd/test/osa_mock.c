@@ -0,0 +1,123 @@
+/*
+ * osasnmpd - Test programs for the OSA-E subagent
+ *
+ * Mock backend for SNMP control ioctls that answers the requests of the
+ * subagent with canned IPAssists replies instead of an OSA-E card.
+ *
+ * The canned MIB consists of one table under MOCK_TOP_OID with
+ * MOCK_COLUMNS integer columns. Each interface registers the indices
+ * "<ifIndex>.<port>" for ports 1 to MOCK_PORTS.
+ *
+ * Copyright IBM Corp. 2020
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#include "osa_mock.h"
+
+int mock_reg_calls;
+int mock_get_calls;
+
+/*
+ * Value of a table cell as returned by GET requests
+ */
+int mock_value(int column, int ifIndex, int port)
+{
+	return column * 10000 + ifIndex * 100 + port;
+}
+
+/*
+ * Append string to REGISTER MIB reply, return position behind it
+ */
+static char *put_str(char *ptr, const char *str)
+{
+	strcpy(ptr, str);
+	return ptr + strlen(str) + 1;
+}
+
+/*
+ * Append integer to REGISTER MIB reply at the next 4-byte boundary
+ */
+static char *put_int(char *ptr, int val)
+{
+	ptr = (char *) (PTR_ALIGN4(ptr));
+	memcpy(ptr, &val, sizeof(val));
+	return ptr + sizeof(val);
+}
+
+/*
+ * Answer REGISTER MIB request in the layout parsed by register_tables()
+ */
+static int mock_reg(IPA_CMD_REG *reg)
+{
+	int ifIndex = reg->ioctl_cmd.ipa_cmd_hdr.ifIndex;
+	char str[MAX_OID_STR_LEN];
+	int column, port;
+	char *ptr;
+
+	mock_reg_calls++;
+	reg->table_cnt = 1;
+	ptr = (char *) reg + sizeof(IPA_CMD_REG);
+	ptr = (char *) (PTR_ALIGN4(ptr));
+	ptr = put_str(ptr, MOCK_TOP_OID);
+	ptr = put_int(ptr, MOCK_COLUMNS * MOCK_PORTS);
+	for (column = 1; column <= MOCK_COLUMNS; column++) {
+		for (port = 1; port <= MOCK_PORTS; port++) {
+			ptr = put_int(ptr, RONLY);
+			ptr = put_int(ptr, ASN_INTEGER);
+			sprintf(str, "1.%d", column);
+			ptr = put_str(ptr, str);
+			sprintf(str, "%d.%d", ifIndex, port);
+			ptr = put_str(ptr, str);
+		}
+	}
+	reg->ioctl_cmd.ipa_cmd_hdr.ret_code = IPA_SNMP_SUCCESS;
+	return 0;
+}
+
+/*
+ * Answer GET request for "<MOCK_TOP_OID>.1.<column>.<ifIndex>.<port>"
+ */
+static int mock_get(IPA_CMD_GET *cmd)
+{
+	size_t top_len = strlen(MOCK_TOP_OID);
+	int column, ifIndex, port, val;
+	IPA_GET_DATA *data;
+	char *ptr;
+
+	mock_get_calls++;
+	if (strncmp(cmd->full_oid, MOCK_TOP_OID, top_len) != 0 ||
+	    sscanf(cmd->full_oid + top_len, ".1.%d.%d.%d",
+		   &column, &ifIndex, &port) != 3 ||
+	    ifIndex != cmd->ioctl_cmd.ipa_cmd_hdr.ifIndex) {
+		cmd->ioctl_cmd.ipa_cmd_hdr.ret_code = IPA_SNMP_INV_INST;
+		return 0;
+	}
+	ptr = cmd->full_oid + strlen(cmd->full_oid) + 1;
+	data = (IPA_GET_DATA *) (PTR_ALIGN4(ptr));
+	val = mock_value(column, ifIndex, port);
+	data->len = sizeof(val);
+	memcpy(data->data, &val, sizeof(val));
+	cmd->ioctl_cmd.ipa_cmd_hdr.ret_code = IPA_SNMP_SUCCESS;
+	return 0;
+}
+
+/*
+ * Replacement for osa_snmp_ioctl_dev()
+ */
+int mock_ioctl(int sd, struct ifreq *ifr)
+{
+	IOCTL_CMD_HDR *hdr = (IOCTL_CMD_HDR *) ifr->ifr_ifru.ifru_data;
+
+	(void) sd;
+	switch (hdr->ipa_cmd_hdr.request) {
+	case IPA_REG_MIB:
+		return mock_reg((IPA_CMD_REG *) hdr);
+	case IPA_GET_OID:
+		return mock_get((IPA_CMD_GET *) hdr);
+	default:
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+}
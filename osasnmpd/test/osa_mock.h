@@ -0,0 +1,30 @@
+/*
+ * osasnmpd - Test programs for the OSA-E subagent
+ *
+ * Mock backend for SNMP control ioctls
+ *
+ * Copyright IBM Corp. 2020
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+
+#ifndef OSA_MOCK_H
+#define OSA_MOCK_H
+
+#include "ibmOSAMibUtil.h"
+
+/* Toplevel OID and column suffixes of the canned table */
+#define MOCK_TOP_OID	"1.3.6.1.4.1.2.6.188.1.4"
+#define MOCK_COLUMNS	2
+/* Ports (second index component) per interface */
+#define MOCK_PORTS	3
+
+/* Number of REGISTER MIB and GET requests answered by the mock */
+extern int mock_reg_calls;
+extern int mock_get_calls;
+
+int mock_value(int column, int ifIndex, int port);
+int mock_ioctl(int sd, struct ifreq *ifr);
+
+#endif /* OSA_MOCK_H */
@@ -0,0 +1,229 @@
+/*
+ * test_cache - Test program for the OSA-E subagent
+ *
+ * Test program to check the lookup of registered indices and the cache
+ * for GET responses with a mock backend for SNMP control ioctls
+ *
+ * Copyright IBM Corp. 2020
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include <assert.h>
+
+#include "osa_mock.h"
+#include "ibmOSAMib.h"
+
+/* defined in ibmOSAMib.c */
+extern TABLE_OID *oid_list_head;
+extern IF_LIST *if_list;
+extern int ifNumber;
+
+/* defined in osasnmpd.c */
+int proc_fd = -1;
+
+static IF_LIST interfaces[] = {
+	{ .ifIndex = 2, .if_Name = "eth0", .is_OSAEXP = TRUE },
+	{ .ifIndex = 5, .if_Name = "eth1", .is_OSAEXP = TRUE },
+	{ .ifIndex = 9, .if_Name = "eth2", .is_OSAEXP = TRUE },
+};
+#define IF_CNT (int) (sizeof(interfaces) / sizeof(interfaces[0]))
+
+/*
+ * Replacement for the net-snmp function, the test does not connect to a
+ * master agent
+ */
+int register_mib(const char *moduleName, const struct variable *var,
+		 size_t varsize, size_t numvars, const oid *mibloc,
+		 size_t mibloclen)
+{
+	(void) moduleName;
+	(void) var;
+	(void) varsize;
+	(void) numvars;
+	(void) mibloc;
+	(void) mibloclen;
+	return MIB_REGISTERED_OK;
+}
+
+/*
+ * Register the canned MIB data of all interfaces like init_ibmOSAMib()
+ */
+static void register_interfaces(void)
+{
+	IPA_CMD_REG *reg;
+	struct ifreq ifr;
+	char *buffer;
+	int i;
+
+	buffer = malloc(MIB_AREA_LEN);
+	assert(buffer != NULL);
+	oid_list_head = init_oid_list();
+	assert(oid_list_head != NULL);
+	for (i = 0; i < IF_CNT; i++) {
+		memset(buffer, 0, MIB_AREA_LEN);
+		reg = (IPA_CMD_REG *) buffer;
+		reg->ioctl_cmd.data_len = MIB_AREA_LEN -
+			offsetof(IOCTL_CMD_HDR, ipa_cmd_hdr);
+		reg->ioctl_cmd.req_len = sizeof(reg->ioctl_cmd);
+		reg->ioctl_cmd.ipa_cmd_hdr.request = IPA_REG_MIB;
+		reg->ioctl_cmd.ipa_cmd_hdr.ifIndex = interfaces[i].ifIndex;
+		strcpy(ifr.ifr_name, interfaces[i].if_Name);
+		ifr.ifr_ifru.ifru_data = (char *) buffer;
+		assert(osa_snmp_ioctl(-1, &ifr) == 0);
+		assert(register_tables(buffer, oid_list_head) == 0);
+	}
+	free(buffer);
+	assert(mock_reg_calls == IF_CNT);
+}
+
+/*
+ * Set up a registered variable for a column of the canned table
+ */
+static void init_var(struct variable *vp, int column)
+{
+	oid top[MAX_OID_LEN];
+	int len;
+
+	memset(vp, 0, sizeof(*vp));
+	len = str_to_oid_conv(MOCK_TOP_OID, top);
+	assert(len > 0);
+	memcpy(vp->name, top, len * sizeof(oid));
+	vp->name[len] = 1;
+	vp->name[len + 1] = column;
+	vp->namelen = len + 2;
+	vp->type = ASN_INTEGER;
+	vp->acl = RONLY;
+	vp->findVar = var_ibmOSAMib;
+}
+
+/*
+ * Issue a GET request for a table cell through var_ibmOSAMib()
+ *
+ * Returns the value or -1 if the cell does not exist.
+ */
+static long get(int column, int ifIndex, int port)
+{
+	WriteMethod *write_method;
+	oid name[MAX_OID_LEN];
+	struct variable vp;
+	size_t length, var_len;
+	unsigned char *val;
+
+	init_var(&vp, column);
+	memcpy(name, vp.name, vp.namelen * sizeof(oid));
+	name[vp.namelen] = ifIndex;
+	name[vp.namelen + 1] = port;
+	length = vp.namelen + 2;
+	val = var_ibmOSAMib(&vp, name, &length, 1, &var_len, &write_method);
+	return val ? *(long *) val : -1;
+}
+
+/*
+ * Read all cells of the canned table and check the values
+ */
+static void get_all(void)
+{
+	int i, column, port;
+	int ifIndex;
+
+	for (i = 0; i < IF_CNT; i++) {
+		ifIndex = interfaces[i].ifIndex;
+		for (column = 1; column <= MOCK_COLUMNS; column++) {
+			for (port = 1; port <= MOCK_PORTS; port++)
+				assert(get(column, ifIndex, port) ==
+				       mock_value(column, ifIndex, port));
+		}
+	}
+}
+
+static void test_index(void)
+{
+	WriteMethod *write_method;
+	oid name[MAX_OID_LEN];
+	struct variable vp;
+	size_t length, var_len;
+	REG_INDICES *ind;
+	int calls;
+
+	/* Exact lookups of all registered indices */
+	assert(search_index("5.2", oid_list_head->next->ind_list, &ind) ==
+	       INDEX_FOUND);
+	assert(ind->ifIndex == 5 && strcmp(ind->full_index, "5.2") == 0);
+	/* Missing index returns the previous one */
+	assert(search_index("5.7", oid_list_head->next->ind_list, &ind) ==
+	       INDEX_NOT_FOUND);
+	assert(strcmp(ind->full_index, "5.3") == 0);
+
+	/* Unregistered indices are rejected without a GET request */
+	calls = mock_get_calls;
+	assert(get(1, 5, MOCK_PORTS + 1) == -1);
+	assert(get(1, 3, 1) == -1);
+	assert(mock_get_calls == calls);
+
+	/* GETNEXT continues with the first port of the next interface */
+	init_var(&vp, 2);
+	memcpy(name, vp.name, vp.namelen * sizeof(oid));
+	name[vp.namelen] = 2;
+	name[vp.namelen + 1] = MOCK_PORTS;
+	length = vp.namelen + 2;
+	assert(var_ibmOSAMib(&vp, name, &length, 0, &var_len,
+			     &write_method) != NULL);
+	assert(length == (size_t) vp.namelen + 2);
+	assert(name[vp.namelen] == 5 && name[vp.namelen + 1] == 1);
+}
+
+static void test_cache(void)
+{
+	int cells = IF_CNT * MOCK_COLUMNS * MOCK_PORTS;
+	int calls;
+
+	/* Discard responses cached by previous tests. The first walk
+	 * queries the card, the second is answered from the cache */
+	get_cache_ttl = GET_CACHE_TTL;
+	mib_generation++;
+	calls = mock_get_calls;
+	get_all();
+	assert(mock_get_calls == calls + cells);
+	get_all();
+	assert(mock_get_calls == calls + cells);
+
+	/* An update of the MIB information invalidates the cache */
+	mib_generation++;
+	get_all();
+	assert(mock_get_calls == calls + 2 * cells);
+	get_all();
+	assert(mock_get_calls == calls + 2 * cells);
+
+	/* Without lifetime every request queries the card */
+	get_cache_ttl = 0;
+	get_all();
+	get_all();
+	assert(mock_get_calls == calls + 4 * cells);
+}
+
+static void test_delete(void)
+{
+	REG_INDICES *ind_list = oid_list_head->next->ind_list;
+	REG_INDICES *ind;
+
+	/* Removed indices must also disappear from the hash table */
+	assert(delete_index(ind_list, 5, IF_ENTRY) == 0);
+	assert(get(1, 5, 1) == -1);
+	assert(search_index("5.1", ind_list, &ind) == INDEX_NOT_FOUND);
+	assert(strcmp(ind->full_index, "2.3") == 0);
+	assert(get(1, 9, 1) == mock_value(1, 9, 1));
+}
+
+int main(void)
+{
+	if_list = interfaces;
+	ifNumber = IF_CNT;
+	osa_snmp_ioctl = mock_ioctl;
+
+	register_interfaces();
+	test_index();
+	test_cache();
+	test_delete();
+	return 0;
+}
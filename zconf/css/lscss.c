@@ -7,10 +7,14 @@
  * it under the terms of the MIT license. See LICENSE for details.
  */
 
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "lib/ccw.h"
+#include "lib/util_attr.h"
 #include "lib/util_base.h"
 #include "lib/util_file.h"
 #include "lib/util_libc.h"
@@ -45,6 +49,8 @@
 #define PREFIX_ID_LENGTH	4
 #define SHORT_ID_LENGTH		4
 #define CHPIDS_SEGMENT_LENGTH	8
+#define SCH_LINE_FIELDS		16	/* Maximum fields set for one entry */
+#define SCH_BATCH_SIZE		4096	/* Subchannels processed at once */
 
 /* Range of subchannel or device identifiers */
 struct range {
@@ -68,6 +74,30 @@ enum sch_type {
 	SUBCHANNEL_TYPE_EADM = 3,	/* EADM subchannels */
 };
 
+/* Subchannel attributes read by fill_sch_io() */
+enum sch_attr {
+	SCH_ATTR_PIMPAMPOM,	/* Path masks */
+	SCH_ATTR_CHPIDS,	/* Channel-path IDs */
+	SCH_ATTR_VPM,		/* Verified path mask, only for --vpm */
+	SCH_ATTR_COUNT,
+};
+
+/*
+ * Output line of one entry
+ *
+ * The field values are recorded in the order they are set and replayed
+ * into the util_rec by line_print(). This allows to fill in entries
+ * concurrently and to print them in order afterwards.
+ */
+struct sch_line {
+	bool print;		/* Entry is to be printed */
+	int count;		/* Number of recorded fields */
+	struct {
+		const char *key;	/* Field key */
+		char *val;		/* Field value */
+	} fld[SCH_LINE_FIELDS];
+};
+
 /*
  * Private data
  */
@@ -83,6 +113,8 @@ static struct lscss_cmd_opts {
 	bool opt_chsc;		/* --chsc */
 	bool opt_eadm;		/* --eadm */
 	bool opt_vfio;		/* --vfio */
+	/* Number of threads for reading subchannel information */
+	long int jobs;
 	/* List of device types for the output limitation */
 	int dev_count;
 	struct util_list *devtypes;
@@ -170,11 +202,51 @@ static struct util_opt opt_vec[] = {
 		.option = { "all", no_argument, NULL, 'a'},
 		.desc = "Show subchannels of all types",
 	},
+	{
+		.option = { "jobs", required_argument, NULL, 'j'},
+		.argument = "NUMBER",
+		.desc = "Read subchannel information using NUMBER threads",
+	},
 	UTIL_OPT_HELP,
 	UTIL_OPT_VERSION,
 	UTIL_OPT_END
 };
 
+/*
+ * Record a field value for an output line
+ */
+static void line_set(struct sch_line *line, const char *key,
+		     const char *fmt, ...)
+{
+	va_list ap;
+
+	util_assert(line->count < SCH_LINE_FIELDS,
+		    "Internal error: Too many fields for one entry");
+	line->fld[line->count].key = key;
+	va_start(ap, fmt);
+	util_vasprintf(&line->fld[line->count].val, fmt, ap);
+	va_end(ap);
+	line->count++;
+}
+
+/*
+ * Set the recorded field values in the record, print the record if
+ * requested and release the values
+ */
+static void line_print(struct sch_line *line, struct util_rec *rec)
+{
+	int i;
+
+	for (i = 0; i < line->count; i++) {
+		util_rec_set(rec, line->fld[i].key, "%s", line->fld[i].val);
+		free(line->fld[i].val);
+	}
+	if (line->print)
+		util_rec_print(rec);
+	line->count = 0;
+	line->print = false;
+}
+
 /*
  * Add new subchannel or device range to the ranges list for further output
  * limitation
@@ -307,24 +379,23 @@ static bool in_devtypes_list(char *dtype)
  * @returns 0 - devtype matches devtypes list, device information filled in
  *          1 - devtype does not match devtypes list, skip entry
  */
-static int fill_device_info(struct util_rec *rec, char *path, char *device)
+static int fill_device_info(struct sch_line *line, struct util_attr_dir *dev)
 {
 	unsigned long int val_ul;
 	char buf[MAX_BUF_SIZE];
 
-	if (!path || !device) {
+	if (!dev) {
 		if (cmd.opt_devtype && cmd.dev_count > 0)
 			return 1;
-		util_rec_set(rec, "devtyp", "");
-		util_rec_set(rec, "cutype", "");
-		util_rec_set(rec, "use", "");
+		line_set(line, "devtyp", "");
+		line_set(line, "cutype", "");
+		line_set(line, "use", "");
 		if (cmd.opt_avail)
-			util_rec_set(rec, "avail", "");
+			line_set(line, "avail", "");
 		return 0;
 	}
 
-	if (util_file_read_line(buf, sizeof(buf), "%s/%s/devtype",
-				path, device) == 0) {
+	if (util_attr_read_line(dev, buf, sizeof(buf), "devtype") == 0) {
 		if (strcmp(buf, "n/a") == 0)
 			/* Special case for 'n/a' devtype */
 			strncpy(buf, "0000/00", sizeof(buf));
@@ -333,49 +404,48 @@ static int fill_device_info(struct util_rec *rec, char *path, char *device)
 			return 1;
 		if (cmd.opt_uppercase)
 			util_str_toupper(buf);
-		util_rec_set(rec, "devtyp", "%s", buf);
+		line_set(line, "devtyp", "%s", buf);
 	} else {
 		if (cmd.opt_devtype && cmd.dev_count > 0)
 			return 1;
-		util_rec_set(rec, "devtyp", "");
+		line_set(line, "devtyp", "");
 	}
 
-	if (util_file_read_line(buf, sizeof(buf), "%s/%s/cutype",
-				path, device) == 0) {
+	if (util_attr_read_line(dev, buf, sizeof(buf), "cutype") == 0) {
 		if (cmd.opt_uppercase)
 			util_str_toupper(buf);
-		util_rec_set(rec, "cutype", "%s", buf);
+		line_set(line, "cutype", "%s", buf);
 	} else {
-		util_rec_set(rec, "cutype", "");
+		line_set(line, "cutype", "");
 	}
 
-	if (util_file_read_ul(&val_ul, 10, "%s/%s/online", path, device) == 0) {
+	if (util_attr_read_ul(dev, &val_ul, 10, "online") == 0) {
 		if (val_ul == 1) {
 			snprintf(buf, sizeof(buf), "yes");
 			if (cmd.opt_uppercase)
 				util_str_toupper(buf);
-			util_rec_set(rec, "use", "%s", buf);
+			line_set(line, "use", "%s", buf);
 		} else {
-			util_rec_set(rec, "use", "");
+			line_set(line, "use", "");
 		}
 	} else {
-		util_rec_set(rec, "use", "");
+		line_set(line, "use", "");
 	}
 
 	if (cmd.opt_avail) {
-		if (util_file_read_line(buf, sizeof(buf), "%s/%s/availability",
-					path, device) == 0) {
+		if (util_attr_read_line(dev, buf, sizeof(buf),
+					"availability") == 0) {
 			if (cmd.opt_uppercase)
 				util_str_toupper(buf);
-			util_rec_set(rec, "avail", "%s", buf);
+			line_set(line, "avail", "%s", buf);
 		} else {
-			util_rec_set(rec, "avail", "");
+			line_set(line, "avail", "");
 		}
 	}
 	return 0;
 }
 
-static bool is_sch_vfio(char *path)
+static bool is_sch_vfio(const char *path)
 {
 	char lnk[PATH_MAX], driver_path[PATH_MAX];
 	ssize_t rc;
@@ -400,7 +470,7 @@ static bool is_sch_vfio(char *path)
  * @returns 0 - MDEV id information filled in
  *          1 - skip entry
  */
-static int fill_vfio_devid(struct util_rec *rec, char *path)
+static int fill_vfio_devid(struct sch_line *line, const char *path)
 {
 	char *device, buf[MAX_BUF_SIZE];
 	struct dirent **de_vec;
@@ -419,7 +489,7 @@ static int fill_vfio_devid(struct util_rec *rec, char *path)
 	}
 	if (cmd.opt_uppercase)
 		util_str_toupper(buf);
-	util_rec_set(rec, "mdev", "%s", buf);
+	line_set(line, "mdev", "%s", buf);
 	util_scandir_free(de_vec, count);
 	return 0;
 }
@@ -430,14 +500,16 @@ static int fill_vfio_devid(struct util_rec *rec, char *path)
  * @returns 0 - CCW device id information filled in
  *          1 - skip entry
  */
-static int fill_io_devid(struct util_rec *rec, char *path)
+static int fill_io_devid(struct sch_line *line, struct util_attr_dir *sch)
 {
 	char *device, buf[MAX_BUF_SIZE];
+	struct util_attr_dir *dev;
 	struct dirent **de_vec;
-	int count;
+	int count, rc;
 
 	/* Find and process device directory */
-	count = util_scandir(&de_vec, alphasort, path, "%s", ID_FORMAT);
+	count = util_scandir(&de_vec, alphasort, util_attr_dir_path(sch), "%s",
+			     ID_FORMAT);
 	if (count > 0) {
 		device = de_vec[0]->d_name;
 		if (cmd.opt_short) {
@@ -454,7 +526,11 @@ static int fill_io_devid(struct util_rec *rec, char *path)
 			util_scandir_free(de_vec, count);
 			return 1;
 		}
-		if (fill_device_info(rec, path, device) != 0) {
+		dev = util_attr_dir_new();
+		util_attr_dir_open_at(dev, sch, device);
+		rc = fill_device_info(line, dev);
+		util_attr_dir_free(dev);
+		if (rc != 0) {
 			util_scandir_free(de_vec, count);
 			return 1;
 		}
@@ -464,20 +540,26 @@ static int fill_io_devid(struct util_rec *rec, char *path)
 			return 1;
 		}
 		strncpy(buf, "none", sizeof(buf));
-		fill_device_info(rec, NULL, NULL);
+		fill_device_info(line, NULL);
 	}
 	if (cmd.opt_uppercase)
 		util_str_toupper(buf);
-	util_rec_set(rec, "device", "%s", buf);
+	line_set(line, "device", "%s", buf);
 	util_scandir_free(de_vec, count);
 	return 0;
 }
 
 /*
- * Print IO subchannel entry
+ * Fill in IO subchannel entry
  */
-static void print_sch_io(struct util_rec *rec, char *path, char *sch_dir)
+static void fill_sch_io(struct sch_line *line, struct util_attr_dir *sch,
+			 char *sch_dir)
 {
+	struct util_attr attr_vec[] = {
+		[SCH_ATTR_PIMPAMPOM]	= { .name = "pimpampom" },
+		[SCH_ATTR_CHPIDS]	= { .name = "chpids" },
+		[SCH_ATTR_VPM]		= { .name = "vpm" },
+	};
 	unsigned int pim, pam, pom;
 	char buf[MAX_BUF_SIZE];
 
@@ -496,43 +578,48 @@ static void print_sch_io(struct util_rec *rec, char *path, char *sch_dir)
 		return;
 	if (cmd.opt_uppercase)
 		util_str_toupper(buf);
-	util_rec_set(rec, "subch", "%s", buf);
+	line_set(line, "subch", "%s", buf);
 	if (cmd.opt_vfio) {
-		if (fill_vfio_devid(rec, path) != 0)
+		if (fill_vfio_devid(line, util_attr_dir_path(sch)) != 0)
 			return;
-	} else if (fill_io_devid(rec, path) != 0)
+	} else if (fill_io_devid(line, sch) != 0)
 		return;
+	/* Read all required subchannel attributes at once */
+	util_attr_dir_read(sch, attr_vec, cmd.opt_vpm ? SCH_ATTR_COUNT :
+			   SCH_ATTR_VPM);
 	/* Fill in PIM-PAM-POM data */
-	if (util_file_read_line(buf, sizeof(buf), "%s/pimpampom", path) == 0) {
-		if (sscanf(buf, "%x %x %x", &pim, &pam, &pom) == 3) {
+	if (attr_vec[SCH_ATTR_PIMPAMPOM].value) {
+		if (sscanf(attr_vec[SCH_ATTR_PIMPAMPOM].value, "%x %x %x",
+			   &pim, &pam, &pom) == 3) {
 			if (cmd.opt_uppercase) {
-				util_rec_set(rec, "pim", "%02X", pim);
-				util_rec_set(rec, "pam", "%02X", pam);
-				util_rec_set(rec, "pom", "%02X", pom);
+				line_set(line, "pim", "%02X", pim);
+				line_set(line, "pam", "%02X", pam);
+				line_set(line, "pom", "%02X", pom);
 			} else {
-				util_rec_set(rec, "pim", "%02x", pim);
-				util_rec_set(rec, "pam", "%02x", pam);
-				util_rec_set(rec, "pom", "%02x", pom);
+				line_set(line, "pim", "%02x", pim);
+				line_set(line, "pam", "%02x", pam);
+				line_set(line, "pom", "%02x", pom);
 			}
 		} else {
-			util_rec_set(rec, "pim", "");
-			util_rec_set(rec, "pam", "");
-			util_rec_set(rec, "pom", "");
+			line_set(line, "pim", "");
+			line_set(line, "pam", "");
+			line_set(line, "pom", "");
 		}
 	} else {
-		util_rec_set(rec, "pim", "");
-		util_rec_set(rec, "pam", "");
-		util_rec_set(rec, "pom", "");
+		line_set(line, "pim", "");
+		line_set(line, "pam", "");
+		line_set(line, "pom", "");
 	}
 	/* Fill in VPM data */
 	if (cmd.opt_vpm) {
-		if (util_file_read_line(buf, sizeof(buf),
-					"%s/vpm", path) == 0) {
+		if (attr_vec[SCH_ATTR_VPM].value) {
+			util_strlcpy(buf, attr_vec[SCH_ATTR_VPM].value,
+				     sizeof(buf));
 			if (cmd.opt_uppercase)
 				util_str_toupper(buf);
-			util_rec_set(rec, "vpm", "%s", buf);
+			line_set(line, "vpm", "%s", buf);
 		} else {
-			util_rec_set(rec, "vpm", "");
+			line_set(line, "vpm", "");
 		}
 	}
 	/*
@@ -541,23 +628,24 @@ static void print_sch_io(struct util_rec *rec, char *path, char *sch_dir)
 	 * we first read it as a single string, then eliminate blanks from it
 	 * and then break in two 8-char segments.
 	 */
-	if (util_file_read_line(buf, sizeof(buf), "%s/chpids", path) == 0) {
+	if (attr_vec[SCH_ATTR_CHPIDS].value) {
+		util_strlcpy(buf, attr_vec[SCH_ATTR_CHPIDS].value, sizeof(buf));
 		misc_str_remove_symbol(buf, ' ');
 		if (cmd.opt_uppercase)
 			util_str_toupper(buf);
-		util_rec_set(rec, "chpids", "%.8s %.8s", buf,
+		line_set(line, "chpids", "%.8s %.8s", buf,
 			     buf + CHPIDS_SEGMENT_LENGTH);
 	} else {
-		util_rec_set(rec, "chpids", "");
+		line_set(line, "chpids", "");
 	}
 
-	util_rec_print(rec);
+	line->print = true;
 }
 
 /*
- * Print CHSC subchannel entry
+ * Fill in CHSC subchannel entry
  */
-static void print_sch_chsc(struct util_rec *rec, char *sch_dir)
+static void fill_sch_chsc(struct sch_line *line, char *sch_dir)
 {
 	char buf[MAX_BUF_SIZE];
 
@@ -580,20 +668,20 @@ static void print_sch_chsc(struct util_rec *rec, char *sch_dir)
 		return;
 	if (cmd.opt_uppercase)
 		util_str_toupper(buf);
-	util_rec_set(rec, "subch", "%s", buf);
+	line_set(line, "subch", "%s", buf);
 	/* Device field is always 'n/a' for CHSC */
 	strncpy(buf, "n/a", sizeof(buf));
 	if (cmd.opt_uppercase)
 		util_str_toupper(buf);
-	util_rec_set(rec, "device", "%s", buf);
+	line_set(line, "device", "%s", buf);
 
-	util_rec_print(rec);
+	line->print = true;
 }
 
 /*
- * Print EADM subchannel entry
+ * Fill in EADM subchannel entry
  */
-static void print_sch_eadm(struct util_rec *rec, char *sch_dir)
+static void fill_sch_eadm(struct sch_line *line, char *sch_dir)
 {
 	char buf[MAX_BUF_SIZE];
 
@@ -616,14 +704,14 @@ static void print_sch_eadm(struct util_rec *rec, char *sch_dir)
 		return;
 	if (cmd.opt_uppercase)
 		util_str_toupper(buf);
-	util_rec_set(rec, "subch", "%s", buf);
+	line_set(line, "subch", "%s", buf);
 	/* Device field is always 'n/a' for EADM */
 	strncpy(buf, "n/a", sizeof(buf));
 	if (cmd.opt_uppercase)
 		util_str_toupper(buf);
-	util_rec_set(rec, "device", "%s", buf);
+	line_set(line, "device", "%s", buf);
 
-	util_rec_print(rec);
+	line->print = true;
 }
 
 /*
@@ -631,18 +719,27 @@ static void print_sch_eadm(struct util_rec *rec, char *sch_dir)
  */
 static void print_defunct_devices(struct util_rec *rec, char *path)
 {
+	struct util_attr_dir *defunct, *dev;
 	char *device, buf[MAX_BUF_SIZE];
+	struct sch_line line;
 	struct dirent **de_vec;
 	int i, count;
 
 	/* Process all the devices within defunct directory */
 	count = util_scandir(&de_vec, alphasort, path, "%s", ID_FORMAT);
+	if (count <= 0) {
+		util_scandir_free(de_vec, count);
+		return;
+	}
+	defunct = util_attr_dir_new();
+	dev = util_attr_dir_new();
+	util_attr_dir_open(defunct, "%s", path);
 	for (i = 0; i < count; i++) {
 		device = de_vec[i]->d_name;
 		if (cmd.opt_short) {
 			/* Display only 0.0.xxxx devices for --short */
 			if (strncmp(device, "0.0.", PREFIX_ID_LENGTH) != 0)
-				return;
+				break;
 			snprintf(buf, sizeof(buf), "%s", device +
 				 strlen(device) - SHORT_ID_LENGTH);
 		} else {
@@ -652,66 +749,107 @@ static void print_defunct_devices(struct util_rec *rec, char *path)
 		   !id_in_ranges_list(device))
 			continue;
 
-		if (fill_device_info(rec, path, device) != 0)
+		memset(&line, 0, sizeof(line));
+		util_attr_dir_open_at(dev, defunct, device);
+		if (fill_device_info(&line, dev) != 0) {
+			line_print(&line, rec);
 			continue;
+		}
 
 		if (cmd.opt_uppercase)
 			util_str_toupper(buf);
-		util_rec_set(rec, "device", "%s", buf);
+		line_set(&line, "device", "%s", buf);
 		/* Subchannel field is always 'n/a' for defunct devices */
 		strncpy(buf, "n/a", sizeof(buf));
 		if (cmd.opt_uppercase)
 			util_str_toupper(buf);
-		util_rec_set(rec, "subch", "%s", buf);
+		line_set(&line, "subch", "%s", buf);
 		/* Other fields are blank */
-		util_rec_set(rec, "pim", "");
-		util_rec_set(rec, "pam", "");
-		util_rec_set(rec, "pom", "");
+		line_set(&line, "pim", "");
+		line_set(&line, "pam", "");
+		line_set(&line, "pom", "");
 		if (cmd.opt_vpm)
-			util_rec_set(rec, "vpm", "");
-		util_rec_set(rec, "chpids", "");
+			line_set(&line, "vpm", "");
+		line_set(&line, "chpids", "");
 
-		util_rec_print(rec);
+		line.print = true;
+		line_print(&line, rec);
 	}
+	util_attr_dir_free(dev);
+	util_attr_dir_free(defunct);
 	util_scandir_free(de_vec, count);
 }
 
+/* Parameters for fill_sch() */
+struct fill_sch_data {
+	enum sch_type type_requested;	/* Subchannel type to print */
+	struct dirent **de_vec;		/* Subchannel directory entries */
+	struct sch_line *lines;		/* Output lines of the entries */
+};
+
+/*
+ * Fill in subchannel entry if it has the requested type
+ *
+ * Called concurrently for different entries with --jobs.
+ */
+static void fill_sch(struct util_attr_dir *sch, int idx, void *data)
+{
+	struct fill_sch_data *sch_data = data;
+	char *sch_dir = sch_data->de_vec[idx]->d_name;
+	struct sch_line *line = &sch_data->lines[idx];
+	unsigned long int type_ul;
+
+	if (util_attr_read_ul(sch, &type_ul, 10, "type") == 0) {
+		if (type_ul != sch_data->type_requested)
+			return;
+		if (type_ul == SUBCHANNEL_TYPE_IO)
+			fill_sch_io(line, sch, sch_dir);
+		else if (type_ul == SUBCHANNEL_TYPE_CHSC)
+			fill_sch_chsc(line, sch_dir);
+		else if (type_ul == SUBCHANNEL_TYPE_EADM)
+			fill_sch_eadm(line, sch_dir);
+	} else {
+	/*
+	 * Subchannels with no type identifier treated as
+	 * IO subchannels
+	 */
+		if (sch_data->type_requested == SUBCHANNEL_TYPE_IO)
+			fill_sch_io(line, sch, sch_dir);
+	}
+}
+
 /*
  * Loop through subchannel directories and print entries of specified type
+ *
+ * The subchannels are processed in batches of SCH_BATCH_SIZE entries. The
+ * entries of a batch are distributed over cmd.jobs threads and the
+ * resulting lines are printed in directory order afterwards, so the
+ * output does not depend on the number of jobs.
  */
 static void print_subchannels_of_type(enum sch_type type_requested,
 				      struct util_rec *rec)
 {
-	unsigned long int type_ul;
+	struct fill_sch_data sch_data = {
+		.type_requested = type_requested,
+	};
 	struct dirent **de_vec;
-	char *path, *sch_dir;
-	int i, count;
+	int i, j, n, count;
+	char *path;
 
 	path = util_path_sysfs("bus/css/devices");
 	count = util_scandir(&de_vec, alphasort, path, "%s", ID_FORMAT);
-	free(path);
-	for (i = 0; i < count; i++) {
-		sch_dir = de_vec[i]->d_name;
-		path = util_path_sysfs("bus/css/devices/%s", sch_dir);
-		if (util_file_read_ul(&type_ul, 10, "%s/type", path) == 0) {
-			if (type_ul != type_requested)
-				continue;
-			if (type_ul == SUBCHANNEL_TYPE_IO)
-				print_sch_io(rec, path, sch_dir);
-			else if (type_ul == SUBCHANNEL_TYPE_CHSC)
-				print_sch_chsc(rec, sch_dir);
-			else if (type_ul == SUBCHANNEL_TYPE_EADM)
-				print_sch_eadm(rec, sch_dir);
-		} else {
-		/*
-		 * Subchannels with no type identifier treated as
-		 * IO subchannels
-		 */
-			if (type_requested == SUBCHANNEL_TYPE_IO)
-				print_sch_io(rec, path, sch_dir);
-		}
-		free(path);
+	sch_data.lines = util_malloc(sizeof(struct sch_line) * SCH_BATCH_SIZE);
+	for (i = 0; i < count; i += n) {
+		n = MIN(count - i, SCH_BATCH_SIZE);
+		memset(sch_data.lines, 0, sizeof(struct sch_line) * n);
+		sch_data.de_vec = &de_vec[i];
+		util_attr_dir_foreach(path, sch_data.de_vec, n, cmd.jobs,
+				      fill_sch, &sch_data);
+		for (j = 0; j < n; j++)
+			line_print(&sch_data.lines[j], rec);
 	}
+	free(sch_data.lines);
+	free(path);
 	util_scandir_free(de_vec, count);
 	/* Process defunct devices (if no subchannel range is specified) */
 	if (!cmd.opt_devrange && cmd.rng_count > 0)
@@ -811,9 +949,10 @@ static void cmd_lscss(void)
 int main(int argc, char *argv[])
 {
 	char *id_from, *id_to, *id_list = NULL;
-	char *dtype, *dtype_list = NULL;
+	char *dtype, *dtype_list = NULL, *endp;
 	int c, i;
 
+	cmd.jobs = 1;
 	util_prg_init(&prg);
 	util_opt_init(opt_vec, NULL);
 
@@ -865,6 +1004,15 @@ int main(int argc, char *argv[])
 			cmd.opt_chsc = true;
 			cmd.opt_eadm = true;
 			break;
+		case 'j':
+			errno = 0;
+			cmd.jobs = strtol(optarg, &endp, 0);
+			if (*optarg == '\0' || *endp != '\0' ||
+			    cmd.jobs <= 0 || cmd.jobs > INT_MAX ||
+			    errno == ERANGE)
+				errx(EXIT_FAILURE, "Invalid value for '--jobs'|'-j': "
+				     "'%s'", optarg);
+			break;
 		default:
 			util_opt_print_parse_error(c, argv);
 			return EXIT_FAILURE;
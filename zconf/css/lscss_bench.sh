@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# lscss_bench.sh - Benchmark lscss and lszdev on a synthetic sysfs tree
+#
+# Usage: lscss_bench.sh [DEVICES] [JOBS...]
+#
+# Create a sysfs tree with DEVICES (default 10000) I/O subchannels, each
+# with one online DASD, and measure the run time of "lscss --jobs JOBS"
+# for each JOBS value (default 1 2 4 8) and of "lszdev". The output of
+# each lscss run is compared to the output with one job.
+#
+# Copyright IBM Corp. 2020
+#
+# s390-tools is free software; you can redistribute it and/or modify
+# it under the terms of the MIT license. See LICENSE for details.
+#
+
+DEVICES=${1:-10000}
+[ $# -gt 0 ] && shift
+JOBS=${*:-1 2 4 8}
+LSCSS=${LSCSS:-./lscss}
+LSZDEV=${LSZDEV:-../../zdev/src/lszdev}
+
+root=`mktemp -d /tmp/lscss_bench.XXXXXX` || exit 1
+trap "rm -rf $root" EXIT TERM INT
+
+# Write value $2 to attribute file $1
+attr() {
+	echo "$2" > "$1"
+}
+
+now_ms() {
+	echo $((`date +%s%N` / 1000000))
+}
+
+echo "Creating $DEVICES devices in $root"
+sys=$root/sys
+mkdir -p $sys/bus/css/devices $sys/bus/ccw/devices \
+	 $sys/bus/ccw/drivers/dasd-eckd $sys/devices/css0 $root/proc
+touch $root/proc/cio_ignore
+i=0
+while [ $i -lt $DEVICES ]; do
+	id=`printf "0.%x.%04x" $((i / 65536)) $((i % 65536))`
+	sch=$sys/devices/css0/$id
+	dev=$sch/$id
+	mkdir -p $dev
+	attr $sch/type 0
+	attr $sch/pimpampom "80 80 ff"
+	attr $sch/chpids "`printf %02x $((i % 256))` 00 00 00 00 00 00 00"
+	attr $sch/vpm 80
+	attr $dev/devtype 3390/0c
+	attr $dev/cutype 3990/e9
+	attr $dev/online 1
+	attr $dev/availability good
+	ln -s $sch $sys/bus/css/devices/$id
+	ln -s $dev $sys/bus/ccw/devices/$id
+	ln -s $dev $sys/bus/ccw/drivers/dasd-eckd/$id
+	i=$((i + 1))
+done
+
+printf "%-20s %10s\n" "command" "time [ms]"
+for j in $JOBS; do
+	start=`now_ms`
+	SYSFS_ROOT=$sys $LSCSS --jobs $j --vpm --avail > $root/out.$j
+	end=`now_ms`
+	printf "%-20s %10d\n" "lscss --jobs $j" $((end - start))
+	if [ ! -f $root/out.ref ]; then
+		mv $root/out.$j $root/out.ref
+	elif ! cmp -s $root/out.ref $root/out.$j; then
+		echo "Output of lscss --jobs $j differs" >&2
+		exit 1
+	fi
+done
+
+if [ -x $LSZDEV ]; then
+	start=`now_ms`
+	$LSZDEV --base /=$root/ dasd-eckd > /dev/null
+	end=`now_ms`
+	printf "%-20s %10d\n" "lszdev" $((end - start))
+fi
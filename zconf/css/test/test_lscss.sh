@@ -0,0 +1,214 @@
+#!/bin/sh
+#
+# test_lscss.sh - Test program for lscss
+#
+# Creates a synthetic sysfs tree with I/O, CHSC and EADM subchannels and
+# defunct devices, uses it through SYSFS_ROOT and compares the output of
+# lscss with the expected output for several options and numbers of jobs.
+#
+# Copyright IBM Corp. 2020
+#
+# s390-tools is free software; you can redistribute it and/or modify
+# it under the terms of the MIT license. See LICENSE for details.
+#
+
+LSCSS=${LSCSS:-../lscss}
+
+tmp=`mktemp -d /tmp/test_lscss.XXXXXX` || exit 1
+trap "rm -rf $tmp" EXIT
+trap "exit 1" TERM INT
+
+sys=$tmp/sys
+SYSFS_ROOT=$sys
+export SYSFS_ROOT
+
+fail() {
+	echo "$*" >&2
+	exit 1
+}
+
+# Write value $2 to attribute file $1
+attr() {
+	echo "$2" > "$1"
+}
+
+# Create subchannel $1 of type $2 (no type attribute if empty)
+sch() {
+	mkdir -p $sys/devices/css0/$1
+	[ -n "$2" ] && attr $sys/devices/css0/$1/type $2
+	ln -s ../../../devices/css0/$1 $sys/bus/css/devices/$1
+}
+
+# Set path attributes $2 (pimpampom), $3 (chpids) and $4 (vpm) of
+# subchannel $1
+paths() {
+	attr $sys/devices/css0/$1/pimpampom "$2"
+	attr $sys/devices/css0/$1/chpids "$3"
+	attr $sys/devices/css0/$1/vpm "$4"
+}
+
+# Create device $2 with type $3, CU type $4, online state $5 and
+# availability $6 in directory $1
+dev() {
+	d=$1/$2
+	mkdir -p $d
+	attr $d/devtype $3
+	attr $d/cutype $4
+	attr $d/online $5
+	attr $d/availability $6
+}
+
+mkdir -p $sys/bus/css/devices $sys/devices/css0/defunct
+# I/O subchannels
+sch 0.0.0000 0
+paths 0.0.0000 "c0 c0 ff" "10 11 00 00 00 00 00 00" c0
+dev $sys/devices/css0/0.0.0000 0.0.1000 3390/0c 3990/e9 1 good
+sch 0.0.0001 0
+paths 0.0.0001 "80 80 ff" "2a 00 00 00 00 00 00 00" 80
+dev $sys/devices/css0/0.0.0001 0.0.1001 3390/0c 3990/e9 0 good
+sch 0.0.0002 0
+paths 0.0.0002 "80 00 ff" "2b 00 00 00 00 00 00 00" 00
+dev $sys/devices/css0/0.0.0002 0.0.f5f0 1732/01 1731/01 1 "no device"
+# I/O subchannels without device and without type attribute
+sch 0.0.0003 0
+paths 0.0.0003 "80 80 ff" "2c 00 00 00 00 00 00 00" 80
+sch 0.0.0004
+paths 0.0.0004 "80 80 ff" "2d 00 00 00 00 00 00 00" 80
+dev $sys/devices/css0/0.0.0004 0.0.2000 3480/00 3490/50 0 good
+# I/O subchannel without path attributes
+sch 0.0.0006 0
+dev $sys/devices/css0/0.0.0006 0.0.5000 3390/0c 3990/e9 1 good
+sch 0.1.0005 0
+paths 0.1.0005 "80 80 ff" "2e 00 00 00 00 00 00 00" 80
+dev $sys/devices/css0/0.1.0005 0.1.3000 3390/0c 3990/e9 1 good
+# CHSC and EADM subchannels
+sch 0.0.ff00 1
+sch 0.0.ff40 3
+sch 0.1.ff40 3
+# defunct devices
+dev $sys/devices/css0/defunct 0.0.4000 3390/0c 3990/e9 0 "no path"
+dev $sys/devices/css0/defunct 0.1.4001 3390/0c 3990/e9 0 "no path"
+dev $sys/devices/css0/defunct 0.2.4002 3390/0c 3990/e9 0 "no path"
+
+# Run lscss with options $@ and compare the output with stdin
+check() {
+	cat > $tmp/expected
+	for jobs in 1 3; do
+		# util_rec pads the last column with blanks
+		$LSCSS --jobs $jobs "$@" > $tmp/out 2>&1 ||
+			fail "lscss $* --jobs $jobs failed"
+		sed -i 's/ *$//' $tmp/out
+		if ! cmp -s $tmp/expected $tmp/out; then
+			diff -u $tmp/expected $tmp/out >&2
+			fail "lscss $* --jobs $jobs: unexpected output"
+		fi
+	done
+}
+
+check <<'EOT'
+Device   Subchan.  DevType CU Type Use  PIM PAM POM  CHPIDs
+----------------------------------------------------------------------
+0.0.1000 0.0.0000  3390/0c 3990/e9 yes  c0  c0  ff   10110000 00000000
+0.0.1001 0.0.0001  3390/0c 3990/e9      80  80  ff   2a000000 00000000
+0.0.f5f0 0.0.0002  1732/01 1731/01 yes  80  00  ff   2b000000 00000000
+none     0.0.0003                       80  80  ff   2c000000 00000000
+0.0.2000 0.0.0004  3480/00 3490/50      80  80  ff   2d000000 00000000
+0.0.5000 0.0.0006  3390/0c 3990/e9 yes
+0.1.3000 0.1.0005  3390/0c 3990/e9 yes  80  80  ff   2e000000 00000000
+0.0.4000 n/a       3390/0c 3990/e9
+0.1.4001 n/a       3390/0c 3990/e9
+0.2.4002 n/a       3390/0c 3990/e9
+EOT
+
+check --vpm --avail <<'EOT'
+Device   Subchan.  DevType CU Type Use  PIM PAM POM VPM CHPIDs            Avail.
+--------------------------------------------------------------------------------
+0.0.1000 0.0.0000  3390/0c 3990/e9 yes  c0  c0  ff  c0  10110000 00000000 good
+0.0.1001 0.0.0001  3390/0c 3990/e9      80  80  ff  80  2a000000 00000000 good
+0.0.f5f0 0.0.0002  1732/01 1731/01 yes  80  00  ff  00  2b000000 00000000 no
+none     0.0.0003                       80  80  ff  80  2c000000 00000000
+0.0.2000 0.0.0004  3480/00 3490/50      80  80  ff  80  2d000000 00000000 good
+0.0.5000 0.0.0006  3390/0c 3990/e9 yes                                    good
+0.1.3000 0.1.0005  3390/0c 3990/e9 yes  80  80  ff  80  2e000000 00000000 good
+0.0.4000 n/a       3390/0c 3990/e9                                        no
+0.1.4001 n/a       3390/0c 3990/e9                                        no
+0.2.4002 n/a       3390/0c 3990/e9                                        no
+EOT
+
+# Only 0.0.xxxx devices are shown, the scan of the defunct devices stops
+# at the first other one
+check --short <<'EOT'
+Device   Subchan.  DevType CU Type Use  PIM PAM POM  CHPIDs
+----------------------------------------------------------------------
+1000     0000      3390/0c 3990/e9 yes  c0  c0  ff   10110000 00000000
+1001     0001      3390/0c 3990/e9      80  80  ff   2a000000 00000000
+f5f0     0002      1732/01 1731/01 yes  80  00  ff   2b000000 00000000
+none     0003                           80  80  ff   2c000000 00000000
+2000     0004      3480/00 3490/50      80  80  ff   2d000000 00000000
+5000     0006      3390/0c 3990/e9 yes
+4000     n/a       3390/0c 3990/e9
+EOT
+
+check --uppercase --devrange 0.0.1000-0.0.1fff <<'EOT'
+Device   Subchan.  DevType CU Type Use  PIM PAM POM  CHPIDs
+----------------------------------------------------------------------
+0.0.1000 0.0.0000  3390/0C 3990/E9 YES  C0  C0  FF   10110000 00000000
+0.0.1001 0.0.0001  3390/0C 3990/E9      80  80  FF   2A000000 00000000
+EOT
+
+check --devrange 0.0.1001,0.1.3000 <<'EOT'
+Device   Subchan.  DevType CU Type Use  PIM PAM POM  CHPIDs
+----------------------------------------------------------------------
+0.0.1001 0.0.0001  3390/0c 3990/e9      80  80  ff   2a000000 00000000
+0.1.3000 0.1.0005  3390/0c 3990/e9 yes  80  80  ff   2e000000 00000000
+EOT
+
+check --chsc --eadm --short <<'EOT'
+
+CHSC Subchannels:
+Device   Subchan.
+------------------
+n/a      ff00
+4000     n/a
+
+EADM Subchannels:
+Device   Subchan.
+------------------
+n/a      ff40
+4000     n/a
+EOT
+
+check --all <<'EOT'
+IO Subchannels and Devices:
+Device   Subchan.  DevType CU Type Use  PIM PAM POM  CHPIDs
+----------------------------------------------------------------------
+0.0.1000 0.0.0000  3390/0c 3990/e9 yes  c0  c0  ff   10110000 00000000
+0.0.1001 0.0.0001  3390/0c 3990/e9      80  80  ff   2a000000 00000000
+0.0.f5f0 0.0.0002  1732/01 1731/01 yes  80  00  ff   2b000000 00000000
+none     0.0.0003                       80  80  ff   2c000000 00000000
+0.0.2000 0.0.0004  3480/00 3490/50      80  80  ff   2d000000 00000000
+0.0.5000 0.0.0006  3390/0c 3990/e9 yes
+0.1.3000 0.1.0005  3390/0c 3990/e9 yes  80  80  ff   2e000000 00000000
+0.0.4000 n/a       3390/0c 3990/e9
+0.1.4001 n/a       3390/0c 3990/e9
+0.2.4002 n/a       3390/0c 3990/e9
+
+CHSC Subchannels:
+Device   Subchan.
+------------------
+n/a      0.0.ff00
+0.0.4000 n/a
+0.1.4001 n/a
+0.2.4002 n/a
+
+EADM Subchannels:
+Device   Subchan.
+------------------
+n/a      0.0.ff40
+n/a      0.1.ff40
+0.0.4000 n/a
+0.1.4001 n/a
+0.2.4002 n/a
+EOT
+
+exit 0
@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# test_zcryptstats.sh - Test program for zcryptstats
+#
+# Uses the fake CHSC backend to check that measurement data that spans
+# several CHSC responses is processed, that the data published by a daemon
+# reaches an attached instance, and that the daemon never removes a file
+# at the socket path that is not a socket.
+#
+# Copyright IBM Corp. 2020
+#
+# s390-tools is free software; you can redistribute it and/or modify
+# it under the terms of the MIT license. See LICENSE for details.
+#
+
+ZCRYPTSTATS=${ZCRYPTSTATS:-../zcryptstats}
+# 3 cards with 200 domains each do not fit into one CHSC response
+ZCRYPTSTATS_FAKE_CHSC=3:200
+export ZCRYPTSTATS_FAKE_CHSC
+
+tmp=`mktemp -d /tmp/test_zcryptstats.XXXXXX` || exit 1
+trap "rm -rf $tmp" EXIT
+trap "exit 1" TERM INT
+
+fail() {
+	echo "$*" >&2
+	exit 1
+}
+
+# Print the device IDs of a CSV report
+devices() {
+	grep -v ^TIMESTAMP $1 | cut -d, -f2 | sort -u
+}
+
+# Expected device IDs: all cards and APQNs of the fake backend
+card=0
+while [ $card -lt 3 ]; do
+	printf "%02x\n" $card
+	domain=0
+	while [ $domain -lt 200 ]; do
+		printf "%02x.%04x\n" $card $domain
+		domain=$((domain + 1))
+	done
+	card=$((card + 1))
+done | sort > $tmp/expected
+
+# Measurement data that spans several CHSC responses
+timeout 30 $ZCRYPTSTATS --all --interval 1 --count 2 --output CSV \
+	> $tmp/local || fail "zcryptstats failed or did not terminate"
+devices $tmp/local | cmp -s - $tmp/expected ||
+	fail "zcryptstats did not report all devices"
+
+# A file that is not a socket is not removed
+touch $tmp/file
+timeout 30 $ZCRYPTSTATS --daemon --socket $tmp/file --all --interval 1 \
+	--count 1 2> /dev/null && fail "zcryptstats --daemon used a regular file"
+[ -f $tmp/file ] || fail "zcryptstats --daemon removed a regular file"
+mkdir $tmp/dir
+timeout 30 $ZCRYPTSTATS --daemon --socket $tmp/dir --all --interval 1 \
+	--count 1 2> /dev/null && fail "zcryptstats --daemon used a directory"
+[ -d $tmp/dir ] || fail "zcryptstats --daemon removed a directory"
+
+# Daemon and attached instance
+timeout 30 $ZCRYPTSTATS --daemon --socket $tmp/socket --all --interval 1 \
+	--count 5 &
+daemon=$!
+i=0
+while [ ! -S $tmp/socket ]; do
+	i=$((i + 1))
+	[ $i -gt 50 ] && fail "zcryptstats --daemon did not create the socket"
+	sleep 0.1
+done
+timeout 30 $ZCRYPTSTATS --attach --socket $tmp/socket --all --count 2 \
+	--output CSV > $tmp/attach || fail "zcryptstats --attach failed"
+devices $tmp/attach | cmp -s - $tmp/expected ||
+	fail "zcryptstats --attach did not report all devices"
+wait $daemon || fail "zcryptstats --daemon failed"
+[ -e $tmp/socket ] && fail "zcryptstats --daemon did not remove the socket"
+
+exit 0
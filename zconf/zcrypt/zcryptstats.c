@@ -12,6 +12,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <locale.h>
+#include <poll.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -19,9 +20,13 @@
 #include <time.h>
 #include <asm/chsc.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <sys/un.h>
 #include <sys/utsname.h>
+#include <unistd.h>
 
 #include "lib/util_base.h"
 #include "lib/util_file.h"
@@ -50,6 +55,10 @@
 #define NUM_CARDS_OLD			64
 #define NUM_CARDS			256
 #define NUM_DOMAINS			256
+#define SOCKET_FILE			"/run/zcryptstats_socket"
+#define MAX_CLIENTS			64
+#define CLIENT_SEND_TIMEOUT		2
+#define FAKE_CHSC_ENV			"ZCRYPTSTATS_FAKE_CHSC"
 
 #define MASK_WORD_BITS			(sizeof(uint32_t) * 8)
 #define MASK_WORD_NO(n)			((n) / MASK_WORD_BITS)
@@ -137,6 +146,32 @@ struct chsc_cmb_area {
 	struct chsc_cmb_entry entries[32];
 } __packed;
 
+/*
+ * Measurement snapshot published by the daemon. The header is followed by
+ * 'length' bytes of CMBs of all devices that have been updated in the
+ * interval, in the format returned by the CHSC.
+ */
+#define SNAPSHOT_MAGIC		"ZCRYSNAP"
+#define SNAPSHOT_MAGIC_LEN	8
+#define SNAPSHOT_VERSION	1
+
+struct snapshot_hdr {
+	char magic[SNAPSHOT_MAGIC_LEN];
+	uint32_t version;
+	uint32_t interval;
+	u64 seq;
+	u64 tv_sec;
+	u64 tv_usec;
+	uint32_t num_cmbs;
+	uint32_t length;
+} __packed;
+
+struct snapshot {
+	struct snapshot_hdr hdr;
+	char *data;
+	size_t size;
+};
+
 #define CRYPTO_TYPE_PCICC	3
 #define CRYPTO_TYPE_PCICA	4
 #define CRYPTO_TYPE_PCIXCC	5
@@ -457,7 +492,16 @@ static struct zcryptstats_globals {
 	bool all;
 	bool only_online;
 	bool verbose;
+	bool interval_set;
+	bool daemon;
+	bool attach;
+	const char *socket_file;
 	int chsc_fd;
+	int sock_fd;
+	unsigned long chsc_requests;
+	unsigned int fake_cards;
+	unsigned int fake_domains;
+	struct snapshot snapshot;
 	uint8_t max_card_used;
 	uint32_t card_mask[8];
 	uint8_t min_card;
@@ -475,7 +519,9 @@ static struct zcryptstats_globals {
 	bool first_counter;
 } g = {
 	.interval = 10,
+	.socket_file = SOCKET_FILE,
 	.chsc_fd = -1,
+	.sock_fd = -1,
 	.print_funcs = &default_print,
 };
 
@@ -568,6 +614,30 @@ static struct util_opt opt_vec[] = {
 			"(APQNs). This option can not be specified together "
 			"with option --all"
 	},
+	{
+		.option = {"daemon", 0, NULL, 'D'},
+		.desc = "Obtains the measurement data once per interval and "
+			"publishes it to other zcryptstats instances that are "
+			"started with option --attach, instead of displaying "
+			"it. Runs until stopped with control-C or SIGTERM, or "
+			"until COUNT intervals have elapsed. This option can "
+			"not be specified together with option --attach or "
+			"option --output",
+	},
+	{
+		.option = {"attach", 0, NULL, 'X'},
+		.desc = "Displays the measurement data published by a "
+			"zcryptstats daemon instead of obtaining it from the "
+			"system. If option --interval is omitted, a report is "
+			"displayed for each interval of the daemon",
+	},
+	{
+		.option = {"socket", required_argument, NULL, 'S'},
+		.argument = "PATH",
+		.desc = "Specifies the Unix domain socket to be used with "
+			"options --daemon and --attach. If omitted, "
+			SOCKET_FILE " is used",
+	},
 	{
 		.option = {"verbose", 0, NULL, 'V'},
 		.desc = "Prints additional information messages during "
@@ -987,6 +1057,11 @@ static bool filter_device(uint8_t card, uint8_t domain, bool is_apqn)
 	struct device_selection *dev;
 	bool found;
 
+	if (is_apqn && g.no_apqn) {
+		pr_verbose("Skipping APQN %02x.%04x (no-apqn)", card, domain);
+		return false;
+	}
+
 	/* Check for selection mask */
 	if ((g.card_mask[MASK_WORD_NO(card)] &
 				MASK_BIT(card)) == 0) {
@@ -1142,6 +1217,126 @@ static int chsc_error_from_response(int response)
 	}
 }
 
+/*
+ * Length of the CMBs reported by the fake CHSC backend: Header and two
+ * counters of a CCA co-processor.
+ */
+#define FAKE_CMB_LEN	offsetofend(struct chsc_cmb_area, entries[1])
+#define FAKE_CMB_MODE	9
+
+/*
+ * Fill a CMB of the fake CHSC backend for a card (domain < 0) or an APQN.
+ * The counters increase at a constant rate derived from the time of day, so
+ * that all instances report the same values at the same time.
+ */
+static void fake_chsc_cmb(struct chsc_cmb_area *cmb, uint8_t card, int domain)
+{
+	struct timeval tv;
+	u64 ms, rate;
+
+	memset(cmb, 0, FAKE_CMB_LEN);
+	cmb->header.ct = CRYPTO_TYPE_CEX7S;
+	cmb->header.format = domain >= 0 ? 1 : 0;
+	cmb->header.ax = card;
+	cmb->header.dx = domain >= 0 ? domain : 0;
+	cmb->header.mt = FAKE_CMB_MODE;
+	cmb->header.s = 0.000001;
+	cmb->header.v = 0xc0000000;
+	cmb->header.l4 = FAKE_CMB_LEN;
+
+	gettimeofday(&tv, NULL);
+	ms = (u64)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+	rate = 100 * (card + 1) + domain + 1;
+	cmb->entries[0].c = ms * rate / 1000;
+	cmb->entries[0].t = cmb->entries[0].c * 200;
+	cmb->entries[1].c = cmb->entries[0].c / 10;
+	cmb->entries[1].t = cmb->entries[1].c * 2000;
+}
+
+/*
+ * Fake CHSC backend: Store Crypto Measurement Data (card level)
+ */
+static int fake_chsc_scmd(struct chsc_scmd_area *scmd_area)
+{
+	unsigned int card;
+	size_t ofs = 0;
+
+	scmd_area->response.p = 0;
+	for (card = scmd_area->request.fcs;
+	     card <= scmd_area->request.lcs && card < g.fake_cards; card++) {
+		if (ofs + FAKE_CMB_LEN > sizeof(scmd_area->response_data)) {
+			scmd_area->response.p = 1;
+			break;
+		}
+		fake_chsc_cmb((struct chsc_cmb_area *)
+					&scmd_area->response_data[ofs],
+			      card, -1);
+		ofs += FAKE_CMB_LEN;
+	}
+
+	scmd_area->response.header.code = 0x0001;
+	scmd_area->response.header.length =
+			sizeof(struct chsc_scmd_response) + ofs;
+	return 0;
+}
+
+/*
+ * Fake CHSC backend: Store Crypto Domain Measurement Data (APQN level)
+ */
+static int fake_chsc_scdmd(struct chsc_scdmd_area *scdmd_area)
+{
+	uint8_t card = scdmd_area->request.first_drid.ap_index;
+	unsigned int domain;
+	size_t ofs = 0;
+
+	scdmd_area->response.p = 0;
+	for (domain = scdmd_area->request.first_drid.domain_index;
+	     domain <= scdmd_area->request.last_drid.domain_index &&
+	     domain < g.fake_domains && card < g.fake_cards; domain++) {
+		if ((scdmd_area->request.dsm[MASK_WORD_NO(domain)] &
+							MASK_BIT(domain)) == 0)
+			continue;
+		if (ofs + FAKE_CMB_LEN > sizeof(scdmd_area->response_data)) {
+			scdmd_area->response.p = 1;
+			scdmd_area->response.crid.ap_index = card;
+			scdmd_area->response.crid.domain_index = domain;
+			break;
+		}
+		fake_chsc_cmb((struct chsc_cmb_area *)
+					&scdmd_area->response_data[ofs],
+			      card, domain);
+		ofs += FAKE_CMB_LEN;
+	}
+
+	scdmd_area->response.header.code = 0x0001;
+	scdmd_area->response.header.length =
+			sizeof(struct chsc_scdmd_response) + ofs;
+	return 0;
+}
+
+/*
+ * Issue a CHSC request, either to the CHSC device or to the fake CHSC backend
+ * if it is enabled with environment variable ZCRYPTSTATS_FAKE_CHSC.
+ */
+static int chsc_start_sync(void *area)
+{
+	struct chsc_header *header = area;
+
+	g.chsc_requests++;
+	if (g.fake_cards == 0)
+		return ioctl(g.chsc_fd, CHSC_START_SYNC, area);
+
+	switch (header->code) {
+	case 0x102e:
+		return fake_chsc_scmd(area);
+	case 0x102d:
+		return fake_chsc_scdmd(area);
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+}
+
 /*
  * Process the APQN measurement data and extract the CMBs
  */
@@ -1174,20 +1369,18 @@ static int get_apqn_measurement_data(uint8_t card)
 	int rc;
 
 	memset(&scdmd_area, 0, sizeof(scdmd_area));
+	scdmd_area.request.header.code = 0x102d;
+	scdmd_area.request.header.length = sizeof(struct chsc_scdmd_request);
+	scdmd_area.request.first_drid.ap_index = card;
+	scdmd_area.request.first_drid.domain_index = g.min_domain;
+	scdmd_area.request.last_drid.ap_index = card;
+	scdmd_area.request.last_drid.domain_index = g.max_domain;
+	scdmd_area.request.s = 1;
+	scdmd_area.request.apsm[MASK_WORD_NO(card)] |= MASK_BIT(card);
+	memcpy(scdmd_area.request.dsm, g.domain_mask,
+	       sizeof(scdmd_area.request.dsm));
 	do {
-		scdmd_area.request.header.code = 0x102d;
-		scdmd_area.request.header.length =
-				sizeof(struct chsc_scdmd_request);
-		scdmd_area.request.first_drid.ap_index = card;
-		scdmd_area.request.first_drid.domain_index = g.min_domain;
-		scdmd_area.request.last_drid.ap_index = card;
-		scdmd_area.request.last_drid.domain_index = g.max_domain;
-		scdmd_area.request.s = 1;
-		scdmd_area.request.apsm[MASK_WORD_NO(card)] |= MASK_BIT(card);
-		memcpy(scdmd_area.request.dsm, g.domain_mask,
-				sizeof(scdmd_area.request.dsm));
-
-		rc = ioctl(g.chsc_fd, CHSC_START_SYNC, &scdmd_area);
+		rc = chsc_start_sync(&scdmd_area);
 		if (rc != 0) {
 			rc = -errno;
 			warnx("Failed to get APQN measurement data for card "
@@ -1268,15 +1461,13 @@ static int get_card_measurement_data(void)
 	int rc;
 
 	memset(&scmd_area, 0, sizeof(scmd_area));
+	scmd_area.request.header.code = 0x102e;
+	scmd_area.request.header.length = sizeof(struct chsc_scmd_request);
+	scmd_area.request.one = 1;
+	scmd_area.request.fcs = g.min_card;
+	scmd_area.request.lcs = g.max_card;
 	do {
-		scmd_area.request.header.code = 0x102e;
-		scmd_area.request.header.length =
-				sizeof(struct chsc_scmd_request);
-		scmd_area.request.one = 1;
-		scmd_area.request.fcs = g.min_card;
-		scmd_area.request.lcs = g.max_card;
-
-		rc = ioctl(g.chsc_fd, CHSC_START_SYNC, &scmd_area);
+		rc = chsc_start_sync(&scmd_area);
 		if (rc != 0) {
 			rc = -errno;
 			warnx("Failed to get card measurement data: %s",
@@ -1991,6 +2182,489 @@ static int print_measurement_data(unsigned long interval_count,
 	return 0;
 }
 
+/*
+ * Append a CMB to the snapshot
+ */
+static void snapshot_add_cmb(struct snapshot *snap, struct chsc_cmb_area *cmb)
+{
+	size_t len = get_cmb_length(cmb);
+
+	if (snap->hdr.length + len > snap->size) {
+		snap->size = MAX(2 * snap->size, snap->hdr.length + len);
+		snap->data = util_realloc(snap->data, snap->size);
+	}
+	memcpy(snap->data + snap->hdr.length, cmb, len);
+	snap->hdr.length += len;
+	snap->hdr.num_cmbs++;
+}
+
+/*
+ * Build the snapshot of an interval from the CMBs of all devices that have
+ * been updated in the interval. Devices that have not been updated are freed.
+ */
+static void build_snapshot(struct timeval *tv)
+{
+	struct snapshot *snap = &g.snapshot;
+	struct interval_data *dd;
+	struct card_data *cd;
+	int card, domain;
+
+	memcpy(snap->hdr.magic, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN);
+	snap->hdr.version = SNAPSHOT_VERSION;
+	snap->hdr.interval = g.interval;
+	snap->hdr.seq++;
+	snap->hdr.tv_sec = tv->tv_sec;
+	snap->hdr.tv_usec = tv->tv_usec;
+	snap->hdr.num_cmbs = 0;
+	snap->hdr.length = 0;
+
+	for (card = 0; card < NUM_CARDS; card++) {
+		cd = g.cards[card];
+		if (cd == NULL)
+			continue;
+
+		if (!cd->data.current_valid) {
+			free_card_data(cd);
+			g.cards[card] = NULL;
+
+			pr_verbose("Card %02x removed", card);
+			continue;
+		}
+		snapshot_add_cmb(snap, &cd->data.current);
+		cd->data.current_valid = false;
+
+		for (domain = 0; domain < NUM_DOMAINS; domain++) {
+			dd = cd->domains[domain];
+			if (dd == NULL)
+				continue;
+
+			if (!dd->current_valid) {
+				free(dd);
+				cd->domains[domain] = NULL;
+
+				pr_verbose("APQN %02x.%04x removed", card,
+					   domain);
+				continue;
+			}
+			snapshot_add_cmb(snap, &dd->current);
+			dd->current_valid = false;
+		}
+	}
+}
+
+/*
+ * Process the CMBs of a snapshot received from the daemon
+ */
+static int process_snapshot_data(struct snapshot *snap)
+{
+	size_t len, ofs = 0;
+	int rc;
+
+	while (ofs < snap->hdr.length) {
+		rc = process_cmb((struct chsc_cmb_area *)&snap->data[ofs],
+				 snap->hdr.length - ofs, &len, NULL);
+		if (rc != 0 && rc != -ENODEV)
+			return rc;
+		ofs += len;
+	}
+
+	return 0;
+}
+
+/*
+ * Write a buffer completely to a socket
+ */
+static int send_all(int fd, const void *buf, size_t len)
+{
+	const char *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = send(fd, p, len, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/*
+ * Read a buffer completely from a socket. Returns -EINTR if the program is
+ * stopped while waiting for data.
+ */
+static int recv_all(int fd, void *buf, size_t len)
+{
+	char *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = recv(fd, p, len, 0);
+		if (n < 0) {
+			if (errno == EINTR && !quit)
+				continue;
+			return -errno;
+		}
+		if (n == 0)
+			return -ECONNRESET;
+		p += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/*
+ * Send the current snapshot to a client
+ */
+static int send_snapshot(int fd)
+{
+	int rc;
+
+	rc = send_all(fd, &g.snapshot.hdr, sizeof(g.snapshot.hdr));
+	if (rc != 0)
+		return rc;
+
+	return send_all(fd, g.snapshot.data, g.snapshot.hdr.length);
+}
+
+/*
+ * Receive the next snapshot from the daemon and process its CMBs. If an
+ * interval has been specified, snapshots are skipped until the interval
+ * has elapsed since the previous snapshot.
+ */
+static int receive_snapshot(struct timeval *tv_previous,
+			    struct timeval *tv_current)
+{
+	struct snapshot *snap = &g.snapshot;
+	int rc;
+
+	while (1) {
+		rc = recv_all(g.sock_fd, &snap->hdr, sizeof(snap->hdr));
+		if (rc != 0)
+			goto out;
+
+		if (memcmp(snap->hdr.magic, SNAPSHOT_MAGIC,
+			   SNAPSHOT_MAGIC_LEN) != 0 ||
+		    snap->hdr.version != SNAPSHOT_VERSION) {
+			warnx("Invalid data received from the zcryptstats "
+			      "daemon");
+			return -EPROTO;
+		}
+
+		if (snap->hdr.length > snap->size) {
+			snap->size = snap->hdr.length;
+			snap->data = util_realloc(snap->data, snap->size);
+		}
+		rc = recv_all(g.sock_fd, snap->data, snap->hdr.length);
+		if (rc != 0)
+			goto out;
+
+		pr_verbose("Snapshot %llu received with %u CMBs",
+			   snap->hdr.seq, snap->hdr.num_cmbs);
+
+		tv_current->tv_sec = snap->hdr.tv_sec;
+		tv_current->tv_usec = snap->hdr.tv_usec;
+		if (!g.interval_set || tv_previous->tv_sec == 0 ||
+		    time_diff(tv_previous, tv_current) >=
+				g.interval - snap->hdr.interval / 2.0)
+			break;
+	}
+
+	return process_snapshot_data(snap);
+
+out:
+	if (rc == -ECONNRESET)
+		warnx("The zcryptstats daemon has closed the connection");
+	else if (rc != -EINTR)
+		warnx("Failed to receive data from the zcryptstats daemon: "
+		      "%s", strerror(-rc));
+	return rc;
+}
+
+/*
+ * Set up the address of the Unix domain socket
+ */
+static int socket_address(struct sockaddr_un *addr)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (strlen(g.socket_file) >= sizeof(addr->sun_path)) {
+		warnx("Socket path '%s' is too long", g.socket_file);
+		return -ENAMETOOLONG;
+	}
+	strcpy(addr->sun_path, g.socket_file);
+	return 0;
+}
+
+/*
+ * Connect to the zcryptstats daemon
+ */
+static int attach_daemon(void)
+{
+	struct sockaddr_un addr;
+	int rc;
+
+	rc = socket_address(&addr);
+	if (rc != 0)
+		return rc;
+
+	g.sock_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (g.sock_fd < 0) {
+		rc = -errno;
+		warnx("Failed to create socket: %s", strerror(errno));
+		return rc;
+	}
+
+	if (connect(g.sock_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		rc = -errno;
+		warnx("Failed to connect to '%s': %s", g.socket_file,
+		      strerror(errno));
+		if (rc == -ENOENT || rc == -ECONNREFUSED)
+			warnx("Start the daemon with 'zcryptstats --daemon'");
+		return rc;
+	}
+	pr_verbose("Attached to zcryptstats daemon at '%s'", g.socket_file);
+
+	return 0;
+}
+
+/*
+ * Create the listening socket of the daemon. A socket file that is left
+ * over from a previous daemon is removed, unless a daemon is still using it.
+ */
+/*
+ * Remove the socket file of the daemon. Any other type of file at the
+ * socket path is left alone.
+ */
+static int remove_socket_file(void)
+{
+	struct stat sb;
+	int rc;
+
+	if (lstat(g.socket_file, &sb) != 0) {
+		if (errno == ENOENT)
+			return 0;
+		rc = -errno;
+		warnx("Failed to access '%s': %s", g.socket_file,
+		      strerror(errno));
+		return rc;
+	}
+	if (!S_ISSOCK(sb.st_mode)) {
+		warnx("'%s' exists and is not a socket", g.socket_file);
+		return -EEXIST;
+	}
+	if (unlink(g.socket_file) != 0) {
+		rc = -errno;
+		warnx("Failed to remove socket '%s': %s", g.socket_file,
+		      strerror(errno));
+		return rc;
+	}
+	return 0;
+}
+
+static int open_daemon_socket(void)
+{
+	struct sockaddr_un addr;
+	int fd, rc;
+
+	rc = socket_address(&addr);
+	if (rc != 0)
+		return rc;
+
+	g.sock_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (g.sock_fd < 0) {
+		rc = -errno;
+		warnx("Failed to create socket: %s", strerror(errno));
+		return rc;
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd >= 0) {
+		rc = connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+		close(fd);
+		if (rc == 0) {
+			warnx("A zcryptstats daemon is already running at '%s'",
+			      g.socket_file);
+			return -EADDRINUSE;
+		}
+	}
+	rc = remove_socket_file();
+	if (rc != 0)
+		return rc;
+
+	if (bind(g.sock_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		rc = -errno;
+		warnx("Failed to bind socket '%s': %s", g.socket_file,
+		      strerror(errno));
+		return rc;
+	}
+	if (chmod(g.socket_file, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP) != 0 ||
+	    listen(g.sock_fd, MAX_CLIENTS) != 0) {
+		rc = -errno;
+		warnx("Failed to set up socket '%s': %s", g.socket_file,
+		      strerror(errno));
+		remove_socket_file();
+		return rc;
+	}
+	pr_verbose("Daemon is listening at '%s'", g.socket_file);
+
+	return 0;
+}
+
+/*
+ * Accept a new client and send it the latest snapshot, so that the client
+ * can display the first interval with the next snapshot.
+ */
+static void accept_client(int *clients, int *num_clients)
+{
+	struct timeval tv = { .tv_sec = CLIENT_SEND_TIMEOUT };
+	int fd;
+
+	fd = accept4(g.sock_fd, NULL, NULL, SOCK_CLOEXEC);
+	if (fd < 0)
+		return;
+
+	if (*num_clients >= MAX_CLIENTS) {
+		pr_verbose("Too many clients, connection refused");
+		close(fd);
+		return;
+	}
+
+	/* Do not let a stalled client block the daemon */
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+	if (g.snapshot.hdr.seq > 0 && send_snapshot(fd) != 0) {
+		close(fd);
+		return;
+	}
+
+	clients[(*num_clients)++] = fd;
+	pr_verbose("Client %d attached, %d clients", fd, *num_clients);
+}
+
+/*
+ * Remove a client
+ */
+static void remove_client(int *clients, int *num_clients, int i)
+{
+	close(clients[i]);
+	pr_verbose("Client %d detached, %d clients", clients[i],
+		   *num_clients - 1);
+	clients[i] = clients[--(*num_clients)];
+}
+
+/*
+ * Returns the time of the monotonic clock in milliseconds
+ */
+static u64 monotonic_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Obtain the measurement data once per interval and publish it to all
+ * attached clients
+ */
+static int run_daemon(void)
+{
+	struct pollfd pfd[MAX_CLIENTS + 1];
+	unsigned long interval_count = 0;
+	int clients[MAX_CLIENTS];
+	struct sigaction int_act;
+	int num_clients = 0;
+	struct timeval tv;
+	u64 next, now;
+	int i, rc;
+
+	/* Set a handler for SIGINT/SIGTERM */
+	memset(&int_act, 0, sizeof(int_act));
+	int_act.sa_handler = int_handler;
+	sigaction(SIGINT, &int_act, NULL);
+	sigaction(SIGTERM, &int_act, NULL);
+	signal(SIGALRM, SIG_IGN);
+
+	rc = open_daemon_socket();
+	if (rc != 0)
+		return rc;
+
+	next = monotonic_ms();
+	while (!quit) {
+		now = monotonic_ms();
+		if (now >= next) {
+			pr_verbose("Interval %lu", interval_count);
+
+			gettimeofday(&tv, NULL);
+			rc = get_card_measurement_data();
+			if (rc != 0)
+				break;
+			build_snapshot(&tv);
+
+			for (i = num_clients - 1; i >= 0; i--) {
+				if (send_snapshot(clients[i]) != 0)
+					remove_client(clients, &num_clients, i);
+			}
+			pr_verbose("Snapshot %llu with %u CMBs sent to %d "
+				   "clients, %lu CHSC requests so far",
+				   g.snapshot.hdr.seq, g.snapshot.hdr.num_cmbs,
+				   num_clients, g.chsc_requests);
+
+			if (g.count > 0 && interval_count >= g.count) {
+				pr_verbose("Interval limit reached");
+				break;
+			}
+			interval_count++;
+
+			next += g.interval * 1000;
+			if (next <= now)
+				next = now + g.interval * 1000;
+			continue;
+		}
+
+		pfd[0].fd = g.sock_fd;
+		pfd[0].events = POLLIN;
+		for (i = 0; i < num_clients; i++) {
+			pfd[i + 1].fd = clients[i];
+			pfd[i + 1].events = POLLIN;
+		}
+
+		rc = poll(pfd, num_clients + 1, next - now);
+		if (rc < 0) {
+			rc = -errno;
+			if (rc == -EINTR) {
+				rc = 0;
+				continue;
+			}
+			warnx("Failed to wait for clients: %s", strerror(-rc));
+			break;
+		}
+		rc = 0;
+
+		/* Clients do not send data, input means the client is gone */
+		for (i = num_clients - 1; i >= 0; i--) {
+			if (pfd[i + 1].revents != 0)
+				remove_client(clients, &num_clients, i);
+		}
+		if (pfd[0].revents & POLLIN)
+			accept_client(clients, &num_clients);
+	}
+
+	if (quit)
+		pr_verbose("Daemon stopped by user");
+
+	for (i = 0; i < num_clients; i++)
+		close(clients[i]);
+	remove_socket_file();
+
+	return rc;
+}
+
 /*
  * Perform the measurement in intervals
  */
@@ -2023,16 +2697,24 @@ static int perform_measurement(void)
 	if (rc != 0)
 		return 0;
 
-	alarm(g.interval);
+	if (!g.attach)
+		alarm(g.interval);
 
 	memset(&tv_current, 0, sizeof(tv_current));
 	while (!quit) {
 		pr_verbose("Interval %lu", interval_count);
 
 		tv_previous = tv_current;
-		rc = gettimeofday(&tv_current, NULL);
-		if (rc != 0)
-			break;
+		if (g.attach) {
+			/* The snapshot provides the time of the measurement */
+			rc = receive_snapshot(&tv_previous, &tv_current);
+			if (rc != 0)
+				break;
+		} else {
+			rc = gettimeofday(&tv_current, NULL);
+			if (rc != 0)
+				break;
+		}
 
 		tm = localtime(&tv_current.tv_sec);
 		if (tm == NULL)
@@ -2040,9 +2722,11 @@ static int perform_measurement(void)
 		strftime(timestamp, sizeof(timestamp), "%x %X", tm);
 		interval_time = time_diff(&tv_previous, &tv_current);
 
-		rc = get_card_measurement_data();
-		if (rc != 0)
-			break;
+		if (!g.attach) {
+			rc = get_card_measurement_data();
+			if (rc != 0)
+				break;
+		}
 
 		rc = print_measurement_data(interval_count, interval_time,
 					    timestamp);
@@ -2058,7 +2742,8 @@ static int perform_measurement(void)
 		if (quit)
 			break;
 
-		pause();
+		if (!g.attach)
+			pause();
 	}
 
 	if (quit)
@@ -2274,7 +2959,7 @@ static int parse_device_selection(void)
  */
 int main(int argc, char *argv[])
 {
-	char *endp;
+	char *endp, *env;
 	int c, rc;
 
 	util_prg_init(&prg);
@@ -2295,6 +2980,7 @@ int main(int argc, char *argv[])
 				util_prg_print_parse_error();
 				return EXIT_FAILURE;
 			}
+			g.interval_set = true;
 			break;
 		case 'c':
 			g.count = strtoull(optarg, &endp, 0);
@@ -2340,6 +3026,15 @@ int main(int argc, char *argv[])
 		case 'O':
 			g.only_online = true;
 			break;
+		case 'D':
+			g.daemon = true;
+			break;
+		case 'X':
+			g.attach = true;
+			break;
+		case 'S':
+			g.socket_file = optarg;
+			break;
 		case 'V':
 			g.verbose = true;
 			break;
@@ -2372,12 +3067,38 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	if (g.daemon && g.attach) {
+		warnx("Either --daemon or --attach can be specified, "
+		      "but not both");
+		return EXIT_FAILURE;
+	}
+
+	if (g.daemon && g.print_funcs != &default_print) {
+		warnx("Option --output can not be specified together with "
+		      "option --daemon");
+		return EXIT_FAILURE;
+	}
+
 	pr_verbose("Interval: %ld Count: %ld", g.interval, g.count);
 
-	rc = get_max_card_index(&g.max_card_used);
-	if (rc != 0) {
-		rc = EXIT_FAILURE;
-		goto out;
+	env = getenv(FAKE_CHSC_ENV);
+	if (env != NULL) {
+		if (sscanf(env, "%u:%u", &g.fake_cards, &g.fake_domains) < 1 ||
+		    g.fake_cards == 0 || g.fake_cards > NUM_CARDS ||
+		    g.fake_domains > NUM_DOMAINS) {
+			warnx("Invalid value for %s: '%s'", FAKE_CHSC_ENV, env);
+			return EXIT_FAILURE;
+		}
+		pr_verbose("Using fake CHSC backend with %u cards and %u "
+			   "domains", g.fake_cards, g.fake_domains);
+		g.max_card_used = g.fake_cards > NUM_CARDS_OLD ?
+					NUM_CARDS - 1 : NUM_CARDS_OLD - 1;
+	} else {
+		rc = get_max_card_index(&g.max_card_used);
+		if (rc != 0) {
+			rc = EXIT_FAILURE;
+			goto out;
+		}
 	}
 
 	rc = parse_device_selection();
@@ -2394,21 +3115,33 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	g.chsc_fd = open(CHSC_DEVICE, O_RDWR);
-	if (g.chsc_fd < 0) {
-		rc = errno;
-		warnx("File '%s:' %s", CHSC_DEVICE, strerror(errno));
-		if (rc == ENOENT)
-			warnx("You might have to load kernel module 'chsc_sch' "
-			      "using 'modprobe chsc_sch'");
-		return EXIT_FAILURE;
+	if (g.attach) {
+		rc = attach_daemon();
+		if (rc != 0) {
+			rc = EXIT_FAILURE;
+			goto out;
+		}
+	} else if (g.fake_cards == 0) {
+		g.chsc_fd = open(CHSC_DEVICE, O_RDWR);
+		if (g.chsc_fd < 0) {
+			rc = errno;
+			warnx("File '%s:' %s", CHSC_DEVICE, strerror(errno));
+			if (rc == ENOENT)
+				warnx("You might have to load kernel module "
+				      "'chsc_sch' using 'modprobe chsc_sch'");
+			return EXIT_FAILURE;
+		}
+		pr_verbose("Device '%s' has been opened successfully",
+			   CHSC_DEVICE);
 	}
-	pr_verbose("Device '%s' has been opened successfully", CHSC_DEVICE);
 
 	/* Don't buffer data if redirected to a pipe */
 	setbuf(stdout, NULL);
 
-	rc = perform_measurement();
+	if (g.daemon)
+		rc = run_daemon();
+	else
+		rc = perform_measurement();
 	if (rc != 0) {
 		rc = EXIT_FAILURE;
 		goto out;
@@ -2416,6 +3149,9 @@ int main(int argc, char *argv[])
 out:
 	if (g.chsc_fd >= 0)
 		close(g.chsc_fd);
+	if (g.sock_fd >= 0)
+		close(g.sock_fd);
+	free(g.snapshot.data);
 	free_device_selection();
 	free_type_mapping();
 	free_interval_data();
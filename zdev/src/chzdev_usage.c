@@ -0,0 +1,60 @@
+"Usage: chzdev TYPE DEVICE [SELECTION] [SETTINGS] [ACTION] [OPTIONS]\n"
+"\n"
+"Use chzdev to manage the configuration of z Systems specific devices in either:\n"
+" - active configuration (running system), or\n"
+" - persistent configuration (configuration files)\n"
+"\n"
+"Actions apply to both configurations unless specified otherwise.\n"
+"\n"
+"TYPE\n"
+"  Device type to which this command applies. Use --list-types to display\n"
+"  supported types.\n"
+"\n"
+"DEVICE\n"
+"  ID                     Select single device by ID, e.g. 0.0.1234\n"
+"  FROM-TO                Select range of devices between FROM and TO\n"
+"  DEV1,DEV2,...          Select list of devices or device ranges\n"
+"\n"
+"SELECTION\n"
+"  --all                  Select all existing and configured devices\n"
+"  --configured           Select devices with a persistent configuration\n"
+"  --existing             Select devices found in the active configuration\n"
+"  --online/--offline     Select devices that are online/offline\n"
+"  --failed               Select devices that are not functioning correctly\n"
+"  --by-path PATH         Select device providing file system path, e.g. /usr\n"
+"  --by-node NODE         Select device providing device node, e.g. /dev/sda\n"
+"  --by-interface NAME    Select device providing network interface, e.g. eth0\n"
+"  --by-attrib KEY=VALUE  Select devices with specified attribute value\n"
+"\n"
+"SETTINGS\n"
+"  Specifications in the form ATTRIB=VALUE used to modify device or device type\n"
+"  settings.  Use --list-attributes (also with --type) to list available\n"
+"  attributes.\n"
+"\n"
+"ACTIONS\n"
+"  -e, --enable           Enable device\n"
+"  -d, --disable          Disable device\n"
+"  -l, --list-attributes  List attributes\n"
+"  -L, --list-types       List supported device types\n"
+"  -H, --help-attribute   Show detailed help on specified attribute\n"
+"      --export FILENAME  Export configuration data to file\n"
+"      --import FILENAME  Import configuration data from file\n"
+"      --apply            Apply persistent settings to active configuration\n"
+"  -h, --help             Print usage information, then exit\n"
+"  -v, --version          Print version information, then exit\n"
+"\n"
+"OPTIONS\n"
+"  -a, --active           Apply changes to active configuration only\n"
+"  -p, --persistent       Apply changes to persistent configuration only\n"
+"  -t, --type             Apply changes to device type\n"
+"  -r, --remove ATTRIB    Remove setting for specified attribute\n"
+"  -R, --remove-all       Remove settings for all attributes\n"
+"  -f, --force            Override safety checks\n"
+"  -y, --yes              Answer all confirmation questions with 'yes'\n"
+"      --no-root-update   Skip root device update\n"
+"      --dry-run          Display changes without applying\n"
+"      --base PATH        Use PATH as base for accessing files\n"
+"      --no-settle        Do not wait for udev to settle\n"
+"      --auto-conf        Apply changes to auto-configuration only\n"
+"  -V, --verbose          Print additional run-time information\n"
+"  -q, --quiet            Print only minimal run-time information\n"
@@ -0,0 +1,46 @@
+"Usage: lszdev [TYPE] [DEVICE] [SELECTION] [ACTION] [OPTIONS]\n"
+"\n"
+"Use lszdev to view the configuration of z Systems specific devices in either:\n"
+" - active configuration (running system), or\n"
+" - persistent configuration (configuration files)\n"
+"\n"
+"Actions apply to both configurations unless specified otherwise.\n"
+"\n"
+"TYPE\n"
+"  Device type to which this command applies. Use --list-types to display\n"
+"  supported types.\n"
+"\n"
+"DEVICE\n"
+"  ID                     Select single device by ID, e.g. 0.0.1234\n"
+"  FROM-TO                Select range of devices between FROM and TO\n"
+"  DEV1,DEV2,...          Select list of devices or device ranges\n"
+"\n"
+"SELECTION\n"
+"  --all                  Select all existing and configured devices (default)\n"
+"  --configured           Select devices with a persistent configuration\n"
+"  --existing             Select devices found in the active configuration\n"
+"  --online/--offline     Select devices that are online/offline\n"
+"  --failed               Select devices that are not functioning correctly\n"
+"  --by-path PATH         Select device providing file system path, e.g. /usr\n"
+"  --by-node NODE         Select device providing device node, e.g. /dev/sda\n"
+"  --by-interface NAME    Select device providing network interface, e.g. eth0\n"
+"  --by-attrib KEY=VALUE  Select devices with specified attribute value\n"
+"\n"
+"ACTIONS\n"
+"  -i, --info             Display detailed information\n"
+"  -l, --list-columns     List available output columns\n"
+"  -L, --list-types       List supported device types\n"
+"  -h, --help             Print usage information, then exit\n"
+"  -v, --version          Print version information, then exit\n"
+"\n"
+"OPTIONS\n"
+"  -a, --active           Only show data from the active configuration\n"
+"  -p, --persistent       Only show data from the persistent configuration\n"
+"  -t, --type             List information about device type\n"
+"  -c, --columns COLUMNS  Specify comma-separated list of columns to display\n"
+"  -n, --no-headings      Do not print column headings\n"
+"      --base PATH        Use PATH as base for accessing files\n"
+"      --pairs            Produce output in KEY=\"VALUE\" format\n"
+"      --auto-conf        Only show auto-configuration data\n"
+"  -V, --verbose          Print additional run-time information\n"
+"  -q, --quiet            Print only minimal run-time information\n"
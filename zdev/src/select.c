@@ -1043,13 +1043,36 @@ static void handle_unmatched_specs(struct select_opts *select,
 	}
 }
 
-/* Remove duplicate entries in selected list. */
-static void remove_duplicates(struct util_list *selected,
-			      struct selected_dev_node *first)
+/* Selected device and its position in the selected list. */
+struct sel_pos {
+	struct selected_dev_node *sel;
+	int pos;
+};
+
+/* Compare selected devices by devtype, subtype and ID. Equal devices are
+ * ordered by their position. */
+static int sel_pos_cmp(const void *a_ptr, const void *b_ptr)
 {
-	struct selected_dev_node *sel, *s, *n;
+	const struct sel_pos *a = a_ptr, *b = b_ptr;
+	int rc;
+
+	if (a->sel->dt != b->sel->dt)
+		return a->sel->dt < b->sel->dt ? -1 : 1;
+	if (a->sel->st != b->sel->st)
+		return a->sel->st < b->sel->st ? -1 : 1;
+	rc = strcmp(a->sel->id, b->sel->id);
+	if (rc)
+		return rc;
 
-	sel = first ? first : util_list_start(selected);
+	return a->pos - b->pos;
+}
+
+/* Remove duplicate entries in selected list by comparing all pairs of
+ * entries. */
+static void remove_duplicates_pairwise(struct util_list *selected,
+				       struct selected_dev_node *sel)
+{
+	struct selected_dev_node *s, *n;
 
 	for (; sel; sel = util_list_next(selected, sel)) {
 		for (s = util_list_next(selected, sel); s; s = n) {
@@ -1073,6 +1096,55 @@ remove:
 	}
 }
 
+/* Remove duplicate entries in selected list. The first entry of each set of
+ * duplicates is kept. */
+static void remove_duplicates(struct util_list *selected,
+			      struct selected_dev_node *first)
+{
+	struct selected_dev_node *sel, *s;
+	struct sel_pos *vec;
+	int i, num = 0;
+
+	sel = first ? first : util_list_start(selected);
+
+	/* Entries without ID are compared by parameter which is not a
+	 * sortable relation - fall back to comparing all pairs. */
+	for (s = sel; s; s = util_list_next(selected, s)) {
+		if (!s->id) {
+			remove_duplicates_pairwise(selected, sel);
+			return;
+		}
+		num++;
+	}
+	if (num < 2)
+		return;
+
+	/* Sort entries to find duplicates in O(n log n) instead of comparing
+	 * all pairs. */
+	vec = misc_malloc(sizeof(struct sel_pos) * num);
+	for (i = 0, s = sel; s; s = util_list_next(selected, s), i++) {
+		vec[i].sel = s;
+		vec[i].pos = i;
+	}
+	qsort(vec, num, sizeof(struct sel_pos), sel_pos_cmp);
+	for (i = 1; i < num; i++) {
+		if (vec[i].sel->dt != vec[i - 1].sel->dt ||
+		    vec[i].sel->st != vec[i - 1].sel->st ||
+		    strcmp(vec[i].sel->id, vec[i - 1].sel->id) != 0)
+			continue;
+		/* Mark duplicate - the entry is still needed for comparison
+		 * with the next one. */
+		vec[i].pos = -1;
+	}
+	for (i = 0; i < num; i++) {
+		if (vec[i].pos >= 0)
+			continue;
+		util_list_remove(selected, vec[i].sel);
+		selected_dev_free(vec[i].sel);
+	}
+	free(vec);
+}
+
 /* Select devices that provide networking interface @name. */
 exit_code_t select_by_interface(struct select_opts *select,
 				struct util_list *selected, config_t config,
@@ -10,6 +10,7 @@
 /* The fuse version define tells fuse that we want to use the new API */
 #define FUSE_USE_VERSION 26
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <fuse.h>
@@ -21,6 +22,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #ifdef HAVE_SETXATTR
 #include <linux/xattr.h>
@@ -42,9 +45,20 @@ struct zdsfs_info {
 	int allow_inclomplete_multi_volume;
 	int keepRDW;
 	int host_count;
+	int prefetch;
 	unsigned int tracks_per_frame;
 	unsigned long long seek_buffer_size;
+	char *indexdir;
+	struct zdsfs_vtoc *vtoc;
+};
+
+/* A snapshot of the data sets on all devices. Open files and running file
+ * system operations hold a reference, so that zdsfs_update_vtoc can replace
+ * the current snapshot while data sets are still in use.
+ */
+struct zdsfs_vtoc {
 	struct zdsroot *zdsroot;
+	unsigned int refcount;
 
 	char *metadata;  /* buffer that contains the content of metadata.txt */
 	size_t metasize; /* total size of meta data buffer */
@@ -53,17 +67,70 @@ struct zdsfs_info {
 };
 
 static struct zdsfs_info zdsfsinfo;
-static int zdsfs_create_meta_data_buffer(struct zdsfs_info *);
-static int zdsfs_verify_datasets(void);
+static pthread_mutex_t vtoc_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int zdsfs_create_meta_data_buffer(struct zdsfs_vtoc *);
+static int zdsfs_verify_datasets(struct zdsroot *);
+
+/* Maximum number of dshandles per open file. Additional handles are only
+ * allocated when several reads of the same file are processed at the same
+ * time, e.g. by readers at different offsets.
+ */
+#define MAX_DSHANDLES 4
 
 struct zdsfs_file_info {
-	struct dshandle *dsh;
+	struct zdsfs_vtoc *vtoc;
+	struct dataset *ds;
+	char mbrname[MEMBERNAMELENGTH];
+	struct dshandle *dsh[MAX_DSHANDLES];
+	int busy[MAX_DSHANDLES];
 	pthread_mutex_t mutex;
+	pthread_cond_t cond;
 
 	int is_metadata_file;
 	size_t metaread; /* how many bytes have already been read */
 };
 
+static struct zdsfs_vtoc *zdsfs_vtoc_get(void)
+{
+	struct zdsfs_vtoc *vtoc;
+
+	pthread_mutex_lock(&vtoc_mutex);
+	vtoc = zdsfsinfo.vtoc;
+	vtoc->refcount++;
+	pthread_mutex_unlock(&vtoc_mutex);
+	return vtoc;
+}
+
+static void zdsfs_vtoc_put(struct zdsfs_vtoc *vtoc)
+{
+	unsigned int refcount;
+
+	pthread_mutex_lock(&vtoc_mutex);
+	refcount = --vtoc->refcount;
+	pthread_mutex_unlock(&vtoc_mutex);
+	if (refcount)
+		return;
+	lzds_zdsroot_free(vtoc->zdsroot);
+	free(vtoc->metadata);
+	free(vtoc);
+}
+
+static struct zdsfs_vtoc *zdsfs_vtoc_alloc(void)
+{
+	struct zdsfs_vtoc *vtoc;
+
+	vtoc = calloc(1, sizeof(*vtoc));
+	if (!vtoc)
+		return NULL;
+	if (lzds_zdsroot_alloc(&vtoc->zdsroot)) {
+		free(vtoc);
+		return NULL;
+	}
+	/* the reference of the creator */
+	vtoc->refcount = 1;
+	return vtoc;
+}
+
 
 
 /* normalize the given path name to a dataset name
@@ -97,16 +164,401 @@ static void path_to_member_name(const char *path, char *normds, size_t size)
 	}
 }
 
+/*
+ * Index of exact data set sizes and seek buffers
+ *
+ * If an index directory is specified, a background thread reads all data
+ * sets once to determine their exact size and to build a complete seek
+ * buffer. The results are stored in one file per data set or PDS member,
+ * so that later mounts can use them immediately. An entry is only used
+ * if the change marker of the data set still matches.
+ */
+#define INDEX_MAGIC "ZDSFSIDX"
+#define INDEX_VERSION 1
+#define INDEX_HASH_SIZE 256
+#define INDEX_NAME_SIZE (6 + 1 + MAXDSNAMELENGTH + MEMBERNAMELENGTH + 2)
+#define INDEX_READ_SIZE (1024 * 1024)
+
+struct zdsfs_index_hdr {
+	char magic[8];
+	unsigned int version;
+	unsigned int tracks_per_frame;
+	unsigned int keepRDW;
+	unsigned int reserved;
+	unsigned long long marker;
+	unsigned long long size;
+	unsigned long long seeksize;
+};
+
+struct zdsfs_index_entry {
+	struct zdsfs_index_entry *next;
+	char name[INDEX_NAME_SIZE];
+	unsigned long long marker;
+	unsigned long long size;
+	char *seekbuf;
+	size_t seeksize;
+};
+
+static struct zdsfs_index_entry *index_hash[INDEX_HASH_SIZE];
+static pthread_mutex_t index_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t index_thread;
+static int index_thread_active;
+static volatile int index_thread_stop;
+
+static unsigned int zdsfs_index_hash(const char *name)
+{
+	unsigned int hash = 0;
+
+	while (*name)
+		hash = hash * 31 + (unsigned char)*name++;
+	return hash % INDEX_HASH_SIZE;
+}
+
+/* The index name consists of the volume serial of the first volume, the
+ * data set name and, for PDS members, the member name in parentheses.
+ */
+static void zdsfs_index_name(struct dataset *ds, const char *mbrname,
+			     char *name, size_t size)
+{
+	char volser[7];
+	format1_label_t *f1;
+	char *dsname;
+
+	lzds_dataset_get_format1_dscb(ds, &f1);
+	vtoc_ebcdic_dec((char *)f1->DS1DSSN, volser, sizeof(volser) - 1);
+	volser[sizeof(volser) - 1] = '\0';
+	lzds_dataset_get_name(ds, &dsname);
+	if (mbrname && *mbrname)
+		snprintf(name, size, "%s_%s(%s)", volser, dsname, mbrname);
+	else
+		snprintf(name, size, "%s_%s", volser, dsname);
+}
+
+/* must be called with index_mutex held */
+static struct zdsfs_index_entry *zdsfs_index_find(const char *name)
+{
+	struct zdsfs_index_entry *entry;
 
+	entry = index_hash[zdsfs_index_hash(name)];
+	while (entry && strcmp(entry->name, name) != 0)
+		entry = entry->next;
+	return entry;
+}
 
-static int zdsfs_getattr(const char *path, struct stat *stbuf)
+/* Add entry to the index, an existing entry with the same name is replaced */
+static void zdsfs_index_insert(struct zdsfs_index_entry *new)
+{
+	struct zdsfs_index_entry **pos;
+	struct zdsfs_index_entry *old;
+
+	pthread_mutex_lock(&index_mutex);
+	pos = &index_hash[zdsfs_index_hash(new->name)];
+	while (*pos && strcmp((*pos)->name, new->name) != 0)
+		pos = &(*pos)->next;
+	old = *pos;
+	new->next = old ? old->next : NULL;
+	*pos = new;
+	pthread_mutex_unlock(&index_mutex);
+	if (old) {
+		free(old->seekbuf);
+		free(old);
+	}
+}
+
+static void zdsfs_index_free(void)
+{
+	struct zdsfs_index_entry *entry, *next;
+	int i;
+
+	for (i = 0; i < INDEX_HASH_SIZE; i++) {
+		for (entry = index_hash[i]; entry; entry = next) {
+			next = entry->next;
+			free(entry->seekbuf);
+			free(entry);
+		}
+		index_hash[i] = NULL;
+	}
+}
+
+/* Return the exact size of a data set or PDS member if it is indexed */
+static int zdsfs_index_get_size(struct dataset *ds, const char *mbrname,
+				unsigned long long *size)
+{
+	char name[INDEX_NAME_SIZE];
+	struct zdsfs_index_entry *entry;
+	unsigned long long marker;
+	int rc = ENOENT;
+
+	if (!zdsfsinfo.indexdir)
+		return rc;
+	zdsfs_index_name(ds, mbrname, name, sizeof(name));
+	lzds_dataset_get_change_marker(ds, &marker);
+	pthread_mutex_lock(&index_mutex);
+	entry = zdsfs_index_find(name);
+	if (entry && entry->marker == marker) {
+		*size = entry->size;
+		rc = 0;
+	}
+	pthread_mutex_unlock(&index_mutex);
+	return rc;
+}
+
+/* Load the indexed seek buffer into dsh, returns ENOENT if there is none */
+static int zdsfs_index_load_seekbuffer(struct dshandle *dsh,
+				       struct dataset *ds, const char *mbrname)
+{
+	char name[INDEX_NAME_SIZE];
+	struct zdsfs_index_entry *entry;
+	unsigned long long marker;
+	int rc = ENOENT;
+
+	if (!zdsfsinfo.indexdir)
+		return rc;
+	zdsfs_index_name(ds, mbrname, name, sizeof(name));
+	lzds_dataset_get_change_marker(ds, &marker);
+	pthread_mutex_lock(&index_mutex);
+	entry = zdsfs_index_find(name);
+	if (entry && entry->marker == marker)
+		rc = lzds_dshandle_load_seekbuffer(dsh, entry->seekbuf,
+						   entry->seeksize);
+	pthread_mutex_unlock(&index_mutex);
+	return rc;
+}
+
+static void zdsfs_index_read_file(const char *name)
+{
+	struct zdsfs_index_entry *entry;
+	struct zdsfs_index_hdr hdr;
+	char path[PATH_MAX];
+	FILE *fp;
+
+	if (strlen(name) >= INDEX_NAME_SIZE)
+		return;
+	snprintf(path, sizeof(path), "%s/%s", zdsfsinfo.indexdir, name);
+	fp = fopen(path, "r");
+	if (!fp)
+		return;
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    memcmp(hdr.magic, INDEX_MAGIC, sizeof(hdr.magic)) != 0 ||
+	    hdr.version != INDEX_VERSION ||
+	    hdr.tracks_per_frame != zdsfsinfo.tracks_per_frame ||
+	    hdr.keepRDW != (unsigned int)zdsfsinfo.keepRDW ||
+	    hdr.seeksize > SIZE_MAX)
+		goto out;
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		goto out;
+	entry->seekbuf = malloc(hdr.seeksize);
+	if (!entry->seekbuf ||
+	    fread(entry->seekbuf, hdr.seeksize, 1, fp) != 1) {
+		free(entry->seekbuf);
+		free(entry);
+		goto out;
+	}
+	util_strlcpy(entry->name, name, sizeof(entry->name));
+	entry->marker = hdr.marker;
+	entry->size = hdr.size;
+	entry->seeksize = hdr.seeksize;
+	zdsfs_index_insert(entry);
+out:
+	fclose(fp);
+}
+
+/* Read all index files that have been written by previous mounts */
+static void zdsfs_index_read_dir(void)
+{
+	struct dirent *de;
+	DIR *dir;
+
+	dir = opendir(zdsfsinfo.indexdir);
+	if (!dir) {
+		fprintf(stderr, "could not open index directory %s: %s\n",
+			zdsfsinfo.indexdir, strerror(errno));
+		return;
+	}
+	while ((de = readdir(dir))) {
+		if (de->d_name[0] == '.')
+			continue;
+		zdsfs_index_read_file(de->d_name);
+	}
+	closedir(dir);
+}
+
+/* Write an index file, a temporary file is renamed to make this atomic */
+static int zdsfs_index_write_file(struct zdsfs_index_entry *entry)
+{
+	char path[PATH_MAX], tmppath[PATH_MAX];
+	struct zdsfs_index_hdr hdr;
+	FILE *fp;
+	int rc;
+
+	snprintf(path, sizeof(path), "%s/%s", zdsfsinfo.indexdir,
+		 entry->name);
+	snprintf(tmppath, sizeof(tmppath), "%s/.%s.tmp", zdsfsinfo.indexdir,
+		 entry->name);
+	fp = fopen(tmppath, "w");
+	if (!fp)
+		return errno;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, INDEX_MAGIC, sizeof(hdr.magic));
+	hdr.version = INDEX_VERSION;
+	hdr.tracks_per_frame = zdsfsinfo.tracks_per_frame;
+	hdr.keepRDW = zdsfsinfo.keepRDW;
+	hdr.marker = entry->marker;
+	hdr.size = entry->size;
+	hdr.seeksize = entry->seeksize;
+	rc = 0;
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    fwrite(entry->seekbuf, entry->seeksize, 1, fp) != 1)
+		rc = errno ? errno : EIO;
+	if (fclose(fp) && !rc)
+		rc = errno;
+	if (!rc && rename(tmppath, path))
+		rc = errno;
+	if (rc)
+		unlink(tmppath);
+	return rc;
+}
+
+/* Read a data set or PDS member to the end and store size and seek buffer */
+static int zdsfs_index_dataset(struct dataset *ds, char *mbrname,
+			       char *buf)
+{
+	struct zdsfs_index_entry *entry;
+	struct dshandle *dsh;
+	long long offset;
+	ssize_t count;
+	int rc;
+
+	entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		return ENOMEM;
+	zdsfs_index_name(ds, mbrname, entry->name, sizeof(entry->name));
+	lzds_dataset_get_change_marker(ds, &entry->marker);
+	if (!zdsfs_index_get_size(ds, mbrname, &entry->size)) {
+		/* already indexed */
+		free(entry);
+		return 0;
+	}
+	rc = lzds_dataset_alloc_dshandle(ds, zdsfsinfo.tracks_per_frame, &dsh);
+	if (rc)
+		goto out_free;
+	/* keep an element for every track frame */
+	rc = lzds_dshandle_set_seekbuffer(dsh, ULLONG_MAX);
+	if (!rc && mbrname)
+		rc = lzds_dshandle_set_member(dsh, mbrname);
+	if (!rc)
+		rc = lzds_dshandle_set_keepRDW(dsh, zdsfsinfo.keepRDW);
+	if (!rc)
+		rc = lzds_dshandle_set_prefetch(dsh, zdsfsinfo.prefetch);
+	if (!rc)
+		rc = lzds_dshandle_open(dsh);
+	if (rc)
+		goto out_dsh;
+	do {
+		rc = lzds_dshandle_read(dsh, buf, INDEX_READ_SIZE, &count);
+	} while (!rc && count > 0 && !index_thread_stop);
+	if (!rc && index_thread_stop)
+		rc = EINTR;
+	if (!rc) {
+		lzds_dshandle_get_offset(dsh, &offset);
+		entry->size = offset;
+		rc = lzds_dshandle_save_seekbuffer(dsh, &entry->seekbuf,
+						   &entry->seeksize);
+	}
+	lzds_dshandle_close(dsh);
+out_dsh:
+	lzds_dshandle_free(dsh);
+	if (rc)
+		goto out_free;
+	rc = zdsfs_index_write_file(entry);
+	if (rc)
+		fprintf(stderr, "Warning: could not write index file for %s:"
+			" %s\n", entry->name, strerror(rc));
+	zdsfs_index_insert(entry);
+	return 0;
+
+out_free:
+	free(entry->seekbuf);
+	free(entry);
+	return rc;
+}
+
+static void *zdsfs_index_thread(void *UNUSED(arg))
+{
+	struct memberiterator *it;
+	struct pdsmember *member;
+	struct dsiterator *dsit;
+	struct zdsfs_vtoc *vtoc;
+	struct dataset *ds;
+	int ispds, issupported, iscomplete;
+	char *mbrname, *buf;
+	int rc;
+
+	buf = malloc(INDEX_READ_SIZE);
+	if (!buf)
+		return NULL;
+	/* the snapshot stays valid even if the VTOC is updated meanwhile */
+	vtoc = zdsfs_vtoc_get();
+	rc = lzds_zdsroot_alloc_dsiterator(vtoc->zdsroot, &dsit);
+	if (rc)
+		goto out;
+	while (!index_thread_stop &&
+	       !lzds_dsiterator_get_next_dataset(dsit, &ds)) {
+		lzds_dataset_get_is_supported(ds, &issupported);
+		lzds_dataset_get_is_complete(ds, &iscomplete);
+		if (!issupported || !iscomplete)
+			continue;
+		lzds_dataset_get_is_PDS(ds, &ispds);
+		if (!ispds) {
+			zdsfs_index_dataset(ds, NULL, buf);
+			continue;
+		}
+		if (lzds_dataset_alloc_memberiterator(ds, &it))
+			continue;
+		while (!index_thread_stop &&
+		       !lzds_memberiterator_get_next_member(it, &member)) {
+			lzds_pdsmember_get_name(member, &mbrname);
+			zdsfs_index_dataset(ds, mbrname, buf);
+		}
+		lzds_memberiterator_free(it);
+	}
+	lzds_dsiterator_free(dsit);
+out:
+	zdsfs_vtoc_put(vtoc);
+	free(buf);
+	return NULL;
+}
+
+/* fuse_main forks into the background, so the thread is started here */
+static void *zdsfs_init(struct fuse_conn_info *UNUSED(conn))
+{
+	if (zdsfsinfo.indexdir &&
+	    !pthread_create(&index_thread, NULL, zdsfs_index_thread, NULL))
+		index_thread_active = 1;
+	return NULL;
+}
+
+static void zdsfs_destroy(void *UNUSED(data))
+{
+	if (!index_thread_active)
+		return;
+	index_thread_stop = 1;
+	pthread_join(index_thread, NULL);
+	index_thread_active = 0;
+}
+
+
+
+static int zdsfs_vtoc_getattr(struct zdsfs_vtoc *vtoc, const char *path,
+			      struct stat *stbuf)
 {
 	char normds[MAXDSNAMELENGTH];
 	size_t dssize;
 	struct dataset *ds;
 	struct pdsmember *member;
 	int rc, ispds, issupported;
-	unsigned long long tracks;
+	unsigned long long tracks, size;
 	format1_label_t *f1;
 	time_t time;
 	struct tm tm;
@@ -116,24 +568,24 @@ static int zdsfs_getattr(const char *path, struct stat *stbuf)
 	if (strcmp(path, "/") == 0) {
 		stbuf->st_mode = S_IFDIR | DEF_DIR_PERM;
 		stbuf->st_nlink = 2;
-		stbuf->st_atime = zdsfsinfo.metatime;
-		stbuf->st_mtime = zdsfsinfo.metatime;
-		stbuf->st_ctime = zdsfsinfo.metatime;
+		stbuf->st_atime = vtoc->metatime;
+		stbuf->st_mtime = vtoc->metatime;
+		stbuf->st_ctime = vtoc->metatime;
 		return 0;
 	}
 
 	if (strcmp(path, "/"METADATAFILE) == 0) {
 		stbuf->st_mode = S_IFREG | DEF_FILE_PERM;
 		stbuf->st_nlink = 1;
-		stbuf->st_size = zdsfsinfo.metaused;
-		stbuf->st_atime = zdsfsinfo.metatime;
-		stbuf->st_mtime = zdsfsinfo.metatime;
-		stbuf->st_ctime = zdsfsinfo.metatime;
+		stbuf->st_size = vtoc->metaused;
+		stbuf->st_atime = vtoc->metatime;
+		stbuf->st_mtime = vtoc->metatime;
+		stbuf->st_ctime = vtoc->metatime;
 		return 0;
 	}
 
 	path_to_ds_name(path, normds, sizeof(normds));
-	rc = lzds_zdsroot_find_dataset(zdsfsinfo.zdsroot, normds, &ds);
+	rc = lzds_zdsroot_find_dataset(vtoc->zdsroot, normds, &ds);
 	if (rc)
 		return -rc;
 
@@ -182,11 +634,15 @@ static int zdsfs_getattr(const char *path, struct stat *stbuf)
 		stbuf->st_nlink = 1;
 		/* the member cannot be bigger than the data set */
 		stbuf->st_size = dssize;
+		if (!zdsfs_index_get_size(ds, normds, &size))
+			stbuf->st_size = size;
 		return 0;
 	} else { /* normal data set */
 		stbuf->st_mode = S_IFREG | DEF_FILE_PERM;
 		stbuf->st_nlink = 1;
 		stbuf->st_size = dssize;
+		if (!zdsfs_index_get_size(ds, NULL, &size))
+			stbuf->st_size = size;
 		stbuf->st_blocks = tracks * 16 * 8;
 		stbuf->st_atime = time;
 		stbuf->st_mtime = time;
@@ -195,18 +651,41 @@ static int zdsfs_getattr(const char *path, struct stat *stbuf)
 	return 0;
 }
 
-static void zdsfs_read_device(struct dasd *newdasd, const char *device)
+static int zdsfs_getattr(const char *path, struct stat *stbuf)
 {
-	struct errorlog *log;
+	struct zdsfs_vtoc *vtoc;
 	int rc;
 
-	rc = dasd_disk_reserve(device);
+	vtoc = zdsfs_vtoc_get();
+	rc = zdsfs_vtoc_getattr(vtoc, path, stbuf);
+	zdsfs_vtoc_put(vtoc);
+	return rc;
+}
+
+/*
+ * Raw track image files, e.g. for tests, cannot be reserved
+ */
+static int zdsfs_is_image(const char *device)
+{
+	struct stat st;
+
+	return stat(device, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+static int zdsfs_read_device(struct zdsroot *root, struct dasd *newdasd,
+			     const char *device)
+{
+	struct errorlog *log;
+	int rc, rc_rel, image;
+
+	image = zdsfs_is_image(device);
+	rc = image ? 0 : dasd_disk_reserve(device);
 	if (rc) {
 		fprintf(stderr, "error when reserving device %s: %s\n",
 			device, strerror(rc));
 		lzds_dasd_get_errorlog(newdasd, &log);
 		lzds_errorlog_fprint(log, stderr);
-		exit(1);
+		return rc;
 	}
 	rc = lzds_dasd_alloc_rawvtoc(newdasd);
 	if (rc) {
@@ -214,30 +693,58 @@ static void zdsfs_read_device(struct dasd *newdasd, const char *device)
 			device, strerror(rc));
 		lzds_dasd_get_errorlog(newdasd, &log);
 		lzds_errorlog_fprint(log, stderr);
-		exit(1);
+		goto out_release;
 	}
-	rc = lzds_zdsroot_extract_datasets_from_dasd(zdsfsinfo.zdsroot,
-						     newdasd);
+	rc = lzds_zdsroot_extract_datasets_from_dasd(root, newdasd);
 	if (rc) {
 		fprintf(stderr,
 			"error when extracting data sets from dasd %s: %s\n",
 			device, strerror(rc));
-		lzds_zdsroot_get_errorlog(zdsfsinfo.zdsroot, &log);
+		lzds_zdsroot_get_errorlog(root, &log);
 		lzds_errorlog_fprint(log, stderr);
-		exit(1);
 	}
-	rc = dasd_disk_release(device);
-	if (rc) {
+out_release:
+	if (image)
+		return rc;
+	rc_rel = dasd_disk_release(device);
+	if (rc_rel) {
 		fprintf(stderr, "error when releasing device %s: %s\n",
-			device, strerror(rc));
+			device, strerror(rc_rel));
 		lzds_dasd_get_errorlog(newdasd, &log);
 		lzds_errorlog_fprint(log, stderr);
-		exit(1);
+		if (!rc)
+			rc = rc_rel;
 	}
+	return rc;
 }
 
+static int zdsfs_add_device(struct zdsroot *root, const char *device)
+{
+	struct dasd *newdasd;
+	struct errorlog *log;
+	int rc;
 
-static int zdsfs_statfs(const char *UNUSED(path), struct statvfs *statvfs)
+	rc = lzds_zdsroot_add_device(root, device, &newdasd);
+	if (rc) {
+		fprintf(stderr, "error when adding device %s: %s\n", device,
+			strerror(rc));
+		lzds_zdsroot_get_errorlog(root, &log);
+		lzds_errorlog_fprint(log, stderr);
+		return rc;
+	}
+	rc = lzds_dasd_read_vlabel(newdasd);
+	if (rc) {
+		fprintf(stderr, "error when reading volume label from "
+			"device %s: %s\n", device, strerror(rc));
+		lzds_dasd_get_errorlog(newdasd, &log);
+		lzds_errorlog_fprint(log, stderr);
+		return rc;
+	}
+	return zdsfs_read_device(root, newdasd, device);
+}
+
+
+static int zdsfs_vtoc_statfs(struct zdsfs_vtoc *vtoc, struct statvfs *statvfs)
 {
 	struct dasditerator *dasdit;
 	unsigned int cyls, heads;
@@ -248,7 +755,7 @@ static int zdsfs_statfs(const char *UNUSED(path), struct statvfs *statvfs)
 	int rc;
 
 	totaltracks = 0;
-	rc = lzds_zdsroot_alloc_dasditerator(zdsfsinfo.zdsroot, &dasdit);
+	rc = lzds_zdsroot_alloc_dasditerator(vtoc->zdsroot, &dasdit);
 	if (rc)
 		return -ENOMEM;
 	while (!lzds_dasditerator_get_next_dasd(dasdit, &dasd)) {
@@ -259,7 +766,7 @@ static int zdsfs_statfs(const char *UNUSED(path), struct statvfs *statvfs)
 	lzds_dasditerator_free(dasdit);
 
 	usedtracks = 0;
-	rc = lzds_zdsroot_alloc_dsiterator(zdsfsinfo.zdsroot, &dsit);
+	rc = lzds_zdsroot_alloc_dsiterator(vtoc->zdsroot, &dsit);
 	if (rc)
 		return -ENOMEM;
 	while (!lzds_dsiterator_get_next_dataset(dsit, &ds)) {
@@ -283,35 +790,69 @@ static int zdsfs_statfs(const char *UNUSED(path), struct statvfs *statvfs)
 	return 0;
 }
 
+static int zdsfs_statfs(const char *UNUSED(path), struct statvfs *statvfs)
+{
+	struct zdsfs_vtoc *vtoc;
+	int rc;
+
+	vtoc = zdsfs_vtoc_get();
+	rc = zdsfs_vtoc_statfs(vtoc, statvfs);
+	zdsfs_vtoc_put(vtoc);
+	return rc;
+}
+
 
+/* Read the VTOCs of all devices again and replace the current snapshot */
 static int zdsfs_update_vtoc(void)
 {
+	struct zdsfs_vtoc *vtoc, *old;
 	struct dasditerator *dasdit;
 	struct dasd *dasd;
 	int rc;
 
-	lzds_dslist_free(zdsfsinfo.zdsroot);
-	rc = lzds_zdsroot_alloc_dasditerator(zdsfsinfo.zdsroot, &dasdit);
-	if (rc)
+	vtoc = zdsfs_vtoc_alloc();
+	if (!vtoc)
 		return -ENOMEM;
-
-	while (!lzds_dasditerator_get_next_dasd(dasdit, &dasd))
-		zdsfs_read_device(dasd, dasd->device);
-
+	old = zdsfs_vtoc_get();
+	rc = lzds_zdsroot_alloc_dasditerator(old->zdsroot, &dasdit);
+	if (rc) {
+		rc = ENOMEM;
+		goto out;
+	}
+	while (!lzds_dasditerator_get_next_dasd(dasdit, &dasd)) {
+		rc = zdsfs_add_device(vtoc->zdsroot, dasd->device);
+		if (rc)
+			break;
+	}
 	lzds_dasditerator_free(dasdit);
-	rc = zdsfs_verify_datasets();
 	if (rc)
-		return rc;
-
-	rc = zdsfs_create_meta_data_buffer(&zdsfsinfo);
+		goto out;
+	rc = zdsfs_verify_datasets(vtoc->zdsroot);
 	if (rc)
-		return rc;
-
+		goto out;
+	rc = zdsfs_create_meta_data_buffer(vtoc);
+	if (rc) {
+		rc = -rc;
+		goto out;
+	}
+	zdsfs_vtoc_put(old);
+
+	/* swap the snapshots, the old one is freed with its last reference */
+	pthread_mutex_lock(&vtoc_mutex);
+	old = zdsfsinfo.vtoc;
+	zdsfsinfo.vtoc = vtoc;
+	pthread_mutex_unlock(&vtoc_mutex);
+	zdsfs_vtoc_put(old);
 	return 0;
+
+out:
+	zdsfs_vtoc_put(old);
+	zdsfs_vtoc_put(vtoc);
+	return -rc;
 }
 
-static int zdsfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
-			 off_t UNUSED(offset), struct fuse_file_info *UNUSED(fi))
+static int zdsfs_vtoc_readdir(struct zdsfs_vtoc *vtoc, const char *path,
+			      void *buf, fuse_fill_dir_t filler)
 {
 	char normds[MAXDSNAMELENGTH];
 	char *mbrname;
@@ -323,10 +864,6 @@ static int zdsfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
 	int rc;
 	int ispds, issupported;
 
-	rc = zdsfs_update_vtoc();
-	if (rc)
-		return rc;
-
 	/* we have two type of directories
 	 * type one: the root directory contains all data sets
 	 */
@@ -338,7 +875,7 @@ static int zdsfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
 		 * normal files and directories here, that is done
 		 * in the rdf_getattr function
 		 */
-		rc = lzds_zdsroot_alloc_dsiterator(zdsfsinfo.zdsroot, &dsit);
+		rc = lzds_zdsroot_alloc_dsiterator(vtoc->zdsroot, &dsit);
 		if (rc)
 			return -ENOMEM;
 		while (!lzds_dsiterator_get_next_dataset(dsit, &ds)) {
@@ -354,7 +891,7 @@ static int zdsfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
 
 	/* type two: a partitioned data set, contains all PDS members */
 	path_to_ds_name(path, normds, sizeof(normds));
-	rc = lzds_zdsroot_find_dataset(zdsfsinfo.zdsroot, normds, &ds);
+	rc = lzds_zdsroot_find_dataset(vtoc->zdsroot, normds, &ds);
 	if (rc)
 		return -ENOENT;
 	lzds_dataset_get_is_PDS(ds, &ispds);
@@ -375,16 +912,122 @@ static int zdsfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
 	return 0;
 }
 
+static int zdsfs_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
+			 off_t UNUSED(offset), struct fuse_file_info *UNUSED(fi))
+{
+	struct zdsfs_vtoc *vtoc;
+	int rc;
+
+	rc = zdsfs_update_vtoc();
+	if (rc)
+		return rc;
+	vtoc = zdsfs_vtoc_get();
+	rc = zdsfs_vtoc_readdir(vtoc, path, buf, filler);
+	zdsfs_vtoc_put(vtoc);
+	return rc;
+}
+
+
+/* Copy the seek buffer of another handle of the same open file */
+static int zdsfs_copy_seekbuffer(struct dshandle *dsh, struct dshandle *src)
+{
+	size_t size;
+	char *buf;
+	int rc;
+
+	rc = lzds_dshandle_save_seekbuffer(src, &buf, &size);
+	if (rc)
+		return rc;
+	rc = lzds_dshandle_load_seekbuffer(dsh, buf, size);
+	free(buf);
+	return rc;
+}
+
+/* Allocate and open a dshandle for the data set or member of an open file.
+ * If seeksrc is specified, the new handle starts with its seek buffer.
+ */
+static int zdsfs_alloc_dshandle(struct zdsfs_file_info *zfi,
+				struct dshandle *seeksrc,
+				struct dshandle **dshp)
+{
+	struct dshandle *dsh;
+	struct errorlog *log;
+	int rc;
+
+	rc = lzds_dataset_alloc_dshandle(zfi->ds, zdsfsinfo.tracks_per_frame,
+					 &dsh);
+	if (rc)
+		return -rc;
+
+	/* a complete seek buffer from the index makes all seeks fast */
+	rc = zdsfs_index_load_seekbuffer(dsh, zfi->ds, zfi->mbrname);
+	if (rc && seeksrc)
+		rc = zdsfs_copy_seekbuffer(dsh, seeksrc);
+	if (rc)
+		rc = lzds_dshandle_set_seekbuffer(dsh,
+						  zdsfsinfo.seek_buffer_size);
+	if (rc) {
+		fprintf(stderr,	"Error when preparing seek buffer:\n");
+		goto error;
+	}
+	/* if the data set is a PDS, then the path must contain a valid
+	 * member name, and the context must be set to this member
+	 */
+	if (zfi->mbrname[0]) {
+		rc = lzds_dshandle_set_member(dsh, zfi->mbrname);
+		if (rc) {
+			fprintf(stderr,	"Error when preparing member:\n");
+			goto error;
+		}
+	}
+	rc = lzds_dshandle_set_keepRDW(dsh, zdsfsinfo.keepRDW);
+	if (rc) {
+		fprintf(stderr,	"Error when preparing RDW setting:\n");
+		goto error;
+	}
+	rc = lzds_dshandle_set_prefetch(dsh, zdsfsinfo.prefetch);
+	if (rc) {
+		fprintf(stderr,	"Error when preparing prefetch setting:\n");
+		goto error;
+	}
+	rc = lzds_dshandle_open(dsh);
+	if (rc) {
+		fprintf(stderr,	"Error when opening data set:\n");
+		goto error;
+	}
+	*dshp = dsh;
+	return 0;
+
+error:
+	lzds_dshandle_get_errorlog(dsh, &log);
+	lzds_errorlog_fprint(log, stderr);
+	lzds_dshandle_free(dsh);
+	return -rc;
+}
+
+static void zdsfs_free_file_info(struct zdsfs_file_info *zfi)
+{
+	int i;
+
+	for (i = 0; i < MAX_DSHANDLES; i++) {
+		if (!zfi->dsh[i])
+			continue;
+		lzds_dshandle_close(zfi->dsh[i]);
+		lzds_dshandle_free(zfi->dsh[i]);
+	}
+	if (zfi->vtoc)
+		zdsfs_vtoc_put(zfi->vtoc);
+	pthread_cond_destroy(&zfi->cond);
+	pthread_mutex_destroy(&zfi->mutex);
+	free(zfi);
+}
 
 static int zdsfs_open(const char *path, struct fuse_file_info *fi)
 {
 	char normds[45];
-	struct dshandle *dsh;
-	struct dataset *ds;
 	struct zdsfs_file_info *zfi;
 	int rc;
 	int ispds, issupported;
-	struct errorlog *log;
 
 	if ((fi->flags & 3) != O_RDONLY)
 		return -EACCES;
@@ -395,162 +1038,182 @@ static int zdsfs_open(const char *path, struct fuse_file_info *fi)
 	 */
 	fi->direct_io = 1;
 
-	zfi = malloc(sizeof(*zfi));
+	zfi = calloc(1, sizeof(*zfi));
 	if (!zfi)
 		return -ENOMEM;
-	rc = pthread_mutex_init(&zfi->mutex, NULL);
-	if (rc)
-		goto error1;
+	pthread_mutex_init(&zfi->mutex, NULL);
+	pthread_cond_init(&zfi->cond, NULL);
 
 	if (strcmp(path, "/"METADATAFILE) == 0) {
 		rc = zdsfs_update_vtoc();
 		if (rc)
-			return rc;
-		zfi->dsh = NULL;
+			goto error;
+		/* the snapshot keeps the meta data of this open file stable */
+		zfi->vtoc = zdsfs_vtoc_get();
 		zfi->is_metadata_file = 1;
 		zfi->metaread = 0;
 		fi->fh = (unsigned long)zfi;
 		return 0;
 	}
 
+	zfi->vtoc = zdsfs_vtoc_get();
 	path_to_ds_name(path, normds, sizeof(normds));
-	rc = lzds_zdsroot_find_dataset(zdsfsinfo.zdsroot, normds, &ds);
-	if (rc)
-		goto error1;
+	rc = lzds_zdsroot_find_dataset(zfi->vtoc->zdsroot, normds, &zfi->ds);
+	if (rc) {
+		rc = -rc;
+		goto error;
+	}
 
-	lzds_dataset_get_is_supported(ds, &issupported);
+	lzds_dataset_get_is_supported(zfi->ds, &issupported);
 	if (!issupported) {
 		/* we should never get this error, as unsupported data sets are
 		 * not listed. But just in case, print a message */
 		fprintf(stderr,	"Error: Data set %s is not supported\n", normds);
 		rc = -ENOENT;
-		goto error1;
-	}
-
-	rc = lzds_dataset_alloc_dshandle(ds, zdsfsinfo.tracks_per_frame, &dsh);
-	if (rc) {
-		rc = -rc;
-		goto error1;
+		goto error;
 	}
 
-	rc = lzds_dshandle_set_seekbuffer(dsh, zdsfsinfo.seek_buffer_size);
-	if (rc) {
-		fprintf(stderr,	"Error when preparing seek buffer:\n");
-		lzds_dshandle_get_errorlog(dsh, &log);
-		lzds_errorlog_fprint(log, stderr);
-		rc = -rc;
-		goto error2;
-	}
-	/* if the data set is a PDS, then the path must contain a valid
-	 * member name, and the context must be set to this member
-	 */
-	lzds_dataset_get_is_PDS(ds, &ispds);
+	lzds_dataset_get_is_PDS(zfi->ds, &ispds);
 	if (ispds) {
-		path_to_member_name(path, normds, sizeof(normds));
-		rc = lzds_dshandle_set_member(dsh, normds);
-		if (rc) {
-			fprintf(stderr,	"Error when preparing member:\n");
-			lzds_dshandle_get_errorlog(dsh, &log);
-			lzds_errorlog_fprint(log, stderr);
-			rc = -rc;
-			goto error2;
+		path_to_member_name(path, zfi->mbrname, sizeof(zfi->mbrname));
+		if (!zfi->mbrname[0]) {
+			rc = -EISDIR;
+			goto error;
 		}
 	}
-	rc = lzds_dshandle_set_keepRDW(dsh, zdsfsinfo.keepRDW);
-	if (rc) {
-		fprintf(stderr,	"Error when preparing RDW setting:\n");
-		lzds_dshandle_get_errorlog(dsh, &log);
-		lzds_errorlog_fprint(log, stderr);
-		rc = -rc;
-		goto error2;
-	}
-	rc = lzds_dshandle_open(dsh);
-	if (rc) {
-		fprintf(stderr,	"Error when opening data set:\n");
-		lzds_dshandle_get_errorlog(dsh, &log);
-		lzds_errorlog_fprint(log, stderr);
-		rc = -rc;
-		goto error2;
-	}
+	/* the first handle is allocated here to report errors on open */
+	rc = zdsfs_alloc_dshandle(zfi, NULL, &zfi->dsh[0]);
+	if (rc)
+		goto error;
 	zfi->is_metadata_file = 0;
 	zfi->metaread = 0;
-	zfi->dsh = dsh;
 	fi->fh = (uint64_t)(unsigned long)zfi;
 	return 0;
 
-error2:
-	lzds_dshandle_free(dsh);
-error1:
-	free(zfi);
+error:
+	zdsfs_free_file_info(zfi);
 	return rc;
-
 }
 
 static int zdsfs_release(const char *UNUSED(path), struct fuse_file_info *fi)
 {
-	struct zdsfs_file_info *zfi;
-	int rc;
-
 	if (!fi->fh)
 		return -EINVAL;
-	zfi = (struct zdsfs_file_info *)(unsigned long)fi->fh;
-	if (zfi->dsh) {
-		lzds_dshandle_close(zfi->dsh);
-		lzds_dshandle_free(zfi->dsh);
-	}
-	rc = pthread_mutex_destroy(&zfi->mutex);
-	if (rc)
-		fprintf(stderr,	"Error: could not destroy mutex, rc=%d\n", rc);
-	free(zfi);
+	zdsfs_free_file_info((struct zdsfs_file_info *)(unsigned long)fi->fh);
 	return 0;
 }
 
+/*
+ * Get an idle dshandle of an open file for a read at offset and mark it
+ * busy. A handle that is positioned at offset is preferred, so that
+ * sequential reads do not need to seek. Otherwise the handle with the
+ * closest position before offset is used, and any other idle handle if
+ * all idle handles are positioned after offset. A new handle is only
+ * allocated if all handles are busy. Must be called with zfi->mutex held.
+ */
+static int zdsfs_get_dshandle(struct zdsfs_file_info *zfi, off_t offset)
+{
+	int i, rc, best, fallback, free_slot;
+	long long dshoffset, bestoffset;
+	struct dshandle *dsh;
+
+	while (1) {
+		best = -1;
+		fallback = -1;
+		free_slot = -1;
+		bestoffset = -1;
+		for (i = 0; i < MAX_DSHANDLES; i++) {
+			if (!zfi->dsh[i]) {
+				if (!zfi->busy[i] && free_slot < 0)
+					free_slot = i;
+				continue;
+			}
+			if (zfi->busy[i])
+				continue;
+			lzds_dshandle_get_offset(zfi->dsh[i], &dshoffset);
+			if (dshoffset == offset) {
+				best = i;
+				break;
+			}
+			if (dshoffset > offset) {
+				if (fallback < 0)
+					fallback = i;
+				continue;
+			}
+			if (dshoffset > bestoffset) {
+				best = i;
+				bestoffset = dshoffset;
+			}
+		}
+		if (best < 0)
+			best = fallback;
+		if (best >= 0) {
+			zfi->busy[best] = 1;
+			return best;
+		}
+		if (free_slot >= 0) {
+			/* the slot is reserved while the handle is allocated */
+			zfi->busy[free_slot] = 1;
+			pthread_mutex_unlock(&zfi->mutex);
+			rc = zdsfs_alloc_dshandle(zfi, zfi->dsh[0], &dsh);
+			pthread_mutex_lock(&zfi->mutex);
+			if (!rc) {
+				zfi->dsh[free_slot] = dsh;
+				return free_slot;
+			}
+			/* do not use this slot again */
+			zfi->busy[free_slot] = -1;
+			continue;
+		}
+		pthread_cond_wait(&zfi->cond, &zfi->mutex);
+	}
+}
+
 static int zdsfs_read(const char *UNUSED(path), char *buf, size_t size,
 		      off_t offset, struct fuse_file_info *fi)
 {
 	struct zdsfs_file_info *zfi;
-	ssize_t count;
-	int rc, rc2;
-	long long rcoffset;
+	struct zdsfs_vtoc *vtoc;
 	struct errorlog *log;
+	ssize_t count;
+	int rc, i;
 
 	if (!fi->fh)
 		return -ENOENT;
 	zfi = (struct zdsfs_file_info *)(unsigned long)fi->fh;
 
-	rc2 = pthread_mutex_lock(&zfi->mutex);
-	if (rc2) {
-		fprintf(stderr,	"Error: could not lock mutex, rc=%d\n", rc2);
-		return -EIO;
-	}
-	rc = 0;
 	if (zfi->is_metadata_file) {
-		if (zfi->metaread >= zdsfsinfo.metaused) {
-			pthread_mutex_unlock(&zfi->mutex);
-			return 0;
+		vtoc = zfi->vtoc;
+		pthread_mutex_lock(&zfi->mutex);
+		count = 0;
+		if (zfi->metaread < vtoc->metaused) {
+			count = vtoc->metaused - zfi->metaread;
+			if (size < (size_t)count)
+				count = size;
+			memcpy(buf, &vtoc->metadata[zfi->metaread], count);
+			zfi->metaread += count;
 		}
-		count = zdsfsinfo.metaused - zfi->metaread;
-		if (size < (size_t)count)
-			count = size;
-		memcpy(buf, &zdsfsinfo.metadata[zfi->metaread], count);
-		zfi->metaread += count;
-	} else {
-		lzds_dshandle_get_offset(zfi->dsh, &rcoffset);
-		if (rcoffset != offset)
-			rc = lzds_dshandle_lseek(zfi->dsh, offset, &rcoffset);
-		if (!rc)
-			rc = lzds_dshandle_read(zfi->dsh, buf, size, &count);
+		pthread_mutex_unlock(&zfi->mutex);
+		return count;
 	}
-	rc2 = pthread_mutex_unlock(&zfi->mutex);
-	if (rc2)
-		fprintf(stderr,	"Error: could not unlock mutex, rc=%d\n", rc2);
+
+	/* reads of different handles run in parallel */
+	pthread_mutex_lock(&zfi->mutex);
+	i = zdsfs_get_dshandle(zfi, offset);
+	pthread_mutex_unlock(&zfi->mutex);
+
+	rc = lzds_dshandle_pread(zfi->dsh[i], buf, size, offset, &count);
 	if (rc) {
 		fprintf(stderr,	"Error when reading from data set:\n");
-		lzds_dshandle_get_errorlog(zfi->dsh, &log);
+		lzds_dshandle_get_errorlog(zfi->dsh[i], &log);
 		lzds_errorlog_fprint(log, stderr);
-		return -rc;
 	}
-	return count;
+
+	pthread_mutex_lock(&zfi->mutex);
+	zfi->busy[i] = 0;
+	pthread_cond_signal(&zfi->cond);
+	pthread_mutex_unlock(&zfi->mutex);
+	return rc ? -rc : count;
 }
 
 
@@ -586,8 +1249,8 @@ static int zdsfs_listxattr(const char *path, char *list, size_t size)
 	return pos;
 }
 
-static int zdsfs_getxattr(const char *path, const char *name, char *value,
-			  size_t size)
+static int zdsfs_vtoc_getxattr(struct zdsfs_vtoc *vtoc, const char *path,
+			       const char *name, char *value, size_t size)
 {
 	char normds[45];
 	struct dataset *ds;
@@ -597,12 +1260,8 @@ static int zdsfs_getxattr(const char *path, const char *name, char *value,
 	size_t length;
 	int ispds;
 
-	/* nothing for root directory but clear error code needed */
-	if (!strcmp(path, "/") || !strcmp(path, "/"METADATAFILE))
-		return -ENODATA;
-
 	path_to_ds_name(path, normds, sizeof(normds));
-	rc = lzds_zdsroot_find_dataset(zdsfsinfo.zdsroot, normds, &ds);
+	rc = lzds_zdsroot_find_dataset(vtoc->zdsroot, normds, &ds);
 	if (rc)
 		return -rc;
 	lzds_dataset_get_format1_dscb(ds, &f1);
@@ -641,6 +1300,22 @@ static int zdsfs_getxattr(const char *path, const char *name, char *value,
 
 }
 
+static int zdsfs_getxattr(const char *path, const char *name, char *value,
+			  size_t size)
+{
+	struct zdsfs_vtoc *vtoc;
+	int rc;
+
+	/* nothing for root directory but clear error code needed */
+	if (!strcmp(path, "/") || !strcmp(path, "/"METADATAFILE))
+		return -ENODATA;
+
+	vtoc = zdsfs_vtoc_get();
+	rc = zdsfs_vtoc_getxattr(vtoc, path, name, value, size);
+	zdsfs_vtoc_put(vtoc);
+	return rc;
+}
+
 #endif /* HAVE_SETXATTR */
 
 
@@ -651,6 +1326,8 @@ static struct fuse_operations rdf_oper = {
 	.open      = zdsfs_open,
 	.release   = zdsfs_release,
 	.read      = zdsfs_read,
+	.init      = zdsfs_init,
+	.destroy   = zdsfs_destroy,
 #ifdef HAVE_SETXATTR
 	.listxattr = zdsfs_listxattr,
 	.getxattr  = zdsfs_getxattr,
@@ -659,7 +1336,7 @@ static struct fuse_operations rdf_oper = {
 };
 
 
-static int zdsfs_verify_datasets(void)
+static int zdsfs_verify_datasets(struct zdsroot *root)
 {
 	int allcomplete, rc;
 	struct dataset *ds;
@@ -669,7 +1346,7 @@ static int zdsfs_verify_datasets(void)
 
 	allcomplete = 1;
 
-	rc = lzds_zdsroot_alloc_dsiterator(zdsfsinfo.zdsroot, &dsit);
+	rc = lzds_zdsroot_alloc_dsiterator(root, &dsit);
 	if (rc)
 		return ENOMEM;
 	while (!lzds_dsiterator_get_next_dataset(dsit, &ds)) {
@@ -709,7 +1386,7 @@ static int zdsfs_verify_datasets(void)
 }
 
 
-static int zdsfs_create_meta_data_buffer(struct zdsfs_info *info)
+static int zdsfs_create_meta_data_buffer(struct zdsfs_vtoc *info)
 {
 	char *mbrname;
 	char *dsname;
@@ -736,7 +1413,7 @@ static int zdsfs_create_meta_data_buffer(struct zdsfs_info *info)
 	metaused = 0;
 	metadata[metaused] = 0;
 
-	rc = lzds_zdsroot_alloc_dsiterator(zdsfsinfo.zdsroot, &dsit);
+	rc = lzds_zdsroot_alloc_dsiterator(info->zdsroot, &dsit);
 	if (rc) {
 		rc = -ENOMEM;
 		goto error;
@@ -831,6 +1508,7 @@ enum {
 	KEY_DEVFILE,
 	KEY_TRACKS,
 	KEY_SEEKBUFFER,
+	KEY_INDEXDIR,
 };
 
 #define ZDSFS_OPT(t, p, v) { t, offsetof(struct zdsfs_info, p), v }
@@ -843,9 +1521,11 @@ static const struct fuse_opt zdsfs_opts[] = {
 	FUSE_OPT_KEY("-l %s",		KEY_DEVFILE),
 	FUSE_OPT_KEY("tracks=",         KEY_TRACKS),
 	FUSE_OPT_KEY("seekbuffer=",     KEY_SEEKBUFFER),
+	FUSE_OPT_KEY("indexdir=",       KEY_INDEXDIR),
 	ZDSFS_OPT("rdw",                keepRDW, 1),
 	ZDSFS_OPT("ignore_incomplete",  allow_inclomplete_multi_volume, 1),
 	ZDSFS_OPT("check_host_count",   host_count, 1),
+	ZDSFS_OPT("prefetch",           prefetch, 1),
 	FUSE_OPT_END
 };
 
@@ -874,33 +1554,16 @@ static void usage(const char *progname)
 "                           size (default 1048576)\n"
 "    -o check_host_count    Stop processing if the device is used by another\n"
 "                           operating system instance\n"
+"    -o prefetch            Read the next track buffer in the background\n"
+"    -o indexdir=DIR        Store exact data set sizes and seek buffers in DIR\n"
 		, progname);
 }
 
 static void zdsfs_process_device(const char *device)
 {
-	struct dasd *newdasd;
-	struct errorlog *log;
-	int rc;
-
-	rc = lzds_zdsroot_add_device(zdsfsinfo.zdsroot, device, &newdasd);
-	if (rc) {
-		fprintf(stderr, "error when adding device %s: %s\n", device,
-			strerror(rc));
-		lzds_zdsroot_get_errorlog(zdsfsinfo.zdsroot, &log);
-		lzds_errorlog_fprint(log, stderr);
+	if (zdsfs_add_device(zdsfsinfo.vtoc->zdsroot, device))
 		exit(1);
-	}
 	zdsfsinfo.devcount++;
-	rc = lzds_dasd_read_vlabel(newdasd);
-	if (rc) {
-		fprintf(stderr, "error when reading volume label from "
-			"device %s: %s\n", device, strerror(rc));
-		lzds_dasd_get_errorlog(newdasd, &log);
-		lzds_errorlog_fprint(log, stderr);
-		exit(1);
-	}
-	zdsfs_read_device(newdasd, device);
 }
 
 static void zdsfs_process_device_file(const char *devfile)
@@ -1036,6 +1699,22 @@ static int zdsfs_process_args(void *UNUSED(data), const char *arg, int key,
 		}
 		zdsfsinfo.seek_buffer_size = seek_buffer_size;
 		return 0;
+	case KEY_INDEXDIR:
+		value = arg + strlen("indexdir=");
+		if (mkdir(value, 0700) && errno != EEXIST) {
+			fprintf(stderr, "could not create index directory %s:"
+				" %s\n", value, strerror(errno));
+			exit(1);
+		}
+		/* fuse changes the working directory to / */
+		free(zdsfsinfo.indexdir);
+		zdsfsinfo.indexdir = realpath(value, NULL);
+		if (!zdsfsinfo.indexdir) {
+			fprintf(stderr, "could not resolve index directory %s:"
+				" %s\n", value, strerror(errno));
+			exit(1);
+		}
+		return 0;
 	case KEY_HELP:
 		usage(outargs->argv[0]);
 
@@ -1075,8 +1754,8 @@ int main(int argc, char *argv[])
 	zdsfsinfo.tracks_per_frame = 128;
 	zdsfsinfo.seek_buffer_size = 1048576;
 
-	rc = lzds_zdsroot_alloc(&zdsfsinfo.zdsroot);
-	if (rc) {
+	zdsfsinfo.vtoc = zdsfs_vtoc_alloc();
+	if (!zdsfsinfo.vtoc) {
 		fprintf(stderr, "Could not allocate internal structures\n");
 		exit(1);
 	}
@@ -1095,26 +1774,31 @@ int main(int argc, char *argv[])
 
 	if (zdsfsinfo.host_count) {
 		/* check, print error and exit if multiple online */
-		rc = lzds_analyse_open_count(zdsfsinfo.zdsroot, 0);
+		rc = lzds_analyse_open_count(zdsfsinfo.vtoc->zdsroot, 0);
 		if (rc == -EACCES)
 			goto cleanup;
 	} else {
 		/* check, print warning if multiple online */
-		lzds_analyse_open_count(zdsfsinfo.zdsroot, 1);
+		lzds_analyse_open_count(zdsfsinfo.vtoc->zdsroot, 1);
 	}
 
-	rc = zdsfs_verify_datasets();
+	rc = zdsfs_verify_datasets(zdsfsinfo.vtoc->zdsroot);
 	if (rc)
 		goto cleanup;
 
-	rc = zdsfs_create_meta_data_buffer(&zdsfsinfo);
+	rc = zdsfs_create_meta_data_buffer(zdsfsinfo.vtoc);
 	if (rc)
 		goto cleanup;
 
+	if (zdsfsinfo.indexdir)
+		zdsfs_index_read_dir();
+
 	rc = fuse_main(args.argc, args.argv, &rdf_oper, NULL);
 
 cleanup:
-	lzds_zdsroot_free(zdsfsinfo.zdsroot);
+	zdsfs_vtoc_put(zdsfsinfo.vtoc);
+	zdsfs_index_free();
+	free(zdsfsinfo.indexdir);
 
 	fuse_opt_free_args(&args);
 	return rc;
@@ -0,0 +1,97 @@
+#!/bin/sh
+#
+# zdsfs_bench.sh - Benchmark parallel reads from zdsfs
+#
+# Usage: zdsfs_bench.sh IMAGE [JOBS...]
+#
+# Mount the raw track image IMAGE with zdsfs on a temporary mount point.
+# Read all data sets and PDS members with JOBS parallel readers for each
+# JOBS value (default 1 2 4 8) and measure the run time. Then read the
+# largest file with JOBS readers at non-overlapping offsets. The checksums
+# of each run are compared to the checksums of the first run.
+#
+# A raw track image of a DASD can be created with the raw_track_access
+# sysfs attribute of the device set to 1, for example:
+#
+#   dd if=/dev/dasdX of=IMAGE bs=64k iflag=direct
+#
+# ZDSFS selects the zdsfs binary (default ./zdsfs).
+#
+# Copyright IBM Corp. 2020
+#
+# s390-tools is free software; you can redistribute it and/or modify
+# it under the terms of the MIT license. See LICENSE for details.
+#
+
+IMAGE=$1
+if [ ! -f "$IMAGE" ]; then
+	echo "Usage: $0 IMAGE [JOBS...]" >&2
+	exit 1
+fi
+shift
+JOBS=${*:-1 2 4 8}
+ZDSFS=${ZDSFS:-./zdsfs}
+BS=131072
+
+tmp=`mktemp -d /tmp/zdsfs_bench.XXXXXX` || exit 1
+MNT=$tmp/mnt
+mkdir $MNT
+trap "fusermount -u -q $MNT 2> /dev/null; rm -rf $tmp" EXIT
+trap "exit 1" TERM INT
+
+now_ms() {
+	echo $((`date +%s%N` / 1000000))
+}
+
+$ZDSFS "$IMAGE" $MNT || exit 1
+
+find $MNT -type f ! -name metadata.txt > $tmp/files
+find $MNT -type f ! -name metadata.txt -printf '%s %p\n' | sort -n |
+	tail -1 > $tmp/largest
+read size largest < $tmp/largest
+if [ -z "$largest" ]; then
+	echo "No data sets found on $IMAGE" >&2
+	exit 1
+fi
+blocks=$(((size + BS - 1) / BS))
+echo "`wc -l < $tmp/files` files, largest ${largest#$MNT/} ($size bytes)"
+
+printf "%-24s %10s\n" "test" "time [ms]"
+for j in $JOBS; do
+	start=`now_ms`
+	xargs -d '\n' -n 1 -P $j md5sum < $tmp/files | sort > $tmp/all.$j
+	end=`now_ms`
+	printf "%-24s %10d\n" "all files, jobs $j" $((end - start))
+	if [ ! -f $tmp/all.ref ]; then
+		mv $tmp/all.$j $tmp/all.ref
+	elif ! cmp -s $tmp/all.ref $tmp/all.$j; then
+		echo "Checksums of all files with $j jobs differ" >&2
+		exit 1
+	fi
+done
+
+for j in $JOBS; do
+	part=$(((blocks + j - 1) / j))
+	start=`now_ms`
+	i=0
+	while [ $i -lt $j ]; do
+		dd if="$largest" of=$tmp/part.$i bs=$BS skip=$((i * part)) \
+		   count=$part 2> /dev/null &
+		i=$((i + 1))
+	done
+	wait
+	end=`now_ms`
+	printf "%-24s %10d\n" "largest file, jobs $j" $((end - start))
+	i=0
+	while [ $i -lt $j ]; do
+		cat $tmp/part.$i
+		i=$((i + 1))
+	done | md5sum > $tmp/one.$j
+	rm -f $tmp/part.*
+	if [ ! -f $tmp/one.ref ]; then
+		mv $tmp/one.$j $tmp/one.ref
+	elif ! cmp -s $tmp/one.ref $tmp/one.$j; then
+		echo "Checksum of the largest file with $j jobs differs" >&2
+		exit 1
+	fi
+done
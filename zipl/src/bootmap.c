@@ -19,6 +19,7 @@
 #include <sys/types.h>
 
 #include "lib/zt_common.h"
+#include "lib/util_list.h"
 #include "lib/util_part.h"
 #include "lib/util_path.h"
 
@@ -288,22 +289,168 @@ struct component_loc {
 	size_t size;
 };
 
+/* Kind of key of a component cache entry */
+typedef enum {
+	cache_key_buffer,	/* Data written to the bootmap file */
+	cache_key_file,		/* Identity of a file copied to the bootmap */
+	cache_key_blocklist	/* Block list of a file on the target device */
+} cache_key_type;
+
+/* Component already added to the bootmap file during this run */
+struct component_cache_entry {
+	struct util_list_node node;
+	cache_key_type type;
+	uint64_t hash;			/* FNV-1a hash of the key */
+	void *key;			/* Copy of the key */
+	size_t key_size;
+	disk_blockptr_t segment;	/* First segment table block */
+	blocknum_t count;		/* Number of data blocks */
+};
+
+/* Identity of an unchanged file */
+struct cache_file_key {
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	struct timespec mtime;
+	struct timespec ctime;
+	size_t trailer;
+};
+
+/* Components written to the bootmap file that is currently created. The
+ * segment tables (and the data) of a component that is added again, e.g.
+ * the stage 3 loader or a kernel and ramdisk used by multiple menu
+ * sections, are reused instead of being written again. */
+static struct util_list *component_cache;
+
+static uint64_t
+component_cache_hash(cache_key_type type, const void *key, size_t size)
+{
+	const uint8_t *byte = key;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	hash = (hash ^ type) * 0x100000001b3ULL;
+	for (i = 0; i < size; i++)
+		hash = (hash ^ byte[i]) * 0x100000001b3ULL;
+	return hash;
+}
+
+static struct component_cache_entry *
+component_cache_find(cache_key_type type, const void *key, size_t size)
+{
+	struct component_cache_entry *entry;
+	uint64_t hash;
+
+	if (component_cache == NULL)
+		return NULL;
+	hash = component_cache_hash(type, key, size);
+	util_list_iterate(component_cache, entry) {
+		if (entry->type == type && entry->hash == hash &&
+		    entry->key_size == size &&
+		    memcmp(entry->key, key, size) == 0)
+			return entry;
+	}
+	return NULL;
+}
+
+/* Remember the segment table SEGMENT and the number of data blocks COUNT
+ * of the component identified by KEY. Failing to do so is not an error,
+ * the component is just not reused. */
+static void
+component_cache_add(cache_key_type type, const void *key, size_t size,
+		    disk_blockptr_t *segment, blocknum_t count)
+{
+	struct component_cache_entry *entry;
+
+	if (component_cache == NULL)
+		return;
+	entry = misc_malloc(sizeof(*entry));
+	if (entry == NULL)
+		return;
+	entry->key = misc_malloc(size);
+	if (entry->key == NULL) {
+		free(entry);
+		return;
+	}
+	memcpy(entry->key, key, size);
+	entry->key_size = size;
+	entry->type = type;
+	entry->hash = component_cache_hash(type, key, size);
+	entry->segment = *segment;
+	entry->count = count;
+	util_list_add_tail(component_cache, entry);
+}
+
+static void
+component_cache_init(void)
+{
+	component_cache = util_list_new(struct component_cache_entry, node);
+}
+
+static void
+component_cache_free(void)
+{
+	struct component_cache_entry *entry, *next;
+
+	util_list_iterate_safe(component_cache, entry, next) {
+		util_list_remove(component_cache, entry);
+		free(entry->key);
+		free(entry);
+	}
+	util_list_free(component_cache);
+	component_cache = NULL;
+}
+
+static void
+get_cache_file_key(struct stat *stats, size_t trailer,
+		   struct cache_file_key *key)
+{
+	/* Clear padding, the key is compared bytewise */
+	memset(key, 0, sizeof(*key));
+	key->dev = stats->st_dev;
+	key->ino = stats->st_ino;
+	key->size = stats->st_size;
+	key->mtime = stats->st_mtim;
+	key->ctime = stats->st_ctim;
+	key->trailer = trailer;
+}
+
 static int
 add_component_file(int fd, const char* filename, address_t load_address,
 		   size_t trailer, void *component, int add_files,
 		   struct disk_info* info, struct job_target_data* target,
 		   struct component_loc *location)
 {
+	struct component_cache_entry *entry;
+	struct cache_file_key key, key_after;
 	struct disk_info* file_info;
 	struct component_loc loc;
+	struct stat stats;
 	disk_blockptr_t segment;
 	disk_blockptr_t* list;
+	blocknum_t compact_count;
 	char* buffer;
 	size_t size;
 	blocknum_t count;
 	int rc;
 
 	if (add_files) {
+		if (stat(filename, &stats)) {
+			error_reason(strerror(errno));
+			error_text("Could not get information for file '%s'",
+				   filename);
+			return -1;
+		}
+		get_cache_file_key(&stats, trailer, &key);
+		entry = component_cache_find(cache_key_file, &key,
+					     sizeof(key));
+		if (entry != NULL) {
+			/* Same unchanged file is already in the bootmap */
+			segment = entry->segment;
+			count = entry->count;
+			goto out_entry;
+		}
 		/* Read file to buffer */
 		rc = misc_read_file(filename, &buffer, &size, 0);
 		if (rc) {
@@ -319,6 +466,22 @@ add_component_file(int fd, const char* filename, address_t load_address,
 			error_text("Could not write to bootmap file");
 			return -1;
 		}
+		/* Try to compact list */
+		compact_count = disk_compact_blocklist(list, count, info);
+		/* Write segment table */
+		rc = add_segment_table(fd, list, compact_count, &segment, info);
+		free(list);
+		if (rc)
+			return rc;
+		/* Only remember the file if it did not change while it
+		 * was read */
+		if (stat(filename, &stats) == 0) {
+			get_cache_file_key(&stats, trailer, &key_after);
+			if (memcmp(&key, &key_after, sizeof(key)) == 0)
+				component_cache_add(cache_key_file, &key,
+						    sizeof(key), &segment,
+						    count);
+		}
 	} else {
 		/* Make sure file is on correct device */
 		rc = disk_get_info_from_file(filename, target, &file_info);
@@ -336,23 +499,38 @@ add_component_file(int fd, const char* filename, address_t load_address,
 		if (count == 0)
 			return -1;
 		count -= DIV_ROUND_UP(trailer, info->phy_block_size);
+		/* Try to compact list */
+		compact_count = disk_compact_blocklist(list, count, info);
+		/* The segment table only depends on the physical blocks of
+		 * the file, reuse it if the file is still at the same
+		 * blocks */
+		entry = component_cache_find(cache_key_blocklist, list,
+					     compact_count * sizeof(*list));
+		if (entry != NULL) {
+			free(list);
+			segment = entry->segment;
+			goto out_entry;
+		}
+		/* Write segment table */
+		rc = add_segment_table(fd, list, compact_count, &segment, info);
+		if (rc == 0)
+			component_cache_add(cache_key_blocklist, list,
+					    compact_count * sizeof(*list),
+					    &segment, count);
+		free(list);
+		if (rc)
+			return rc;
 	}
+out_entry:
 	/* Fill in component location */
 	loc.addr = load_address;
 	loc.size = count * info->phy_block_size;
-	/* Try to compact list */
-	count = disk_compact_blocklist(list, count, info);
-	/* Write segment table */
-	rc = add_segment_table(fd, list, count, &segment, info);
-	free(list);
-	if (rc == 0) {
-		create_component_entry(component, &segment, component_load,
-				       (component_data) load_address, info);
-		/* Return location if requested */
-		if (location != NULL)
-			*location = loc;
-	}
-	return rc;
+	create_component_entry(component, &segment, component_load,
+			       (component_data) load_address, info);
+	/* Return location if requested */
+	if (location != NULL)
+		*location = loc;
+	return 0;
 }
 
 static int
@@ -360,17 +538,36 @@ add_component_buffer(int fd, void* buffer, size_t size, component_data data,
 		     void* component, struct disk_info* info,
 		     struct component_loc *location, int type)
 {
+	struct component_cache_entry *entry;
 	struct component_loc loc;
 	disk_blockptr_t segment;
 	disk_blockptr_t* list;
+	blocknum_t compact_count;
 	blocknum_t count;
 	int rc;
 
-	/* Write buffer */
-	count = disk_write_block_buffer(fd, 0, buffer, size, &list, info);
-	if (count == 0) {
-		error_text("Could not write to bootmap file");
-		return -1;
+	entry = component_cache_find(cache_key_buffer, buffer, size);
+	if (entry != NULL) {
+		/* Same data is already in the bootmap */
+		segment = entry->segment;
+		count = entry->count;
+	} else {
+		/* Write buffer */
+		count = disk_write_block_buffer(fd, 0, buffer, size, &list,
+						info);
+		if (count == 0) {
+			error_text("Could not write to bootmap file");
+			return -1;
+		}
+		/* Try to compact list */
+		compact_count = disk_compact_blocklist(list, count, info);
+		/* Write segment table */
+		rc = add_segment_table(fd, list, compact_count, &segment, info);
+		free(list);
+		if (rc)
+			return rc;
+		component_cache_add(cache_key_buffer, buffer, size, &segment,
+				    count);
 	}
 	if (type == component_load) {
 		/* Fill in component location */
@@ -380,18 +577,11 @@ add_component_buffer(int fd, void* buffer, size_t size, component_data data,
 		loc.addr = 0;
 		loc.size = 0;
 	}
-	/* Try to compact list */
-	count = disk_compact_blocklist(list, count, info);
-	/* Write segment table */
-	rc = add_segment_table(fd, list, count, &segment, info);
-	free(list);
-	if (rc == 0) {
-		create_component_entry(component, &segment, type, data, info);
-		/* Return location if requested */
-		if (location != NULL)
-			*location = loc;
-	}
-	return rc;
+	create_component_entry(component, &segment, type, data, info);
+	/* Return location if requested */
+	if (location != NULL)
+		*location = loc;
+	return 0;
 }
 
 
@@ -957,6 +1147,8 @@ build_program_table(int fd, struct job_data* job, disk_blockptr_t* pointer,
 	if (table == NULL)
 		return -1;
 	memset((void *) table, 0, sizeof(disk_blockptr_t) * entries);
+	/* Components shared by the programs are added only once */
+	component_cache_init();
 	/* Add programs */
 	switch (job->id) {
 	case job_ipl:
@@ -1057,6 +1249,7 @@ build_program_table(int fd, struct job_data* job, disk_blockptr_t* pointer,
 		rc = -1;
 		break;
 	}
+	component_cache_free();
 	if (rc == 0) {
 		/* Add program table block */
 		rc = add_program_table(fd, table, entries, pointer, info);
@@ -32,6 +32,9 @@
 #include "job.h"
 #include "misc.h"
 
+/* Number of extents requested with one FIEMAP call */
+#define DISK_FIEMAP_EXTENTS	512
+
 /* from linux/fs.h */
 #define FIBMAP			_IO(0x00,1)
 #define FIGETBSZ		_IO(0x00,2)
@@ -1046,6 +1049,110 @@ disk_compact_blocklist(disk_blockptr_t* list, blocknum_t count,
 }
 
 
+/* Fill LIST with the pointers to the COUNT physical blocks of the file
+ * identified by FD using the extents reported by FIEMAP. Usually one ioctl
+ * covers the whole file. The resulting block numbers are the same that
+ * disk_get_blocknum() computes block by block. Return 0 on success, 1 if
+ * FIEMAP is not supported for the file and -1 on any other error. */
+static int
+disk_get_blocklist_fiemap(int fd, disk_blockptr_t* list, blocknum_t count,
+			  struct disk_info* info)
+{
+	struct fiemap_extent *extent;
+	struct fiemap *fiemap;
+	struct statfs buf;
+	blocknum_t phy_per_fs;
+	blocknum_t mapped;
+	blocknum_t i = 0;
+	uint64_t start = 0;
+	uint64_t offset;
+	unsigned int j;
+	size_t size;
+	int last = 0;
+
+	/* Get file system type */
+	if (fstatfs(fd, &buf)) {
+		error_reason(strerror(errno));
+		return -1;
+	}
+	/* Files on ReiserFS need unpacking */
+	if (buf.f_type == REISERFS_SUPER_MAGIC) {
+		if (ioctl(fd, REISERFS_IOC_UNPACK, 1)) {
+			error_reason("Could not unpack ReiserFS file");
+			return -1;
+		}
+	}
+	phy_per_fs = info->fs_block_size / info->phy_block_size;
+	size = sizeof(struct fiemap) +
+	       DISK_FIEMAP_EXTENTS * sizeof(struct fiemap_extent);
+	fiemap = misc_malloc(size);
+	if (!fiemap)
+		return -1;
+	while (i < count) {
+		memset(fiemap, 0, size);
+		fiemap->fm_extent_count = DISK_FIEMAP_EXTENTS;
+		/* Flush dirty data only once */
+		fiemap->fm_flags = start ? 0 : FIEMAP_FLAG_SYNC;
+		fiemap->fm_start = start;
+		fiemap->fm_length = count * info->phy_block_size - start;
+		if (ioctl(fd, FS_IOC_FIEMAP, (unsigned long) fiemap)) {
+			free(fiemap);
+			/* Let the caller fall back to FIBMAP */
+			return start ? -1 : 1;
+		}
+		if (fiemap->fm_mapped_extents == 0)
+			break;
+		for (j = 0; j < fiemap->fm_mapped_extents; j++) {
+			extent = &fiemap->fm_extents[j];
+			if (extent->fe_flags & FIEMAP_EXTENT_ENCODED) {
+				error_reason("File mapping is encoded");
+				free(fiemap);
+				return -1;
+			}
+			/* Blocks before this extent are holes */
+			for (; i < count; i++) {
+				offset = i * info->phy_block_size;
+				if (offset >= extent->fe_logical)
+					break;
+				disk_blockptr_from_blocknum(&list[i], 0, info);
+			}
+			for (; i < count; i++) {
+				offset = i * info->phy_block_size;
+				if (offset >= extent->fe_logical +
+					      extent->fe_length)
+					break;
+				/* In file system block units */
+				mapped = (extent->fe_physical + offset -
+					  extent->fe_logical) /
+					 info->fs_block_size;
+				if (mapped == 0) {
+					/* This is a hole in the file */
+					disk_blockptr_from_blocknum(&list[i], 0,
+								    info);
+					continue;
+				}
+				/* Convert file system block to physical and
+				 * add partition start */
+				disk_blockptr_from_blocknum(&list[i],
+					mapped * phy_per_fs + i % phy_per_fs +
+					info->geo.start, info);
+			}
+			if (extent->fe_flags & FIEMAP_EXTENT_LAST)
+				last = 1;
+		}
+		extent = &fiemap->fm_extents[fiemap->fm_mapped_extents - 1];
+		start = extent->fe_logical + extent->fe_length;
+		if (last || start >= count * info->phy_block_size)
+			break;
+	}
+	free(fiemap);
+	/* Remaining blocks are holes at the end of the file */
+	for (; i < count; i++)
+		disk_blockptr_from_blocknum(&list[i], 0, info);
+	return 0;
+}
+
+
 /* Retrieve a list of pointers to the disk blocks that make up the file
  * specified by FILENAME. Upon success, return the number of blocks and set
  * BLOCKLIST to point to the uncompacted list. INFO provides information
@@ -1060,6 +1167,7 @@ disk_get_blocklist_from_file(const char* filename, disk_blockptr_t** blocklist,
 	blocknum_t count;
 	blocknum_t i;
 	blocknum_t blocknum;
+	int rc;
 
 	fd = open(filename, O_RDONLY);
 	if (fd == -1) {
@@ -1089,7 +1197,21 @@ disk_get_blocklist_from_file(const char* filename, disk_blockptr_t** blocklist,
 		return 0;
 	}
 	memset((void *) list, 0, sizeof(disk_blockptr_t) * count);
-	/* Build list */
+	/* Build list from the file extents if possible */
+	if (info->fs_block_size != -1) {
+		rc = disk_get_blocklist_fiemap(fd, list, count, info);
+		if (rc < 0) {
+			free(list);
+			close(fd);
+			return 0;
+		}
+		if (rc == 0) {
+			close(fd);
+			*blocklist = list;
+			return count;
+		}
+	}
+	/* Build list block by block */
 	for (i=0; i < count; i++) {
 		if (disk_get_blocknum(fd, 0, i, &blocknum, info)) {
 			free(list);
@@ -14,6 +14,7 @@
 #include <err.h>
 #include <errno.h>
 #include <fnmatch.h>
+#include <pthread.h>
 #include <regex.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,6 +27,7 @@
 
 #include "lib/util_base.h"
 #include "lib/util_libc.h"
+#include "lib/util_list.h"
 #include "lib/util_panic.h"
 #include "lib/util_path.h"
 #include "lib/util_rec.h"
@@ -2673,8 +2675,79 @@ struct reencipher_info {
 	unsigned long num_reenciphered;
 	unsigned long num_failed;
 	unsigned long num_skipped;
+	unsigned long num_retried;
+	struct util_list jobs;
 };
 
+#define REENCIPHER_MAX_TRIES	3
+
+enum reencipher_job_state {
+	REENCIPHER_JOB_QUEUED,
+	REENCIPHER_JOB_RUNNING,
+	REENCIPHER_JOB_DONE,
+};
+
+struct reencipher_job {
+	struct util_list_node node;	/* All jobs in repository order */
+	struct util_list_node queue;	/* Jobs waiting for a worker */
+	enum reencipher_job_state state;
+	char *name;
+	struct reencipher_params params;
+	u8 *secure_key;
+	u8 *orig_key;
+	size_t secure_key_size;
+	int is_old_mk;
+	char *apqns;
+	char **apqn_list;
+	bool is_cca;
+	int tries;
+	int rc;
+};
+
+struct reencipher_pool {
+	struct keystore *keystore;
+	struct reencipher_info *info;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	struct util_list queue;
+	struct util_list running;
+	unsigned long num_total;
+	unsigned long num_done;
+};
+
+/**
+ * Determines the re-encipher mode if it was not specified by the user
+ *
+ * @param[in/out] params  reenciphering parameters
+ * @param[in] is_old_mk   if true the key is currently re-enciphered with the
+ *            OLD master key
+ * @param[in] print       if true, the detected mode is displayed
+ */
+static void _keystore_detect_reencipher_mode(struct reencipher_params *params,
+					     bool is_old_mk, bool print)
+{
+	if (params->from_old || params->to_new)
+		return;
+
+	if (is_old_mk) {
+		params->from_old = 1;
+		if (print)
+			util_print_indented("The secure key is currently "
+					    "enciphered with the OLD "
+					    "master key and is being "
+					    "re-enciphered with the CURRENT "
+					    "master key\n", 0);
+	} else {
+		params->to_new = 1;
+		if (print)
+			util_print_indented("The secure key is currently "
+					    "enciphered with the CURRENT "
+					    "master key and is being "
+					    "re-enciphered with the NEW "
+					    "master key\n", 0);
+	}
+}
+
 /**
  * Perform the reencipherment of a key
  *
@@ -2700,24 +2773,7 @@ static int _keystore_perform_reencipher(struct keystore *keystore,
 	bool selected;
 	int rc;
 
-	if (!params->from_old && !params->to_new) {
-		/* Autodetect reencipher mode */
-		if (is_old_mk) {
-			params->from_old = 1;
-			util_print_indented("The secure key is currently "
-					    "enciphered with the OLD "
-					    "master key and is being "
-					    "re-enciphered with the CURRENT "
-					    "master key\n", 0);
-		} else {
-			params->to_new = 1;
-			util_print_indented("The secure key is currently "
-					    "enciphered with the CURRENT "
-					    "master key and is being "
-					    "re-enciphered with the NEW "
-					    "master key\n", 0);
-		}
-	}
+	_keystore_detect_reencipher_mode(params, is_old_mk, true);
 
 	if (params->from_old) {
 		if (params->inplace == -1)
@@ -2779,75 +2835,74 @@ static int _keystore_perform_reencipher(struct keystore *keystore,
 }
 
 /**
- * Processing function for the key re-enciphering function.
+ * Prepares the re-enciphering of a key: Checks that re-enciphering can be
+ * performed, reads the secure key and validates it.
  *
  * @param[in] keystore   the keystore
  * @param[in] name       the name of the key
- * @param[in] properties the properties object of the key (not used here)
+ * @param[in] properties the properties object of the key
  * @param[in] file_names the file names used by this key
- * @param[in] private    private data: struct reencipher_info
+ * @param[in] info       reencipher info
+ * @param[in/out] params reenciphering parameters of this key
+ * @param[out] secure_key on return: the secure key read from the repository
+ * @param[out] secure_key_size on return: the size of the secure key
+ * @param[out] is_old_mk on return: if the secure key is enciphered with the
+ *             OLD master key
  *
- * @returns 0 if the re-enciphering is successful, a negative errno value
- *          otherwise
+ * @returns 0 if the key is to be re-enciphered, 1 if it is to be skipped,
+ *          or a negative errno value in case of an error
  */
-static int _keystore_process_reencipher(struct keystore *keystore,
+static int _keystore_prepare_reencipher(struct keystore *keystore,
 					const char *name,
 					struct properties *properties,
 					struct key_filenames *file_names,
-					void *private)
+					struct reencipher_info *info,
+					struct reencipher_params *params,
+					u8 **secure_key,
+					size_t *secure_key_size,
+					int *is_old_mk)
 {
-	struct reencipher_info *info = (struct reencipher_info *)private;
-	struct reencipher_params params = info->params;
 	size_t clear_key_bitsize;
-	size_t secure_key_size;
 	char **apqn_list = NULL;
-	u8 *secure_key = NULL;
-	char *apqns = NULL;
-	char *out_file;
-	int is_old_mk;
-	char *temp;
+	char *apqns;
 	int rc;
 
 	rc = _keystore_ensure_keyfiles_exist(file_names, name);
 	if (rc != 0)
-		goto out;
+		return rc;
 
-	pr_verbose(keystore, "Complete reencipher: %d", params.complete);
-	pr_verbose(keystore, "In-place reencipher: %d", params.inplace);
+	pr_verbose(keystore, "Complete reencipher: %d", params->complete);
+	pr_verbose(keystore, "In-place reencipher: %d", params->inplace);
 
-	if (params.complete) {
+	if (params->complete) {
 		if (!_keystore_reencipher_key_exists(file_names)) {
 			warnx("Staged re-enciphering is not pending for key "
 			      "'%s', skipping",
 			      name);
-			info->num_skipped++;
-			rc = 0;
-			goto out;
+			return 1;
 		}
 
 		printf("Completing re-enciphering for key '%s'\n", name);
 
-		params.inplace = 1;
+		params->inplace = 1;
 	}
 
-	secure_key = read_secure_key(params.complete ?
+	*secure_key = read_secure_key(params->complete ?
 						file_names->renc_filename :
 						file_names->skey_filename,
-				     &secure_key_size, keystore->verbose);
-	if (secure_key == NULL) {
-		rc = -ENOENT;
-		goto out;
-	}
+				      secure_key_size, keystore->verbose);
+	if (*secure_key == NULL)
+		return -ENOENT;
 
 	apqns = properties_get(properties, PROP_NAME_APQNS);
 	if (apqns != NULL)
 		apqn_list = str_list_split(apqns);
 
-	rc = validate_secure_key(info->pkey_fd, secure_key, secure_key_size,
-				 &clear_key_bitsize, &is_old_mk,
+	rc = validate_secure_key(info->pkey_fd, *secure_key, *secure_key_size,
+				 &clear_key_bitsize, is_old_mk,
 				 (const char **)apqn_list, keystore->verbose);
 	if (rc != 0) {
-		if (params.complete) {
+		if (params->complete) {
 			warnx("Key '%s' is not valid, re-enciphering is not "
 			      "completed", name);
 			warnx("The new master key might yet have to be set "
@@ -2855,43 +2910,60 @@ static int _keystore_process_reencipher(struct keystore *keystore,
 		} else {
 			warnx("Key '%s' is not valid, it is not re-enciphered",
 			      name);
-			info->num_skipped++;
-			rc = 0;
+			rc = 1;
 		}
-		goto out;
 	}
 
-	if (!params.complete) {
-		printf("Re-enciphering key '%s'\n", name);
-
-		rc = _keystore_perform_reencipher(keystore, name, info->lib,
-						  &params, secure_key,
-						  secure_key_size, is_old_mk,
-						  properties_get(properties,
-							PROP_NAME_APQNS));
-		if (rc < 0)
-			goto out;
-		if (rc > 0) {
-			info->num_skipped++;
-			rc = 0;
-			goto out;
-		}
+	if (apqns != NULL)
+		free(apqns);
+	if (apqn_list != NULL)
+		str_list_free_string_array(apqn_list);
+	if (rc != 0) {
+		free(*secure_key);
+		*secure_key = NULL;
 	}
+	return rc;
+}
+
+/**
+ * Finishes the re-enciphering of a key: Writes the re-enciphered secure key
+ * into the repository and updates the key's properties.
+ *
+ * @param[in] keystore   the keystore
+ * @param[in] name       the name of the key
+ * @param[in] properties the properties object of the key
+ * @param[in] file_names the file names used by this key
+ * @param[in] params     reenciphering parameters of this key
+ * @param[in] secure_key the re-enciphered secure key
+ * @param[in] secure_key_size the size of the secure key
+ *
+ * @returns 0 for success, or a negative errno value in case of an error
+ */
+static int _keystore_finish_reencipher(struct keystore *keystore,
+				       const char *name,
+				       struct properties *properties,
+				       struct key_filenames *file_names,
+				       struct reencipher_params *params,
+				       u8 *secure_key, size_t secure_key_size)
+{
+	char *out_file;
+	char *temp;
+	int rc;
 
-	pr_verbose(keystore, "In-place reencipher: %d", params.inplace);
+	pr_verbose(keystore, "In-place reencipher: %d", params->inplace);
 
-	out_file = params.inplace == 1 ? file_names->skey_filename :
-					 file_names->renc_filename;
+	out_file = params->inplace == 1 ? file_names->skey_filename :
+					  file_names->renc_filename;
 	rc = write_secure_key(out_file, secure_key,
 			      secure_key_size, keystore->verbose);
 	if (rc != 0)
-		goto out;
+		return rc;
 
-	if (params.complete || params.inplace == 1) {
+	if (params->complete || params->inplace == 1) {
 		rc = _keystore_set_timestamp_property(properties,
 						      PROP_NAME_REENC_TIME);
 		if (rc != 0)
-			goto out;
+			return rc;
 
 		rc = _keystore_ensure_vp_exists(keystore, file_names,
 						properties);
@@ -2901,7 +2973,7 @@ static int _keystore_process_reencipher(struct keystore *keystore,
 			      strerror(-rc));
 			warnx("Make sure that kernel module 'paes_s390' is loaded and "
 			      "that the 'paes' cipher is available");
-			goto out;
+			return rc;
 		}
 
 		rc = properties_save(properties, file_names->info_filename, 1);
@@ -2909,7 +2981,7 @@ static int _keystore_process_reencipher(struct keystore *keystore,
 			pr_verbose(keystore,
 				   "Failed to write key info file '%s': %s",
 				   file_names->info_filename, strerror(-rc));
-			goto out;
+			return rc;
 		}
 
 		util_asprintf(&temp, "The following LUKS2 volumes are "
@@ -2921,17 +2993,17 @@ static int _keystore_process_reencipher(struct keystore *keystore,
 		free(temp);
 	}
 
-	if (params.complete ||
-	    (params.inplace && _keystore_reencipher_key_exists(file_names))) {
+	if (params->complete ||
+	    (params->inplace && _keystore_reencipher_key_exists(file_names))) {
 		if (remove(file_names->renc_filename) != 0) {
 			rc = -errno;
 			pr_verbose(keystore, "Failed to remove '%s': %s",
 				   file_names->renc_filename, strerror(-rc));
-			goto out;
+			return rc;
 		}
 	}
 
-	if (params.inplace != 1) {
+	if (params->inplace != 1) {
 		util_asprintf(&temp, "Staged re-enciphering is initiated for "
 			      "key '%s'. After the NEW master key has been "
 			      "set to become the CURRENT master key run "
@@ -2941,18 +3013,74 @@ static int _keystore_process_reencipher(struct keystore *keystore,
 		free(temp);
 	}
 
+	return 0;
+}
+
+/**
+ * Processing function for the key re-enciphering function.
+ *
+ * @param[in] keystore   the keystore
+ * @param[in] name       the name of the key
+ * @param[in] properties the properties object of the key (not used here)
+ * @param[in] file_names the file names used by this key
+ * @param[in] private    private data: struct reencipher_info
+ *
+ * @returns 0 if the re-enciphering is successful, a negative errno value
+ *          otherwise
+ */
+static int _keystore_process_reencipher(struct keystore *keystore,
+					const char *name,
+					struct properties *properties,
+					struct key_filenames *file_names,
+					void *private)
+{
+	struct reencipher_info *info = (struct reencipher_info *)private;
+	struct reencipher_params params = info->params;
+	size_t secure_key_size;
+	u8 *secure_key = NULL;
+	char *apqns = NULL;
+	int is_old_mk;
+	int rc;
+
+	rc = _keystore_prepare_reencipher(keystore, name, properties,
+					  file_names, info, &params,
+					  &secure_key, &secure_key_size,
+					  &is_old_mk);
+	if (rc != 0)
+		goto out;
+
+	if (!params.complete) {
+		printf("Re-enciphering key '%s'\n", name);
+
+		apqns = properties_get(properties, PROP_NAME_APQNS);
+		rc = _keystore_perform_reencipher(keystore, name, info->lib,
+						  &params, secure_key,
+						  secure_key_size, is_old_mk,
+						  apqns);
+		if (rc != 0)
+			goto out;
+	}
+
+	rc = _keystore_finish_reencipher(keystore, name, properties,
+					 file_names, &params, secure_key,
+					 secure_key_size);
+	if (rc != 0)
+		goto out;
+
 	info->num_reenciphered++;
 
 out:
 	if (apqns != NULL)
 		free(apqns);
-	if (apqn_list != NULL)
-		str_list_free_string_array(apqn_list);
 	if (secure_key != NULL)
 		free(secure_key);
 
 	printf("\n");
 
+	if (rc > 0) {
+		info->num_skipped++;
+		rc = 0;
+	}
 	if (rc != 0) {
 		info->num_failed++;
 		pr_verbose(keystore, "Failed to re-encipher key '%s': %s",
@@ -2962,6 +3090,323 @@ out:
 	return rc;
 }
 
+/**
+ * Frees a re-encipher job
+ *
+ * @param[in] job        the job to free
+ */
+static void _keystore_free_reencipher_job(struct reencipher_job *job)
+{
+	if (job->name != NULL)
+		free(job->name);
+	if (job->secure_key != NULL)
+		free(job->secure_key);
+	if (job->orig_key != NULL)
+		free(job->orig_key);
+	if (job->apqns != NULL)
+		free(job->apqns);
+	if (job->apqn_list != NULL)
+		str_list_free_string_array(job->apqn_list);
+	free(job);
+}
+
+/**
+ * Processing function that queues a key for parallel re-enciphering. The key
+ * is checked and validated here, the re-encipherment itself is performed
+ * later by the worker threads.
+ *
+ * @param[in] keystore   the keystore
+ * @param[in] name       the name of the key
+ * @param[in] properties the properties object of the key
+ * @param[in] file_names the file names used by this key
+ * @param[in] private    private data: struct reencipher_info
+ *
+ * @returns 0 if the key was queued or skipped, a negative errno value
+ *          otherwise
+ */
+static int _keystore_queue_reencipher(struct keystore *keystore,
+				      const char *name,
+				      struct properties *properties,
+				      struct key_filenames *file_names,
+				      void *private)
+{
+	struct reencipher_info *info = (struct reencipher_info *)private;
+	struct reencipher_job *job;
+	int rc;
+
+	job = util_zalloc(sizeof(struct reencipher_job));
+	job->params = info->params;
+
+	rc = _keystore_prepare_reencipher(keystore, name, properties,
+					  file_names, info, &job->params,
+					  &job->secure_key,
+					  &job->secure_key_size,
+					  &job->is_old_mk);
+	if (rc != 0)
+		goto out;
+
+	_keystore_detect_reencipher_mode(&job->params, job->is_old_mk, false);
+
+	job->name = util_strdup(name);
+	job->orig_key = util_malloc(job->secure_key_size);
+	memcpy(job->orig_key, job->secure_key, job->secure_key_size);
+	job->apqns = properties_get(properties, PROP_NAME_APQNS);
+	if (job->apqns != NULL)
+		job->apqn_list = str_list_split(job->apqns);
+	job->is_cca = !is_ep11_aes_key(job->secure_key, job->secure_key_size);
+
+	/*
+	 * Load the external libraries now, so that the worker threads do not
+	 * race on loading them on demand.
+	 */
+	if (job->is_cca && info->lib->cca->lib_csulcca == NULL)
+		rc = load_cca_library(info->lib->cca, keystore->verbose);
+	if (!job->is_cca && info->lib->ep11->lib_ep11 == NULL)
+		rc = load_ep11_library(info->lib->ep11, keystore->verbose);
+	if (rc != 0)
+		goto out;
+
+	util_list_add_tail(&info->jobs, job);
+	return 0;
+
+out:
+	if (rc > 0) {
+		info->num_skipped++;
+		rc = 0;
+	}
+	if (rc != 0) {
+		info->num_failed++;
+		pr_verbose(keystore, "Failed to re-encipher key '%s': %s",
+			   name, strerror(-rc));
+		rc = 0;
+	}
+	_keystore_free_reencipher_job(job);
+	return rc;
+}
+
+/**
+ * Checks if two re-encipher jobs conflict with each other, i.e. if they
+ * must not run concurrently. Jobs are serialized per APQN. A key without
+ * APQN association can use any APQN, so it is serialized against all other
+ * jobs. Since the CCA host library selects an APQN process-wide, CCA keys
+ * are always serialized against each other.
+ *
+ * @param[in] job1       the first job
+ * @param[in] job2       the second job
+ *
+ * @returns true if the jobs conflict
+ */
+static bool _keystore_reencipher_jobs_conflict(struct reencipher_job *job1,
+					       struct reencipher_job *job2)
+{
+	int i, k;
+
+	if (job1->is_cca && job2->is_cca)
+		return true;
+	/* The APQNs property of a key without association is empty */
+	if (job1->apqn_list == NULL || job1->apqn_list[0] == NULL ||
+	    job2->apqn_list == NULL || job2->apqn_list[0] == NULL)
+		return true;
+
+	for (i = 0; job1->apqn_list[i] != NULL; i++) {
+		for (k = 0; job2->apqn_list[k] != NULL; k++) {
+			if (strcmp(job1->apqn_list[i], job2->apqn_list[k]) == 0)
+				return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Picks the next queued job that does not conflict with a running job.
+ * Must be called with the pool mutex held.
+ *
+ * @param[in] pool       the worker pool
+ *
+ * @returns the job, or NULL if no job can be started currently
+ */
+static struct reencipher_job *_keystore_pick_reencipher_job(
+						struct reencipher_pool *pool)
+{
+	struct reencipher_job *job, *running;
+	bool conflict;
+
+	util_list_iterate(&pool->queue, job) {
+		conflict = false;
+		util_list_iterate(&pool->running, running) {
+			if (_keystore_reencipher_jobs_conflict(job, running)) {
+				conflict = true;
+				break;
+			}
+		}
+		if (!conflict)
+			return job;
+	}
+	return NULL;
+}
+
+/**
+ * Worker thread function for parallel re-enciphering
+ *
+ * @param[in] arg        the worker pool
+ *
+ * @returns NULL
+ */
+static void *_keystore_reencipher_worker(void *arg)
+{
+	struct reencipher_pool *pool = arg;
+	struct keystore *keystore = pool->keystore;
+	struct reencipher_info *info = pool->info;
+	struct reencipher_job *job;
+	int rc;
+
+	pthread_mutex_lock(&pool->mutex);
+	while (!util_list_is_empty(&pool->queue) ||
+	       !util_list_is_empty(&pool->running)) {
+		job = _keystore_pick_reencipher_job(pool);
+		if (job == NULL) {
+			pthread_cond_wait(&pool->cond, &pool->mutex);
+			continue;
+		}
+
+		util_list_remove(&pool->queue, job);
+		util_list_add_tail(&pool->running, job);
+		job->state = REENCIPHER_JOB_RUNNING;
+		job->tries++;
+		pthread_mutex_unlock(&pool->mutex);
+
+		memcpy(job->secure_key, job->orig_key, job->secure_key_size);
+		rc = _keystore_perform_reencipher(keystore, job->name,
+						  info->lib, &job->params,
+						  job->secure_key,
+						  job->secure_key_size,
+						  job->is_old_mk, job->apqns);
+
+		pthread_mutex_lock(&pool->mutex);
+		util_list_remove(&pool->running, job);
+		job->rc = rc;
+		if (rc < 0 && rc != -ENODEV && rc != -EINVAL &&
+		    job->tries < REENCIPHER_MAX_TRIES) {
+			/* Retry the job after all other queued jobs */
+			pr_verbose(keystore, "Retrying key '%s' (attempt %d)",
+				   job->name, job->tries + 1);
+			info->num_retried++;
+			job->state = REENCIPHER_JOB_QUEUED;
+			util_list_add_tail(&pool->queue, job);
+		} else {
+			job->state = REENCIPHER_JOB_DONE;
+			pool->num_done++;
+			printf("[%lu/%lu] Key '%s' %s\n", pool->num_done,
+			       pool->num_total, job->name,
+			       rc == 0 ? "re-enciphered" :
+					 "failed to re-encipher");
+		}
+		pthread_cond_broadcast(&pool->cond);
+	}
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->mutex);
+
+	return NULL;
+}
+
+/**
+ * Re-enciphers all queued keys using a pool of worker threads, and then
+ * stores the re-enciphered keys in the repository in repository order.
+ *
+ * @param[in] keystore   the keystore
+ * @param[in] info       reencipher info with the queued jobs
+ * @param[in] num_jobs   the number of worker threads
+ *
+ * @returns 0 for success or a negative errno in case of an error
+ */
+static int _keystore_run_reencipher_jobs(struct keystore *keystore,
+					 struct reencipher_info *info,
+					 long int num_jobs)
+{
+	struct key_filenames file_names = { NULL, NULL, NULL };
+	struct reencipher_pool pool;
+	struct reencipher_job *job, *next;
+	struct properties *properties;
+	pthread_t *threads;
+	long int i, started;
+	int rc = 0;
+
+	memset(&pool, 0, sizeof(pool));
+	pool.keystore = keystore;
+	pool.info = info;
+	pthread_mutex_init(&pool.mutex, NULL);
+	pthread_cond_init(&pool.cond, NULL);
+	util_list_init(&pool.queue, struct reencipher_job, queue);
+	util_list_init(&pool.running, struct reencipher_job, queue);
+
+	util_list_iterate(&info->jobs, job) {
+		util_list_add_tail(&pool.queue, job);
+		pool.num_total++;
+	}
+	if (num_jobs > (long int)pool.num_total)
+		num_jobs = pool.num_total;
+
+	printf("Re-enciphering %lu keys using %ld parallel jobs\n",
+	       pool.num_total, num_jobs);
+
+	threads = util_zalloc(num_jobs * sizeof(pthread_t));
+	for (started = 0; started < num_jobs; started++) {
+		rc = -pthread_create(&threads[started], NULL,
+				     _keystore_reencipher_worker, &pool);
+		if (rc != 0) {
+			pr_verbose(keystore, "Failed to start worker: %s",
+				   strerror(-rc));
+			break;
+		}
+	}
+	/* Run the jobs in this thread if no worker could be started */
+	if (started == 0)
+		_keystore_reencipher_worker(&pool);
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	rc = 0;
+
+	printf("\n");
+
+	util_list_iterate_safe(&info->jobs, job, next) {
+		util_list_remove(&info->jobs, job);
+		rc = job->rc;
+		if (rc != 0)
+			goto next;
+
+		rc = _keystore_get_key_filenames(keystore, job->name,
+						 &file_names);
+		if (rc != 0)
+			goto next;
+
+		properties = properties_new();
+		rc = properties_load(properties, file_names.info_filename, 1);
+		if (rc == 0)
+			rc = _keystore_finish_reencipher(keystore, job->name,
+							 properties,
+							 &file_names,
+							 &job->params,
+							 job->secure_key,
+							 job->secure_key_size);
+		properties_free(properties);
+		_keystore_free_key_filenames(&file_names);
+next:
+		if (rc != 0) {
+			info->num_failed++;
+			pr_verbose(keystore, "Failed to re-encipher key '%s': "
+				   "%s", job->name, strerror(-rc));
+		} else {
+			info->num_reenciphered++;
+		}
+		_keystore_free_reencipher_job(job);
+	}
+
+	pthread_cond_destroy(&pool.cond);
+	pthread_mutex_destroy(&pool.mutex);
+	return 0;
+}
+
 /**
  * Reenciphers a key in the keystore
  *
@@ -2975,6 +3420,8 @@ out:
  * @param[in] inplace      if true, the key will be re-enciphere in-place
  * @param[in] staged       if true, the key will be re-enciphere not in-place
  * @param[in] complete     if true, a pending re-encipherment is completed
+ * @param[in] jobs         the number of keys to re-encipher in parallel. If
+ *                         less than 2, keys are re-enciphered one by one.
  * @param[in] pkey_fd      the file descriptor of /dev/pkey
  * @param[in] lib          the external library struct
  * Note: if both fromOld and toNew are FALSE, then the reencipherement mode is
@@ -2983,19 +3430,23 @@ out:
  * Note: if both inplace and staged are FLASE, then the key is re-enciphered
  *       inplace when for OLD-to-CURRENT, and is reenciphered staged for
  *       CURRENT-to-NEW.
+ * Note: completing a staged re-encipherment does not involve the crypto
+ *       adapters, thus it is always performed one by one.
  * @returns 0 for success or a negative errno in case of an error
  */
 int keystore_reencipher_key(struct keystore *keystore, const char *name_filter,
 			    const char *apqn_filter,
 			    bool from_old, bool to_new, bool inplace,
-			    bool staged, bool complete, int pkey_fd,
-			    struct ext_lib *lib)
+			    bool staged, bool complete, long int jobs,
+			    int pkey_fd, struct ext_lib *lib)
 {
 	struct reencipher_info info;
+	bool parallel;
 	int rc;
 
 	util_assert(keystore != NULL, "Internal error: keystore is NULL");
 
+	memset(&info, 0, sizeof(info));
 	info.params.from_old = from_old;
 	info.params.to_new = to_new;
 	info.params.inplace = -1;
@@ -3006,13 +3457,15 @@ int keystore_reencipher_key(struct keystore *keystore, const char *name_filter,
 	info.params.complete = complete;
 	info.pkey_fd = pkey_fd;
 	info.lib = lib;
-	info.num_failed = 0;
-	info.num_reenciphered = 0;
-	info.num_skipped = 0;
+	util_list_init(&info.jobs, struct reencipher_job, node);
 
+	parallel = jobs > 1 && !complete;
 	rc = _keystore_process_filtered(keystore, name_filter, NULL,
 					apqn_filter, NULL, NULL,
+					parallel ? _keystore_queue_reencipher :
 					_keystore_process_reencipher, &info);
+	if (rc == 0 && parallel && !util_list_is_empty(&info.jobs))
+		rc = _keystore_run_reencipher_jobs(keystore, &info, jobs);
 
 	if (rc != 0) {
 		pr_verbose(keystore, "Failed to re-encipher keys: %s",
@@ -3023,6 +3476,9 @@ int keystore_reencipher_key(struct keystore *keystore, const char *name_filter,
 		       "failed to re-encipher\n",
 		       info.num_reenciphered, info.num_skipped,
 		       info.num_failed);
+		if (info.num_retried > 0)
+			printf("%lu re-encipher attempts were retried\n",
+			       info.num_retried);
 		if (info.num_failed > 0)
 			rc = -EIO;
 	}
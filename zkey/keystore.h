@@ -54,8 +54,8 @@ int keystore_validate_key(struct keystore *keystore, const char *name_filter,
 int keystore_reencipher_key(struct keystore *keystore, const char *name_filter,
 			    const char *apqn_filter,
 			    bool from_old, bool to_new, bool inplace,
-			    bool staged, bool complete, int pkey_fd,
-			    struct ext_lib *lib);
+			    bool staged, bool complete, long int jobs,
+			    int pkey_fd, struct ext_lib *lib);
 
 int keystore_copy_key(struct keystore *keystore, const char *name,
 		      const char *newname, const char *volumes);
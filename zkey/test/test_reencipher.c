@@ -0,0 +1,299 @@
+/*
+ * test_reencipher - Test program for zkey
+ *
+ * Test program to check the serialization of parallel re-encipher jobs.
+ * The crypto functions used by keystore.c are replaced at compile time, so
+ * that keys are re-enciphered without crypto adapters.
+ *
+ * Copyright IBM Corp. 2020
+ *
+ * s390-tools is free software; you can redistribute it and/or modify
+ * it under the terms of the MIT license. See LICENSE for details.
+ */
+#include <assert.h>
+
+#define validate_secure_key			test_validate_secure_key
+#define reencipher_secure_key			test_reencipher_secure_key
+#define generate_key_verification_pattern	test_generate_key_verification_pattern
+#define load_cca_library			test_load_cca_library
+#define load_ep11_library			test_load_ep11_library
+
+#include "../keystore.c"
+
+#define TEST_NUM_KEYS	8
+#define TEST_NUM_JOBS	4
+#define TEST_MARK	0xaa
+
+/* Keys of the scheduling test and their associated APQNs */
+static const char *test_apqns[TEST_NUM_KEYS] = {
+	"01.0001", "02.0002", "01.0001", NULL,
+	"03.0003", "02.0002", "04.0004", "03.0003",
+};
+
+static pthread_mutex_t test_mutex = PTHREAD_MUTEX_INITIALIZER;
+static const char *test_running[TEST_NUM_JOBS];
+static int test_max_running;
+static int test_conflicts;
+static int test_failed_once;
+
+int test_validate_secure_key(int pkey_fd, u8 *secure_key,
+			     size_t secure_key_size, size_t *clear_key_bitsize,
+			     int *is_old_mk, const char **apqns, bool verbose)
+{
+	(void)pkey_fd;
+	(void)secure_key;
+	(void)secure_key_size;
+	(void)apqns;
+	(void)verbose;
+
+	*clear_key_bitsize = 256;
+	*is_old_mk = 1;
+	return 0;
+}
+
+int test_generate_key_verification_pattern(const u8 *key, size_t key_size,
+					   char *vp, size_t vp_len,
+					   bool verbose)
+{
+	(void)key;
+	(void)key_size;
+	(void)verbose;
+
+	snprintf(vp, vp_len, "%0*d", VERIFICATION_PATTERN_LEN - 1, 0);
+	return 0;
+}
+
+int test_load_cca_library(struct cca_lib *cca, bool verbose)
+{
+	(void)cca;
+	(void)verbose;
+	return 0;
+}
+
+int test_load_ep11_library(struct ep11_lib *ep11, bool verbose)
+{
+	(void)ep11;
+	(void)verbose;
+	return 0;
+}
+
+/*
+ * Simulate the re-encipherment of a key: Check that no conflicting key is
+ * re-enciphered at the same time and mark the key as re-enciphered. The
+ * first attempt of the first key fails to check that it is retried.
+ */
+int test_reencipher_secure_key(struct ext_lib *lib, u8 *secure_key,
+			       size_t secure_key_size, const char *apqns,
+			       enum reencipher_method method,
+			       bool *apqn_selected, bool verbose)
+{
+	struct ep11keytoken *key = (struct ep11keytoken *)secure_key;
+	int i, slot = -1, running = 0;
+
+	(void)lib;
+	(void)secure_key_size;
+	(void)method;
+	(void)verbose;
+
+	*apqn_selected = true;
+
+	pthread_mutex_lock(&test_mutex);
+	if (key->iv[0] == 0 && !test_failed_once) {
+		test_failed_once = 1;
+		pthread_mutex_unlock(&test_mutex);
+		return -EIO;
+	}
+	for (i = 0; i < TEST_NUM_JOBS; i++) {
+		if (test_running[i] == NULL) {
+			if (slot < 0)
+				slot = i;
+			continue;
+		}
+		running++;
+		if (apqns == NULL || *test_running[i] == '\0' ||
+		    strcmp(apqns, test_running[i]) == 0)
+			test_conflicts++;
+	}
+	assert(slot >= 0);
+	test_running[slot] = apqns != NULL ? apqns : "";
+	if (running + 1 > test_max_running)
+		test_max_running = running + 1;
+	pthread_mutex_unlock(&test_mutex);
+
+	usleep(20000);
+
+	pthread_mutex_lock(&test_mutex);
+	test_running[slot] = NULL;
+	pthread_mutex_unlock(&test_mutex);
+
+	key->iv[13] = TEST_MARK;
+	return 0;
+}
+
+static struct reencipher_job *new_job(const char *apqns, bool is_cca)
+{
+	struct reencipher_job *job;
+
+	job = util_zalloc(sizeof(*job));
+	if (apqns != NULL) {
+		job->apqns = util_strdup(apqns);
+		job->apqn_list = str_list_split(job->apqns);
+	}
+	job->is_cca = is_cca;
+	return job;
+}
+
+static bool conflict(struct reencipher_job *job1, struct reencipher_job *job2)
+{
+	bool rc;
+
+	rc = _keystore_reencipher_jobs_conflict(job1, job2);
+	assert(rc == _keystore_reencipher_jobs_conflict(job2, job1));
+	return rc;
+}
+
+static void test_conflict(void)
+{
+	struct reencipher_job *a = new_job("01.0001,02.0002", false);
+	struct reencipher_job *b = new_job("02.0002,03.0003", false);
+	struct reencipher_job *c = new_job("04.0004", false);
+	struct reencipher_job *n1 = new_job(NULL, false);
+	struct reencipher_job *n2 = new_job(NULL, false);
+	struct reencipher_job *e = new_job("", false);
+	struct reencipher_job *cca1 = new_job("05.0005", true);
+	struct reencipher_job *cca2 = new_job("06.0006", true);
+
+	/* Jobs with a common APQN */
+	assert(conflict(a, b));
+	/* Jobs with disjoint APQNs */
+	assert(!conflict(a, c));
+	assert(!conflict(b, c));
+	/* Keys without APQN association can use any APQN */
+	assert(conflict(n1, n2));
+	assert(conflict(n1, a));
+	assert(conflict(n1, c));
+	assert(conflict(n1, cca1));
+	/* An empty APQNs property means no association */
+	assert(conflict(e, a));
+	assert(conflict(e, n1));
+	/* The CCA host library selects the APQN process-wide */
+	assert(conflict(cca1, cca2));
+	assert(!conflict(cca1, a));
+
+	_keystore_free_reencipher_job(a);
+	_keystore_free_reencipher_job(b);
+	_keystore_free_reencipher_job(c);
+	_keystore_free_reencipher_job(n1);
+	_keystore_free_reencipher_job(n2);
+	_keystore_free_reencipher_job(e);
+	_keystore_free_reencipher_job(cca1);
+	_keystore_free_reencipher_job(cca2);
+}
+
+static void test_pick(void)
+{
+	struct reencipher_job *a = new_job("01.0001", false);
+	struct reencipher_job *n = new_job(NULL, false);
+	struct reencipher_job *c = new_job("02.0002", false);
+	struct reencipher_pool pool;
+
+	util_list_init(&pool.queue, struct reencipher_job, queue);
+	util_list_init(&pool.running, struct reencipher_job, queue);
+	util_list_add_tail(&pool.queue, n);
+	util_list_add_tail(&pool.queue, c);
+
+	/* Nothing runs: the first queued job is picked */
+	assert(_keystore_pick_reencipher_job(&pool) == n);
+
+	/* A job bound to an APQN runs: the key without association waits */
+	util_list_add_tail(&pool.running, a);
+	assert(_keystore_pick_reencipher_job(&pool) == c);
+
+	/* The key without association runs: no other job may start */
+	util_list_remove(&pool.running, a);
+	util_list_remove(&pool.queue, n);
+	util_list_add_tail(&pool.running, n);
+	util_list_add_tail(&pool.queue, a);
+	assert(_keystore_pick_reencipher_job(&pool) == NULL);
+
+	_keystore_free_reencipher_job(a);
+	_keystore_free_reencipher_job(n);
+	_keystore_free_reencipher_job(c);
+}
+
+/*
+ * Re-encipher the keys of a temporary repository with several jobs
+ */
+static void test_schedule(void)
+{
+	struct key_filenames file_names = { NULL, NULL, NULL };
+	struct ep11keytoken token;
+	struct cca_lib cca = { 0 };
+	struct ep11_lib ep11 = { 0 };
+	struct ext_lib lib = { .cca = &cca, .ep11 = &ep11 };
+	char dir[] = "/tmp/test_reencipher.XXXXXX";
+	struct keystore *keystore;
+	struct ep11keytoken *key;
+	char name[16], *cmd;
+	size_t key_size;
+	int i;
+
+	assert(mkdtemp(dir) != NULL);
+	keystore = keystore_new(dir, false);
+	assert(keystore != NULL);
+
+	memset(&token, 0, sizeof(token));
+	token.head.type = TOKEN_TYPE_NON_CCA;
+	token.head.version = TOKEN_VERSION_EP11_AES;
+	token.head.length = sizeof(token);
+	token.head.keybitlen = 256;
+	token.version = 0x1234;
+	for (i = 0; i < TEST_NUM_KEYS; i++) {
+		sprintf(name, "key%d", i);
+		token.iv[0] = i;
+		assert(_keystore_get_key_filenames(keystore, name,
+						   &file_names) == 0);
+		assert(write_secure_key(file_names.skey_filename,
+					(u8 *)&token, sizeof(token),
+					false) == 0);
+		assert(_keystore_create_info_file(keystore, name, &file_names,
+						  NULL, NULL, test_apqns[i],
+						  true, 0, NULL,
+						  KEY_TYPE_EP11_AES) == 0);
+		_keystore_free_key_filenames(&file_names);
+	}
+
+	assert(keystore_reencipher_key(keystore, NULL, NULL, true, false,
+				       true, false, false, TEST_NUM_JOBS, -1,
+				       &lib) == 0);
+
+	/* All keys are written back, keys with common APQNs never ran
+	 * at the same time, but disjoint ones did */
+	for (i = 0; i < TEST_NUM_KEYS; i++) {
+		sprintf(name, "key%d", i);
+		assert(_keystore_get_key_filenames(keystore, name,
+						   &file_names) == 0);
+		key = (struct ep11keytoken *)read_secure_key(
+				file_names.skey_filename, &key_size, false);
+		assert(key != NULL && key_size == sizeof(token));
+		assert(key->iv[0] == i && key->iv[13] == TEST_MARK);
+		free(key);
+		_keystore_free_key_filenames(&file_names);
+	}
+	assert(test_failed_once);
+	assert(test_conflicts == 0);
+	assert(test_max_running > 1);
+
+	keystore_free(keystore);
+	util_asprintf(&cmd, "rm -rf %s", dir);
+	assert(system(cmd) == 0);
+	free(cmd);
+}
+
+int main(void)
+{
+	test_conflict();
+	test_pick();
+	test_schedule();
+	return 0;
+}
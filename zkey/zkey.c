@@ -66,6 +66,7 @@ static struct zkey_globals {
 	bool complete;
 	bool inplace;
 	bool staged;
+	long int jobs;
 	char *name;
 	char *description;
 	char *volumes;
@@ -299,6 +300,14 @@ static struct util_opt opt_vec[] = {
 			"associated with specific crypto cards",
 		.command = COMMAND_REENCIPHER,
 	},
+	{
+		.option = { "jobs", required_argument, NULL, 'j'},
+		.argument = "NUMBER",
+		.desc = "Number of secure AES keys in the repository that are "
+			"re-enciphered in parallel. Keys associated with the "
+			"same APQN are never re-enciphered concurrently",
+		.command = COMMAND_REENCIPHER,
+	},
 	/***********************************************************/
 	{
 		.flags = UTIL_OPT_FLAG_SECTION,
@@ -1239,6 +1248,12 @@ static int command_reencipher_file(void)
 		util_prg_print_parse_error();
 		return EXIT_FAILURE;
 	}
+	if (g.jobs != 0) {
+		warnx("Option '--jobs|-j' is not valid for "
+		      "re-enciphering a key outside of the repository");
+		util_prg_print_parse_error();
+		return EXIT_FAILURE;
+	}
 
 	/* Read the secure key to be re-enciphered */
 	secure_key = read_secure_key(g.pos_arg, &secure_key_size, g.verbose);
@@ -1381,7 +1396,7 @@ static int command_reencipher_repository(void)
 
 	rc = keystore_reencipher_key(g.keystore, g.name, g.apqns, g.fromold,
 				     g.tonew, g.inplace, g.staged, g.complete,
-				     g.pkey_fd, &g.lib);
+				     g.jobs, g.pkey_fd, &g.lib);
 
 	return rc != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -2097,6 +2112,17 @@ int main(int argc, char *argv[])
 		case OPT_NO_APQN_CHECK:
 			g.noapqncheck = 1;
 			break;
+		case 'j':
+			g.jobs = strtol(optarg, &endp, 0);
+			if (*optarg == '\0' || *endp != '\0' ||
+			    g.jobs <= 0 ||
+			    (g.jobs == LONG_MAX && errno == ERANGE)) {
+				warnx("Invalid value for '--jobs'|'-j': "
+				      "'%s'", optarg);
+				util_prg_print_parse_error();
+				return EXIT_FAILURE;
+			}
+			break;
 		case 'S':
 			g.sector_size = strtol(optarg, &endp, 0);
 			if (*optarg == '\0' || *endp != '\0' ||